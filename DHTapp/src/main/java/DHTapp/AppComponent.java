@@ -74,6 +74,8 @@ public class AppComponent{
     /** Tiempo de refresco */
     private final long TIME_REFRESH = 3000l, TIME_DELETE = 3000l;
     private long Time_delete = 0;
+    /** Numero de secuencia de la ronda de descubrimiento en curso (nunca 0) */
+    private int Seq_round = 0;
     /** MAC Propia del protocolo */
     private final String MAC_GENERIC = "AA:BB:CC:DD:EE:FF";
     /** Opction code del protocolo */
@@ -227,6 +229,10 @@ public class AppComponent{
     /** @brief Función que inicia el proceso de exploración del protocolo */
     private void startDHTProcess() {
         while (true){
+            /** Nueva ronda: los switches descartan las copias repetidas de cada request */
+            Seq_round++;
+            if (Seq_round == 0)
+                Seq_round = 1;
             /** Se Genera un array de dispositivos descubierto por SDN*/
             Iterable<Device> devices = deviceService.getAvailableDevices(Device.Type.SWITCH);
             /** Reiniciamos los Estadisticos */
@@ -453,7 +459,7 @@ public class AppComponent{
                 "Id Device: "+id_mac_devices[0]);
 
         DHTpacket RequestPacket = new DHTpacket(Opcode, Num_devices, Type_devices,
-                outports, inports, id_mac_devices);
+                outports, inports, id_mac_devices, Seq_round);
 
         /** Creamos paquete y completamos los datos como pay load*/
         RequestPacket.setParent(packet);
@@ -45,13 +45,15 @@ public class DHTpacket extends BasePacket {
         static public final short DHT_MAX_ELEMENT = (short)31;
         /** @brief Tamaño maximo de un paquete (ojo que me lo devuelve en bit) */
         static public final short DHT_PACKET_SIZE =
-                ((2*Short.SIZE) + ((Short.SIZE + (2*Integer.SIZE) + Long.SIZE) * DHT_MAX_ELEMENT))/8;
+                ((2*Short.SIZE) + ((Short.SIZE + (2*Integer.SIZE) + Long.SIZE) * DHT_MAX_ELEMENT) + Integer.SIZE)/8;
 
         /** @brief Campos del paquete */
         private short Opcode;
         private short Num_devices, Type_devices[];
         private int outports[], inports[];
         private long id_mac_devices[];
+        /** @brief Ronda de descubrimiento, los switches descartan copias repetidas (0 = sin secuencia) */
+        private int Seq;
 
     /** Metodos de la clase */
 
@@ -69,16 +71,18 @@ public class DHTpacket extends BasePacket {
      * @param outports: Array con los puertos de salida
      * @param inports: Array con los puertos de entrada
      * @param id_mac_devices: Array con los ID de los dispositivos por los que pasa
+     * @param Seq: Numero de secuencia de la ronda de descubrimiento
      * @return objeto de la clase DHTpacket
      */
     public DHTpacket(short Opcode, short Num_devices, short Type_devices[],
-                     int outports[], int inports[], long id_mac_devices[]) {
+                     int outports[], int inports[], long id_mac_devices[], int Seq) {
         this.Opcode = Opcode;
         this.Num_devices = Num_devices;
         this.Type_devices = Type_devices;
         this.id_mac_devices = id_mac_devices;
         this.inports = inports;
         this.outports = outports;
+        this.Seq = Seq;
     }
     /**
      * @brief Obtiene el Option code del paquete
@@ -133,6 +137,15 @@ public class DHTpacket extends BasePacket {
     public long [] getidmacdevices() {
         return id_mac_devices;
     }
+
+    /**
+     * @brief Obtiene el numero de secuencia de la ronda de descubrimiento
+     *
+     * @return int Seq
+     */
+    public int getSeq() {
+        return Seq;
+    }
     /**
      * @brief Indica si un objeto es "igual que" este objeto, comparando todos sus elementos
      *
@@ -168,6 +181,9 @@ public class DHTpacket extends BasePacket {
         if (this.id_mac_devices != other.id_mac_devices) {
             return false;
         }
+        if (this.Seq != other.Seq) {
+            return false;
+        }
         return true;
     }
 
@@ -198,6 +214,9 @@ public class DHTpacket extends BasePacket {
         set_array_buffer(bb, inports, this.Num_devices);
         set_array_buffer(bb, outports, this.Num_devices);
 
+        /** Serializamos el numero de secuencia */
+        bb.putInt(this.Seq);
+
         /** Devolvemos los datos serializados */
         return data;
     }
@@ -223,6 +242,8 @@ public class DHTpacket extends BasePacket {
         this.id_mac_devices = get_array_buffer_long(bb);
         this.inports = get_array_buffer_int(bb);
         this.outports = get_array_buffer_int(bb);
+        /** Sacamos el numero de secuencia */
+        this.Seq = bb.getInt();
 
         return this;
     }
@@ -249,6 +270,7 @@ public class DHTpacket extends BasePacket {
             packet.id_mac_devices = get_array_buffer_long(bb);
             packet.inports = get_array_buffer_int(bb);
             packet.outports = get_array_buffer_int(bb);
+            packet.Seq = bb.getInt();
 
             return packet;
         };
@@ -263,6 +285,7 @@ public class DHTpacket extends BasePacket {
                 .add("Id Mac Devices", Arrays.toString(id_mac_devices))
                 .add("In Ports", Arrays.toString(inports))
                 .add("Out Ports", Arrays.toString(outports))
+                .add("Seq", String.valueOf(this.Seq))
                 .toString();
     }
 
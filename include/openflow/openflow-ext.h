@@ -24,6 +24,22 @@ enum ofp_extension_commands { /* Queue configuration commands */
     OFP_EXT_QUEUE_DELETE,  /* Remove a queue */
     OFP_EXT_SET_DESC,      /* Set ofp_desc_stat->dp_desc */
 
+    /* Bundle Commands */
+    OFP_EXT_BUNDLE_CONTROL,     /* Open, close, commit or discard a bundle */
+    OFP_EXT_BUNDLE_ADD_MESSAGE, /* Add a message to an open bundle */
+
+    /* Instrumentation Commands */
+    OFP_EXT_LATENCY_REQUEST,    /* Configure and/or read the latency
+                                   histograms */
+    OFP_EXT_LATENCY_REPLY,      /* Summary of the latency histograms */
+
+    /* HDDP Asynchronous Messages */
+    OFP_EXT_NEIGHBOR_STATUS,    /* Sensors attached to the switch changed */
+
+    /* HDDP Configuration Commands */
+    OFP_EXT_HDDP_CONFIG_REQUEST, /* Set and/or read the HDDP parameters */
+    OFP_EXT_HDDP_CONFIG_REPLY,   /* Current HDDP parameters */
+
     OFP_EXT_COUNT
 };
 
@@ -90,6 +106,249 @@ OFP_ASSERT(sizeof(struct openflow_ext_set_dp_desc) == 272);
 #define ofq_error_string(rv) (((rv) < OFQ_ERR_COUNT) && ((rv) >= 0) ? \
     openflow_queue_error_strings[rv] : "Unknown error code")
 
+/****************************************************************
+ *
+ * Bundles: a set of flow mods applied as a single transaction,
+ * modelled after the bundles of OpenFlow 1.4.
+ *
+ ****************************************************************/
+
+enum ofp_ext_bundle_ctrl_type {
+    OFPEBCT_OPEN_REQUEST    = 0,
+    OFPEBCT_OPEN_REPLY      = 1,
+    OFPEBCT_CLOSE_REQUEST   = 2,
+    OFPEBCT_CLOSE_REPLY     = 3,
+    OFPEBCT_COMMIT_REQUEST  = 4,
+    OFPEBCT_COMMIT_REPLY    = 5,
+    OFPEBCT_DISCARD_REQUEST = 6,
+    OFPEBCT_DISCARD_REPLY   = 7
+};
+
+enum ofp_ext_bundle_flags {
+    OFPEBF_ATOMIC  = 1 << 0,   /* Execute atomically. */
+    OFPEBF_ORDERED = 1 << 1    /* Execute in specified order. */
+};
+
+/* Bundle control message. */
+struct openflow_ext_bundle_ctrl {
+    struct ofp_extension_header header; /* OFP_EXT_BUNDLE_CONTROL */
+    uint32_t bundle_id;         /* Identify the bundle. */
+    uint16_t type;              /* OFPEBCT_* */
+    uint16_t flags;             /* Bitmap of OFPEBF_* flags. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_bundle_ctrl) == 24);
+
+/* Message added to a bundle. */
+struct openflow_ext_bundle_add_msg {
+    struct ofp_extension_header header; /* OFP_EXT_BUNDLE_ADD_MESSAGE */
+    uint32_t bundle_id;         /* Identify the bundle. */
+    uint16_t pad;               /* Align to 64 bits. */
+    uint16_t flags;             /* Bitmap of OFPEBF_* flags. */
+    struct ofp_header message;  /* Message added to the bundle, a flow mod.
+                                   Its xid is not used. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_bundle_add_msg) == 32);
+
+/* Error type of bundle failures, OFPET_BUNDLE_FAILED in OpenFlow 1.4. */
+#define OFPET_EXT_BUNDLE_FAILED 17
+
+/* ofp_error_msg 'code' values for OFPET_EXT_BUNDLE_FAILED. */
+enum ofp_ext_bundle_failed_code {
+    OFPEBFC_UNKNOWN        = 0,  /* Unspecified error. */
+    OFPEBFC_EPERM          = 1,  /* Permissions error. */
+    OFPEBFC_BAD_ID         = 2,  /* Bundle ID doesn't exist. */
+    OFPEBFC_BUNDLE_EXIST   = 3,  /* Bundle ID already exists. */
+    OFPEBFC_BUNDLE_CLOSED  = 4,  /* Bundle ID is closed. */
+    OFPEBFC_OUT_OF_BUNDLES = 5,  /* Too many bundles IDs. */
+    OFPEBFC_BAD_TYPE       = 6,  /* Unsupported or unknown message control
+                                    type. */
+    OFPEBFC_BAD_FLAGS      = 7,  /* Unsupported, unknown, or inconsistent
+                                    flags. */
+    OFPEBFC_MSG_BAD_LEN    = 8,  /* Length problem in included message. */
+    OFPEBFC_MSG_BAD_XID    = 9,  /* Inconsistent or duplicate XID. */
+    OFPEBFC_MSG_UNSUP      = 10, /* Unsupported message in this bundle. */
+    OFPEBFC_MSG_CONFLICT   = 11, /* Unsupported message combination in this
+                                    bundle. */
+    OFPEBFC_MSG_TOO_MANY   = 12, /* Cant handle this many messages in
+                                    bundle. */
+    OFPEBFC_MSG_FAILED     = 13  /* One message in bundle failed. */
+};
+
+/****************************************************************
+ *
+ * Latency histograms of the stages of the packet path.
+ *
+ ****************************************************************/
+
+/* Stages of the packet path. Stages nest: the time spent in a lookup is also
+ * counted in the pipeline stage, and a transmit done from an apply-actions
+ * instruction is also counted in the instructions stage. */
+enum ofp_ext_latency_stage {
+    OFPELS_RECEIVE      = 0,  /* Reading a packet from a port netdev. */
+    OFPELS_PARSE        = 1,  /* Parsing a packet into its match fields. */
+    OFPELS_PIPELINE     = 2,  /* A packet through the whole pipeline. */
+    OFPELS_HDDP         = 3,  /* Handling of hello and HDDP packets. */
+    OFPELS_LOOKUP       = 4,  /* A lookup in one flow table. */
+    OFPELS_INSTRUCTIONS = 5,  /* Instructions of one flow entry. */
+    OFPELS_GROUP        = 6,  /* Execution of a group. */
+    OFPELS_METER        = 7,  /* Application of a meter. */
+    OFPELS_TRANSMIT     = 8,  /* Writing a packet to a port netdev. */
+
+    OFPELS_COUNT
+};
+
+enum ofp_ext_latency_command {
+    OFPELC_GET     = 0,  /* Only read the histograms. */
+    OFPELC_ENABLE  = 1,  /* Start measuring. */
+    OFPELC_DISABLE = 2,  /* Stop measuring, the histograms are kept. */
+    OFPELC_RESET   = 3   /* Clear the histograms. */
+};
+
+/* Configures the measurements, then asks for a summary of the histograms.
+ * The switch always answers with an OFP_EXT_LATENCY_REPLY. */
+struct openflow_ext_latency_request {
+    struct ofp_extension_header header; /* OFP_EXT_LATENCY_REQUEST */
+    uint16_t command;           /* OFPELC_* */
+    uint8_t pad[6];             /* Align to 64 bits. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_latency_request) == 24);
+
+/* Summary of the latency histogram of one stage, in nanoseconds. Percentiles
+ * are accurate to within 1/16 of their value. */
+struct openflow_ext_latency_stage {
+    uint16_t stage;             /* OFPELS_* */
+    uint8_t pad[6];             /* Align to 64 bits. */
+    uint64_t count;             /* Number of samples. */
+    uint64_t min;
+    uint64_t max;
+    uint64_t mean;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t p999;
+};
+OFP_ASSERT(sizeof(struct openflow_ext_latency_stage) == 72);
+
+struct openflow_ext_latency_reply {
+    struct ofp_extension_header header; /* OFP_EXT_LATENCY_REPLY */
+    uint8_t enabled;            /* Whether measuring is on. */
+    uint8_t pad[7];             /* Align to 64 bits. */
+    struct openflow_ext_latency_stage stages[0];
+};
+OFP_ASSERT(sizeof(struct openflow_ext_latency_reply) == 24);
+
+/****************************************************************
+ *
+ * HDDP neighbor status: sent asynchronously, like OFPT_PORT_STATUS,
+ * when a sensor appears behind a port, moves to another port or its
+ * hellos time out. The events of one poll cycle share a message.
+ *
+ ****************************************************************/
+
+enum ofp_ext_neighbor_reason {
+    OFPENR_ADD    = 0,   /* A new sensor said hello. */
+    OFPENR_MODIFY = 1,   /* A sensor changed port or type. */
+    OFPENR_DELETE = 2    /* The hellos of a sensor timed out. */
+};
+
+struct openflow_ext_neighbor {
+    uint8_t mac[OFP_ETH_ALEN];  /* Address of the sensor. */
+    uint16_t type;              /* Type of sensor. */
+    uint32_t port_no;           /* Port the sensor is attached to. */
+    uint8_t reason;             /* OFPENR_* */
+    uint8_t pad[3];             /* Align to 32 bits. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_neighbor) == 16);
+
+struct openflow_ext_neighbor_status {
+    struct ofp_extension_header header; /* OFP_EXT_NEIGHBOR_STATUS */
+    struct openflow_ext_neighbor neighbors[0];
+};
+OFP_ASSERT(sizeof(struct openflow_ext_neighbor_status) == 16);
+
+/****************************************************************
+ *
+ * HDDP configuration: timers and role of the switch in the discovery.
+ *
+ ****************************************************************/
+
+/* Role of the switch in the discovery. */
+enum ofp_ext_hddp_role {
+    OFPEHR_AUTO    = 0,  /* From the datapath id: sensor from 0x1000,
+                            gateway below 0x100, switch otherwise. */
+    OFPEHR_SWITCH  = 1,  /* Non-SDN switch. */
+    OFPEHR_GATEWAY = 2,  /* Switch that tracks the sensors saying hello. */
+    OFPEHR_SENSOR  = 3   /* Sensor, sends hellos to its gateway. */
+};
+
+/* Fields of openflow_ext_hddp_config set by a request. */
+enum ofp_ext_hddp_config_field {
+    OFPEHC_HELLO_INTERVAL   = 1 << 0,
+    OFPEHC_HELLO_LIFETIME   = 1 << 1,
+    OFPEHC_BT_LIFETIME      = 1 << 2,
+    OFPEHC_NEIGHBOR_SWEEP   = 1 << 3,
+    OFPEHC_BT_SWEEP         = 1 << 4,
+    OFPEHC_SENSOR_TYPE      = 1 << 5,
+    OFPEHC_ROLE             = 1 << 6,
+    OFPEHC_SENSOR_TO_SENSOR = 1 << 7
+};
+
+/* Sets the fields in 'fields' and replies with all of them; a request with
+ * no fields only reads the configuration. Times are in milliseconds. */
+struct openflow_ext_hddp_config {
+    struct ofp_extension_header header; /* OFP_EXT_HDDP_CONFIG_REQUEST or
+                                           OFP_EXT_HDDP_CONFIG_REPLY */
+    uint32_t fields;            /* Bitmap of OFPEHC_*, all in a reply. */
+    uint32_t hello_interval;    /* Between hellos of a sensor. */
+    uint32_t hello_lifetime;    /* Of a sensor in the neighbor table. */
+    uint32_t bt_lifetime;       /* Of a controller in the blocking table. */
+    uint32_t neighbor_sweep;    /* Between removals of expired neighbors. */
+    uint32_t bt_sweep;          /* Between removals of expired blockings. */
+    uint16_t sensor_type;       /* Type announced by a sensor. */
+    uint8_t role;               /* OFPEHR_* */
+    uint8_t sensor_to_sensor;   /* Whether sensors discover each other. */
+    uint8_t pad[4];             /* Align to 64 bits. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_hddp_config) == 48);
+
+/****************************************************************
+ *
+ * Experimenter multipart messages. The body of the request and of the
+ * reply starts with an ofp_experimenter_multipart_header, with
+ * OPENFLOW_VENDOR_ID and one of the types below.
+ *
+ ****************************************************************/
+
+enum ofp_ext_multipart_types {
+    OFPEMP_HDDP = 0   /* Counters of the HDDP discovery.
+                         The request body is empty.
+                         The reply body is struct openflow_ext_hddp_stats. */
+};
+
+/* Body of reply to OFPEMP_HDDP request. Times are in milliseconds. */
+struct openflow_ext_hddp_stats {
+    uint64_t requests_rx;       /* Discovery requests received. */
+    uint64_t requests_fwd;      /* Requests flooded to the next switches. */
+    uint64_t requests_answered; /* Requests answered with replies. */
+    uint64_t requests_dup;      /* Copies of a request already handled. */
+    uint64_t replies_tx;        /* Replies originated by this switch. */
+    uint64_t replies_relayed;   /* Replies forwarded towards the controller. */
+    uint64_t replies_dropped;   /* Replies with no valid output port. */
+    uint64_t replies_overflow;  /* Replies with no room left for this switch. */
+    uint64_t replies_suppressed;/* Replies not sent in delta mode, unchanged. */
+    uint64_t hellos_rx;         /* Hello packets received from sensors. */
+    uint64_t neighbor_expired;  /* Entries expired from the neighbor table. */
+    uint64_t bt_expired;        /* Entries expired from the blocking table. */
+    uint32_t neighbor_entries;  /* Entries in the neighbor table. */
+    uint32_t bt_entries;        /* Entries in the blocking table. */
+    uint64_t rounds;            /* Discovery rounds seen by this switch. */
+    uint32_t round_last;        /* Duration of the last round. */
+    uint32_t round_max;         /* Longest round. */
+    uint32_t round_mean;        /* Mean duration of the finished rounds. */
+    uint8_t pad[4];             /* Align to 64 bits. */
+};
+OFP_ASSERT(sizeof(struct openflow_ext_hddp_stats) == 128);
+
 /****************************************************************
  *
  * Unsupported, but potential extended queue properties
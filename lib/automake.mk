@@ -94,6 +94,7 @@ lib_libopenflow_a_LIBADD = oflib/ofl-actions.o \
                            oflib/ofl-actions-pack.o \
                            oflib/ofl-actions-print.o \
                            oflib/ofl-actions-unpack.o \
+                           oflib/ofl-arena.o \
                            oflib/ofl-messages.o \
                            oflib/ofl-messages-pack.o \
                            oflib/ofl-messages-print.o \
@@ -931,7 +931,7 @@ do_receive_msg(struct dhclient *cli, struct dhcp_msg *msg)
         int error;
 
         ofpbuf_clear(&b);
-        error = netdev_recv(cli->netdev, &b, 0);
+        error = netdev_recv(cli->netdev, &b);
         if (error) {
             goto drained;
         }
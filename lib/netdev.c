@@ -71,9 +71,12 @@
 #include <fcntl.h>
 #include <arpa/inet.h>
 #include <inttypes.h>
+#include <linux/pkt_sched.h>
 #include <linux/rtnetlink.h>
 #include <linux/if_tun.h>
 #include <linux/if_packet.h>
+#include <linux/virtio_net.h>
+#include <sys/uio.h>
 
 
 #ifdef PACKET_AUXDATA
@@ -111,6 +114,7 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "csum.h"
 #include "fatal-signal.h"
 #include "list.h"
 #include "netlink.h"
@@ -129,6 +133,11 @@
 #define IFF_LOWER_UP 0x10000
 #endif
 
+/* Multiqueue tap devices came with Linux 3.8. */
+#ifndef IFF_MULTI_QUEUE
+#define IFF_MULTI_QUEUE 0x0100
+#endif
+
 #define LOG_MODULE VLM_netdev
 #include "vlog.h"
 
@@ -142,12 +151,21 @@ struct netdev {
     int tap_fd;                 /* TAP character device, if any, otherwise the
                                  * network device. */
 
-    int netlink_fd;
-
     /* one socket per queue.These are valid only for ordinary network devices*/
     int queue_fd[NETDEV_MAX_QUEUES + 1];
     uint16_t num_queues;
 
+    /* File descriptors frames are received from: the queues of a multiqueue
+     * tap device, tap_fd being the first, or just tap_fd.  They are read in
+     * turn, starting from 'next_rx_fd'. */
+    int rx_fds[NETDEV_MAX_TAP_QUEUES];
+    int n_rx_fds;
+    int next_rx_fd;
+
+    /* Frames go through tap_fd and the queue sockets after a virtio net
+     * header, which carries their checksum and segmentation offloads. */
+    bool vnet_hdr;
+
     /* Cached network device information. */
     int ifindex;
     uint8_t etheraddr[ETH_ADDR_LEN];
@@ -178,6 +196,9 @@ static int af_inet_sock = -1;
  * additional log messages. */
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(5, 20);
 
+/* Queues opened on each new tap device, see netdev_set_tap_queues(). */
+static int n_tap_queues = 1;
+
 static void init_netdev(void);
 static int do_open_netdev(const char *name, int ethertype, int tap_fd,
                           struct netdev **netdev_);
@@ -223,7 +244,6 @@ get_ipv6_address(const char *name, struct in6_addr *in6)
     fclose(file);
 }
 
-#define TC_QDISC_NO_CONFIG_ERR 512
 /* All queues in a port, lie beneath a qdisc */
 #define TC_QDISC 0x0001
 /* This is a root class. In order to efficiently share excess bandwidth
@@ -234,37 +254,182 @@ get_ipv6_address(const char *name, struct in6_addr *in6)
  * without any bandwidth guarantees */
 #define TC_DEFAULT_CLASS 0xfffe
 #define TC_MIN_RATE 1
-/* This configures an HTB qdisc under the defined device. */
-#define COMMAND_ADD_DEV_QDISC "/sbin/tc qdisc add dev %s " \
-                              "root handle %x: htb default %x"
-#define COMMAND_DEL_DEV_QDISC "/sbin/tc qdisc del dev %s root"
-#define COMMAND_ADD_CLASS "/sbin/tc class add dev %s parent %x:%x " \
-                          "classid %x:%x htb rate %dkbit ceil %dkbit"
-#define COMMAND_CHANGE_CLASS "/sbin/tc class change dev %s parent %x:%x " \
-                             "classid %x:%x htb rate %dkbit ceil %dkbit"
-#define COMMAND_DEL_CLASS "/sbin/tc class del dev %s parent %x:%x classid %x:%x"
+
+/* Queues are configured with rtnetlink requests over this socket, which is
+ * opened the first time a device is set up for slicing. */
+static struct nl_sock *rtnl_sock;
+
+/* Ticks per second of the kernel packet scheduler clock and frequency of the
+ * scheduler timer, read from /proc/net/psched.  Rate tables and HTB buffers
+ * are expressed in those units. */
+static double tc_ticks_per_s;
+static unsigned int tc_buffer_hz;
 
 static int
-netdev_setup_root_class(const struct netdev *netdev, uint16_t class_id,
-                        uint16_t rate)
+tc_init(void)
 {
-    char command[1024];
-    int actual_rate;
+    unsigned int a, b, c, d;
+    FILE *stream;
+    int error;
 
-    /* we need to translate from .1% to kbps */
-    actual_rate = rate*netdev->speed;
+    if (rtnl_sock != NULL) {
+        return 0;
+    }
 
-    snprintf(command, sizeof(command), COMMAND_ADD_CLASS, netdev->name,
-             TC_QDISC,0,TC_QDISC, class_id, actual_rate, netdev->speed*1000);
-    if (system(command) != 0) {
-        VLOG_ERR(LOG_MODULE, "Problem configuring root class %d for device %s",
-                 class_id, netdev->name);
-        return -1;
+    error = nl_sock_create(NETLINK_ROUTE, 0, 0, 0, &rtnl_sock);
+    if (error) {
+        VLOG_ERR(LOG_MODULE, "could not create rtnetlink socket: %s",
+                 strerror(error));
+        return error;
     }
 
+    /* Defaults of a kernel with high resolution timers. */
+    tc_ticks_per_s = 1000.0 * 1000000 / 64;
+    tc_buffer_hz = 1000000000;
+    stream = fopen("/proc/net/psched", "r");
+    if (stream == NULL) {
+        VLOG_WARN(LOG_MODULE, "could not open /proc/net/psched: %s",
+                  strerror(errno));
+        return 0;
+    }
+    if (fscanf(stream, "%x %x %x %x", &a, &b, &c, &d) == 4 && a && b && c) {
+        tc_ticks_per_s = (double) a * c / b;
+        tc_buffer_hz = c == 1000000 ? d : c;
+    } else {
+        VLOG_WARN(LOG_MODULE, "could not parse /proc/net/psched");
+    }
+    fclose(stream);
     return 0;
 }
 
+/* Returns a new rtnetlink request of the given 'type' for 'netdev', with its
+ * tcmsg stored in '*tcmsgp' for the caller to fill in. */
+static struct ofpbuf *
+tc_make_request(const struct netdev *netdev, int type, unsigned int flags,
+                struct tcmsg **tcmsgp)
+{
+    struct ofpbuf *request = ofpbuf_new(512);
+    struct tcmsg *tcmsg;
+
+    nl_msg_put_nlmsghdr(request, rtnl_sock, sizeof *tcmsg, type,
+                        NLM_F_REQUEST | flags);
+    tcmsg = ofpbuf_put_zeros(request, sizeof *tcmsg);
+    tcmsg->tcm_family = AF_UNSPEC;
+    tcmsg->tcm_ifindex = netdev->ifindex;
+    *tcmsgp = tcmsg;
+    return request;
+}
+
+/* Sends 'request' to the kernel and waits for its acknowledgement.  Frees
+ * 'request' and returns 0 or a positive errno value. */
+static int
+tc_transact(struct ofpbuf *request)
+{
+    struct ofpbuf *reply;
+    int error;
+
+    error = nl_sock_transact(rtnl_sock, request, &reply);
+    ofpbuf_delete(request);
+    ofpbuf_delete(reply);
+    return error;
+}
+
+static uint32_t
+tc_bytes_to_ticks(uint32_t Bps, uint32_t size)
+{
+    return Bps ? tc_ticks_per_s * size / Bps : 0;
+}
+
+/* Fills 'spec' for a rate of 'Bps' bytes per second on a device whose
+ * packets are at most 'mtu' bytes long, the same way tc(8) does. */
+static void
+tc_fill_rate(struct tc_ratespec *spec, uint64_t Bps, int mtu)
+{
+    unsigned int size = mtu + ETH_HEADER_LEN + VLAN_HEADER_LEN;
+
+    memset(spec, 0, sizeof *spec);
+    for (spec->cell_log = 0; size >= 256; spec->cell_log++) {
+        size >>= 1;
+    }
+    spec->mpu = ETH_TOTAL_MIN;
+    spec->rate = MIN(Bps, UINT32_MAX);
+}
+
+/* Appends to 'request' an attribute of the given 'type' with the time it
+ * takes to send packets of every size at the rate in 'spec', which kernels
+ * without their own rate computation still require. */
+static void
+tc_put_rtab(struct ofpbuf *request, uint16_t type,
+            const struct tc_ratespec *spec)
+{
+    uint32_t *rtab;
+    unsigned int i;
+
+    rtab = nl_msg_put_unspec_uninit(request, type, TC_RTAB_SIZE);
+    for (i = 0; i < TC_RTAB_SIZE / sizeof *rtab; i++) {
+        uint32_t size = (i + 1) << spec->cell_log;
+        rtab[i] = tc_bytes_to_ticks(spec->rate, MAX(size, spec->mpu));
+    }
+}
+
+/* Sends a request to create ('flags' of NLM_F_CREATE | NLM_F_EXCL) or change
+ * ('flags' of 0) the HTB class 'class_id' under the class 'parent_id', which
+ * is guaranteed 'rate' tenths of a percent of the speed of 'netdev' and may
+ * borrow up to all of it. */
+static int
+tc_setup_class(const struct netdev *netdev, uint16_t parent_id,
+               uint16_t class_id, uint16_t rate, unsigned int flags)
+{
+    struct ofpbuf *request;
+    struct tcmsg *tcmsg;
+    struct tc_htb_opt opt;
+    size_t opt_offset;
+    int mtu = netdev->mtu ? netdev->mtu : ETH_PAYLOAD_MAX;
+    int error;
+
+    error = tc_init();
+    if (error) {
+        return error;
+    }
+
+    /* we need to translate from .1% of the speed in Mbps to bytes/s */
+    memset(&opt, 0, sizeof opt);
+    tc_fill_rate(&opt.rate, (uint64_t) rate * netdev->speed * 125, mtu);
+    tc_fill_rate(&opt.ceil, (uint64_t) netdev->speed * 125000, mtu);
+    opt.buffer = tc_bytes_to_ticks(opt.rate.rate,
+                                   opt.rate.rate / tc_buffer_hz + mtu);
+    opt.cbuffer = tc_bytes_to_ticks(opt.ceil.rate,
+                                    opt.ceil.rate / tc_buffer_hz + mtu);
+
+    request = tc_make_request(netdev, RTM_NEWTCLASS, flags, &tcmsg);
+    tcmsg->tcm_handle = TC_H_MAKE(TC_QDISC << 16, class_id);
+    tcmsg->tcm_parent = TC_H_MAKE(TC_QDISC << 16, parent_id);
+    nl_msg_put_string(request, TCA_KIND, "htb");
+    opt_offset = nl_msg_start_nested(request, TCA_OPTIONS);
+    nl_msg_put_unspec(request, TCA_HTB_PARMS, &opt, sizeof opt);
+    tc_put_rtab(request, TCA_HTB_RTAB, &opt.rate);
+    tc_put_rtab(request, TCA_HTB_CTAB, &opt.ceil);
+    nl_msg_end_nested(request, opt_offset);
+
+    return tc_transact(request);
+}
+
+static int
+netdev_setup_root_class(const struct netdev *netdev, uint16_t class_id,
+                        uint16_t rate)
+{
+    int error;
+
+    error = tc_setup_class(netdev, 0, class_id, rate,
+                           NLM_F_CREATE | NLM_F_EXCL);
+    if (error) {
+        VLOG_ERR(LOG_MODULE, "Problem configuring root class %d for device %s: %s",
+                 class_id, netdev->name, strerror(error));
+    }
+
+    return error;
+}
+
 /** Defines a class for the specific queue discipline. A class
  * represents an OpenFlow queue.
  *
@@ -272,30 +437,24 @@ netdev_setup_root_class(const struct netdev *netdev, uint16_t class_id,
  * @param class_id unique identifier for this queue. TC limits this to 16-bits,
  * so we need to keep an internal mapping between class_id and OpenFlow
  * queue_id
- * @param rate the minimum rate for this queue in kbps
- * @return 0 on success, non-zero value when the configuration was not
+ * @param rate the minimum rate for this queue in .1% of the link speed
+ * @return 0 on success, a positive errno value when the configuration was not
  * successful.
  */
 int
 netdev_setup_class(const struct netdev *netdev, uint16_t class_id,
                    uint16_t rate)
 {
-    char command[1024];
-    int actual_rate;
-
-    /* we need to translate from .1% to kbps */
-    actual_rate = rate*netdev->speed;
+    int error;
 
-    snprintf(command, sizeof(command), COMMAND_ADD_CLASS, netdev->name,
-             TC_QDISC, TC_ROOT_CLASS, TC_QDISC, class_id, actual_rate,
-             netdev->speed*1000);
-    if (system(command) != 0) {
-        VLOG_ERR(LOG_MODULE, "Problem configuring class %d for device %s",class_id,
-                 netdev->name);
-        return -1;
+    error = tc_setup_class(netdev, TC_ROOT_CLASS, class_id, rate,
+                           NLM_F_CREATE | NLM_F_EXCL);
+    if (error) {
+        VLOG_ERR(LOG_MODULE, "Problem configuring class %d for device %s: %s",
+                 class_id, netdev->name, strerror(error));
     }
 
-    return 0;
+    return error;
 }
 
 /** Changes a class already defined.
@@ -304,57 +463,58 @@ netdev_setup_class(const struct netdev *netdev, uint16_t class_id,
  * @param class_id unique identifier for this queue. TC limits this to 16-bits,
  * so we need to keep an internal mapping between class_id and OpenFlow
  * queue_id
- * @param rate the minimum rate for this queue in kbps
- * @return 0 on success, non-zero value when the configuration was not
+ * @param rate the minimum rate for this queue in .1% of the link speed
+ * @return 0 on success, a positive errno value when the configuration was not
  * successful.
  */
 int
 netdev_change_class(const struct netdev *netdev, uint16_t class_id, uint16_t rate)
 {
-    char command[1024];
-    int actual_rate;
-
-    /* we need to translate from .1% to kbps */
-    actual_rate = rate*netdev->speed;
+    int error;
 
-    snprintf(command, sizeof(command), COMMAND_CHANGE_CLASS, netdev->name,
-             TC_QDISC, TC_ROOT_CLASS, TC_QDISC, class_id, actual_rate,
-             netdev->speed*1000 );
-    if (system(command) != 0) {
-        VLOG_ERR(LOG_MODULE, "Problem configuring class %d for device %s",
-                 class_id, netdev->name);
-        return -1;
+    error = tc_setup_class(netdev, TC_ROOT_CLASS, class_id, rate, 0);
+    if (error) {
+        VLOG_ERR(LOG_MODULE, "Problem configuring class %d for device %s: %s",
+                 class_id, netdev->name, strerror(error));
     }
 
-    return 0;
+    return error;
 }
 
 /** Deletes a class already defined to represent an OpenFlow queue.
  *
  * @param netdev the device under configuration
  * @param class_id unique identifier for this queue.
- * @param rate the minimum rate for this queue in kbps
- * @return 0 on success, non-zero value when the configuration was not
+ * @return 0 on success, a positive errno value when the configuration was not
  * successful.
  */
 int
 netdev_delete_class(const struct netdev *netdev, uint16_t class_id)
 {
-    char command[1024];
+    struct ofpbuf *request;
+    struct tcmsg *tcmsg;
+    int error;
 
-    snprintf(command, sizeof(command), COMMAND_DEL_CLASS, netdev->name,
-             TC_QDISC, TC_ROOT_CLASS, TC_QDISC, class_id);
-    if (system(command) != 0) {
-        VLOG_ERR(LOG_MODULE, "Problem deleting class %d for device %s",class_id,
-                 netdev->name);
-        return -1;
+    error = tc_init();
+    if (error) {
+        return error;
     }
 
-    return 0;
+    request = tc_make_request(netdev, RTM_DELTCLASS, 0, &tcmsg);
+    tcmsg->tcm_handle = TC_H_MAKE(TC_QDISC << 16, class_id);
+    tcmsg->tcm_parent = TC_H_MAKE(TC_QDISC << 16, TC_ROOT_CLASS);
+    error = tc_transact(request);
+    if (error) {
+        VLOG_ERR(LOG_MODULE, "Problem deleting class %d for device %s: %s",
+                 class_id, netdev->name, strerror(error));
+    }
+
+    return error;
 }
 
 static int
-open_queue_socket(const char * name, uint16_t class_id, int * fd)
+open_queue_socket(const char * name, uint16_t class_id, bool vnet_hdr,
+                  int * fd)
 {
     int error;
     struct ifreq ifr;
@@ -372,6 +532,17 @@ open_queue_socket(const char * name, uint16_t class_id, int * fd)
         goto error_already_set;
     }
 
+    /* Frames are written the same way as on the default queue. */
+    if (vnet_hdr) {
+        int val = 1;
+        if (setsockopt(*fd, SOL_PACKET, PACKET_VNET_HDR, &val,
+                       sizeof val) < 0) {
+            VLOG_ERR(LOG_MODULE, "setsockopt(PACKET_VNET_HDR) on %s failed: "
+                     "%s", name, strerror(errno));
+            goto error;
+        }
+    }
+
     /* Get ethernet device index. */
     strncpy(ifr.ifr_name, name, sizeof ifr.ifr_name);
     if (ioctl(*fd, SIOCGIFINDEX, &ifr) < 0) {
@@ -425,43 +596,61 @@ open_queue_socket(const char * name, uint16_t class_id, int * fd)
  * http://luxik.cdi.cz/~devik/qos/htb/
  * http://luxik.cdi.cz/~devik/qos/htb/manual/userg.htm
  *
- * @param netdev_name the device to be configured
+ * @param netdev the device to be configured
  * @return 0 on success, non-zero value when the configuration was not
  * successful.
  */
 static int
-do_setup_qdisc(const char *netdev_name)
+do_setup_qdisc(const struct netdev *netdev)
 {
-    char command[1024];
+    struct ofpbuf *request;
+    struct tcmsg *tcmsg;
+    struct tc_htb_glob glob;
+    size_t opt_offset;
     int error;
 
-    snprintf(command, sizeof(command), COMMAND_ADD_DEV_QDISC, netdev_name,
-             TC_QDISC, TC_DEFAULT_CLASS);
-    error = system(command);
+    memset(&glob, 0, sizeof glob);
+    glob.version = 3;
+    glob.rate2quantum = 10;
+    glob.defcls = TC_DEFAULT_CLASS;
+
+    request = tc_make_request(netdev, RTM_NEWQDISC, NLM_F_CREATE | NLM_F_EXCL,
+                              &tcmsg);
+    tcmsg->tcm_handle = TC_H_MAKE(TC_QDISC << 16, 0);
+    tcmsg->tcm_parent = TC_H_ROOT;
+    nl_msg_put_string(request, TCA_KIND, "htb");
+    opt_offset = nl_msg_start_nested(request, TCA_OPTIONS);
+    nl_msg_put_unspec(request, TCA_HTB_INIT, &glob, sizeof glob);
+    nl_msg_end_nested(request, opt_offset);
+
+    error = tc_transact(request);
     if (error) {
-        VLOG_WARN(LOG_MODULE, "Problem configuring qdisc for device %s",netdev_name);
-        fprintf(stderr, "Error is %d\n", error);
-	return error;
+        VLOG_WARN(LOG_MODULE, "Problem configuring qdisc for device %s: %s",
+                  netdev->name, strerror(error));
     }
-    return 0;
+    return error;
 }
 
 /** Remove current queue disciplines from a net device
- * @param netdev_name the device under configuration
+ * @param netdev the device under configuration
  */
 static int
-do_remove_qdisc(const char *netdev_name)
+do_remove_qdisc(const struct netdev *netdev)
 {
-    char command[1024];
+    struct ofpbuf *request;
+    struct tcmsg *tcmsg;
     int error;
-    snprintf(command, sizeof(command), COMMAND_DEL_DEV_QDISC, netdev_name);
-    error = system(command);
-    if (error && error != TC_QDISC_NO_CONFIG_ERR) {
-        VLOG_WARN(LOG_MODULE, "Problem configuring qdisc for device %s ",netdev_name);
-        return error;
-    }
+
+    request = tc_make_request(netdev, RTM_DELQDISC, 0, &tcmsg);
+    tcmsg->tcm_parent = TC_H_ROOT;
+    error = tc_transact(request);
     /* There is no need for a device to already be configured. Therefore no
      * need to indicate any error */
+    if (error && error != ENOENT && error != EINVAL) {
+        VLOG_WARN(LOG_MODULE, "Problem configuring qdisc for device %s: %s",
+                  netdev->name, strerror(error));
+        return error;
+    }
     return 0;
 }
 
@@ -480,14 +669,19 @@ netdev_setup_slicing(struct netdev *netdev, uint16_t num_queues)
 
     netdev->num_queues = num_queues;
 
+    error = tc_init();
+    if (error) {
+        return error;
+    }
+
     /* remove any previous queue configuration for this device */
-    error = do_remove_qdisc(netdev->name);
+    error = do_remove_qdisc(netdev);
     if (error) {
         return error;
     }
 
     /* Configure tc queue discipline to allow slicing queues */
-    error = do_setup_qdisc(netdev->name);
+    error = do_setup_qdisc(netdev);
     if (error) {
         return error;
     }
@@ -521,7 +715,7 @@ netdev_setup_slicing(struct netdev *netdev, uint16_t num_queues)
 
     for (i=1; i <= netdev->num_queues; i++) {
         fd = &netdev->queue_fd[i];
-        error = open_queue_socket(netdev->name,i,fd);
+        error = open_queue_socket(netdev->name, i, netdev->vnet_hdr, fd);
         if (error) {
             return error;
         }
@@ -678,50 +872,113 @@ netdev_open(const char *name, int ethertype, struct netdev **netdevp)
     }
 }
 
+/* Sets to 'n' the number of queues opened on each tap device from now on.
+ * With more than one, the device is a multiqueue one: the kernel spreads the
+ * flows it sends over the queues, which netdev_recv() reads in turn. */
+void
+netdev_set_tap_queues(int n)
+{
+    n_tap_queues = MAX(1, MIN(n, NETDEV_MAX_TAP_QUEUES));
+}
+
+/* Opens a queue of the tap device that 'ifr' describes.  Returns zero and
+ * stores its file descriptor in '*fdp' if successful, otherwise returns a
+ * positive errno value. */
+static int
+open_tap_queue(struct ifreq *ifr, int *fdp)
+{
+    static const char tap_dev[] = "/dev/net/tun";
+    int error;
+    int fd;
+
+    fd = open(tap_dev, O_RDWR);
+    if (fd < 0) {
+        return errno;
+    }
+    if (ioctl(fd, TUNSETIFF, ifr) < 0) {
+        error = errno;
+        close(fd);
+        return error;
+    }
+    error = set_nonblocking(fd);
+    if (error) {
+        close(fd);
+        return error;
+    }
+    *fdp = fd;
+    return 0;
+}
+
 /* Opens a TAP virtual network device.  If 'name' is a nonnull, non-empty
  * string, attempts to assign that name to the TAP device (failing if the name
  * is already in use); otherwise, a name is automatically assigned.  Returns
  * zero if successful, otherwise a positive errno value.  On success, sets
- * '*netdevp' to the new network device, otherwise to null.  */
+ * '*netdevp' to the new network device, otherwise to null.
+ *
+ * Frames are exchanged with the kernel along with their checksum and
+ * segmentation offloads, so that the large segments of a TCP connection are
+ * not split before they have to.  Kernels without virtio net headers get a
+ * plain device. */
 int
 netdev_open_tap(const char *name, struct netdev **netdevp)
 {
     static const char tap_dev[] = "/dev/net/tun";
+    struct netdev *netdev;
     struct ifreq ifr;
+    unsigned int offloads;
     int error;
     int tap_fd;
-
-    tap_fd = open(tap_dev, O_RDWR);
-    if (tap_fd < 0) {
-        ofp_error(errno, "opening \"%s\" failed", tap_dev);
-        return errno;
-    }
+    int i;
 
     memset(&ifr, 0, sizeof ifr);
-    ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+    ifr.ifr_flags = IFF_TAP | IFF_NO_PI | IFF_VNET_HDR;
+    if (n_tap_queues > 1) {
+        ifr.ifr_flags |= IFF_MULTI_QUEUE;
+    }
     if (name) {
         strncpy(ifr.ifr_name, name, sizeof ifr.ifr_name);
     }
-    if (ioctl(tap_fd, TUNSETIFF, &ifr) < 0) {
-        int error = errno;
-        ofp_error(error, "ioctl(TUNSETIFF) on \"%s\" failed", tap_dev);
-        close(tap_fd);
-        return error;
+    error = open_tap_queue(&ifr, &tap_fd);
+    if (error == EINVAL) {
+        VLOG_WARN(LOG_MODULE, "opening \"%s\" again without offloads or "
+                  "queues", tap_dev);
+        ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+        error = open_tap_queue(&ifr, &tap_fd);
     }
-
-    error = set_nonblocking(tap_fd);
     if (error) {
-        ofp_error(error, "set_nonblocking on \"%s\" failed", tap_dev);
-        close(tap_fd);
+        ofp_error(error, "opening tap device on \"%s\" failed", tap_dev);
         return error;
     }
 
+    /* The kernel may hand over frames with their checksum still to be done
+     * and TCP segments of up to 64 kB. */
+    offloads = TUN_F_CSUM | TUN_F_TSO4 | TUN_F_TSO6 | TUN_F_TSO_ECN;
+    if (ifr.ifr_flags & IFF_VNET_HDR
+        && ioctl(tap_fd, TUNSETOFFLOAD, offloads) < 0) {
+        VLOG_WARN(LOG_MODULE, "ioctl(TUNSETOFFLOAD) on %s failed: %s",
+                  ifr.ifr_name, strerror(errno));
+    }
+
     error = do_open_netdev(ifr.ifr_name, NETDEV_ETH_TYPE_NONE, tap_fd,
                            netdevp);
     if (error) {
-        close(tap_fd);
+        return error;
     }
-    return error;
+    netdev = *netdevp;
+    netdev->vnet_hdr = (ifr.ifr_flags & IFF_VNET_HDR) != 0;
+
+    for (i = 1; i < n_tap_queues && ifr.ifr_flags & IFF_MULTI_QUEUE; i++) {
+        int fd;
+
+        error = open_tap_queue(&ifr, &fd);
+        if (error) {
+            VLOG_WARN(LOG_MODULE, "%s has %d queues instead of %d: %s",
+                      ifr.ifr_name, i, n_tap_queues, strerror(error));
+            break;
+        }
+        netdev->rx_fds[netdev->n_rx_fds++] = fd;
+    }
+    return 0;
 }
 
 static int
@@ -729,9 +986,7 @@ do_open_netdev(const char *name, int ethertype, int tap_fd,
                struct netdev **netdev_)
 {
     int netdev_fd;
-    int netlink_fd;
     struct sockaddr_ll sll;
-    struct sockaddr_nl snl;
     struct ifreq ifr;
     unsigned int ifindex;
     uint8_t etheraddr[ETH_ADDR_LEN];
@@ -741,23 +996,12 @@ do_open_netdev(const char *name, int ethertype, int tap_fd,
     int hwaddr_family;
     int error;
     struct netdev *netdev;
+    bool vnet_hdr;
     uint32_t val;
     init_netdev();
     *netdev_ = NULL;
     netdev_fd = -1;
 
-    netlink_fd = socket(PF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
-
-    if (netlink_fd < 0) {
-        return errno;
-    }
-
-    /* Set non-blocking mode. */
-    error = set_nonblocking(netlink_fd);
-    if (error) {
-        goto error_already_set;
-    }
-
     /* Create raw socket. */
     netdev_fd = socket(PF_PACKET, SOCK_RAW,
                        htons(ethertype == NETDEV_ETH_TYPE_NONE ? 0
@@ -782,14 +1026,6 @@ do_open_netdev(const char *name, int ethertype, int tap_fd,
         goto error_already_set;
     }
 
-    memset (&snl,0,sizeof(snl));
-    snl.nl_family = AF_NETLINK;
-    snl.nl_groups =  RTMGRP_LINK;
-
-    if (bind(netlink_fd, (struct sockaddr *)&snl, sizeof(snl)) < 0){
-        VLOG_ERR(LOG_MODULE, "netlink bind to %s failed: %s", name, strerror(errno));
-        goto error;
-    }
     /* Get ethernet device index. */
     strncpy(ifr.ifr_name, name, sizeof ifr.ifr_name);
     if (ioctl(netdev_fd, SIOCGIFINDEX, &ifr) < 0) {
@@ -808,6 +1044,15 @@ do_open_netdev(const char *name, int ethertype, int tap_fd,
         goto error;
     }
 
+    /* Frames of ordinary devices come and go with a virtio net header too,
+     * so that those the kernel segments or checksums for us pass as such. */
+    vnet_hdr = false;
+    if (tap_fd < 0) {
+        val = 1;
+        vnet_hdr = !setsockopt(netdev_fd, SOL_PACKET, PACKET_VNET_HDR, &val,
+                               sizeof val);
+    }
+
     if (ethertype != NETDEV_ETH_TYPE_NONE) {
         /* Between the socket() and bind() calls above, the socket receives all
          * packets of the requested type on all system interfaces.  We do not
@@ -857,9 +1102,12 @@ do_open_netdev(const char *name, int ethertype, int tap_fd,
     netdev->txqlen = txqlen;
     netdev->hwaddr_family = hwaddr_family;
     netdev->netdev_fd = netdev_fd;
-    netdev->netlink_fd = netlink_fd;
     netdev->tap_fd = tap_fd < 0 ? netdev_fd : tap_fd;
     netdev->queue_fd[0] = netdev->tap_fd;
+    netdev->rx_fds[0] = netdev->tap_fd;
+    netdev->n_rx_fds = 1;
+    netdev->next_rx_fd = 0;
+    netdev->vnet_hdr = vnet_hdr;
     memcpy(netdev->etheraddr, etheraddr, sizeof etheraddr);
     netdev->mtu = mtu;
     netdev->in6 = in6;
@@ -917,6 +1165,9 @@ netdev_close(struct netdev *netdev)
         if (netdev->netdev_fd != netdev->tap_fd) {
             close(netdev->tap_fd);
         }
+        for (i = 1; i < netdev->n_rx_fds; i++) {
+            close(netdev->rx_fds[i]);
+        }
 
         for (i =1; i <= netdev->num_queues; i++) {
             close(netdev->queue_fd[i]);
@@ -935,46 +1186,81 @@ pad_to_minimum_length(struct ofpbuf *buffer)
     }
 }
 
-int
-netdev_link_state(struct netdev *netdev)
-{
-     int len;
-     char buff[4096];
-     struct nlmsghdr *nlm;
-     struct ifinfomsg *ifa;
-     enum netdev_flags flags;
-     nlm = (struct nlmsghdr *)buff;
-     do
-     {
-        len = recv (netdev->netlink_fd,nlm,4096,0);
-        for (;(NLMSG_OK (nlm, len)) && (nlm->nlmsg_type != NLMSG_DONE); nlm = NLMSG_NEXT(nlm, len))
-         {
-             if (nlm->nlmsg_type != RTM_NEWLINK)
-                continue;
-             ifa = (struct ifinfomsg *) NLMSG_DATA (nlm);
-             if (ifa->ifi_index == netdev->ifindex){
-                 if (ifa->ifi_flags & IFF_UP){
-                     netdev_nodev_get_flags(netdev->name, &flags);
-                     netdev_set_flags(netdev, flags, false);
-                     return NETDEV_LINK_UP;
-                 }
-                 else {
-                     netdev_nodev_get_flags(netdev->name, &flags);
-                     netdev_set_flags(netdev, flags, false);
-                     return NETDEV_LINK_DOWN;
-                 }
-	     }
-         }
-     } while (len < 0 && errno == EINTR);
-     return NETDEV_LINK_NO_CHANGE;
+/* Sets the offloads of the frame in 'b' from the virtio net header 'vnet' it
+ * was received with. */
+static void
+offload_from_vnet_hdr(struct ofpbuf *b, const struct virtio_net_hdr *vnet)
+{
+    struct ofpbuf_offload *o = &b->offload;
+
+    memset(o, 0, sizeof *o);
+    if (vnet->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM
+        && vnet->csum_start + vnet->csum_offset + 2 <= b->size) {
+        o->flags = OFPBUF_OFFLOAD_NEEDS_CSUM;
+        o->csum_tail = b->size - vnet->csum_start;
+        o->csum_offset = vnet->csum_offset;
+    }
+    if (vnet->gso_type != VIRTIO_NET_HDR_GSO_NONE) {
+        o->gso_type = vnet->gso_type;
+        o->gso_size = vnet->gso_size;
+    }
+}
+
+/* Fills in the virtio net header 'vnet' to send the frame in 'b' with. */
+static void
+offload_to_vnet_hdr(const struct ofpbuf *b, struct virtio_net_hdr *vnet)
+{
+    const struct ofpbuf_offload *o = &b->offload;
+
+    memset(vnet, 0, sizeof *vnet);
+    if (o->flags & OFPBUF_OFFLOAD_NEEDS_CSUM && o->csum_tail <= b->size) {
+        vnet->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+        vnet->csum_start = b->size - o->csum_tail;
+        vnet->csum_offset = o->csum_offset;
+        vnet->hdr_len = vnet->csum_start + vnet->csum_offset + 2;
+    }
+    if (o->gso_type != OFPBUF_GSO_NONE) {
+        vnet->gso_type = o->gso_type;
+        vnet->gso_size = o->gso_size;
+        if ((o->gso_type & ~OFPBUF_GSO_ECN) != OFPBUF_GSO_UDP
+            && vnet->hdr_len && vnet->csum_start + 13 <= b->size) {
+            /* The segments share all the headers, up to the TCP options. */
+            const uint8_t *tcp = (const uint8_t *) b->data + vnet->csum_start;
+            vnet->hdr_len = vnet->csum_start + (tcp[12] >> 4) * 4;
+        }
+    }
+}
+
+/* Reads a frame from the file descriptors of the tap device 'netdev' into
+ * 'iov', taking them in turn so that a busy queue does not starve the others.
+ * Returns the number of bytes read, or -1 with errno set. */
+static ssize_t
+read_tap(struct netdev *netdev, const struct iovec *iov, int n_iov)
+{
+    ssize_t n_bytes = -1;
+    int i;
+
+    for (i = 0; i < netdev->n_rx_fds; i++) {
+        int fd = netdev->rx_fds[netdev->next_rx_fd];
+
+        netdev->next_rx_fd = (netdev->next_rx_fd + 1) % netdev->n_rx_fds;
+        do {
+            n_bytes = readv(fd, iov, n_iov);
+        } while (n_bytes < 0 && errno == EINTR);
+        if (n_bytes >= 0 || errno != EAGAIN) {
+            break;
+        }
+    }
+    return n_bytes;
 }
 
 /* Attempts to receive a packet from 'netdev' into 'buffer', which the caller
- * must have initialized with sufficient room for the packet.  The space
- * required to receive any packet is ETH_HEADER_LEN bytes, plus VLAN_HEADER_LEN
- * bytes, plus the device's MTU (which may be retrieved via netdev_get_mtu()).
+ * must have initialized with room for the packet.  The space required to
+ * receive most packets is ETH_HEADER_LEN bytes, plus VLAN_HEADER_LEN bytes,
+ * plus the device's MTU (which may be retrieved via netdev_get_mtu()).
  * (Some devices do not allow for a VLAN header, in which case VLAN_HEADER_LEN
- * need not be included.)
+ * need not be included.)  'buffer' is enlarged for the larger frames whose
+ * segmentation is left to do, as its offloads then tell.
  *
  * If a packet is successfully retrieved, returns 0.  In this case 'buffer' is
  * guaranteed to contain at least ETH_TOTAL_MIN bytes.  Otherwise, returns a
@@ -982,11 +1268,18 @@ netdev_link_state(struct netdev *netdev)
  * be returned.
  */
 int
-netdev_recv(struct netdev *netdev, struct ofpbuf *buffer, size_t max_mtu)
+netdev_recv(struct netdev *netdev, struct ofpbuf *buffer)
 {
+    /* Where the bytes that do not fit in 'buffer' go: a frame whose
+     * segmentation is left to do may take up to 64 kB. */
+    static uint8_t overflow[65536];
+    struct virtio_net_hdr vnet;
+    struct iovec iov[3];
+    size_t hdr_len = netdev->vnet_hdr ? sizeof vnet : 0;
+    size_t tailroom;
+    int n_iov = 0;
 #ifdef HAVE_PACKET_AUXDATA
     /* Code from libpcap to reconstruct VLAN header */
-    struct iovec    iov;
     struct cmsghdr    *cmsg;
     struct msghdr     msg;
     struct sockaddr   from;
@@ -996,52 +1289,49 @@ netdev_recv(struct netdev *netdev, struct ofpbuf *buffer, size_t max_mtu)
     } cmsg_buf;
 #else
     struct sockaddr_ll sll;
-    socklen_t sll_len;
+    struct msghdr msg;
 #endif
     ssize_t n_bytes;
 
     assert(buffer->size == 0);
     assert(ofpbuf_tailroom(buffer) >= ETH_TOTAL_MIN);
 
+    tailroom = ofpbuf_tailroom(buffer);
+    if (hdr_len) {
+        iov[n_iov].iov_base = &vnet;
+        iov[n_iov++].iov_len = hdr_len;
+    }
+    iov[n_iov].iov_base = ofpbuf_tail(buffer);
+    iov[n_iov++].iov_len = tailroom;
+    iov[n_iov].iov_base = overflow;
+    iov[n_iov++].iov_len = sizeof overflow;
+
+    memset(&msg, 0, sizeof(struct msghdr));
+    msg.msg_iov   = iov;
+    msg.msg_iovlen    = n_iov;
 #ifdef HAVE_PACKET_AUXDATA
     /* Code from libpcap to reconstruct VLAN header */
-    memset(&msg, 0, sizeof(struct msghdr));
     memset(cmsg_buf.buf, 0, CMSG_SPACE(sizeof(struct tpacket_auxdata)));
 
     msg.msg_name    = &from;
     msg.msg_namelen   = sizeof(from);
-    msg.msg_iov   = &iov;
-    msg.msg_iovlen    = 1;
     msg.msg_control   = &cmsg_buf;
     msg.msg_controllen  = sizeof(cmsg_buf);
     msg.msg_flags   = 0;
-
-    iov.iov_len   = max_mtu;
-    iov.iov_base    = buffer->data;
-
 #else
-    /* prepare to call recvfrom */
+    /* prepare to call recvmsg */
     memset(&sll,0,sizeof sll);
-    sll_len = sizeof sll;
+    msg.msg_name = &sll;
+    msg.msg_namelen = sizeof sll;
 #endif
 
-    /* cannot execute recvfrom over a tap device */
-    if (!strncmp(netdev->name, "tap", 3)) {
-        do {
-            n_bytes = read(netdev->tap_fd, ofpbuf_tail(buffer),
-                           (ssize_t)ofpbuf_tailroom(buffer));
-        } while (n_bytes < 0 && errno == EINTR);
+    /* cannot execute recvmsg over a tap device */
+    if (netdev->tap_fd != netdev->netdev_fd) {
+        n_bytes = read_tap(netdev, iov, n_iov);
     }
     else {
         do {
-#ifdef HAVE_PACKET_AUXDATA
-            /* Code from libpcap to reconstruct VLAN header */
             n_bytes = recvmsg(netdev->tap_fd, &msg, 0);
-#else
-            n_bytes = recvfrom(netdev->tap_fd, ofpbuf_tail(buffer),
-                               (ssize_t)ofpbuf_tailroom(buffer), 0,
-                               (struct sockaddr *)&sll, &sll_len);
-#endif /* ifdef HAVE_PACKET_AUXDATA  */
         } while (n_bytes < 0 && errno == EINTR);
     }
     if (n_bytes < 0) {
@@ -1050,15 +1340,36 @@ netdev_recv(struct netdev *netdev, struct ofpbuf *buffer, size_t max_mtu)
                          strerror(errno), netdev->name);
         }
         return errno;
+    } else if (n_bytes < hdr_len) {
+        VLOG_WARN_RL(LOG_MODULE, &rl, "short frame received on %s",
+                     netdev->name);
+        return EAGAIN;
     } else {
+        size_t n_data = n_bytes - hdr_len;
+
+#ifndef HAVE_PACKET_AUXDATA
+        /* we have multiple raw sockets at the same interface, so we also
+         * receive what others send, and need to filter them out.
+         * TODO(yiannisy): can we install this as a BPF at kernel?*/
+        if (netdev->tap_fd == netdev->netdev_fd
+            && sll.sll_pkttype == PACKET_OUTGOING) {
+            return EAGAIN;
+        }
+#endif
+        if (n_data <= tailroom) {
+            buffer->size += n_data;
+        } else {
+            buffer->size += tailroom;
+            ofpbuf_put(buffer, overflow, n_data - tailroom);
+        }
 
 #ifdef HAVE_PACKET_AUXDATA
+        if (netdev->tap_fd == netdev->netdev_fd) {
             /* Code from libpcap to reconstruct VLAN header */
             for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
                 struct tpacket_auxdata *aux;
                 struct vlan_tag *tag;
                 uint16_t eth_type;
-                buffer->size += n_bytes;
 
                 if (cmsg->cmsg_len < CMSG_LEN(sizeof(struct tpacket_auxdata)) ||
                     cmsg->cmsg_level != SOL_PACKET ||
@@ -1085,21 +1396,22 @@ netdev_recv(struct netdev *netdev, struct ofpbuf *buffer, size_t max_mtu)
                 }
                 tag->vlan_tci = htons(aux->tp_vlan_tci);
             }
-#else
-        /* we have multiple raw sockets at the same interface, so we also
-         * receive what others send, and need to filter them out.
-         * TODO(yiannisy): can we install this as a BPF at kernel?*/
-        if (sll.sll_pkttype == PACKET_OUTGOING) {
-            return EAGAIN;
         }
-        buffer->size += n_bytes;
 #endif
         /* When the kernel internally sends out an Ethernet frame on an
          * interface, it gives us a copy *before* padding the frame to the
          * minimum length.  Thus, when it sends out something like an ARP
          * request, we see a too-short frame.  So pad it out to the minimum
-         * length. */
+         * length.  The padding sums to nothing in a checksum left to do. */
         pad_to_minimum_length(buffer);
+
+        /* The header counts a VLAN tag taken out of the frame as if it were
+         * still in, as it is again by now. */
+        if (hdr_len) {
+            offload_from_vnet_hdr(buffer, &vnet);
+        } else {
+            memset(&buffer->offload, 0, sizeof buffer->offload);
+        }
         return 0;
     }
 
@@ -1110,7 +1422,11 @@ netdev_recv(struct netdev *netdev, struct ofpbuf *buffer, size_t max_mtu)
 void
 netdev_recv_wait(struct netdev *netdev)
 {
-    poll_fd_wait(netdev->tap_fd, POLLIN);
+    int i;
+
+    for (i = 0; i < netdev->n_rx_fds; i++) {
+        poll_fd_wait(netdev->rx_fds[i], POLLIN);
+    }
 }
 
 /* Discards all packets waiting to be received from 'netdev'. */
@@ -1118,7 +1434,11 @@ int
 netdev_drain(struct netdev *netdev)
 {
     if (netdev->tap_fd != netdev->netdev_fd) {
-        drain_fd(netdev->tap_fd, netdev->txqlen);
+        int i;
+
+        for (i = 0; i < netdev->n_rx_fds; i++) {
+            drain_fd(netdev->rx_fds[i], netdev->txqlen);
+        }
         return 0;
     } else {
         return drain_rcvbuf(netdev->netdev_fd);
@@ -1133,6 +1453,10 @@ netdev_drain(struct netdev *netdev)
  * class_id denotes the queue to send the packet. If 0, it goes to the
  * default,best-effort queue.
  *
+ * The offloads of 'buffer' go along with it, to be done by the kernel.  On a
+ * device that cannot take them, a checksum left to do is done on the way out
+ * and a frame still to be segmented is dropped with EMSGSIZE.
+ *
  * The caller retains ownership of 'buffer' in all cases.
  *
  * The kernel maintains a packet transmission queue, so the caller is not
@@ -1142,12 +1466,51 @@ int
 netdev_send(struct netdev *netdev, const struct ofpbuf *buffer,
             uint16_t class_id)
 {
+    const struct ofpbuf_offload *o = &buffer->offload;
+    struct virtio_net_hdr vnet;
+    struct iovec iov[4];
+    size_t hdr_len = 0;
+    uint16_t sum;
     ssize_t n_bytes;
+    int n_iov = 0;
 
     assert(class_id <= NETDEV_MAX_QUEUES);
 
+    if (netdev->vnet_hdr) {
+        offload_to_vnet_hdr(buffer, &vnet);
+        hdr_len = sizeof vnet;
+        iov[n_iov].iov_base = &vnet;
+        iov[n_iov++].iov_len = hdr_len;
+    } else if (o->gso_type != OFPBUF_GSO_NONE) {
+        VLOG_WARN_RL(LOG_MODULE, &rl, "dropping %zu byte frame to be "
+                     "segmented on %s, which cannot do it",
+                     buffer->size, netdev->name);
+        return EMSGSIZE;
+    }
+
+    if (!netdev->vnet_hdr && o->flags & OFPBUF_OFFLOAD_NEEDS_CSUM
+        && o->csum_tail <= buffer->size
+        && o->csum_offset + 2 <= o->csum_tail) {
+        /* The checksum goes out in place of the sum of the pseudo header,
+         * without writing to the frame. */
+        const uint8_t *tail = ofpbuf_tail(buffer);
+        const uint8_t *field = tail - o->csum_tail + o->csum_offset;
+
+        sum = csum(tail - o->csum_tail, o->csum_tail);
+        sum = sum ? sum : 0xffff;
+        iov[n_iov].iov_base = buffer->data;
+        iov[n_iov++].iov_len = field - (const uint8_t *) buffer->data;
+        iov[n_iov].iov_base = &sum;
+        iov[n_iov++].iov_len = sizeof sum;
+        iov[n_iov].iov_base = (uint8_t *) field + sizeof sum;
+        iov[n_iov++].iov_len = tail - (field + sizeof sum);
+    } else {
+        iov[n_iov].iov_base = buffer->data;
+        iov[n_iov++].iov_len = buffer->size;
+    }
+
     do {
-        n_bytes = write(netdev->queue_fd[class_id], buffer->data, buffer->size);
+        n_bytes = writev(netdev->queue_fd[class_id], iov, n_iov);
     } while (n_bytes < 0 && errno == EINTR);
     if (n_bytes < 0) {
         /* The Linux AF_PACKET implementation never blocks waiting for room
@@ -1160,10 +1523,10 @@ netdev_send(struct netdev *netdev, const struct ofpbuf *buffer,
                          netdev->name, strerror(errno));
         }
         return errno;
-    } else if (n_bytes != buffer->size) {
+    } else if (n_bytes != hdr_len + buffer->size) {
         VLOG_WARN_RL(LOG_MODULE, &rl,
                      "send partial Ethernet packet (%d bytes of %zu) on %s",
-                     (int) n_bytes, buffer->size, netdev->name);
+                     (int) (n_bytes - hdr_len), buffer->size, netdev->name);
         return EMSGSIZE;
     } else {
         return 0;
@@ -1628,6 +1991,7 @@ netdev_monitor_poll(struct netdev_monitor *mon)
                                  rtnlgrp_link_policy,
                                  attrs, ARRAY_SIZE(rtnlgrp_link_policy))) {
                 VLOG_WARN_RL(LOG_MODULE, &slow_rl, "received bad rtnl message");
+                ofpbuf_delete(buf);
                 return all_netdevs_changed(mon);
             }
             name = lookup_netdev(mon, nl_attr_get_string(attrs[IFLA_IFNAME]));
@@ -666,6 +666,27 @@ nl_msg_put_nested(struct ofpbuf *msg,
     nl_msg_put_unspec(msg, type, nested_msg->data, nested_msg->size);
 }
 
+/* Appends the header of a Netlink attribute of the given 'type' to 'msg', to
+ * be followed by the nested attributes that make up its payload, and returns
+ * the offset of the header within 'msg'.  The caller must pass that offset to
+ * nl_msg_end_nested() once all the nested attributes have been added. */
+size_t
+nl_msg_start_nested(struct ofpbuf *msg, uint16_t type)
+{
+    size_t offset = msg->size;
+    nl_msg_put_unspec_uninit(msg, type, 0);
+    return offset;
+}
+
+/* Finalizes the length of the attribute started with nl_msg_start_nested() at
+ * 'offset' in 'msg' to cover everything added to 'msg' since. */
+void
+nl_msg_end_nested(struct ofpbuf *msg, size_t offset)
+{
+    struct nlattr *attr = ofpbuf_at_assert(msg, offset, sizeof *attr);
+    attr->nla_len = msg->size - offset;
+}
+
 /* Returns the first byte in the payload of attribute 'nla'. */
 const void *
 nl_attr_get(const struct nlattr *nla) 
@@ -95,6 +95,8 @@ void nl_msg_put_u32(struct ofpbuf *, uint16_t type, uint32_t value);
 void nl_msg_put_u64(struct ofpbuf *, uint16_t type, uint64_t value);
 void nl_msg_put_string(struct ofpbuf *, uint16_t type, const char *value);
 void nl_msg_put_nested(struct ofpbuf *, uint16_t type, struct ofpbuf *);
+size_t nl_msg_start_nested(struct ofpbuf *, uint16_t type);
+void nl_msg_end_nested(struct ofpbuf *, size_t offset);
 
 /* Netlink attribute types. */
 enum nl_attr_type
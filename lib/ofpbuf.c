@@ -35,6 +35,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
+#include "csum.h"
 #include "dynamic-string.h"
 #include "util.h"
 
@@ -54,6 +55,7 @@ ofpbuf_use(struct ofpbuf *b, void *base, size_t allocated)
     b->l2 = b->l3 = b->l4 = b->l7 = NULL;
     b->next = NULL;
     b->private_p = NULL;
+    memset(&b->offload, 0, sizeof b->offload);
 }
 
 /* Initializes 'b' as an empty ofpbuf with an initial capacity of 'size'
@@ -104,7 +106,9 @@ ofpbuf_new_with_headroom(size_t size, size_t headroom)
 struct ofpbuf *
 ofpbuf_clone(const struct ofpbuf *buffer)
 {
-    return ofpbuf_clone_data(buffer->data, buffer->size);
+    struct ofpbuf *b = ofpbuf_clone_data(buffer->data, buffer->size);
+    b->offload = buffer->offload;
+    return b;
 }
 
 /* Creates and returns a new ofpbuf whose data are copied from 'buffer'.   The
@@ -114,6 +118,7 @@ ofpbuf_clone_with_headroom(const struct ofpbuf *buffer, size_t headroom)
 {
     struct ofpbuf *b = ofpbuf_new_with_headroom(buffer->size, headroom);
     ofpbuf_put(b, buffer->data, buffer->size);
+    b->offload = buffer->offload;
     return b;
 }
 
@@ -323,6 +328,7 @@ ofpbuf_clear(struct ofpbuf *b)
 {
     b->data = b->base;
     b->size = 0;
+    memset(&b->offload, 0, sizeof b->offload);
 }
 
 /* Removes 'size' bytes from the head end of 'b', which must contain at least
@@ -345,3 +351,29 @@ ofpbuf_try_pull(struct ofpbuf *b, size_t size)
 {
     return b->size >= size ? ofpbuf_pull(b, size) : NULL;
 }
+
+/* Completes the transport checksum of the frame in 'b', if its offloads leave
+ * it to be done, the way a device would, and drops that offload.  Frames to be
+ * segmented keep that offload: each segment gets its own checksum then. */
+void
+ofpbuf_finish_csum(struct ofpbuf *b)
+{
+    struct ofpbuf_offload *o = &b->offload;
+    uint8_t *start, *field;
+    uint16_t sum;
+
+    if (!(o->flags & OFPBUF_OFFLOAD_NEEDS_CSUM)
+        || o->gso_type != OFPBUF_GSO_NONE) {
+        return;
+    }
+    o->flags &= ~OFPBUF_OFFLOAD_NEEDS_CSUM;
+    if (o->csum_tail > b->size || o->csum_offset + 2 > o->csum_tail) {
+        return;
+    }
+    start = (uint8_t *) ofpbuf_tail(b) - o->csum_tail;
+    field = start + o->csum_offset;
+    sum = csum(start, o->csum_tail);
+    /* A sum of zero means "no checksum" to UDP. */
+    sum = sum ? sum : 0xffff;
+    memcpy(field, &sum, sizeof sum);
+}
@@ -37,6 +37,31 @@
 #include <stddef.h>
 #include <stdint.h>
 
+/* Work on a frame that a network device left for the next one to do, as the
+ * virtio net header of a tap device or a packet socket describes it.  All
+ * zeros for a complete frame. */
+struct ofpbuf_offload {
+    uint8_t flags;              /* OFPBUF_OFFLOAD_NEEDS_CSUM or 0. */
+    uint8_t gso_type;           /* One of OFPBUF_GSO_*. */
+    uint16_t gso_size;          /* Payload bytes of each segment, for GSO. */
+    uint16_t csum_tail;         /* Bytes from the start of the checksummed
+                                 * part to the end of the frame, so that it
+                                 * holds while headers are pushed or popped. */
+    uint16_t csum_offset;       /* Offset of the checksum from that start. */
+};
+
+/* The transport checksum holds the sum of the pseudo header only; the sum of
+ * the rest is still to be added. */
+#define OFPBUF_OFFLOAD_NEEDS_CSUM 1
+
+/* Segmentation left to do on a frame larger than the MTU.  The values are
+ * those of the virtio net header. */
+#define OFPBUF_GSO_NONE  0
+#define OFPBUF_GSO_TCPV4 1
+#define OFPBUF_GSO_UDP   3
+#define OFPBUF_GSO_TCPV6 4
+#define OFPBUF_GSO_ECN   0x80
+
 /* Buffer for holding arbitrary data.  An ofpbuf is automatically reallocated
  * as necessary if it grows too large for the available memory. */
 struct ofpbuf {
@@ -56,6 +81,8 @@ struct ofpbuf {
 
     struct ofpbuf *next;        /* Next in a list of ofpbufs. */
     void *private_p;            /* Private pointer for use by owner. */
+
+    struct ofpbuf_offload offload;  /* Offloads of the frame, if any. */
 };
 
 void ofpbuf_use(struct ofpbuf *, void *, size_t);
@@ -95,4 +122,6 @@ void ofpbuf_clear(struct ofpbuf *);
 void *ofpbuf_pull(struct ofpbuf *, size_t);
 void *ofpbuf_try_pull(struct ofpbuf *, size_t);
 
+void ofpbuf_finish_csum(struct ofpbuf *);
+
 #endif /* ofpbuf.h */
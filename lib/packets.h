@@ -408,11 +408,12 @@ struct dht_header{
     uint64_t macs[DHT_MAX_ELEMENTS];
     uint32_t in_ports[DHT_MAX_ELEMENTS];
     uint32_t out_ports[DHT_MAX_ELEMENTS];
+    uint32_t seq;   /* Ronda de descubrimiento del controlador, 0 = sin secuencia */
 }__attribute__((packed));
 
 BUILD_ASSERT_DECL( ( (2*sizeof(uint16_t))+ (sizeof(uint16_t)*DHT_MAX_ELEMENTS) + 
-     (sizeof(uint64_t)*DHT_MAX_ELEMENTS) + (2*sizeof(uint32_t)*DHT_MAX_ELEMENTS) ) 
-        == (sizeof(struct dht_header)));
+     (sizeof(uint64_t)*DHT_MAX_ELEMENTS) + (2*sizeof(uint32_t)*DHT_MAX_ELEMENTS) +
+     sizeof(uint32_t) ) == (sizeof(struct dht_header)));
 /*Fin Modificacion UAH Discovery hybrid topologies, JAH-*/
 
 struct protocols_std {
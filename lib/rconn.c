@@ -51,6 +51,9 @@
 #define LOG_MODULE VLM_rconn
 #include "vlog.h"
 
+/* Maximum number of queued messages handed to the vconn at once. */
+#define TX_BATCH 64
+
 #define STATES                                  \
     STATE(VOID, 1 << 0)                         \
     STATE(BACKOFF, 1 << 1)                      \
@@ -86,6 +89,8 @@ struct rconn {
     bool reliable;
 
     struct ofp_queue txq;
+    bool corked;                /* Hold messages in txq until uncorked? */
+    bool vconn_corked;          /* vconn told that more messages follow? */
 
     int backoff;
     int max_backoff;
@@ -200,6 +205,8 @@ rconn_create(int probe_interval, int max_backoff)
     rc->reliable = false;
 
     queue_init(&rc->txq);
+    rc->corked = false;
+    rc->vconn_corked = false;
 
     rc->backoff = 0;
     rc->max_backoff = max_backoff ? max_backoff : 60;
@@ -554,9 +561,20 @@ rconn_send(struct rconn *rc, struct ofpbuf *b, int *n_queued)
         /* If the queue was empty before we added 'b', try to send some
          * packets.  (But if the queue had packets in it, it's because the
          * vconn is backlogged and there's no point in stuffing more into it
-         * now.  We'll get back to that in rconn_run().) */
-        if (rc->txq.n == 1) {
+         * now.  We'll get back to that in rconn_run().)  A corked rconn
+         * leaves them queued, to be sent together by rconn_uncork(), but
+         * sends each full batch right away, so that the queue does not grow
+         * past the limits callers put on it.  The vconn is then told that
+         * more follow, so that the tail of a batch goes out with the next
+         * one rather than in a segment of its own. */
+        if (rc->txq.n == 1 && !rc->corked) {
             try_send(rc);
+        } else if (rc->corked && rc->txq.n >= TX_BATCH) {
+            if (!rc->vconn_corked) {
+                vconn_cork(rc->vconn, true);
+                rc->vconn_corked = true;
+            }
+            do_tx_work(rc);
         }
         return 0;
     } else {
@@ -588,6 +606,33 @@ rconn_send_with_limit(struct rconn *rc, struct ofpbuf *b,
     return retval;
 }
 
+/* Corks 'rc': messages passed to rconn_send() are queued, not sent right away,
+ * until rconn_uncork() is called or a full batch of them is queued.  Meant to
+ * surround bursts of messages (such as multipart replies or packet-ins) so
+ * that they reach the vconn as batches, written with as few system calls as
+ * possible. */
+void
+rconn_cork(struct rconn *rc)
+{
+    rc->corked = true;
+}
+
+/* Uncorks 'rc' and tries to send the messages queued while it was corked. */
+void
+rconn_uncork(struct rconn *rc)
+{
+    rc->corked = false;
+    if (rc->state & (S_ACTIVE | S_IDLE)) {
+        do_tx_work(rc);
+    }
+    if (rc->vconn_corked) {
+        if (rc->vconn) {
+            vconn_cork(rc->vconn, false);
+        }
+        rc->vconn_corked = false;
+    }
+}
+
 /* Returns the total number of packets successfully sent on the underlying
  * vconn.  A packet is not counted as sent while it is still queued in the
  * rconn, only when it has been successfuly passed to the vconn.  */
@@ -782,19 +827,30 @@ rconn_update_protocol_stat(struct rconn *rconn,
 }
 */
 
-/* Tries to send a packet from 'rc''s send buffer.  Returns 0 if successful,
- * otherwise a positive errno value. */
+/* Tries to send packets from 'rc''s send buffer, as many as the vconn takes in
+ * a single batch.  Returns 0 if at least one was sent, otherwise a positive
+ * errno value. */
 static int
 try_send(struct rconn *rc)
 {
-    int retval = 0;
-    struct ofpbuf *next = rc->txq.head->next;
-    struct ofp_header *h = rc->txq.head->data;
-    int *n_queued = rc->txq.head->private_p;
+    struct ofpbuf *msgs[TX_BATCH];
+    int *n_queued[TX_BATCH];
+    uint32_t xids[TX_BATCH];
+    struct ofpbuf *b, *next;
+    size_t n, n_sent, i;
+    int retval;
+
+    /* The vconn frees the messages it sends, so everything needed from them
+     * afterwards is collected first. */
+    for (n = 0, b = rc->txq.head; b != NULL && n < TX_BATCH; b = b->next) {
+        xids[n] = ((struct ofp_header *) b->data)->xid;
+        msgs[n] = b;
+        n_queued[n++] = b->private_p;
+    }
+    next = b;
     /* TODO Zoltan: Temporarily removed when moving to OpenFlow 1.1 */
     /* ofpstat_inc_protocol_stat(&rc->ofps_sent, h); */
-    rc->idle_echo_xid = h->xid;
-    retval = vconn_send(rc->vconn, rc->txq.head);
+    retval = vconn_send_batch(rc->vconn, msgs, n, &n_sent);
     if (retval) {
         rc->idle_echo_xid = 0;
         if (retval != EAGAIN) {
@@ -802,11 +858,14 @@ try_send(struct rconn *rc)
         }
         return retval;
     }
-    rc->packets_sent++;
-    if (n_queued) {
-        --*n_queued;
+    rc->idle_echo_xid = xids[n_sent - 1];
+    rc->packets_sent += n_sent;
+    for (i = 0; i < n_sent; i++) {
+        if (n_queued[i]) {
+            --*n_queued[i];
+        }
+        queue_advance_head(&rc->txq, i + 1 < n ? msgs[i + 1] : next);
     }
-    queue_advance_head(&rc->txq, next);
     return 0;
 }
 
@@ -72,6 +72,9 @@ void rconn_recv_wait(struct rconn *);
 int rconn_send(struct rconn *, struct ofpbuf *, int *n_queued);
 int rconn_send_with_limit(struct rconn *, struct ofpbuf *,
                           int *n_queued, int queue_limit);
+#define TXQ_LIMIT 128           /* Max number of packets to queue for tx. */
+void rconn_cork(struct rconn *);
+void rconn_uncork(struct rconn *);
 unsigned int rconn_packets_sent(const struct rconn *);
 unsigned int rconn_packets_received(const struct rconn *);
 
@@ -126,6 +126,25 @@ struct vconn_class {
     /* Arranges for the poll loop to wake up when 'vconn' is ready to take an
      * action of the given 'type'. */
     void (*wait)(struct vconn *vconn, enum vconn_wait_type type);
+
+    /* Tries to queue the 'n' messages in 'msgs' for transmission on 'vconn',
+     * in order, gathering as many of them as possible into a single system
+     * call.  Stores into '*n_sent' the number of messages whose ownership was
+     * transferred to the vconn, which are always the first ones of 'msgs'.
+     * Returns 0 if at least one message was accepted, otherwise a positive
+     * errno value as the send function does.
+     *
+     * May be null, in which case the messages are passed to the send function
+     * one at a time. */
+    int (*send_batch)(struct vconn *vconn, struct ofpbuf **msgs, size_t n,
+                      size_t *n_sent);
+
+    /* Tells 'vconn' that more messages follow while 'corked' is true, so that
+     * it may hold back partly filled segments until it is called again with
+     * 'corked' false.
+     *
+     * May be null if the vconn has nothing to gain from it. */
+    void (*cork)(struct vconn *vconn, bool corked);
 };
 
 /* Passive virtual connection to an OpenFlow device.
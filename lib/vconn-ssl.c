@@ -785,6 +785,8 @@ struct vconn_class ssl_vconn_class = {
     ssl_recv,                   /* recv */
     ssl_send,                   /* send */
     ssl_wait,                   /* wait */
+    NULL,                       /* send_batch */
+    NULL,                       /* cork */
 };
 
 /* Passive SSL. */
@@ -35,10 +35,14 @@
 #include "vconn-stream.h"
 #include <assert.h>
 #include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <poll.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include "ofpbuf.h"
 #include "openflow/openflow.h"
@@ -224,6 +228,64 @@ stream_send(struct vconn *vconn, struct ofpbuf *buffer)
     }
 }
 
+/* Maximum number of messages gathered into a single sendmsg() call. */
+#define STREAM_MAX_IOV 64
+
+static int
+stream_send_batch(struct vconn *vconn, struct ofpbuf **msgs, size_t n,
+                  size_t *n_sent)
+{
+    struct stream_vconn *s = stream_vconn_cast(vconn);
+    struct iovec iov[STREAM_MAX_IOV];
+    struct msghdr msg;
+    size_t n_iov, i;
+    ssize_t retval;
+
+    *n_sent = 0;
+    if (s->txbuf) {
+        return EAGAIN;
+    }
+
+    n_iov = MIN(n, STREAM_MAX_IOV);
+    for (i = 0; i < n_iov; i++) {
+        iov[i].iov_base = msgs[i]->data;
+        iov[i].iov_len = msgs[i]->size;
+    }
+    memset(&msg, 0, sizeof msg);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = n_iov;
+
+    retval = sendmsg(s->fd, &msg, 0);
+    if (retval < 0) {
+        return errno;
+    }
+
+    for (i = 0; i < n_iov && retval >= msgs[i]->size; i++) {
+        retval -= msgs[i]->size;
+        ofpbuf_delete(msgs[i]);
+    }
+    *n_sent = i;
+    if (i < n_iov && (retval > 0 || i == 0)) {
+        /* The rest of a partially written message goes out from the poll
+         * loop, as in stream_send(). */
+        s->txbuf = msgs[i];
+        ofpbuf_pull(s->txbuf, retval);
+        s->tx_waiter = poll_fd_callback(s->fd, POLLOUT, stream_do_tx, vconn);
+        (*n_sent)++;
+    }
+    return 0;
+}
+
+static void
+stream_cork(struct vconn *vconn, bool corked)
+{
+    struct stream_vconn *s = stream_vconn_cast(vconn);
+    int on = corked;
+
+    /* Only means something to TCP; other sockets refuse it, harmlessly. */
+    setsockopt(s->fd, IPPROTO_TCP, TCP_CORK, &on, sizeof on);
+}
+
 static void
 stream_wait(struct vconn *vconn, enum vconn_wait_type wait)
 {
@@ -258,6 +320,8 @@ static struct vconn_class stream_vconn_class = {
     stream_recv,                /* recv */
     stream_send,                /* send */
     stream_wait,                /* wait */
+    stream_send_batch,          /* send_batch */
+    stream_cork,                /* cork */
 };
 
 /* Passive stream socket vconn. */
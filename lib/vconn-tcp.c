@@ -134,6 +134,8 @@ struct vconn_class tcp_vconn_class = {
     NULL,                       /* recv */
     NULL,                       /* send */
     NULL,                       /* wait */
+    NULL,                       /* send_batch */
+    NULL,                       /* cork */
 };
 
 /* Passive TCP. */
@@ -88,6 +88,8 @@ struct vconn_class unix_vconn_class = {
     NULL,                       /* recv */
     NULL,                       /* send */
     NULL,                       /* wait */
+    NULL,                       /* send_batch */
+    NULL,                       /* cork */
 };
 
 /* Passive UNIX socket. */
@@ -610,6 +610,50 @@ do_send(struct vconn *vconn, struct ofpbuf *buf)
     return retval;
 }
 
+/* Tries to queue the 'n' messages in 'msgs', in order, for transmission on
+ * 'vconn', gathering them into as few system calls as the vconn allows.
+ * Stores into '*n_sent' how many of them, always the first ones of 'msgs',
+ * were accepted; ownership of those is transferred to 'vconn'.  Returns 0 if
+ * at least one message was accepted, otherwise a positive errno value as
+ * vconn_send() does. */
+int
+vconn_send_batch(struct vconn *vconn, struct ofpbuf **msgs, size_t n,
+                 size_t *n_sent)
+{
+    int retval;
+
+    *n_sent = 0;
+    retval = vconn_connect(vconn);
+    if (retval) {
+        return retval;
+    }
+    if (n > 1 && vconn->class->send_batch
+        && !VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
+        return (vconn->class->send_batch)(vconn, msgs, n, n_sent);
+    }
+
+    /* One message at a time, which also logs each of them if enabled. */
+    while (*n_sent < n) {
+        retval = do_send(vconn, msgs[*n_sent]);
+        if (retval) {
+            break;
+        }
+        (*n_sent)++;
+    }
+    return *n_sent ? 0 : retval;
+}
+
+/* Tells 'vconn' whether a burst of messages is being sent, so that while
+ * 'corked' is true it may gather them into full segments, which are pushed
+ * out once it is false again. */
+void
+vconn_cork(struct vconn *vconn, bool corked)
+{
+    if (vconn->class->cork) {
+        (vconn->class->cork)(vconn, corked);
+    }
+}
+
 /* Same as vconn_send, except that it waits until 'msg' can be transmitted. */
 int
 vconn_send_block(struct vconn *vconn, struct ofpbuf *msg)
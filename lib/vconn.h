@@ -56,6 +56,9 @@ bool vconn_is_reconnectable(const struct vconn *);
 int vconn_connect(struct vconn *);
 int vconn_recv(struct vconn *, struct ofpbuf **);
 int vconn_send(struct vconn *, struct ofpbuf *);
+int vconn_send_batch(struct vconn *, struct ofpbuf **, size_t n,
+                     size_t *n_sent);
+void vconn_cork(struct vconn *, bool corked);
 int vconn_recv_xid(struct vconn *, uint32_t xid, struct ofpbuf **);
 int vconn_transact(struct vconn *, struct ofpbuf *, struct ofpbuf **);
 
@@ -36,7 +36,9 @@
 #include <assert.h>
 #include <ctype.h>
 #include <errno.h>
+#include <pthread.h>
 #include <stdarg.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
@@ -98,10 +100,56 @@ static long long int boot_time;
 static char *log_file_name;
 static FILE *log_file;
 
+/* Per-module rate limits, applied to every message of the module on top of
+ * the rate limits of the VLOG_*_RL macros.  A zero 'rate' means no limit. */
+static struct vlog_rate_limit module_rate_limits[VLM_N_MODULES];
+
+/* Asynchronous logging.
+ *
+ * Once vlog_async_start() is called, the messages logged by the thread that
+ * called it are rendered into a single-producer, single-consumer ring buffer
+ * and a flusher thread expands the facility patterns and does the writes, so
+ * that the caller only pays for a vsnprintf() and a memcpy().  Messages that
+ * do not fit in the ring are dropped and counted.  Other threads keep
+ * logging synchronously, serialized with the flusher by 'log_mutex', which
+ * also guards the levels, patterns and log file that the flusher reads. */
+#define ASYNC_RING_SIZE (1 << 20)    /* Bytes, a power of 2. */
+#define ASYNC_MSG_MAX   1024         /* Longest message, with its '\0'. */
+
+enum async_kind {
+    ASYNC_PAD,                  /* Unused space up to the end of the ring. */
+    ASYNC_LOG,                  /* A log message. */
+    ASYNC_CALL                  /* A call deferred with vlog_defer(). */
+};
+
+struct async_record {
+    uint32_t size;              /* Bytes, with this header, multiple of 8. */
+    uint8_t kind;               /* One of ASYNC_*. */
+    uint8_t level;              /* ASYNC_LOG: enum vlog_level. */
+    uint16_t module;            /* ASYNC_LOG: enum vlog_module. */
+    unsigned int msg_num;       /* ASYNC_LOG: sequence number. */
+    unsigned int dropped;       /* Records dropped just before this one. */
+    long long int msec;         /* ASYNC_LOG: time_msec() when logged. */
+    time_t wall;                /* ASYNC_LOG: time_now() when logged. */
+    void (*cb)(const void *, size_t); /* ASYNC_CALL: function to call. */
+    size_t data_len;            /* ASYNC_CALL: bytes in 'data'. */
+    char data[0];               /* Message or argument of 'cb'. */
+};
+
+static uint8_t *async_ring;     /* Nonnull once asynchronous. */
+static size_t async_head;       /* Written by the producer only. */
+static size_t async_tail;       /* Written by the flusher only. */
+static size_t async_head_pending; /* Head after the reserved record. */
+static unsigned int async_dropped; /* Dropped since the last record. */
+static bool async_stop;
+static pthread_t async_producer;
+static pthread_t async_flusher;
+static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 static void format_log_message(enum vlog_module, enum vlog_level,
                                enum vlog_facility, unsigned int msg_num,
-                               const char *message, va_list, struct ds *)
-    PRINTF_FORMAT(5, 0);
+                               long long int msec, time_t wall,
+                               const char *text, struct ds *);
 
 /* Searches the 'n_names' in 'names'.  Returns the index of a match for
  * 'target', or 'n_names' if no name matches. */
@@ -220,6 +268,7 @@ vlog_set_levels(enum vlog_module module, enum vlog_facility facility,
                 enum vlog_level level) 
 {
     assert(facility < VLF_N_FACILITIES || facility == VLF_ANY_FACILITY);
+    pthread_mutex_lock(&log_mutex);
     if (facility == VLF_ANY_FACILITY) {
         for (facility = 0; facility < VLF_N_FACILITIES; facility++) {
             set_facility_level(facility, module, level);
@@ -227,6 +276,7 @@ vlog_set_levels(enum vlog_module module, enum vlog_facility facility,
     } else {
         set_facility_level(facility, module, level);
     }
+    pthread_mutex_unlock(&log_mutex);
 }
 
 static void
@@ -246,6 +296,7 @@ void
 vlog_set_pattern(enum vlog_facility facility, const char *pattern)
 {
     assert(facility < VLF_N_FACILITIES || facility == VLF_ANY_FACILITY);
+    pthread_mutex_lock(&log_mutex);
     if (facility == VLF_ANY_FACILITY) {
         for (facility = 0; facility < VLF_N_FACILITIES; facility++) {
             do_set_pattern(facility, pattern);
@@ -253,6 +304,7 @@ vlog_set_pattern(enum vlog_facility facility, const char *pattern)
     } else {
         do_set_pattern(facility, pattern);
     }
+    pthread_mutex_unlock(&log_mutex);
 }
 
 /* Returns the name of the log file used by VLF_FILE, or a null pointer if no
@@ -278,8 +330,10 @@ vlog_set_log_file(const char *file_name)
     /* Close old log file. */
     if (log_file) {
         VLOG_INFO(LOG_MODULE, "closing log file");
+        pthread_mutex_lock(&log_mutex);
         fclose(log_file);
         log_file = NULL;
+        pthread_mutex_unlock(&log_mutex);
     }
 
     /* Update log file name and free old name.  The ordering is important
@@ -293,7 +347,9 @@ vlog_set_log_file(const char *file_name)
 
     /* Open new log file and update min_levels[] to reflect whether we actually
      * have a log_file. */
+    pthread_mutex_lock(&log_mutex);
     log_file = fopen(log_file_name, "a");
+    pthread_mutex_unlock(&log_mutex);
     for (module = 0; module < VLM_N_MODULES; module++) {
         update_min_level(module);
     }
@@ -476,10 +532,11 @@ fetch_braces(const char *p, const char *def, char *out, size_t out_size)
 static void
 format_log_message(enum vlog_module module, enum vlog_level level,
                    enum vlog_facility facility, unsigned int msg_num,
-                   const char *message, va_list args_, struct ds *s)
+                   long long int msec, time_t wall, const char *text,
+                   struct ds *s)
 {
     char tmp[128];
-    va_list args;
+    struct tm tm;
     const char *p;
 
     ds_clear(s);
@@ -519,12 +576,11 @@ format_log_message(enum vlog_module module, enum vlog_level level,
             break;
         case 'd':
             p = fetch_braces(p, "%Y-%m-%d %H:%M:%S", tmp, sizeof tmp);
-            ds_put_strftime(s, tmp, NULL);
+            localtime_r(&wall, &tm);
+            ds_put_strftime(s, tmp, &tm);
             break;
         case 'm':
-            va_copy(args, args_);
-            ds_put_format_valist(s, message, args);
-            va_end(args);
+            ds_put_cstr(s, text);
             break;
         case 'N':
             ds_put_format(s, "%u", msg_num);
@@ -539,7 +595,7 @@ format_log_message(enum vlog_module module, enum vlog_level level,
             ds_put_format(s, "%ld", (long int) getpid());
             break;
         case 'r':
-            ds_put_format(s, "%lld", time_msec() - boot_time);
+            ds_put_format(s, "%lld", msec - boot_time);
             break;
         default:
             ds_put_char(s, p[-1]);
@@ -559,6 +615,322 @@ format_log_message(enum vlog_module module, enum vlog_level level,
     }
 }
 
+/* Writes 'text' to the facilities enabled for 'module' and 'level', using
+ * 's' as scratch space. */
+static void
+write_log_message(enum vlog_module module, enum vlog_level level,
+                  unsigned int msg_num, long long int msec, time_t wall,
+                  const char *text, bool flush, struct ds *s)
+{
+    if (levels[module][VLF_CONSOLE] >= level) {
+        format_log_message(module, level, VLF_CONSOLE, msg_num, msec, wall,
+                           text, s);
+        ds_put_char(s, '\n');
+        fputs(ds_cstr(s), stderr);
+    }
+
+    if (levels[module][VLF_SYSLOG] >= level) {
+        int syslog_level = syslog_levels[level];
+        char *save_ptr = NULL;
+        char *line;
+
+        format_log_message(module, level, VLF_SYSLOG, msg_num, msec, wall,
+                           text, s);
+        for (line = strtok_r(s->string, "\n", &save_ptr); line;
+             line = strtok_r(NULL, "\n", &save_ptr)) {
+            syslog(syslog_level, "%s", line);
+        }
+    }
+
+    if (levels[module][VLF_FILE] >= level && log_file) {
+        format_log_message(module, level, VLF_FILE, msg_num, msec, wall,
+                           text, s);
+        ds_put_char(s, '\n');
+        fputs(ds_cstr(s), log_file);
+        if (flush) {
+            fflush(log_file);
+        }
+    }
+}
+
+/* Reserves room for a record of 'size' bytes in the ring.  Returns null,
+ * counting the record as dropped, if the ring is full. */
+static struct async_record *
+async_reserve(size_t size)
+{
+    size_t tail = __atomic_load_n(&async_tail, __ATOMIC_ACQUIRE);
+    size_t ofs = async_head & (ASYNC_RING_SIZE - 1);
+    size_t contiguous = ASYNC_RING_SIZE - ofs;
+    size_t needed;
+
+    size = ROUND_UP(size, 8);
+    needed = contiguous < size ? contiguous + size : size;
+    if (size > ASYNC_RING_SIZE / 4
+        || ASYNC_RING_SIZE - (async_head - tail) < needed) {
+        async_dropped++;
+        return NULL;
+    }
+
+    async_head_pending = async_head;
+    if (contiguous < size) {
+        /* Records do not wrap around. */
+        struct async_record *pad = (struct async_record *) &async_ring[ofs];
+        pad->size = contiguous;
+        pad->kind = ASYNC_PAD;
+        async_head_pending += contiguous;
+        ofs = 0;
+    }
+    return (struct async_record *) &async_ring[ofs];
+}
+
+/* Hands the record reserved with async_reserve(), of 'size' bytes, to the
+ * flusher. */
+static void
+async_commit(struct async_record *rec, size_t size)
+{
+    rec->size = ROUND_UP(size, 8);
+    rec->dropped = async_dropped;
+    async_dropped = 0;
+    __atomic_store_n(&async_head, async_head_pending + rec->size,
+                     __ATOMIC_RELEASE);
+}
+
+/* Whether the calling thread logs through the ring. */
+static inline bool
+async_is_producer(void)
+{
+    return async_ring && pthread_equal(pthread_self(), async_producer);
+}
+
+static void *
+async_flush_loop(void *aux UNUSED)
+{
+    struct ds s = DS_EMPTY_INITIALIZER;
+
+    for (;;) {
+        size_t head = __atomic_load_n(&async_head, __ATOMIC_ACQUIRE);
+
+        if (async_tail == head) {
+            if (__atomic_load_n(&async_stop, __ATOMIC_ACQUIRE)) {
+                break;
+            }
+            usleep(10000);
+            continue;
+        }
+
+        while (async_tail != head) {
+            struct async_record *rec = (struct async_record *)
+                &async_ring[async_tail & (ASYNC_RING_SIZE - 1)];
+            size_t size = rec->size;
+
+            if (rec->kind != ASYNC_PAD && rec->dropped) {
+                pthread_mutex_lock(&log_mutex);
+                ds_clear(&s);
+                ds_put_format(&s, "Dropped %u messages, log buffer full",
+                              rec->dropped);
+                write_log_message(LOG_MODULE, VLL_WARN, 0, time_msec(),
+                                  time_now(), ds_cstr(&s), false, &s);
+                pthread_mutex_unlock(&log_mutex);
+            }
+            if (rec->kind == ASYNC_LOG) {
+                pthread_mutex_lock(&log_mutex);
+                write_log_message(rec->module, rec->level, rec->msg_num,
+                                  rec->msec, rec->wall, rec->data, false, &s);
+                pthread_mutex_unlock(&log_mutex);
+            } else if (rec->kind == ASYNC_CALL) {
+                rec->cb(rec->data, rec->data_len);
+            }
+            __atomic_store_n(&async_tail, async_tail + size, __ATOMIC_RELEASE);
+        }
+
+        pthread_mutex_lock(&log_mutex);
+        if (log_file) {
+            fflush(log_file);
+        }
+        pthread_mutex_unlock(&log_mutex);
+    }
+
+    ds_destroy(&s);
+    return NULL;
+}
+
+/* Writes out what is left in the ring and stops the flusher. */
+static void
+async_exit(void)
+{
+    if (async_ring && async_is_producer()) {
+        __atomic_store_n(&async_stop, true, __ATOMIC_RELEASE);
+        pthread_join(async_flusher, NULL);
+        async_ring = NULL;
+    }
+}
+
+/* Makes the messages logged from now on by the calling thread, and the calls
+ * it defers with vlog_defer(), be handed to a flusher thread.  Must be called
+ * after daemonizing, since threads do not survive fork(). */
+void
+vlog_async_start(void)
+{
+    int error;
+
+    if (async_ring) {
+        return;
+    }
+    async_ring = xmalloc(ASYNC_RING_SIZE);
+    async_producer = pthread_self();
+    error = pthread_create(&async_flusher, NULL, async_flush_loop, NULL);
+    if (error) {
+        free(async_ring);
+        async_ring = NULL;
+        VLOG_WARN(LOG_MODULE, "failed to start the log flusher thread: %s",
+                  strerror(error));
+        return;
+    }
+    atexit(async_exit);
+    VLOG_INFO(LOG_MODULE, "logging asynchronously");
+}
+
+/* Queues a call of 'cb' with 'header' and 'data', one after the other, for
+ * the flusher. */
+static void
+async_defer(void (*cb)(const void *, size_t),
+            const void *header, size_t header_size,
+            const void *data, size_t size)
+{
+    struct async_record *rec;
+
+    rec = async_reserve(sizeof *rec + header_size + size);
+    if (rec) {
+        rec->kind = ASYNC_CALL;
+        rec->cb = cb;
+        rec->data_len = header_size + size;
+        if (header_size) {
+            memcpy(rec->data, header, header_size);
+        }
+        memcpy(rec->data + header_size, data, size);
+        async_commit(rec, sizeof *rec + header_size + size);
+    }
+}
+
+/* Calls 'cb' with a copy of the 'size' bytes of 'data' from the flusher
+ * thread, in order with the messages logged, or right away if logging is not
+ * asynchronous.  For slow writes, such as trace files, that should not be
+ * done in the caller. */
+void
+vlog_defer(void (*cb)(const void *data, size_t size),
+           const void *data, size_t size)
+{
+    if (!async_is_producer()) {
+        cb(data, size);
+        return;
+    }
+    async_defer(cb, NULL, 0, data, size);
+}
+
+/* Same as vlog_defer(), with 'cb' getting the 'header_size' bytes of 'header'
+ * followed by the 'size' bytes of 'data', which are copied straight into the
+ * ring rather than joined first. */
+void
+vlog_defer_with_header(void (*cb)(const void *data, size_t size),
+                       const void *header, size_t header_size,
+                       const void *data, size_t size)
+{
+    char *joined;
+
+    if (async_is_producer()) {
+        async_defer(cb, header, header_size, data, size);
+        return;
+    }
+    joined = xmalloc(header_size + size);
+    memcpy(joined, header, header_size);
+    memcpy(joined + header_size, data, size);
+    cb(joined, header_size + size);
+    free(joined);
+}
+
+/* Limits the messages of 'module', or of every module if 'module' is
+ * VLM_ANY_MODULE, to 'rate' per minute with bursts of 'burst'.  A 'rate' of
+ * 0 removes the limit. */
+void
+vlog_set_rate_limit(enum vlog_module module, unsigned int rate,
+                    unsigned int burst)
+{
+    struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(rate, burst);
+
+    if (module == VLM_ANY_MODULE) {
+        for (module = 0; module < VLM_N_MODULES; module++) {
+            module_rate_limits[module] = rl;
+        }
+    } else {
+        module_rate_limits[module] = rl;
+    }
+}
+
+/* Sets a rate limit from 'arg', in the form "MODULE:RATE[:BURST]" where
+ * MODULE may be "ANY" and RATE is in messages per minute.  Returns null if
+ * successful, otherwise an error message that the caller must free(). */
+char *
+vlog_set_rate_limit_from_string(const char *arg)
+{
+    char *s = xstrdup(arg);
+    char *save_ptr = NULL;
+    char *module_name, *rate, *burst;
+    enum vlog_module module;
+    char *error = NULL;
+    long long int r, b;
+
+    module_name = strtok_r(s, ":", &save_ptr);
+    rate = strtok_r(NULL, ":", &save_ptr);
+    burst = strtok_r(NULL, ":", &save_ptr);
+    if (!module_name || !rate) {
+        error = xasprintf("expected MODULE:RATE[:BURST]");
+    } else {
+        module = (!strcmp(module_name, "ANY") ? VLM_ANY_MODULE
+                  : vlog_get_module_val(module_name));
+        if (module == VLM_N_MODULES) {
+            error = xasprintf("unknown module \"%s\"", module_name);
+        } else if (!str_to_llong(rate, 10, &r) || r < 0 || r > UINT_MAX) {
+            error = xasprintf("invalid rate \"%s\"", rate);
+        } else if (burst && (!str_to_llong(burst, 10, &b)
+                             || b < 0 || b > UINT_MAX)) {
+            error = xasprintf("invalid burst \"%s\"", burst);
+        } else {
+            vlog_set_rate_limit(module, r, burst ? b : r);
+        }
+    }
+    free(s);
+    return error;
+}
+
+/* Takes the tokens of one message from 'rl'.  Returns false, counting the
+ * message as dropped, if 'rl' does not have enough. */
+static bool
+vlog_rate_limit_take(struct vlog_rate_limit *rl)
+{
+    if (rl->tokens < VLOG_MSG_TOKENS) {
+        time_t now = time_now();
+        if (rl->last_fill > now) {
+            /* Last filled in the future?  Time must have gone backward, or
+             * 'rl' has not been used before. */
+            rl->tokens = rl->burst;
+        } else if (rl->last_fill < now) {
+            unsigned int add = sat_mul(rl->rate, now - rl->last_fill);
+            unsigned int tokens = sat_add(rl->tokens, add);
+            rl->tokens = MIN(tokens, rl->burst);
+            rl->last_fill = now;
+        }
+        if (rl->tokens < VLOG_MSG_TOKENS) {
+            if (!rl->n_dropped) {
+                rl->first_dropped = now;
+            }
+            rl->n_dropped++;
+            return false;
+        }
+    }
+    rl->tokens -= VLOG_MSG_TOKENS;
+    return true;
+}
+
 /* Writes 'message' to the log at the given 'level' and as coming from the
  * given 'module'.
  *
@@ -571,43 +943,60 @@ vlog_valist(enum vlog_module module, enum vlog_level level,
     bool log_to_syslog = levels[module][VLF_SYSLOG] >= level;
     bool log_to_file = levels[module][VLF_FILE] >= level && log_file;
     if (log_to_console || log_to_syslog || log_to_file) {
+        struct vlog_rate_limit *rl = &module_rate_limits[module];
         int save_errno = errno;
         static unsigned int msg_num;
-        struct ds s;
 
-        ds_init(&s);
-        ds_reserve(&s, 1024);
+        if (rl->rate && !vlog_rate_limit_take(rl)) {
+            errno = save_errno;
+            return;
+        }
         msg_num++;
 
-        if (log_to_console) {
-            format_log_message(module, level, VLF_CONSOLE, msg_num,
-                               message, args, &s);
-            ds_put_char(&s, '\n');
-            fputs(ds_cstr(&s), stderr);
-        }
+        if (async_is_producer()) {
+            struct async_record *rec;
+            int n;
+
+            rec = async_reserve(sizeof *rec + ASYNC_MSG_MAX);
+            if (rec) {
+                rec->kind = ASYNC_LOG;
+                rec->level = level;
+                rec->module = module;
+                rec->msg_num = msg_num;
+                rec->msec = time_msec();
+                rec->wall = time_now();
+                n = vsnprintf(rec->data, ASYNC_MSG_MAX, message, args);
+                n = n < 0 ? 0 : MIN(n, ASYNC_MSG_MAX - 1);
+                async_commit(rec, sizeof *rec + n + 1);
+            }
+        } else {
+            struct ds text, s;
 
-        if (log_to_syslog) {
-            int syslog_level = syslog_levels[level];
-            char *save_ptr = NULL;
-            char *line;
+            ds_init(&text);
+            ds_init(&s);
+            ds_reserve(&s, 1024);
+            ds_put_format_valist(&text, message, args);
 
-            format_log_message(module, level, VLF_SYSLOG, msg_num,
-                               message, args, &s);
-            for (line = strtok_r(s.string, "\n", &save_ptr); line;
-                 line = strtok_r(NULL, "\n", &save_ptr)) {
-                syslog(syslog_level, "%s", line);
+            if (async_ring) {
+                pthread_mutex_lock(&log_mutex);
+            }
+            write_log_message(module, level, msg_num, time_msec(), time_now(),
+                              ds_cstr(&text), true, &s);
+            if (async_ring) {
+                pthread_mutex_unlock(&log_mutex);
             }
-        }
 
-        if (log_to_file) {
-            format_log_message(module, level, VLF_FILE, msg_num,
-                               message, args, &s);
-            ds_put_char(&s, '\n');
-            fputs(ds_cstr(&s), log_file);
-            fflush(log_file);
+            ds_destroy(&text);
+            ds_destroy(&s);
         }
 
-        ds_destroy(&s);
+        if (rl->rate && rl->n_dropped) {
+            unsigned int n_dropped = rl->n_dropped;
+            rl->n_dropped = 0;
+            vlog(module, level, "Dropped %u messages in last %u seconds "
+                 "due to the rate limit of the module", n_dropped,
+                 (unsigned int) (time_now() - rl->first_dropped));
+        }
         errno = save_errno;
     }
 }
@@ -632,27 +1021,9 @@ vlog_rate_limit(enum vlog_module module, enum vlog_level level,
         return;
     }
 
-    if (rl->tokens < VLOG_MSG_TOKENS) {
-        time_t now = time_now();
-        if (rl->last_fill > now) {
-            /* Last filled in the future?  Time must have gone backward, or
-             * 'rl' has not been used before. */
-            rl->tokens = rl->burst;
-        } else if (rl->last_fill < now) {
-            unsigned int add = sat_mul(rl->rate, now - rl->last_fill);
-            unsigned int tokens = sat_add(rl->tokens, add);
-            rl->tokens = MIN(tokens, rl->burst);
-            rl->last_fill = now;
-        }
-        if (rl->tokens < VLOG_MSG_TOKENS) {
-            if (!rl->n_dropped) {
-                rl->first_dropped = now;
-            }
-            rl->n_dropped++;
-            return;
-        }
+    if (!vlog_rate_limit_take(rl)) {
+        return;
     }
-    rl->tokens -= VLOG_MSG_TOKENS;
 
     va_start(args, message);
     vlog_valist(module, level, message, args);
@@ -128,6 +128,17 @@ void vlog_set_pattern(enum vlog_facility, const char *pattern);
 const char *vlog_get_log_file(void);
 int vlog_set_log_file(const char *file_name);
 int vlog_reopen_log_file(void);
+void vlog_set_rate_limit(enum vlog_module, unsigned int rate,
+                         unsigned int burst);
+char *vlog_set_rate_limit_from_string(const char *);
+
+/* Asynchronous logging. */
+void vlog_async_start(void);
+void vlog_defer(void (*cb)(const void *data, size_t size),
+                const void *data, size_t size);
+void vlog_defer_with_header(void (*cb)(const void *data, size_t size),
+                            const void *header, size_t header_size,
+                            const void *data, size_t size);
 
 /* Function for actual logging. */
 void vlog_init(void);
@@ -129,22 +129,19 @@ extern "C" int nblink_initialize(void)
 }
 
 
-int nblink_check_for_entry_on_hmap(struct hmap * pktout ,uint32_t  header, struct ofl_match_tlv * field)
+int nblink_check_for_entry_on_match(struct ofl_match * pktout ,uint32_t  header, struct ofl_match_tlv * field)
 /*
-* This search for an entry on the hmap and points field to it.
+* This search for an entry on the match and points field to it.
 * If no entry is found, -1 is returned.
 */
 {
-    struct ofl_match_tlv *iter;
-    bool done=0;
-    HMAP_FOR_EACH(iter,struct ofl_match_tlv, hmap_node,pktout)
+    struct ofl_match_tlv *iter = ofl_structs_match_lookup(pktout, header);
+
+    if (iter != NULL)
     {
-        if(iter->header == header)
-        {
-            /* Adding entry to existing hash entry (for now, do this only to ethertype)*/
-            field = iter;
-            return 0;
-        }
+        /* Adding entry to existing entry (for now, do this only to ethertype)*/
+        field = iter;
+        return 0;
     }
     return -1;
 }
@@ -162,7 +159,8 @@ int nblink_extract_exthdr_fields(struct ofpbuf * pktin, struct ofl_match * pktou
         (*destination_num)++;
     }
 
-    HMAP_FOR_EACH_WITH_HASH(iter, struct ofl_match_tlv, hmap_node, hash_int(OXM_OF_IPV6_EXTHDR, 0), &pktout->match_fields)
+    iter = ofl_structs_match_lookup(pktout, OXM_OF_IPV6_EXTHDR);
+    if (iter != NULL)
     {
         /*First check if is duplicated*/
         ext_hdrs = (uint16_t*) iter->value;
@@ -348,10 +346,9 @@ int nblink_extract_proto_fields(struct ofpbuf * pktin, _nbPDMLField * field, str
             case 2:{
                 uint16_t m_value = *((uint16_t*)((uint8_t*)pktin->data + field->Position));
                 m_value =  ntohs(m_value);  
-                struct ofl_match_tlv *iter;
                 if(header == OXM_OF_ETH_TYPE){
                     /*If Ethertype is already present we should not insert the next*/
-                    HMAP_FOR_EACH_WITH_HASH(iter, struct ofl_match_tlv, hmap_node, hash_int(OXM_OF_ETH_TYPE, 0), &pktout->match_fields)
+                    if (ofl_structs_match_lookup(pktout, OXM_OF_ETH_TYPE) != NULL)
                     {
                         return 0;
                     }
@@ -561,11 +558,10 @@ extern "C" int nblink_packet_parse(struct ofpbuf * pktin,  struct ofl_match * pk
                 /*Initialize extension header OXM */
                 struct ofl_match_tlv * EH_field;
                 uint16_t bit_field = OFPIEH_NONEXT;
-                EH_field = (struct ofl_match_tlv *) malloc(sizeof(struct ofl_match_tlv));
-                EH_field->value = (uint8_t*) malloc(OXM_LENGTH(OXM_OF_IPV6_EXTHDR));
-                EH_field->header = OXM_OF_IPV6_EXTHDR;
                 /*Set everything to zero */
-                memset(EH_field->value,0x0, sizeof(uint16_t));
+                uint16_t no_ext_hdrs = 0;
+                ofl_structs_match_put(pktout, OXM_OF_IPV6_EXTHDR, &no_ext_hdrs, sizeof(uint16_t));
+                EH_field = ofl_structs_match_lookup(pktout, OXM_OF_IPV6_EXTHDR);
 
                 char *pEnd;
                 uint16_t next_header = strtol(field->Value, &pEnd,16);
@@ -579,10 +575,6 @@ extern "C" int nblink_packet_parse(struct ofpbuf * pktin,  struct ofl_match * pk
                     *ext_hdrs = *ext_hdrs;
                 }
 
-                hmap_insert_fast(&pktout->match_fields, &EH_field->hmap_node,
-                            hash_int(EH_field->header, 0));
-                pktout->header.length += 6;
-
                 PDMLReader->GetPDMLField(proto->Name, (char*) "src", proto->FirstField, &field);
                 nblink_extract_proto_fields(pktin, field, pktout, OXM_OF_IPV6_SRC);
                 PDMLReader->GetPDMLField(proto->Name, (char*) "dst", proto->FirstField, &field);
@@ -29,6 +29,8 @@
  * Author: Zoltán Lajos Kis <zoltan.lajos.kis@ericsson.com>
  */
 
+#include <inttypes.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -38,10 +40,16 @@
 #include "ofl-exp-openflow.h"
 #include "../oflib/ofl-log.h"
 #include "../oflib/ofl-print.h"
+#include "../oflib/ofl-utils.h"
 
 #define LOG_MODULE ofl_exp_of
 OFL_LOG_INIT(LOG_MODULE)
 
+#define ETH_ADDR_FMT                                                    \
+    "%02"PRIx8":%02"PRIx8":%02"PRIx8":%02"PRIx8":%02"PRIx8":%02"PRIx8
+#define ETH_ADDR_ARGS(ea)                                   \
+    (ea)[0], (ea)[1], (ea)[2], (ea)[3], (ea)[4], (ea)[5]
+
 
 int
 ofl_exp_openflow_msg_pack(struct ofl_msg_experimenter *msg, uint8_t **buf, size_t *buf_len) {
@@ -78,6 +86,142 @@ ofl_exp_openflow_msg_pack(struct ofl_msg_experimenter *msg, uint8_t **buf, size_
 
                 return 0;
             }
+            case (OFP_EXT_BUNDLE_CONTROL): {
+                struct ofl_exp_openflow_msg_bundle_ctrl *b = (struct ofl_exp_openflow_msg_bundle_ctrl *)exp;
+                struct openflow_ext_bundle_ctrl *ofp;
+
+                *buf_len  = sizeof(struct openflow_ext_bundle_ctrl);
+                *buf     = (uint8_t *)malloc(*buf_len);
+
+                ofp = (struct openflow_ext_bundle_ctrl *)(*buf);
+                ofp->header.vendor  = htonl(exp->header.experimenter_id);
+                ofp->header.subtype = htonl(exp->type);
+                ofp->bundle_id = htonl(b->bundle_id);
+                ofp->type      = htons(b->type);
+                ofp->flags     = htons(b->flags);
+
+                return 0;
+            }
+            case (OFP_EXT_BUNDLE_ADD_MESSAGE): {
+                struct ofl_exp_openflow_msg_bundle_add *b = (struct ofl_exp_openflow_msg_bundle_add *)exp;
+                struct openflow_ext_bundle_add_msg *ofp;
+                uint8_t *msg_buf;
+                size_t msg_len;
+
+                if (ofl_msg_pack(b->message, 0, &msg_buf, &msg_len, NULL)) {
+                    OFL_LOG_WARN(LOG_MODULE, "Error packing the message added to the bundle.");
+                    return -1;
+                }
+
+                *buf_len  = sizeof(struct openflow_ext_bundle_add_msg) - sizeof(struct ofp_header) + msg_len;
+                *buf     = (uint8_t *)malloc(*buf_len);
+
+                ofp = (struct openflow_ext_bundle_add_msg *)(*buf);
+                ofp->header.vendor  = htonl(exp->header.experimenter_id);
+                ofp->header.subtype = htonl(exp->type);
+                ofp->bundle_id = htonl(b->bundle_id);
+                ofp->pad       = 0;
+                ofp->flags     = htons(b->flags);
+                memcpy(&ofp->message, msg_buf, msg_len);
+                free(msg_buf);
+
+                return 0;
+            }
+            case (OFP_EXT_LATENCY_REQUEST): {
+                struct ofl_exp_openflow_msg_latency_request *l = (struct ofl_exp_openflow_msg_latency_request *)exp;
+                struct openflow_ext_latency_request *ofp;
+
+                *buf_len  = sizeof(struct openflow_ext_latency_request);
+                *buf     = (uint8_t *)malloc(*buf_len);
+
+                ofp = (struct openflow_ext_latency_request *)(*buf);
+                ofp->header.vendor  = htonl(exp->header.experimenter_id);
+                ofp->header.subtype = htonl(exp->type);
+                ofp->command = htons(l->command);
+                memset(ofp->pad, 0x00, 6);
+
+                return 0;
+            }
+            case (OFP_EXT_LATENCY_REPLY): {
+                struct ofl_exp_openflow_msg_latency_reply *l = (struct ofl_exp_openflow_msg_latency_reply *)exp;
+                struct openflow_ext_latency_reply *ofp;
+                size_t i;
+
+                *buf_len  = sizeof(struct openflow_ext_latency_reply) +
+                            l->stages_num * sizeof(struct openflow_ext_latency_stage);
+                *buf     = (uint8_t *)malloc(*buf_len);
+
+                ofp = (struct openflow_ext_latency_reply *)(*buf);
+                ofp->header.vendor  = htonl(exp->header.experimenter_id);
+                ofp->header.subtype = htonl(exp->type);
+                ofp->enabled = l->enabled;
+                memset(ofp->pad, 0x00, 7);
+                for (i = 0; i < l->stages_num; i++) {
+                    struct ofl_exp_openflow_latency_stage *src = &l->stages[i];
+                    struct openflow_ext_latency_stage *dst = &ofp->stages[i];
+
+                    dst->stage = htons(src->stage);
+                    memset(dst->pad, 0x00, 6);
+                    dst->count = hton64(src->count);
+                    dst->min   = hton64(src->min);
+                    dst->max   = hton64(src->max);
+                    dst->mean  = hton64(src->mean);
+                    dst->p50   = hton64(src->p50);
+                    dst->p90   = hton64(src->p90);
+                    dst->p99   = hton64(src->p99);
+                    dst->p999  = hton64(src->p999);
+                }
+
+                return 0;
+            }
+            case (OFP_EXT_NEIGHBOR_STATUS): {
+                struct ofl_exp_openflow_msg_neighbor_status *n = (struct ofl_exp_openflow_msg_neighbor_status *)exp;
+                struct openflow_ext_neighbor_status *ofp;
+                size_t i;
+
+                *buf_len  = sizeof(struct openflow_ext_neighbor_status) +
+                            n->neighbors_num * sizeof(struct openflow_ext_neighbor);
+                *buf     = (uint8_t *)malloc(*buf_len);
+
+                ofp = (struct openflow_ext_neighbor_status *)(*buf);
+                ofp->header.vendor  = htonl(exp->header.experimenter_id);
+                ofp->header.subtype = htonl(exp->type);
+                for (i = 0; i < n->neighbors_num; i++) {
+                    struct ofl_exp_openflow_neighbor *src = &n->neighbors[i];
+                    struct openflow_ext_neighbor *dst = &ofp->neighbors[i];
+
+                    memcpy(dst->mac, src->mac, OFP_ETH_ALEN);
+                    dst->type    = htons(src->type);
+                    dst->port_no = htonl(src->port_no);
+                    dst->reason  = src->reason;
+                    memset(dst->pad, 0x00, 3);
+                }
+
+                return 0;
+            }
+            case (OFP_EXT_HDDP_CONFIG_REQUEST):
+            case (OFP_EXT_HDDP_CONFIG_REPLY): {
+                struct ofl_exp_openflow_msg_hddp_config *c = (struct ofl_exp_openflow_msg_hddp_config *)exp;
+                struct openflow_ext_hddp_config *ofp;
+
+                *buf_len  = sizeof(struct openflow_ext_hddp_config);
+                *buf     = (uint8_t *)malloc(*buf_len);
+
+                ofp = (struct openflow_ext_hddp_config *)(*buf);
+                ofp->header.vendor    = htonl(exp->header.experimenter_id);
+                ofp->header.subtype   = htonl(exp->type);
+                ofp->fields           = htonl(c->fields);
+                ofp->hello_interval   = htonl(c->hello_interval);
+                ofp->hello_lifetime   = htonl(c->hello_lifetime);
+                ofp->bt_lifetime      = htonl(c->bt_lifetime);
+                ofp->neighbor_sweep   = htonl(c->neighbor_sweep);
+                ofp->bt_sweep         = htonl(c->bt_sweep);
+                ofp->sensor_type      = htons(c->sensor_type);
+                ofp->role             = c->role;
+                ofp->sensor_to_sensor = c->sensor_to_sensor;
+                memset(ofp->pad, 0x00, 4);
+                return 0;
+            }
             default: {
                 OFL_LOG_WARN(LOG_MODULE, "Trying to print unknown Openflow Experimenter message.");
                 return -1;
@@ -152,6 +296,174 @@ ofl_exp_openflow_msg_unpack(struct ofp_header *oh, size_t *len, struct ofl_msg_e
                 (*msg) = (struct ofl_msg_experimenter *)dst;
                 return 0;
             }
+            case (OFP_EXT_BUNDLE_CONTROL): {
+                struct openflow_ext_bundle_ctrl *src;
+                struct ofl_exp_openflow_msg_bundle_ctrl *dst;
+
+                if (*len < sizeof(struct openflow_ext_bundle_ctrl)) {
+                    OFL_LOG_WARN(LOG_MODULE, "Received EXT_BUNDLE_CONTROL message has invalid length (%zu).", *len);
+                    return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+                }
+                *len -= sizeof(struct openflow_ext_bundle_ctrl);
+
+                src = (struct openflow_ext_bundle_ctrl *)exp;
+
+                dst = (struct ofl_exp_openflow_msg_bundle_ctrl *)malloc(sizeof(struct ofl_exp_openflow_msg_bundle_ctrl));
+                dst->header.header.experimenter_id = ntohl(exp->vendor);
+                dst->header.type                   = ntohl(exp->subtype);
+                dst->bundle_id                     = ntohl(src->bundle_id);
+                dst->type                          = ntohs(src->type);
+                dst->flags                         = ntohs(src->flags);
+
+                (*msg) = (struct ofl_msg_experimenter *)dst;
+                return 0;
+            }
+            case (OFP_EXT_BUNDLE_ADD_MESSAGE): {
+                struct openflow_ext_bundle_add_msg *src;
+                struct ofl_exp_openflow_msg_bundle_add *dst;
+                struct ofl_msg_header *message;
+                size_t msg_len;
+                ofl_err error;
+
+                if (*len < sizeof(struct openflow_ext_bundle_add_msg)) {
+                    OFL_LOG_WARN(LOG_MODULE, "Received EXT_BUNDLE_ADD_MESSAGE message has invalid length (%zu).", *len);
+                    return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+                }
+                src = (struct openflow_ext_bundle_add_msg *)exp;
+                msg_len = *len - (sizeof(struct openflow_ext_bundle_add_msg) - sizeof(struct ofp_header));
+                if (ntohs(src->message.length) != msg_len) {
+                    OFL_LOG_WARN(LOG_MODULE, "Received EXT_BUNDLE_ADD_MESSAGE message has invalid inner length (%zu).", msg_len);
+                    return ofl_error(OFPET_EXT_BUNDLE_FAILED, OFPEBFC_MSG_BAD_LEN);
+                }
+
+                error = ofl_msg_unpack((uint8_t *)&src->message, msg_len, &message, NULL, NULL);
+                if (error) {
+                    return error;
+                }
+                *len = 0;
+
+                dst = (struct ofl_exp_openflow_msg_bundle_add *)malloc(sizeof(struct ofl_exp_openflow_msg_bundle_add));
+                dst->header.header.experimenter_id = ntohl(exp->vendor);
+                dst->header.type                   = ntohl(exp->subtype);
+                dst->bundle_id                     = ntohl(src->bundle_id);
+                dst->flags                         = ntohs(src->flags);
+                dst->message                       = message;
+
+                (*msg) = (struct ofl_msg_experimenter *)dst;
+                return 0;
+            }
+            case (OFP_EXT_LATENCY_REQUEST): {
+                struct openflow_ext_latency_request *src;
+                struct ofl_exp_openflow_msg_latency_request *dst;
+
+                if (*len < sizeof(struct openflow_ext_latency_request)) {
+                    OFL_LOG_WARN(LOG_MODULE, "Received EXT_LATENCY_REQUEST message has invalid length (%zu).", *len);
+                    return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+                }
+                *len -= sizeof(struct openflow_ext_latency_request);
+
+                src = (struct openflow_ext_latency_request *)exp;
+
+                dst = (struct ofl_exp_openflow_msg_latency_request *)malloc(sizeof(struct ofl_exp_openflow_msg_latency_request));
+                dst->header.header.experimenter_id = ntohl(exp->vendor);
+                dst->header.type                   = ntohl(exp->subtype);
+                dst->command                       = ntohs(src->command);
+
+                (*msg) = (struct ofl_msg_experimenter *)dst;
+                return 0;
+            }
+            case (OFP_EXT_LATENCY_REPLY): {
+                struct openflow_ext_latency_reply *src;
+                struct ofl_exp_openflow_msg_latency_reply *dst;
+                size_t i;
+
+                if (*len < sizeof(struct openflow_ext_latency_reply) ||
+                    (*len - sizeof(struct openflow_ext_latency_reply)) % sizeof(struct openflow_ext_latency_stage) != 0) {
+                    OFL_LOG_WARN(LOG_MODULE, "Received EXT_LATENCY_REPLY message has invalid length (%zu).", *len);
+                    return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+                }
+
+                src = (struct openflow_ext_latency_reply *)exp;
+
+                dst = (struct ofl_exp_openflow_msg_latency_reply *)malloc(sizeof(struct ofl_exp_openflow_msg_latency_reply));
+                dst->header.header.experimenter_id = ntohl(exp->vendor);
+                dst->header.type                   = ntohl(exp->subtype);
+                dst->enabled                       = src->enabled;
+                dst->stages_num = (*len - sizeof(struct openflow_ext_latency_reply)) / sizeof(struct openflow_ext_latency_stage);
+                dst->stages = (struct ofl_exp_openflow_latency_stage *)malloc(dst->stages_num * sizeof(struct ofl_exp_openflow_latency_stage));
+                for (i = 0; i < dst->stages_num; i++) {
+                    dst->stages[i].stage = ntohs(src->stages[i].stage);
+                    dst->stages[i].count = ntoh64(src->stages[i].count);
+                    dst->stages[i].min   = ntoh64(src->stages[i].min);
+                    dst->stages[i].max   = ntoh64(src->stages[i].max);
+                    dst->stages[i].mean  = ntoh64(src->stages[i].mean);
+                    dst->stages[i].p50   = ntoh64(src->stages[i].p50);
+                    dst->stages[i].p90   = ntoh64(src->stages[i].p90);
+                    dst->stages[i].p99   = ntoh64(src->stages[i].p99);
+                    dst->stages[i].p999  = ntoh64(src->stages[i].p999);
+                }
+                *len = 0;
+
+                (*msg) = (struct ofl_msg_experimenter *)dst;
+                return 0;
+            }
+            case (OFP_EXT_NEIGHBOR_STATUS): {
+                struct openflow_ext_neighbor_status *src;
+                struct ofl_exp_openflow_msg_neighbor_status *dst;
+                size_t i;
+
+                if ((*len - sizeof(struct openflow_ext_neighbor_status)) % sizeof(struct openflow_ext_neighbor) != 0) {
+                    OFL_LOG_WARN(LOG_MODULE, "Received EXT_NEIGHBOR_STATUS message has invalid length (%zu).", *len);
+                    return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+                }
+
+                src = (struct openflow_ext_neighbor_status *)exp;
+
+                dst = (struct ofl_exp_openflow_msg_neighbor_status *)malloc(sizeof(struct ofl_exp_openflow_msg_neighbor_status));
+                dst->header.header.experimenter_id = ntohl(exp->vendor);
+                dst->header.type                   = ntohl(exp->subtype);
+                dst->neighbors_num = (*len - sizeof(struct openflow_ext_neighbor_status)) / sizeof(struct openflow_ext_neighbor);
+                dst->neighbors = (struct ofl_exp_openflow_neighbor *)malloc(dst->neighbors_num * sizeof(struct ofl_exp_openflow_neighbor));
+                for (i = 0; i < dst->neighbors_num; i++) {
+                    memcpy(dst->neighbors[i].mac, src->neighbors[i].mac, OFP_ETH_ALEN);
+                    dst->neighbors[i].type    = ntohs(src->neighbors[i].type);
+                    dst->neighbors[i].port_no = ntohl(src->neighbors[i].port_no);
+                    dst->neighbors[i].reason  = src->neighbors[i].reason;
+                }
+                *len = 0;
+
+                (*msg) = (struct ofl_msg_experimenter *)dst;
+                return 0;
+            }
+            case (OFP_EXT_HDDP_CONFIG_REQUEST):
+            case (OFP_EXT_HDDP_CONFIG_REPLY): {
+                struct openflow_ext_hddp_config *src;
+                struct ofl_exp_openflow_msg_hddp_config *dst;
+
+                if (*len < sizeof(struct openflow_ext_hddp_config)) {
+                    OFL_LOG_WARN(LOG_MODULE, "Received EXT_HDDP_CONFIG message has invalid length (%zu).", *len);
+                    return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+                }
+                *len -= sizeof(struct openflow_ext_hddp_config);
+
+                src = (struct openflow_ext_hddp_config *)exp;
+
+                dst = (struct ofl_exp_openflow_msg_hddp_config *)malloc(sizeof(struct ofl_exp_openflow_msg_hddp_config));
+                dst->header.header.experimenter_id = ntohl(exp->vendor);
+                dst->header.type                   = ntohl(exp->subtype);
+                dst->fields           = ntohl(src->fields);
+                dst->hello_interval   = ntohl(src->hello_interval);
+                dst->hello_lifetime   = ntohl(src->hello_lifetime);
+                dst->bt_lifetime      = ntohl(src->bt_lifetime);
+                dst->neighbor_sweep   = ntohl(src->neighbor_sweep);
+                dst->bt_sweep         = ntohl(src->bt_sweep);
+                dst->sensor_type      = ntohs(src->sensor_type);
+                dst->role             = src->role;
+                dst->sensor_to_sensor = src->sensor_to_sensor != 0;
+
+                (*msg) = (struct ofl_msg_experimenter *)dst;
+                return 0;
+            }
             default: {
                 OFL_LOG_WARN(LOG_MODULE, "Trying to unpack unknown Openflow Experimenter message.");
                 return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXPERIMENTER);
@@ -181,6 +493,33 @@ ofl_exp_openflow_msg_free(struct ofl_msg_experimenter *msg) {
                 free(s->dp_desc);
                 break;
             }
+            case (OFP_EXT_BUNDLE_CONTROL): {
+                break;
+            }
+            case (OFP_EXT_BUNDLE_ADD_MESSAGE): {
+                struct ofl_exp_openflow_msg_bundle_add *b = (struct ofl_exp_openflow_msg_bundle_add *)exp;
+                if (b->message != NULL) {
+                    ofl_msg_free(b->message, NULL);
+                }
+                break;
+            }
+            case (OFP_EXT_LATENCY_REQUEST): {
+                break;
+            }
+            case (OFP_EXT_LATENCY_REPLY): {
+                struct ofl_exp_openflow_msg_latency_reply *l = (struct ofl_exp_openflow_msg_latency_reply *)exp;
+                free(l->stages);
+                break;
+            }
+            case (OFP_EXT_NEIGHBOR_STATUS): {
+                struct ofl_exp_openflow_msg_neighbor_status *n = (struct ofl_exp_openflow_msg_neighbor_status *)exp;
+                free(n->neighbors);
+                break;
+            }
+            case (OFP_EXT_HDDP_CONFIG_REQUEST):
+            case (OFP_EXT_HDDP_CONFIG_REPLY): {
+                break;
+            }
             default: {
                 OFL_LOG_WARN(LOG_MODULE, "Trying to free unknown Openflow Experimenter message.");
             }
@@ -192,6 +531,175 @@ ofl_exp_openflow_msg_free(struct ofl_msg_experimenter *msg) {
     return 0;
 }
 
+static const char *
+ofl_exp_openflow_bundle_ctrl_type_str(uint16_t type) {
+    switch (type) {
+        case (OFPEBCT_OPEN_REQUEST):    return "open_req";
+        case (OFPEBCT_OPEN_REPLY):      return "open_reply";
+        case (OFPEBCT_CLOSE_REQUEST):   return "close_req";
+        case (OFPEBCT_CLOSE_REPLY):     return "close_reply";
+        case (OFPEBCT_COMMIT_REQUEST):  return "commit_req";
+        case (OFPEBCT_COMMIT_REPLY):    return "commit_reply";
+        case (OFPEBCT_DISCARD_REQUEST): return "discard_req";
+        case (OFPEBCT_DISCARD_REPLY):   return "discard_reply";
+        default:                        return "?";
+    }
+}
+
+static const char *
+ofl_exp_openflow_latency_command_str(uint16_t command) {
+    switch (command) {
+        case (OFPELC_GET):     return "get";
+        case (OFPELC_ENABLE):  return "enable";
+        case (OFPELC_DISABLE): return "disable";
+        case (OFPELC_RESET):   return "reset";
+        default:               return "?";
+    }
+}
+
+static const char *
+ofl_exp_openflow_latency_stage_str(uint16_t stage) {
+    switch (stage) {
+        case (OFPELS_RECEIVE):      return "receive";
+        case (OFPELS_PARSE):        return "parse";
+        case (OFPELS_PIPELINE):     return "pipeline";
+        case (OFPELS_HDDP):         return "hddp";
+        case (OFPELS_LOOKUP):       return "lookup";
+        case (OFPELS_INSTRUCTIONS): return "instructions";
+        case (OFPELS_GROUP):        return "group";
+        case (OFPELS_METER):        return "meter";
+        case (OFPELS_TRANSMIT):     return "transmit";
+        default:                    return "?";
+    }
+}
+
+static const char *hddp_role_names[] = {"auto", "switch", "gateway", "sensor"};
+
+static void
+ofl_exp_openflow_hddp_config_print(FILE *stream, struct ofl_exp_openflow_msg_hddp_config *c) {
+    const char *sep = "";
+
+    if (c->fields & OFPEHC_HELLO_INTERVAL) {
+        fprintf(stream, "%shello=\"%u\"", sep, c->hello_interval);
+        sep = ", ";
+    }
+    if (c->fields & OFPEHC_HELLO_LIFETIME) {
+        fprintf(stream, "%shello-lifetime=\"%u\"", sep, c->hello_lifetime);
+        sep = ", ";
+    }
+    if (c->fields & OFPEHC_BT_LIFETIME) {
+        fprintf(stream, "%sbt-lifetime=\"%u\"", sep, c->bt_lifetime);
+        sep = ", ";
+    }
+    if (c->fields & OFPEHC_NEIGHBOR_SWEEP) {
+        fprintf(stream, "%sneighbor-sweep=\"%u\"", sep, c->neighbor_sweep);
+        sep = ", ";
+    }
+    if (c->fields & OFPEHC_BT_SWEEP) {
+        fprintf(stream, "%sbt-sweep=\"%u\"", sep, c->bt_sweep);
+        sep = ", ";
+    }
+    if (c->fields & OFPEHC_SENSOR_TYPE) {
+        fprintf(stream, "%ssensor-type=\"%u\"", sep, c->sensor_type);
+        sep = ", ";
+    }
+    if (c->fields & OFPEHC_ROLE) {
+        fprintf(stream, "%srole=\"%s\"", sep,
+                c->role <= OFPEHR_SENSOR ? hddp_role_names[c->role] : "?");
+        sep = ", ";
+    }
+    if (c->fields & OFPEHC_SENSOR_TO_SENSOR) {
+        fprintf(stream, "%ssensor-to-sensor=\"%s\"", sep, c->sensor_to_sensor ? "on" : "off");
+    }
+}
+
+static char *
+hddp_config_error(const char *format, ...) {
+    char *error = malloc(128);
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(error, 128, format, args);
+    va_end(args);
+    return error;
+}
+
+char *
+ofl_exp_openflow_hddp_config_parse(const char *str, struct ofl_exp_openflow_msg_hddp_config *c) {
+    char *copy = strdup(str);
+    char *save_ptr = NULL;
+    char *token, *error = NULL;
+
+    for (token = strtok_r(copy, ", ", &save_ptr); token != NULL && error == NULL;
+         token = strtok_r(NULL, ", ", &save_ptr)) {
+        char *value = strchr(token, '=');
+        char *end;
+        unsigned long n;
+
+        if (value == NULL) {
+            error = hddp_config_error("\"%s\": expected KEY=VALUE", token);
+            break;
+        }
+        *value++ = '\0';
+        n = strtoul(value, &end, 10);
+
+        if (!strcmp(token, "role")) {
+            size_t i;
+            for (i = 0; i < sizeof hddp_role_names / sizeof *hddp_role_names; i++) {
+                if (!strcmp(value, hddp_role_names[i])) {
+                    break;
+                }
+            }
+            if (i == sizeof hddp_role_names / sizeof *hddp_role_names) {
+                error = hddp_config_error("unknown role \"%s\"", value);
+            }
+            c->role = i;
+            c->fields |= OFPEHC_ROLE;
+        } else if (!strcmp(token, "sensor-to-sensor")) {
+            if (strcmp(value, "on") && strcmp(value, "off")) {
+                error = hddp_config_error("sensor-to-sensor must be \"on\" or \"off\"");
+            }
+            c->sensor_to_sensor = !strcmp(value, "on");
+            c->fields |= OFPEHC_SENSOR_TO_SENSOR;
+        } else if (*value == '\0' || *end != '\0' || n > UINT32_MAX) {
+            error = hddp_config_error("\"%s\": invalid value \"%s\"", token, value);
+        } else if (!strcmp(token, "hello")) {
+            c->hello_interval = n;
+            c->fields |= OFPEHC_HELLO_INTERVAL;
+        } else if (!strcmp(token, "hello-lifetime")) {
+            c->hello_lifetime = n;
+            c->fields |= OFPEHC_HELLO_LIFETIME;
+        } else if (!strcmp(token, "bt-lifetime")) {
+            c->bt_lifetime = n;
+            c->fields |= OFPEHC_BT_LIFETIME;
+        } else if (!strcmp(token, "neighbor-sweep")) {
+            c->neighbor_sweep = n;
+            c->fields |= OFPEHC_NEIGHBOR_SWEEP;
+        } else if (!strcmp(token, "bt-sweep")) {
+            c->bt_sweep = n;
+            c->fields |= OFPEHC_BT_SWEEP;
+        } else if (!strcmp(token, "sensor-type") && n <= UINT16_MAX) {
+            c->sensor_type = n;
+            c->fields |= OFPEHC_SENSOR_TYPE;
+        } else {
+            error = hddp_config_error("unknown key \"%s\"", token);
+        }
+    }
+
+    free(copy);
+    return error;
+}
+
+static const char *
+ofl_exp_openflow_neighbor_reason_str(uint8_t reason) {
+    switch (reason) {
+        case (OFPENR_ADD):    return "add";
+        case (OFPENR_MODIFY): return "modify";
+        case (OFPENR_DELETE): return "delete";
+        default:              return "?";
+    }
+}
+
 char *
 ofl_exp_openflow_msg_to_string(struct ofl_msg_experimenter *msg) {
     char *str;
@@ -216,6 +724,64 @@ ofl_exp_openflow_msg_to_string(struct ofl_msg_experimenter *msg) {
                 fprintf(stream, "setdesc{desc=\"%s\"}", s->dp_desc);
                 break;
             }
+            case (OFP_EXT_BUNDLE_CONTROL): {
+                struct ofl_exp_openflow_msg_bundle_ctrl *b = (struct ofl_exp_openflow_msg_bundle_ctrl *)exp;
+                fprintf(stream, "bundlectrl{id=\"%u\", type=\"%s\", flags=\"0x%"PRIx16"\"}",
+                        b->bundle_id, ofl_exp_openflow_bundle_ctrl_type_str(b->type), b->flags);
+                break;
+            }
+            case (OFP_EXT_BUNDLE_ADD_MESSAGE): {
+                struct ofl_exp_openflow_msg_bundle_add *b = (struct ofl_exp_openflow_msg_bundle_add *)exp;
+                char *ms = ofl_msg_to_string(b->message, NULL);
+                fprintf(stream, "bundleadd{id=\"%u\", flags=\"0x%"PRIx16"\", msg=%s}",
+                        b->bundle_id, b->flags, ms);
+                free(ms);
+                break;
+            }
+            case (OFP_EXT_LATENCY_REQUEST): {
+                struct ofl_exp_openflow_msg_latency_request *l = (struct ofl_exp_openflow_msg_latency_request *)exp;
+                fprintf(stream, "latencyreq{cmd=\"%s\"}", ofl_exp_openflow_latency_command_str(l->command));
+                break;
+            }
+            case (OFP_EXT_LATENCY_REPLY): {
+                struct ofl_exp_openflow_msg_latency_reply *l = (struct ofl_exp_openflow_msg_latency_reply *)exp;
+                size_t i;
+
+                fprintf(stream, "latencyrep{enabled=\"%s\", stages=[", l->enabled ? "true" : "false");
+                for (i = 0; i < l->stages_num; i++) {
+                    struct ofl_exp_openflow_latency_stage *st = &l->stages[i];
+                    fprintf(stream, "%s\n  {stage=\"%s\", count=\"%"PRIu64"\", min=\"%"PRIu64"\", "
+                                    "max=\"%"PRIu64"\", mean=\"%"PRIu64"\", p50=\"%"PRIu64"\", "
+                                    "p90=\"%"PRIu64"\", p99=\"%"PRIu64"\", p999=\"%"PRIu64"\"}",
+                            i > 0 ? "," : "", ofl_exp_openflow_latency_stage_str(st->stage),
+                            st->count, st->min, st->max, st->mean, st->p50, st->p90, st->p99, st->p999);
+                }
+                fprintf(stream, "]}");
+                break;
+            }
+            case (OFP_EXT_NEIGHBOR_STATUS): {
+                struct ofl_exp_openflow_msg_neighbor_status *n = (struct ofl_exp_openflow_msg_neighbor_status *)exp;
+                size_t i;
+
+                fprintf(stream, "neighborstatus{neighbors=[");
+                for (i = 0; i < n->neighbors_num; i++) {
+                    struct ofl_exp_openflow_neighbor *nb = &n->neighbors[i];
+                    fprintf(stream, "%s{reason=\"%s\", mac=\""ETH_ADDR_FMT"\", type=\"%u\", port=\"%u\"}",
+                            i > 0 ? ", " : "", ofl_exp_openflow_neighbor_reason_str(nb->reason),
+                            ETH_ADDR_ARGS(nb->mac), nb->type, nb->port_no);
+                }
+                fprintf(stream, "]}");
+                break;
+            }
+            case (OFP_EXT_HDDP_CONFIG_REQUEST):
+            case (OFP_EXT_HDDP_CONFIG_REPLY): {
+                struct ofl_exp_openflow_msg_hddp_config *c = (struct ofl_exp_openflow_msg_hddp_config *)exp;
+
+                fprintf(stream, "%s{", exp->type == OFP_EXT_HDDP_CONFIG_REQUEST ? "hddpconfigreq" : "hddpconfig");
+                ofl_exp_openflow_hddp_config_print(stream, c);
+                fprintf(stream, "}");
+                break;
+            }
             default: {
                 OFL_LOG_WARN(LOG_MODULE, "Trying to print unknown Openflow Experimenter message.");
                 fprintf(stream, "ofexp{type=\"%u\"}", exp->type);
@@ -229,3 +795,218 @@ ofl_exp_openflow_msg_to_string(struct ofl_msg_experimenter *msg) {
     fclose(stream);
     return str;
 }
+
+int
+ofl_exp_openflow_stats_req_pack(struct ofl_msg_multipart_request_header *msg, uint8_t **buf, size_t *buf_len) {
+    struct ofl_exp_openflow_msg_multipart_request *exp = (struct ofl_exp_openflow_msg_multipart_request *)msg;
+    struct ofp_multipart_request *req;
+    struct ofp_experimenter_multipart_header *ofp;
+
+    switch (exp->type) {
+        case (OFPEMP_HDDP): {
+            *buf_len = sizeof(struct ofp_multipart_request) + sizeof(struct ofp_experimenter_multipart_header);
+            *buf     = (uint8_t *)malloc(*buf_len);
+
+            req = (struct ofp_multipart_request *)(*buf);
+            ofp = (struct ofp_experimenter_multipart_header *)req->body;
+            ofp->experimenter = htonl(exp->header.experimenter_id);
+            ofp->exp_type     = htonl(exp->type);
+            return 0;
+        }
+        default: {
+            OFL_LOG_WARN(LOG_MODULE, "Trying to pack unknown Openflow Experimenter stats request.");
+            return -1;
+        }
+    }
+}
+
+ofl_err
+ofl_exp_openflow_stats_req_unpack(struct ofp_multipart_request *os, size_t *len, struct ofl_msg_multipart_request_header **msg) {
+    struct ofp_experimenter_multipart_header *exp = (struct ofp_experimenter_multipart_header *)os->body;
+    struct ofl_exp_openflow_msg_multipart_request *dst;
+
+    switch (ntohl(exp->exp_type)) {
+        case (OFPEMP_HDDP): {
+            if (*len != sizeof(struct ofp_experimenter_multipart_header)) {
+                OFL_LOG_WARN(LOG_MODULE, "Received EXT_HDDP stats request has invalid length (%zu).", *len);
+                return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+            }
+            *len -= sizeof(struct ofp_experimenter_multipart_header);
+
+            dst = (struct ofl_exp_openflow_msg_multipart_request *)malloc(sizeof(struct ofl_exp_openflow_msg_multipart_request));
+            dst->header.experimenter_id = ntohl(exp->experimenter);
+            dst->type                   = ntohl(exp->exp_type);
+
+            (*msg) = (struct ofl_msg_multipart_request_header *)dst;
+            return 0;
+        }
+        default: {
+            OFL_LOG_WARN(LOG_MODULE, "Trying to unpack unknown Openflow Experimenter stats request.");
+            return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXP_TYPE);
+        }
+    }
+}
+
+int
+ofl_exp_openflow_stats_req_free(struct ofl_msg_multipart_request_header *msg) {
+    free(msg);
+    return 0;
+}
+
+char *
+ofl_exp_openflow_stats_req_to_string(struct ofl_msg_multipart_request_header *msg) {
+    struct ofl_exp_openflow_msg_multipart_request *exp = (struct ofl_exp_openflow_msg_multipart_request *)msg;
+    char *str;
+    size_t str_size;
+    FILE *stream = open_memstream(&str, &str_size);
+
+    switch (exp->type) {
+        case (OFPEMP_HDDP): {
+            fprintf(stream, "hddpstatsreq{}");
+            break;
+        }
+        default: {
+            fprintf(stream, "ofexpstatsreq{type=\"%u\"}", exp->type);
+        }
+    }
+
+    fclose(stream);
+    return str;
+}
+
+int
+ofl_exp_openflow_stats_reply_pack(struct ofl_msg_multipart_reply_header *msg, uint8_t **buf, size_t *buf_len) {
+    struct ofl_exp_openflow_msg_multipart_reply *exp = (struct ofl_exp_openflow_msg_multipart_reply *)msg;
+    struct ofp_multipart_reply *resp;
+    struct ofp_experimenter_multipart_header *ofp;
+
+    switch (exp->type) {
+        case (OFPEMP_HDDP): {
+            struct ofl_exp_openflow_msg_multipart_reply_hddp *h = (struct ofl_exp_openflow_msg_multipart_reply_hddp *)exp;
+            struct openflow_ext_hddp_stats *stats;
+
+            *buf_len = sizeof(struct ofp_multipart_reply) + sizeof(struct ofp_experimenter_multipart_header) +
+                       sizeof(struct openflow_ext_hddp_stats);
+            *buf     = (uint8_t *)malloc(*buf_len);
+
+            resp = (struct ofp_multipart_reply *)(*buf);
+            ofp = (struct ofp_experimenter_multipart_header *)resp->body;
+            ofp->experimenter = htonl(exp->experimenter_id);
+            ofp->exp_type     = htonl(exp->type);
+
+            stats = (struct openflow_ext_hddp_stats *)((uint8_t *)ofp + sizeof(struct ofp_experimenter_multipart_header));
+            stats->requests_rx       = hton64(h->requests_rx);
+            stats->requests_fwd      = hton64(h->requests_fwd);
+            stats->requests_answered = hton64(h->requests_answered);
+            stats->requests_dup      = hton64(h->requests_dup);
+            stats->replies_tx        = hton64(h->replies_tx);
+            stats->replies_relayed   = hton64(h->replies_relayed);
+            stats->replies_dropped   = hton64(h->replies_dropped);
+            stats->replies_overflow  = hton64(h->replies_overflow);
+            stats->replies_suppressed = hton64(h->replies_suppressed);
+            stats->hellos_rx         = hton64(h->hellos_rx);
+            stats->neighbor_expired  = hton64(h->neighbor_expired);
+            stats->bt_expired        = hton64(h->bt_expired);
+            stats->neighbor_entries  = htonl(h->neighbor_entries);
+            stats->bt_entries        = htonl(h->bt_entries);
+            stats->rounds            = hton64(h->rounds);
+            stats->round_last        = htonl(h->round_last);
+            stats->round_max         = htonl(h->round_max);
+            stats->round_mean        = htonl(h->round_mean);
+            memset(stats->pad, 0x00, 4);
+            return 0;
+        }
+        default: {
+            OFL_LOG_WARN(LOG_MODULE, "Trying to pack unknown Openflow Experimenter stats reply.");
+            return -1;
+        }
+    }
+}
+
+ofl_err
+ofl_exp_openflow_stats_reply_unpack(struct ofp_multipart_reply *os, size_t *len, struct ofl_msg_multipart_reply_header **msg) {
+    struct ofp_experimenter_multipart_header *exp = (struct ofp_experimenter_multipart_header *)os->body;
+
+    switch (ntohl(exp->exp_type)) {
+        case (OFPEMP_HDDP): {
+            struct ofl_exp_openflow_msg_multipart_reply_hddp *dst;
+            struct openflow_ext_hddp_stats *src;
+
+            if (*len != sizeof(struct ofp_experimenter_multipart_header) + sizeof(struct openflow_ext_hddp_stats)) {
+                OFL_LOG_WARN(LOG_MODULE, "Received EXT_HDDP stats reply has invalid length (%zu).", *len);
+                return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
+            }
+            *len = 0;
+
+            src = (struct openflow_ext_hddp_stats *)((uint8_t *)exp + sizeof(struct ofp_experimenter_multipart_header));
+
+            dst = (struct ofl_exp_openflow_msg_multipart_reply_hddp *)malloc(sizeof(struct ofl_exp_openflow_msg_multipart_reply_hddp));
+            dst->header.experimenter_id = ntohl(exp->experimenter);
+            dst->header.type            = ntohl(exp->exp_type);
+            dst->requests_rx       = ntoh64(src->requests_rx);
+            dst->requests_fwd      = ntoh64(src->requests_fwd);
+            dst->requests_answered = ntoh64(src->requests_answered);
+            dst->requests_dup      = ntoh64(src->requests_dup);
+            dst->replies_tx        = ntoh64(src->replies_tx);
+            dst->replies_relayed   = ntoh64(src->replies_relayed);
+            dst->replies_dropped   = ntoh64(src->replies_dropped);
+            dst->replies_overflow  = ntoh64(src->replies_overflow);
+            dst->replies_suppressed = ntoh64(src->replies_suppressed);
+            dst->hellos_rx         = ntoh64(src->hellos_rx);
+            dst->neighbor_expired  = ntoh64(src->neighbor_expired);
+            dst->bt_expired        = ntoh64(src->bt_expired);
+            dst->neighbor_entries  = ntohl(src->neighbor_entries);
+            dst->bt_entries        = ntohl(src->bt_entries);
+            dst->rounds            = ntoh64(src->rounds);
+            dst->round_last        = ntohl(src->round_last);
+            dst->round_max         = ntohl(src->round_max);
+            dst->round_mean        = ntohl(src->round_mean);
+
+            (*msg) = (struct ofl_msg_multipart_reply_header *)dst;
+            return 0;
+        }
+        default: {
+            OFL_LOG_WARN(LOG_MODULE, "Trying to unpack unknown Openflow Experimenter stats reply.");
+            return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXP_TYPE);
+        }
+    }
+}
+
+int
+ofl_exp_openflow_stats_reply_free(struct ofl_msg_multipart_reply_header *msg) {
+    free(msg);
+    return 0;
+}
+
+char *
+ofl_exp_openflow_stats_reply_to_string(struct ofl_msg_multipart_reply_header *msg) {
+    struct ofl_exp_openflow_msg_multipart_reply *exp = (struct ofl_exp_openflow_msg_multipart_reply *)msg;
+    char *str;
+    size_t str_size;
+    FILE *stream = open_memstream(&str, &str_size);
+
+    switch (exp->type) {
+        case (OFPEMP_HDDP): {
+            struct ofl_exp_openflow_msg_multipart_reply_hddp *h = (struct ofl_exp_openflow_msg_multipart_reply_hddp *)exp;
+
+            fprintf(stream, "hddpstats{requests={rx=\"%"PRIu64"\", fwd=\"%"PRIu64"\", answered=\"%"PRIu64"\", dup=\"%"PRIu64"\"}, "
+                            "replies={tx=\"%"PRIu64"\", relayed=\"%"PRIu64"\", dropped=\"%"PRIu64"\", overflow=\"%"PRIu64"\", suppressed=\"%"PRIu64"\"}, "
+                            "hellos=\"%"PRIu64"\",\n  neighbors={entries=\"%u\", expired=\"%"PRIu64"\"}, "
+                            "bt={entries=\"%u\", expired=\"%"PRIu64"\"}, "
+                            "rounds={count=\"%"PRIu64"\", last_ms=\"%u\", max_ms=\"%u\", mean_ms=\"%u\"}}",
+                    h->requests_rx, h->requests_fwd, h->requests_answered, h->requests_dup,
+                    h->replies_tx, h->replies_relayed, h->replies_dropped, h->replies_overflow,
+                    h->replies_suppressed,
+                    h->hellos_rx, h->neighbor_entries, h->neighbor_expired,
+                    h->bt_entries, h->bt_expired,
+                    h->rounds, h->round_last, h->round_max, h->round_mean);
+            break;
+        }
+        default: {
+            fprintf(stream, "ofexpstatsrep{type=\"%u\"}", exp->type);
+        }
+    }
+
+    fclose(stream);
+    return str;
+}
@@ -57,6 +57,112 @@ struct ofl_exp_openflow_msg_set_dp_desc {
     char  *dp_desc;
 };
 
+struct ofl_exp_openflow_msg_bundle_ctrl {
+    struct ofl_exp_openflow_msg_header   header; /* OFP_EXT_BUNDLE_CONTROL */
+
+    uint32_t   bundle_id;
+    uint16_t   type;      /* OFPEBCT_* */
+    uint16_t   flags;     /* OFPEBF_* */
+};
+
+struct ofl_exp_openflow_msg_bundle_add {
+    struct ofl_exp_openflow_msg_header   header; /* OFP_EXT_BUNDLE_ADD_MESSAGE */
+
+    uint32_t                 bundle_id;
+    uint16_t                 flags;     /* OFPEBF_* */
+    struct ofl_msg_header   *message;   /* The message added to the bundle. */
+};
+
+struct ofl_exp_openflow_msg_latency_request {
+    struct ofl_exp_openflow_msg_header   header; /* OFP_EXT_LATENCY_REQUEST */
+
+    uint16_t   command;   /* OFPELC_* */
+};
+
+struct ofl_exp_openflow_latency_stage {
+    uint16_t   stage;     /* OFPELS_* */
+    uint64_t   count;
+    uint64_t   min;       /* In nanoseconds. */
+    uint64_t   max;
+    uint64_t   mean;
+    uint64_t   p50;
+    uint64_t   p90;
+    uint64_t   p99;
+    uint64_t   p999;
+};
+
+struct ofl_exp_openflow_msg_latency_reply {
+    struct ofl_exp_openflow_msg_header   header; /* OFP_EXT_LATENCY_REPLY */
+
+    bool                                    enabled;
+    size_t                                  stages_num;
+    struct ofl_exp_openflow_latency_stage  *stages;
+};
+
+struct ofl_exp_openflow_neighbor {
+    uint8_t    mac[OFP_ETH_ALEN];
+    uint16_t   type;
+    uint32_t   port_no;
+    uint8_t    reason;    /* OFPENR_* */
+};
+
+struct ofl_exp_openflow_msg_neighbor_status {
+    struct ofl_exp_openflow_msg_header   header; /* OFP_EXT_NEIGHBOR_STATUS */
+
+    size_t                             neighbors_num;
+    struct ofl_exp_openflow_neighbor  *neighbors;
+};
+
+struct ofl_exp_openflow_msg_hddp_config {
+    struct ofl_exp_openflow_msg_header   header; /* OFP_EXT_HDDP_CONFIG_* */
+
+    uint32_t   fields;          /* OFPEHC_* */
+    uint32_t   hello_interval;  /* In milliseconds. */
+    uint32_t   hello_lifetime;
+    uint32_t   bt_lifetime;
+    uint32_t   neighbor_sweep;
+    uint32_t   bt_sweep;
+    uint16_t   sensor_type;
+    uint8_t    role;            /* OFPEHR_* */
+    bool       sensor_to_sensor;
+};
+
+struct ofl_exp_openflow_msg_multipart_request {
+    struct ofl_msg_multipart_request_experimenter   header; /* OPENFLOW_VENDOR_ID */
+
+    uint32_t   type;      /* OFPEMP_* */
+};
+
+struct ofl_exp_openflow_msg_multipart_reply {
+    struct ofl_msg_multipart_reply_header   header; /* OFPMP_EXPERIMENTER */
+
+    uint32_t   experimenter_id;  /* OPENFLOW_VENDOR_ID */
+    uint32_t   type;             /* OFPEMP_* */
+};
+
+struct ofl_exp_openflow_msg_multipart_reply_hddp {
+    struct ofl_exp_openflow_msg_multipart_reply   header; /* OFPEMP_HDDP */
+
+    uint64_t   requests_rx;
+    uint64_t   requests_fwd;
+    uint64_t   requests_answered;
+    uint64_t   requests_dup;
+    uint64_t   replies_tx;
+    uint64_t   replies_relayed;
+    uint64_t   replies_dropped;
+    uint64_t   replies_overflow;
+    uint64_t   replies_suppressed;
+    uint64_t   hellos_rx;
+    uint64_t   neighbor_expired;
+    uint64_t   bt_expired;
+    uint32_t   neighbor_entries;
+    uint32_t   bt_entries;
+    uint64_t   rounds;
+    uint32_t   round_last;    /* In milliseconds. */
+    uint32_t   round_max;
+    uint32_t   round_mean;
+};
+
 
 
 int
@@ -71,5 +177,37 @@ ofl_exp_openflow_msg_free(struct ofl_msg_experimenter *msg);
 char *
 ofl_exp_openflow_msg_to_string(struct ofl_msg_experimenter *msg);
 
+/* Parses "KEY=VALUE[,KEY=VALUE]..." into the fields of 'c', with the keys
+ * hello, hello-lifetime, bt-lifetime, neighbor-sweep, bt-sweep (in
+ * milliseconds), sensor-type, role (auto, switch, gateway or sensor) and
+ * sensor-to-sensor (on or off). Returns NULL, or an error message that the
+ * caller must free. */
+char *
+ofl_exp_openflow_hddp_config_parse(const char *str, struct ofl_exp_openflow_msg_hddp_config *c);
+
+int
+ofl_exp_openflow_stats_req_pack(struct ofl_msg_multipart_request_header *msg, uint8_t **buf, size_t *buf_len);
+
+ofl_err
+ofl_exp_openflow_stats_req_unpack(struct ofp_multipart_request *os, size_t *len, struct ofl_msg_multipart_request_header **msg);
+
+int
+ofl_exp_openflow_stats_req_free(struct ofl_msg_multipart_request_header *msg);
+
+char *
+ofl_exp_openflow_stats_req_to_string(struct ofl_msg_multipart_request_header *msg);
+
+int
+ofl_exp_openflow_stats_reply_pack(struct ofl_msg_multipart_reply_header *msg, uint8_t **buf, size_t *buf_len);
+
+ofl_err
+ofl_exp_openflow_stats_reply_unpack(struct ofp_multipart_reply *os, size_t *len, struct ofl_msg_multipart_reply_header **msg);
+
+int
+ofl_exp_openflow_stats_reply_free(struct ofl_msg_multipart_reply_header *msg);
+
+char *
+ofl_exp_openflow_stats_reply_to_string(struct ofl_msg_multipart_reply_header *msg);
+
 
 #endif /* OFL_EXP_OPENFLOW_H */
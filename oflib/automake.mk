@@ -7,6 +7,8 @@ oflib_liboflib_a_SOURCES = \
 	oflib/ofl-actions-pack.c \
 	oflib/ofl-actions-print.c \
 	oflib/ofl-actions-unpack.c \
+	oflib/ofl-arena.c \
+	oflib/ofl-arena.h \
 	oflib/ofl-messages.c \
 	oflib/ofl-messages.h \
 	oflib/ofl-messages-pack.c \
@@ -33,8 +33,10 @@
 #include <string.h>
 #include <netinet/in.h>
 #include "ofl.h"
+#include "ofl-arena.h"
 #include "ofl-actions.h"
 #include "ofl-log.h"
+#include "oxm-match.h"
 
 #define LOG_MODULE ofl_act
 OFL_LOG_INIT(LOG_MODULE)
@@ -44,9 +46,9 @@ ofl_actions_free(struct ofl_action_header *act, struct ofl_exp *exp) {
     switch (act->type) {
         case OFPAT_SET_FIELD:{
             struct ofl_action_set_field *a = (struct ofl_action_set_field*) act;
-            free(a->field->value);
-            free(a->field);
-            free(a);
+            ofl_free(a->field->value);
+            ofl_free(a->field);
+            ofl_free(a);
             return;
             break;        
         }
@@ -78,7 +80,47 @@ ofl_actions_free(struct ofl_action_header *act, struct ofl_exp *exp) {
         default: {
         }
     }
-    free(act);
+    ofl_free(act);
+}
+
+struct ofl_action_header *
+ofl_actions_copy_out(struct ofl_action_header *act) {
+    size_t size;
+
+    if (!ofl_arena_owns(act)) {
+        return act;
+    }
+    switch (act->type) {
+        case OFPAT_SET_FIELD: {
+            struct ofl_action_set_field *a = (struct ofl_action_set_field *)act;
+            struct ofl_action_set_field *c = malloc(sizeof(struct ofl_action_set_field));
+            size_t len = OXM_LENGTH(a->field->header);
+
+            c->header = a->header;
+            c->field = malloc(sizeof(struct ofl_match_tlv));
+            c->field->header = a->field->header;
+            c->field->value = memcpy(malloc(len), a->field->value, len);
+            return (struct ofl_action_header *)c;
+        }
+        case OFPAT_OUTPUT:       size = sizeof(struct ofl_action_output); break;
+        case OFPAT_SET_MPLS_TTL: size = sizeof(struct ofl_action_mpls_ttl); break;
+        case OFPAT_PUSH_VLAN:
+        case OFPAT_PUSH_MPLS:
+        case OFPAT_PUSH_PBB:     size = sizeof(struct ofl_action_push); break;
+        case OFPAT_POP_MPLS:     size = sizeof(struct ofl_action_pop_mpls); break;
+        case OFPAT_SET_QUEUE:    size = sizeof(struct ofl_action_set_queue); break;
+        case OFPAT_GROUP:        size = sizeof(struct ofl_action_group); break;
+        case OFPAT_SET_NW_TTL:   size = sizeof(struct ofl_action_set_nw_ttl); break;
+        case OFPAT_COPY_TTL_OUT:
+        case OFPAT_COPY_TTL_IN:
+        case OFPAT_DEC_MPLS_TTL:
+        case OFPAT_POP_VLAN:
+        case OFPAT_POP_PBB:
+        case OFPAT_DEC_NW_TTL:
+        case OFPAT_EXPERIMENTER:
+        default:                 size = sizeof(struct ofl_action_header); break;
+    }
+    return memcpy(malloc(size), act, size);
 }
 
 ofl_err
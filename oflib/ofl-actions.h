@@ -144,6 +144,11 @@ ofl_actions_unpack(struct ofp_action_header *src, size_t *len, struct ofl_action
 void
 ofl_actions_free(struct ofl_action_header *act, struct ofl_exp *exp);
 
+/* Returns a copy on the heap of an action that was unpacked into an arena, or
+ * the action itself if it was not (experimenter actions never are). */
+struct ofl_action_header *
+ofl_actions_copy_out(struct ofl_action_header *act);
+
 
 
 /****************************************************************************
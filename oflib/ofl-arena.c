@@ -0,0 +1,182 @@
+/* 
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/HDDP).
+ * Copyright (c) 2020.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "ofl-arena.h"
+
+/* Alignment of the allocations, enough for any oflib structure. */
+#define ARENA_ALIGN 16
+
+struct arena_chunk {
+    struct arena_chunk  *next;
+    size_t               size;  /* Usable bytes in 'data'. */
+    size_t               used;
+    uint8_t              data[] __attribute__((aligned(ARENA_ALIGN)));
+};
+
+struct ofl_arena {
+    struct arena_chunk  *chunks;     /* Current chunk first. */
+    size_t               chunk_size;
+    bool                 live;       /* In 'live_arenas'. */
+    struct ofl_arena    *next_live;
+};
+
+/* The arena ofl_malloc() allocates from, if any. */
+static struct ofl_arena *current;
+
+/* Arenas that hold allocations; ofl_free() must leave their memory alone. */
+static struct ofl_arena *live_arenas;
+
+static struct arena_chunk *
+chunk_new(size_t size) {
+    struct arena_chunk *c = malloc(sizeof(struct arena_chunk) + size);
+
+    if (c != NULL) {
+        c->next = NULL;
+        c->size = size;
+        c->used = 0;
+    }
+    return c;
+}
+
+struct ofl_arena *
+ofl_arena_create(size_t chunk_size) {
+    struct ofl_arena *arena = malloc(sizeof(struct ofl_arena));
+
+    arena->chunk_size = chunk_size;
+    arena->chunks = chunk_new(chunk_size);
+    arena->live = false;
+    arena->next_live = NULL;
+    return arena;
+}
+
+static void
+arena_unlink(struct ofl_arena *arena) {
+    struct ofl_arena **p;
+
+    for (p = &live_arenas; *p != NULL; p = &(*p)->next_live) {
+        if (*p == arena) {
+            *p = arena->next_live;
+            break;
+        }
+    }
+    arena->live = false;
+    arena->next_live = NULL;
+}
+
+void
+ofl_arena_reset(struct ofl_arena *arena) {
+    struct arena_chunk *c, *first = NULL;
+
+    if (arena->live) {
+        arena_unlink(arena);
+    }
+    /* Keep the last chunk of the list, which is the oldest one and has the
+     * default size. */
+    for (c = arena->chunks; c != NULL; ) {
+        struct arena_chunk *next = c->next;
+
+        if (next == NULL) {
+            first = c;
+        } else {
+            free(c);
+        }
+        c = next;
+    }
+    if (first != NULL) {
+        first->used = 0;
+    }
+    arena->chunks = first;
+}
+
+void
+ofl_arena_destroy(struct ofl_arena *arena) {
+    if (arena == NULL) {
+        return;
+    }
+    if (current == arena) {
+        current = NULL;
+    }
+    ofl_arena_reset(arena);
+    free(arena->chunks);
+    free(arena);
+}
+
+struct ofl_arena *
+ofl_arena_use(struct ofl_arena *arena) {
+    struct ofl_arena *prev = current;
+
+    current = arena;
+    return prev;
+}
+
+static void *
+arena_alloc(struct ofl_arena *arena, size_t size) {
+    struct arena_chunk *c = arena->chunks;
+
+    /* Even empty allocations get a byte, so that ofl_arena_owns() sees them. */
+    if (size == 0) {
+        size = 1;
+    }
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (c == NULL || c->size - c->used < size) {
+        /* Oversized requests get a chunk of their own. */
+        c = chunk_new(size > arena->chunk_size ? size : arena->chunk_size);
+        if (c == NULL) {
+            return NULL;
+        }
+        c->next = arena->chunks;
+        arena->chunks = c;
+    }
+    if (!arena->live) {
+        arena->live = true;
+        arena->next_live = live_arenas;
+        live_arenas = arena;
+    }
+    c->used += size;
+    return c->data + c->used - size;
+}
+
+bool
+ofl_arena_owns(const void *p) {
+    const struct ofl_arena *arena;
+    const uint8_t *b = p;
+
+    for (arena = live_arenas; arena != NULL; arena = arena->next_live) {
+        const struct arena_chunk *c;
+
+        for (c = arena->chunks; c != NULL; c = c->next) {
+            if (b >= c->data && b < c->data + c->used) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void *
+ofl_malloc(size_t size) {
+    return current != NULL ? arena_alloc(current, size) : malloc(size);
+}
+
+void
+ofl_free(void *p) {
+    if (p != NULL && (live_arenas == NULL || !ofl_arena_owns(p))) {
+        free(p);
+    }
+}
@@ -0,0 +1,69 @@
+/* 
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/HDDP).
+ * Copyright (c) 2020.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Region allocator for unpacked OpenFlow messages.
+ *
+ * Unpacking a message makes one allocation for the message, and one more for
+ * every match field, instruction, action and action list in it. While an arena
+ * is in use (see ofl_msg_unpack_arena()) these allocations are carved out of
+ * the arena instead, and all of them are released together by
+ * ofl_arena_reset().
+ *
+ * oflib allocates and frees the parts of unpacked messages with ofl_malloc()
+ * and ofl_free(), which fall back to malloc() and free() when no arena is in
+ * use, and ofl_free() ignores memory that belongs to an arena. The free
+ * functions can therefore be called on arena messages as usual. Anything that
+ * must outlive the reset has to be copied out to the heap first, see
+ * ofl_msg_flow_mod_copy_out(). */
+
+#ifndef OFL_ARENA_H
+#define OFL_ARENA_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct ofl_arena;
+
+/* Creates an arena that takes memory from the heap in chunks of 'chunk_size'
+ * bytes. */
+struct ofl_arena *
+ofl_arena_create(size_t chunk_size);
+
+void
+ofl_arena_destroy(struct ofl_arena *arena);
+
+/* Releases everything allocated from 'arena', keeping its first chunk for
+ * reuse. */
+void
+ofl_arena_reset(struct ofl_arena *arena);
+
+/* Makes ofl_malloc() allocate from 'arena', or from the heap if it is NULL.
+ * Returns the arena that was in use before. */
+struct ofl_arena *
+ofl_arena_use(struct ofl_arena *arena);
+
+/* Returns true if 'p' was allocated from an arena that was not reset since. */
+bool
+ofl_arena_owns(const void *p);
+
+void *
+ofl_malloc(size_t size);
+
+void
+ofl_free(void *p);
+
+#endif /* OFL_ARENA_H */
@@ -932,6 +932,84 @@ ofl_msg_pack_multipart_reply(struct ofl_msg_multipart_reply_header *msg, uint8_t
     return 0;
 }
 
+static void
+multipart_reply_put_header(struct ofl_msg_multipart_reply_header *msg, struct ofpbuf *buf) {
+    struct ofp_multipart_reply *resp;
+
+    resp = ofl_utils_put_uninit(buf, sizeof(struct ofp_multipart_reply));
+    resp->type  = htons(msg->type);
+    resp->flags = htons(msg->flags);
+    memset(resp->pad, 0x00, 4);
+}
+
+/* Appends the multipart reply in msg to buf, writing each entry straight into
+ * it. Only the replies that can grow large are written this way; for the
+ * other types nothing is appended and -1 is returned. The OpenFlow header is
+ * left for the caller to fill in. */
+static int
+ofl_msg_put_multipart_reply(struct ofl_msg_multipart_reply_header *msg, struct ofpbuf *buf, struct ofl_exp *exp) {
+    size_t i;
+
+    switch (msg->type) {
+        case OFPMP_FLOW: {
+            struct ofl_msg_multipart_reply_flow *m = (struct ofl_msg_multipart_reply_flow *)msg;
+            multipart_reply_put_header(msg, buf);
+            for (i=0; i<m->stats_num; i++) {
+                ofl_structs_flow_stats_put(m->stats[i], buf, exp);
+            }
+            return 0;
+        }
+        case OFPMP_PORT_STATS: {
+            struct ofl_msg_multipart_reply_port *m = (struct ofl_msg_multipart_reply_port *)msg;
+            multipart_reply_put_header(msg, buf);
+            for (i=0; i<m->stats_num; i++) {
+                ofl_structs_port_stats_pack(m->stats[i],
+                        ofl_utils_put_uninit(buf, sizeof(struct ofp_port_stats)));
+            }
+            return 0;
+        }
+        case OFPMP_GROUP: {
+            struct ofl_msg_multipart_reply_group *m = (struct ofl_msg_multipart_reply_group *)msg;
+            multipart_reply_put_header(msg, buf);
+            for (i=0; i<m->stats_num; i++) {
+                ofl_structs_group_stats_pack(m->stats[i],
+                        ofl_utils_put_uninit(buf, ofl_structs_group_stats_ofp_len(m->stats[i])));
+            }
+            return 0;
+        }
+        case OFPMP_GROUP_DESC: {
+            struct ofl_msg_multipart_reply_group_desc *m = (struct ofl_msg_multipart_reply_group_desc *)msg;
+            multipart_reply_put_header(msg, buf);
+            for (i=0; i<m->stats_num; i++) {
+                ofl_structs_group_desc_stats_put(m->stats[i], buf, exp);
+            }
+            return 0;
+        }
+        case OFPMP_PORT_DESC: {
+            struct ofl_msg_multipart_reply_port_desc *m = (struct ofl_msg_multipart_reply_port_desc *)msg;
+            multipart_reply_put_header(msg, buf);
+            for (i=0; i<m->stats_num; i++) {
+                ofl_structs_port_pack(m->stats[i],
+                        ofl_utils_put_uninit(buf, sizeof(struct ofp_port)));
+            }
+            return 0;
+        }
+        case OFPMP_DESC:
+        case OFPMP_AGGREGATE:
+        case OFPMP_TABLE:
+        case OFPMP_TABLE_FEATURES:
+        case OFPMP_QUEUE:
+        case OFPMP_GROUP_FEATURES:
+        case OFPMP_METER:
+        case OFPMP_METER_CONFIG:
+        case OFPMP_METER_FEATURES:
+        case OFPMP_EXPERIMENTER:
+        default: {
+            return -1;
+        }
+    }
+}
+
 static int
 ofl_msg_pack_queue_get_config_request(struct ofl_msg_queue_get_config_request *msg, uint8_t **buf, size_t *buf_len) {
     struct ofp_queue_get_config_request *req;
@@ -1127,3 +1205,39 @@ ofl_msg_pack(struct ofl_msg_header *msg, uint32_t xid, uint8_t **buf, size_t *bu
 
     return 0;
 }
+
+int
+ofl_msg_pack_ofpbuf(struct ofl_msg_header *msg, uint32_t xid, struct ofpbuf *buf, struct ofl_exp *exp) {
+    struct ofp_header *oh;
+    size_t start = buf->size;
+
+    if (msg->type != OFPT_MULTIPART_REPLY ||
+        ofl_msg_put_multipart_reply((struct ofl_msg_multipart_reply_header *)msg, buf, exp)) {
+        /* Small messages are packed as usual and copied in. */
+        uint8_t *data;
+        size_t data_len;
+        int error;
+
+        error = ofl_msg_pack(msg, xid, &data, &data_len, exp);
+        if (error) {
+            return error;
+        }
+        ofpbuf_put(buf, data, data_len);
+        free(data);
+        return 0;
+    }
+
+    if (buf->size - start > UINT16_MAX) {
+        OFL_LOG_WARN(LOG_MODULE, "Trying to pack a message of %zu bytes.", buf->size - start);
+        buf->size = start;
+        return -1;
+    }
+
+    oh = ofpbuf_at_assert(buf, start, sizeof(struct ofp_header));
+    oh->version =        OFP_VERSION;
+    oh->type    =        msg->type;
+    oh->length  = htons(buf->size - start);
+    oh->xid     = htonl(xid);
+
+    return 0;
+}
@@ -64,12 +64,12 @@ ofl_msg_unpack_error(struct ofp_header *src, size_t *len, struct ofl_msg_header
 
     se = (struct ofp_error_msg *)src;
 
-    de = (struct ofl_msg_error *)malloc(sizeof(struct ofl_msg_error));
+    de = (struct ofl_msg_error *)ofl_malloc(sizeof(struct ofl_msg_error));
 
     de->type = (enum ofp_error_type)((int)ntohs(se->type));
     de->code = ntohs(se->code);
     de->data_length = *len;
-    de->data = *len > 0 ? (uint8_t *)memcpy(malloc(*len), se->data, *len) : NULL;
+    de->data = *len > 0 ? (uint8_t *)memcpy(ofl_malloc(*len), se->data, *len) : NULL;
     *len = 0;
 
     (*msg) = (struct ofl_msg_header *)de;
@@ -80,7 +80,7 @@ ofl_msg_unpack_error(struct ofp_header *src, size_t *len, struct ofl_msg_header
 static ofl_err
 ofl_msg_unpack_echo(struct ofp_header *src, size_t *len, struct ofl_msg_header **msg) {
     
-    struct ofl_msg_echo *e = (struct ofl_msg_echo *)malloc(sizeof(struct ofl_msg_echo));
+    struct ofl_msg_echo *e = (struct ofl_msg_echo *)ofl_malloc(sizeof(struct ofl_msg_echo));
     uint8_t *data;
 
     // ofp_header length was checked at ofl_msg_unpack
@@ -88,7 +88,7 @@ ofl_msg_unpack_echo(struct ofp_header *src, size_t *len, struct ofl_msg_header *
 
     data = (uint8_t *)src + sizeof(struct ofp_header);
     e->data_length = *len;
-    e->data = *len > 0 ? (uint8_t *)memcpy(malloc(*len), data, *len) : NULL;
+    e->data = *len > 0 ? (uint8_t *)memcpy(ofl_malloc(*len), data, *len) : NULL;
     *len = 0;
 
     *msg = (struct ofl_msg_header *)e;
@@ -108,7 +108,7 @@ ofl_msg_unpack_role_request(struct ofp_header *src, size_t *len, struct ofl_msg_
     *len -= sizeof(struct ofp_role_request);    
     
     srl = (struct ofp_role_request *) src;
-    drl = (struct ofl_msg_role_request *) malloc(sizeof(struct ofl_msg_role_request));
+    drl = (struct ofl_msg_role_request *) ofl_malloc(sizeof(struct ofl_msg_role_request));
     
     drl->role = ntohl(srl->role);
     drl->generation_id = ntoh64(srl->generation_id);
@@ -130,7 +130,7 @@ ofl_msg_unpack_features_reply(struct ofp_header *src, size_t *len, struct ofl_ms
     *len -= sizeof(struct ofp_switch_features);
 
     sr = (struct ofp_switch_features *)src;
-    dr = (struct ofl_msg_features_reply *)malloc(sizeof(struct ofl_msg_features_reply));
+    dr = (struct ofl_msg_features_reply *)ofl_malloc(sizeof(struct ofl_msg_features_reply));
 
     dr->datapath_id  = ntoh64(sr->datapath_id);
     dr->n_buffers    = ntohl( sr->n_buffers);
@@ -156,9 +156,9 @@ ofl_msg_unpack_get_config_reply(struct ofp_header *src, size_t *len, struct ofl_
     *len -= sizeof(struct ofp_switch_config);
 
     sr = (struct ofp_switch_config *)src;
-    dr = (struct ofl_msg_get_config_reply *)malloc(sizeof(struct ofl_msg_get_config_reply));
+    dr = (struct ofl_msg_get_config_reply *)ofl_malloc(sizeof(struct ofl_msg_get_config_reply));
 
-    dr->config = (struct ofl_config *)malloc(sizeof(struct ofl_config));
+    dr->config = (struct ofl_config *)ofl_malloc(sizeof(struct ofl_config));
     dr->config->miss_send_len = ntohs(sr->miss_send_len);
     dr->config->flags = ntohs(sr->flags);
 
@@ -179,9 +179,9 @@ ofl_msg_unpack_set_config(struct ofp_header *src, size_t *len, struct ofl_msg_he
      *len -= sizeof(struct ofp_switch_config);
 
      sr = (struct ofp_switch_config *)src;
-     dr = (struct ofl_msg_set_config *)malloc(sizeof(struct ofl_msg_set_config));
+     dr = (struct ofl_msg_set_config *)ofl_malloc(sizeof(struct ofl_msg_set_config));
 
-     dr->config = (struct ofl_config *)malloc(sizeof(struct ofl_config));
+     dr->config = (struct ofl_config *)ofl_malloc(sizeof(struct ofl_config));
      // TODO Zoltan: validate flags
      dr->config->miss_send_len = ntohs(sr->miss_send_len);
      dr->config->flags = ntohs(sr->flags);
@@ -204,8 +204,8 @@ ofl_msg_unpack_async_config(struct ofp_header *src, size_t *len, struct ofl_msg_
     
     *len -= sizeof(struct ofp_async_config);
     sac = (struct ofp_async_config*)src;
-    dac = (struct ofl_msg_async_config*)malloc(sizeof(struct ofl_msg_async_config));
-    dac->config = (struct ofl_async_config*) malloc(sizeof(struct ofl_async_config));
+    dac = (struct ofl_msg_async_config*)ofl_malloc(sizeof(struct ofl_msg_async_config));
+    dac->config = (struct ofl_async_config*) ofl_malloc(sizeof(struct ofl_async_config));
     for(i = 0; i < 2; i++){
         dac->config->packet_in_mask[i] = ntohl(sac->packet_in_mask[i]);
         dac->config->port_status_mask[i] = ntohl(sac->port_status_mask[i]);
@@ -236,7 +236,7 @@ ofl_msg_unpack_packet_in(struct ofp_header *src, uint8_t* buf, size_t *len, stru
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
             char *ps = ofl_port_to_string(ntohl(sp->in_port));
             OFL_LOG_WARN(LOG_MODULE, "Received PACKET_IN message has invalid in_port (%s).", ps);
-            free(ps);
+            ofl_free(ps);
         }
         return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_PORT);
     }*/
@@ -245,12 +245,12 @@ ofl_msg_unpack_packet_in(struct ofp_header *src, uint8_t* buf, size_t *len, stru
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
             char *ts = ofl_table_to_string(sp->table_id);
             OFL_LOG_WARN(LOG_MODULE, "Received PACKET_IN has invalid table_id (%s).", ts);
-            free(ts);
+            ofl_free(ts);
         }
         return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_TABLE_ID);
     }
     *len -= sizeof(struct ofp_packet_in) - sizeof(struct ofp_match);
-    dp = (struct ofl_msg_packet_in *)malloc(sizeof(struct ofl_msg_packet_in));
+    dp = (struct ofl_msg_packet_in *)ofl_malloc(sizeof(struct ofl_msg_packet_in));
     dp->buffer_id = ntohl(sp->buffer_id);
     dp->total_len = ntohs(sp->total_len);
     dp->reason = (enum ofp_packet_in_reason)sp->reason;
@@ -264,7 +264,7 @@ ofl_msg_unpack_packet_in(struct ofp_header *src, uint8_t* buf, size_t *len, stru
     /* Minus padding bytes */
     *len -= 2;
     dp->data_length = *len;
-    dp->data = *len > 0 ? (uint8_t *)memcpy(malloc(*len), ptr, *len) : NULL;
+    dp->data = *len > 0 ? (uint8_t *)memcpy(ofl_malloc(*len), ptr, *len) : NULL;
     *len = 0;
 
     *msg = (struct ofl_msg_header *)dp;
@@ -290,16 +290,16 @@ ofl_msg_unpack_flow_removed(struct ofp_header *src,uint8_t *buf, size_t *len, st
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
             char *ts = ofl_table_to_string(sr->table_id);
             OFL_LOG_WARN(LOG_MODULE, "Received FLOW_REMOVED message has invalid table_id (%s).", ts);
-            free(ts);
+            ofl_free(ts);
         }
         return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_TABLE_ID);
     }
     *len -=  sizeof(struct ofp_flow_removed) - sizeof(struct ofp_match) ;
 
-    dr = (struct ofl_msg_flow_removed *)malloc(sizeof(struct ofl_msg_flow_removed));
+    dr = (struct ofl_msg_flow_removed *)ofl_malloc(sizeof(struct ofl_msg_flow_removed));
     dr->reason = (enum ofp_flow_removed_reason)sr->reason;
 
-    dr->stats = (struct ofl_flow_stats *)malloc(sizeof(struct ofl_flow_stats));
+    dr->stats = (struct ofl_flow_stats *)ofl_malloc(sizeof(struct ofl_flow_stats));
     dr->stats->table_id         =        sr->table_id;
     dr->stats->duration_sec     = ntohl( sr->duration_sec);
     dr->stats->duration_nsec    = ntohl( sr->duration_nsec);
@@ -316,8 +316,8 @@ ofl_msg_unpack_flow_removed(struct ofp_header *src,uint8_t *buf, size_t *len, st
 
     error = ofl_structs_match_unpack(&(sr->match),buf + match_pos, len, &(dr->stats->match), exp);
     if (error) {
-        free(dr->stats);
-        free(dr);
+        ofl_free(dr->stats);
+        ofl_free(dr);
         return error;
     }
     *msg = (struct ofl_msg_header *)dr;
@@ -338,13 +338,13 @@ ofl_msg_unpack_port_status(struct ofp_header *src, size_t *len, struct ofl_msg_h
     *len -= (sizeof(struct ofp_port_status) - sizeof(struct ofp_port));
 
     ss = (struct ofp_port_status *)src;
-    ds = (struct ofl_msg_port_status *)malloc(sizeof(struct ofl_msg_port_status));
+    ds = (struct ofl_msg_port_status *)ofl_malloc(sizeof(struct ofl_msg_port_status));
 
     ds->reason = (enum ofp_port_reason) ss->reason;
 
     error = ofl_structs_port_unpack(&(ss->desc), len, &(ds->desc));
     if (error) {
-        free(ds);
+        ofl_free(ds);
         return error;
     }
 
@@ -374,7 +374,7 @@ ofl_msg_unpack_packet_out(struct ofp_header *src, size_t *len, struct ofl_msg_he
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
             char *ps = ofl_port_to_string(ntohl(sp->in_port));
             OFL_LOG_WARN(LOG_MODULE, "Received PACKET_OUT message with invalid in_port (%s).", ps);
-            free(ps);
+            ofl_free(ps);
         }
         return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_PORT);
     }*/
@@ -384,29 +384,29 @@ ofl_msg_unpack_packet_out(struct ofp_header *src, size_t *len, struct ofl_msg_he
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
             char *bs = ofl_buffer_to_string(ntohl(sp->buffer_id));
             OFL_LOG_WARN(LOG_MODULE, "Received PACKET_OUT message with data and buffer_id (%s).", bs);
-            free(bs);
+            ofl_free(bs);
         }
         return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
     }
     *len -= sizeof(struct ofp_packet_out);
 
-    dp = (struct ofl_msg_packet_out *)malloc(sizeof(struct ofl_msg_packet_out));
+    dp = (struct ofl_msg_packet_out *)ofl_malloc(sizeof(struct ofl_msg_packet_out));
 
     dp->buffer_id = ntohl(sp->buffer_id);
     dp->in_port = ntohl(sp->in_port);	
     if (*len < ntohs(sp->actions_len)) {
         OFL_LOG_WARN(LOG_MODULE, "Received PACKET_OUT message has invalid action length (%zu).", *len);
-        free(dp);
+        ofl_free(dp);
         return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
     }
 
     error = ofl_utils_count_ofp_actions(&(sp->actions), ntohs(sp->actions_len), &actions_num);
     if (error) {
-        free(dp);
+        ofl_free(dp);
         return error;
     }
     dp->actions_num = actions_num;
-    dp->actions = (struct ofl_action_header **)malloc(dp->actions_num * sizeof(struct ofp_action_header *));
+    dp->actions = (struct ofl_action_header **)ofl_malloc(dp->actions_num * sizeof(struct ofp_action_header *));
 
     // TODO Zoltan: Output actions can contain OFPP_TABLE
     act = sp->actions;
@@ -415,13 +415,15 @@ ofl_msg_unpack_packet_out(struct ofp_header *src, size_t *len, struct ofl_msg_he
         if (error) {
             OFL_UTILS_FREE_ARR_FUN2(dp->actions, i,
                                     ofl_actions_free, exp);
-            free(dp);
+            ofl_free(dp);
         }
         act = (struct ofp_action_header *)((uint8_t *)act + ntohs(act->len));
     }
 
     data = ((uint8_t *)sp->actions) + ntohs(sp->actions_len);
     dp->data_length = *len;
+    /* Not from the arena: the packet built from the message adopts the data
+     * and frees it with free(). */
     dp->data = *len > 0 ? (uint8_t *)memcpy(malloc(*len), data, *len) : NULL;
     *len = 0;
 
@@ -449,7 +451,7 @@ ofl_msg_unpack_flow_mod(struct ofp_header *src,uint8_t* buf, size_t *len, struct
     *len -= (sizeof(struct ofp_flow_mod) - sizeof(struct ofp_match));
 
     sm = (struct ofp_flow_mod *)src;
-    dm = (struct ofl_msg_flow_mod *)malloc(sizeof(struct ofl_msg_flow_mod));
+    dm = (struct ofl_msg_flow_mod *)ofl_malloc(sizeof(struct ofl_msg_flow_mod));
 
     if (sm->table_id >= PIPELINE_TABLES && ((sm->command != OFPFC_DELETE
     || sm->command != OFPFC_DELETE_STRICT) && sm->table_id != OFPTT_ALL)) {
@@ -472,18 +474,18 @@ ofl_msg_unpack_flow_mod(struct ofp_header *src,uint8_t* buf, size_t *len, struct
     match_pos = sizeof(struct ofp_flow_mod) - 4;
     error = ofl_structs_match_unpack(&(sm->match), buf + match_pos, len, &(dm->match), exp);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
     
     error = ofl_utils_count_ofp_instructions((struct ofp_instruction *)(buf + ROUND_UP(match_pos + dm->match->length,8)), *len, &dm->instructions_num);
     if (error) {
         ofl_structs_free_match(dm->match, exp);
-        free(dm);
+        ofl_free(dm);
         return error;
     }
         
-    dm->instructions = (struct ofl_instruction_header **)malloc(dm->instructions_num * sizeof(struct ofl_instruction_header *));
+    dm->instructions = (struct ofl_instruction_header **)ofl_malloc(dm->instructions_num * sizeof(struct ofl_instruction_header *));
     inst = (struct ofp_instruction *) (buf + ROUND_UP(match_pos + dm->match->length,8));
     for (i = 0; i < dm->instructions_num; i++) {
         error = ofl_structs_instructions_unpack(inst, len, &(dm->instructions[i]), exp);
@@ -491,7 +493,7 @@ ofl_msg_unpack_flow_mod(struct ofp_header *src,uint8_t* buf, size_t *len, struct
             OFL_UTILS_FREE_ARR_FUN2(dm->instructions, i,
                     ofl_structs_free_instruction, exp);
             ofl_structs_free_match(dm->match, exp);
-            free(dm);
+            ofl_free(dm);
             return error;
         }
         inst = (struct ofp_instruction *)((uint8_t *)inst + ntohs(inst->len));
@@ -532,12 +534,12 @@ ofl_msg_unpack_group_mod(struct ofp_header *src, size_t *len, struct ofl_msg_hea
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
             char *gs = ofl_group_to_string(ntohl(sm->group_id));
             OFL_LOG_WARN(LOG_MODULE, "Received GROUP_MOD message with invalid group id (%s).", gs);
-            free(gs);
+            ofl_free(gs);
         }
         return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_INVALID_GROUP);
     }
 
-    dm = (struct ofl_msg_group_mod *)malloc(sizeof(struct ofl_msg_group_mod));
+    dm = (struct ofl_msg_group_mod *)ofl_malloc(sizeof(struct ofl_msg_group_mod));
 
     dm->command = (enum ofp_group_mod_command)((int)ntohs(sm->command));
     dm->type = sm->type;
@@ -545,23 +547,23 @@ ofl_msg_unpack_group_mod(struct ofp_header *src, size_t *len, struct ofl_msg_hea
 
     error = ofl_utils_count_ofp_buckets(&(sm->buckets), *len, &dm->buckets_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
 
     if (dm->command == OFPGC_DELETE && dm->buckets_num > 0) {
         OFL_LOG_WARN(LOG_MODULE, "Received DELETE group command with buckets (%zu).", dm->buckets_num);
-        free(dm);
+        ofl_free(dm);
         return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_INVALID_GROUP);
     }
 
     if (dm->type == OFPGT_INDIRECT && dm->buckets_num != 1) {
         OFL_LOG_WARN(LOG_MODULE, "Received INDIRECT group doesn't have exactly one bucket (%zu).", dm->buckets_num);
-        free(dm);
+        ofl_free(dm);
         return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_INVALID_GROUP);
     }
 
-    dm->buckets = (struct ofl_bucket **)malloc(dm->buckets_num * sizeof(struct ofl_bucket *));
+    dm->buckets = (struct ofl_bucket **)ofl_malloc(dm->buckets_num * sizeof(struct ofl_bucket *));
 
     bucket = sm->buckets;
     for (i = 0; i < dm->buckets_num; i++) {
@@ -569,7 +571,7 @@ ofl_msg_unpack_group_mod(struct ofp_header *src, size_t *len, struct ofl_msg_hea
         if (error) {
             OFL_UTILS_FREE_ARR_FUN2(dm->buckets, i,
                                     ofl_structs_free_bucket, exp);
-            free(dm);
+            ofl_free(dm);
             return error;
         }
         bucket = (struct ofp_bucket *)((uint8_t *)bucket + ntohs(bucket->len));
@@ -611,7 +613,7 @@ ofl_msg_unpack_meter_mod(struct ofp_header *src, size_t *len, struct ofl_msg_hea
         return ofl_error(OFPET_METER_MOD_FAILED, OFPMMFC_INVALID_METER);
     }
 
-    dm = (struct ofl_msg_meter_mod *)malloc(sizeof(struct ofl_msg_meter_mod));
+    dm = (struct ofl_msg_meter_mod *)ofl_malloc(sizeof(struct ofl_msg_meter_mod));
 
     dm->command = ntohs(sm->command);
     dm->flags = ntohs(sm->flags);
@@ -619,11 +621,11 @@ ofl_msg_unpack_meter_mod(struct ofp_header *src, size_t *len, struct ofl_msg_hea
 
     error = ofl_utils_count_ofp_meter_bands(&(sm->bands), *len, &dm->meter_bands_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
 
-    dm->bands = (struct ofl_meter_band_header **)malloc(dm->meter_bands_num * sizeof(struct ofl_meter_band_header *));
+    dm->bands = (struct ofl_meter_band_header **)ofl_malloc(dm->meter_bands_num * sizeof(struct ofl_meter_band_header *));
 
     band = sm->bands;
     for (i = 0; i < dm->meter_bands_num; i++) {
@@ -631,7 +633,7 @@ ofl_msg_unpack_meter_mod(struct ofp_header *src, size_t *len, struct ofl_msg_hea
         if (error) {
             OFL_UTILS_FREE_ARR_FUN(dm->bands, i,
             		ofl_structs_free_meter_bands);
-            free(dm);
+            ofl_free(dm);
             return error;
         }
         band = (struct ofp_meter_band_header *)((uint8_t *)band + ntohs(band->len));
@@ -658,13 +660,13 @@ ofl_msg_unpack_port_mod(struct ofp_header *src, size_t *len, struct ofl_msg_head
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
             char *ps = ofl_port_to_string(ntohl(sm->port_no));
             OFL_LOG_WARN(LOG_MODULE, "Received PORT_MOD message has invalid in_port (%s).", ps);
-            free(ps);
+            ofl_free(ps);
         }
         return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_PORT);
     }*/
     *len -= sizeof(struct ofp_port_mod);
 
-    dm = (struct ofl_msg_port_mod *)malloc(sizeof(struct ofl_msg_port_mod));
+    dm = (struct ofl_msg_port_mod *)ofl_malloc(sizeof(struct ofl_msg_port_mod));
 
     dm->port_no =   ntohl(sm->port_no);
     memcpy(dm->hw_addr, sm->hw_addr, OFP_ETH_ALEN);
@@ -689,7 +691,7 @@ ofl_msg_unpack_table_mod(struct ofp_header *src, size_t *len, struct ofl_msg_hea
     *len -= sizeof(struct ofp_table_mod);
 
     sm = (struct ofp_table_mod *)src;
-    dm = (struct ofl_msg_table_mod *)malloc(sizeof(struct ofl_msg_table_mod));
+    dm = (struct ofl_msg_table_mod *)ofl_malloc(sizeof(struct ofl_msg_table_mod));
     if (sm->table_id >= PIPELINE_TABLES) {
         OFL_LOG_WARN(LOG_MODULE, "Received TABLE_MOD message has invalid table id (%d).", sm->table_id );
         return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_TABLE_ID);
@@ -719,7 +721,7 @@ ofl_msg_unpack_multipart_request_flow(struct ofp_multipart_request *os, uint8_t*
     *len -= (sizeof(struct ofp_flow_stats_request) - sizeof(struct ofp_match));
 
     sm = (struct ofp_flow_stats_request *)os->body;
-    dm = (struct ofl_msg_multipart_request_flow *) malloc(sizeof(struct ofl_msg_multipart_request_flow));
+    dm = (struct ofl_msg_multipart_request_flow *) ofl_malloc(sizeof(struct ofl_msg_multipart_request_flow));
 
     if (sm->table_id != OFPTT_ALL && sm->table_id >= PIPELINE_TABLES) {
          OFL_LOG_WARN(LOG_MODULE, "Received MULTIPART REQUEST FLOW message has invalid table id (%d).", sm->table_id );
@@ -735,7 +737,7 @@ ofl_msg_unpack_multipart_request_flow(struct ofp_multipart_request *os, uint8_t*
     match_pos = sizeof(struct ofp_multipart_request) + sizeof(struct ofp_flow_stats_request) - 4;
     error = ofl_structs_match_unpack(&(sm->match),buf + match_pos, len, &(dm->match), exp);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
 
@@ -766,7 +768,7 @@ ofl_msg_unpack_multipart_request_port(struct ofp_multipart_request *os, size_t *
 
     *len -= sizeof(struct ofp_port_stats_request);
 
-    dm = (struct ofl_msg_multipart_request_port *) malloc(sizeof(struct ofl_msg_multipart_request_port));
+    dm = (struct ofl_msg_multipart_request_port *) ofl_malloc(sizeof(struct ofl_msg_multipart_request_port));
 
     dm->port_no = ntohl(sm->port_no);
 
@@ -780,7 +782,7 @@ ofl_msg_unpack_multipart_request_empty(struct ofp_multipart_request *os UNUSED,
     // ofp_multipart_request length was checked at ofl_msg_unpack_multipart_request
     len -= sizeof(struct ofp_multipart_request);
 
-    *msg = (struct ofl_msg_header *)malloc(sizeof(struct ofl_msg_multipart_request_header));
+    *msg = (struct ofl_msg_header *)ofl_malloc(sizeof(struct ofl_msg_multipart_request_header));
     return 0;
 }
 
@@ -791,7 +793,7 @@ ofl_msg_unpack_multipart_request_table_features(struct ofp_multipart_request *os
     ofl_err error;
     uint8_t *features;
     size_t i;
-    dm = (struct ofl_msg_multipart_request_table_features*) malloc(sizeof(struct ofl_msg_multipart_request_table_features));
+    dm = (struct ofl_msg_multipart_request_table_features*) ofl_malloc(sizeof(struct ofl_msg_multipart_request_table_features));
     if (!(*len)){
         dm->tables_num = 0;
         dm->table_features = NULL;
@@ -801,10 +803,10 @@ ofl_msg_unpack_multipart_request_table_features(struct ofp_multipart_request *os
     
     error = ofl_utils_count_ofp_table_features((uint8_t*) os->body, *len, &dm->tables_num);  
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->table_features = (struct ofl_table_features **) malloc(sizeof(struct ofl_table_features *) * dm->tables_num);
+    dm->table_features = (struct ofl_table_features **) ofl_malloc(sizeof(struct ofl_table_features *) * dm->tables_num);
     features = (uint8_t* ) os->body;
 
     for(i = 0; i < dm->tables_num; i++){
@@ -812,7 +814,7 @@ ofl_msg_unpack_multipart_request_table_features(struct ofp_multipart_request *os
         if (error) {
             OFL_UTILS_FREE_ARR_FUN2(dm->table_features, i,
                                     ofl_structs_free_table_features, exp);
-            free(dm);
+            ofl_free(dm);
             return error;
         }
         features += ntohs(((struct ofp_table_features*) features)->length); 
@@ -843,7 +845,7 @@ ofl_msg_unpack_multipart_request_queue(struct ofp_multipart_request *os, size_t
     }
     *len -= sizeof(struct ofp_queue_stats_request);
 
-    dm = (struct ofl_msg_multipart_request_queue *) malloc(sizeof(struct ofl_msg_multipart_request_queue));
+    dm = (struct ofl_msg_multipart_request_queue *) ofl_malloc(sizeof(struct ofl_msg_multipart_request_queue));
 
     dm->port_no = ntohl(sm->port_no);
     dm->queue_id = ntohl(sm->queue_id);
@@ -867,7 +869,7 @@ ofl_msg_unpack_multipart_request_group(struct ofp_multipart_request *os, size_t
     *len -= sizeof(struct ofp_group_stats_request);
 
     sm = (struct ofp_group_stats_request *)os->body;
-    dm = (struct ofl_msg_multipart_request_group *) malloc(sizeof(struct ofl_msg_multipart_request_group));
+    dm = (struct ofl_msg_multipart_request_group *) ofl_malloc(sizeof(struct ofl_msg_multipart_request_group));
 
     dm->group_id = ntohl(sm->group_id);
 
@@ -890,7 +892,7 @@ ofl_msg_unpack_meter_multipart_request(struct ofp_multipart_request *os, size_t
     *len -= sizeof(struct ofp_meter_multipart_request);
 
     sm = (struct ofp_meter_multipart_request *)os->body;
-    dm = (struct ofl_msg_multipart_meter_request *) malloc(sizeof(struct ofl_msg_multipart_meter_request));
+    dm = (struct ofl_msg_multipart_meter_request *) ofl_malloc(sizeof(struct ofl_msg_multipart_meter_request));
 
     dm->meter_id = ntohl(sm->meter_id);
 
@@ -965,7 +967,7 @@ ofl_msg_unpack_multipart_request(struct ofp_header *src,uint8_t *buf, size_t *le
             break;
         }        
         case OFPMP_EXPERIMENTER: {
-            if (exp == NULL || exp->stats == NULL || exp->stats->reply_unpack == NULL) {
+            if (exp == NULL || exp->stats == NULL || exp->stats->req_unpack == NULL) {
                 OFL_LOG_WARN(LOG_MODULE, "Received EXPERIMENTER stats request, but no callback was given.");
                 error = ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_MULTIPART);
             } else {
@@ -1002,13 +1004,13 @@ ofl_msg_unpack_reply_desc(struct ofp_multipart_reply *os, size_t *len, struct of
     *len -= sizeof(struct ofp_desc);
 
     sm = (struct ofp_desc *)os->body;
-    dm = (struct ofl_msg_reply_desc *) malloc(sizeof(struct ofl_msg_reply_desc));
+    dm = (struct ofl_msg_reply_desc *) ofl_malloc(sizeof(struct ofl_msg_reply_desc));
 
-    dm->mfr_desc =   (char *)strcpy((char *)malloc(strlen(sm->mfr_desc) + 1), sm->mfr_desc);
-    dm->hw_desc =    (char *)strcpy((char *)malloc(strlen(sm->hw_desc) + 1), sm->hw_desc);
-    dm->sw_desc =    (char *)strcpy((char *)malloc(strlen(sm->sw_desc) + 1), sm->sw_desc);
-    dm->serial_num = (char *)strcpy((char *)malloc(strlen(sm->serial_num) + 1), sm->serial_num);
-    dm->dp_desc =    (char *)strcpy((char *)malloc(strlen(sm->dp_desc) + 1), sm->dp_desc);
+    dm->mfr_desc =   (char *)strcpy((char *)ofl_malloc(strlen(sm->mfr_desc) + 1), sm->mfr_desc);
+    dm->hw_desc =    (char *)strcpy((char *)ofl_malloc(strlen(sm->hw_desc) + 1), sm->hw_desc);
+    dm->sw_desc =    (char *)strcpy((char *)ofl_malloc(strlen(sm->sw_desc) + 1), sm->sw_desc);
+    dm->serial_num = (char *)strcpy((char *)ofl_malloc(strlen(sm->serial_num) + 1), sm->serial_num);
+    dm->dp_desc =    (char *)strcpy((char *)ofl_malloc(strlen(sm->dp_desc) + 1), sm->dp_desc);
 
     *msg = (struct ofl_msg_header *)dm;
     return 0;
@@ -1026,14 +1028,14 @@ ofl_msg_unpack_multipart_reply_flow(struct ofp_multipart_reply *os, uint8_t *buf
 
     // ofp_multipart_reply was already checked and subtracted in unpack_multipart_reply
     stat = (struct ofp_flow_stats *)os->body;
-    dm = (struct ofl_msg_multipart_reply_flow *)malloc(sizeof(struct ofl_msg_multipart_reply_flow));
+    dm = (struct ofl_msg_multipart_reply_flow *)ofl_malloc(sizeof(struct ofl_msg_multipart_reply_flow));
 
     error = ofl_utils_count_ofp_flow_stats(stat, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->stats = (struct ofl_flow_stats **)malloc(dm->stats_num * sizeof(struct ofl_flow_stats *));
+    dm->stats = (struct ofl_flow_stats **)ofl_malloc(dm->stats_num * sizeof(struct ofl_flow_stats *));
 
     ini_len = *len;
     ptr = buf + sizeof(struct ofp_multipart_reply);
@@ -1069,7 +1071,7 @@ ofl_msg_unpack_multipart_reply_aggregate(struct ofp_multipart_reply *os, size_t
     *len -= sizeof(struct ofp_aggregate_stats_reply);
 
     sm = (struct ofp_aggregate_stats_reply *)os->body;
-    dm = (struct ofl_msg_multipart_reply_aggregate *) malloc(sizeof(struct ofl_msg_multipart_reply_aggregate));
+    dm = (struct ofl_msg_multipart_reply_aggregate *) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_aggregate));
 
     dm->packet_count = ntoh64(sm->packet_count);
     dm->byte_count =   ntoh64(sm->byte_count);
@@ -1090,20 +1092,20 @@ ofl_msg_unpack_multipart_reply_table(struct ofp_multipart_reply *os, size_t *len
     // ofp_multipart_reply was already checked and subtracted in unpack_multipart_reply
 
     stat = (struct ofp_table_stats *)os->body;
-    dm = (struct ofl_msg_multipart_reply_table *) malloc(sizeof(struct ofl_msg_multipart_reply_table));
+    dm = (struct ofl_msg_multipart_reply_table *) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_table));
 
     error = ofl_utils_count_ofp_table_stats(stat, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->stats = (struct ofl_table_stats **)malloc(dm->stats_num * sizeof(struct ofl_table_stats *));
+    dm->stats = (struct ofl_table_stats **)ofl_malloc(dm->stats_num * sizeof(struct ofl_table_stats *));
 
     for (i = 0; i < dm->stats_num; i++) {
         error = ofl_structs_table_stats_unpack(stat, len, &(dm->stats[i]));
         if (error) {
             OFL_UTILS_FREE_ARR(dm->stats, i);
-            free(dm);
+            ofl_free(dm);
             return error;
         }
         stat = (struct ofp_table_stats *)((uint8_t *)stat + sizeof(struct ofp_table_stats));
@@ -1117,7 +1119,7 @@ static ofl_err
 ofl_msg_unpack_multipart_reply_port(struct ofp_multipart_reply *os, size_t *len, struct ofl_msg_header **msg) {
     
     struct ofp_port_stats *stat = (struct ofp_port_stats *)os->body;
-    struct ofl_msg_multipart_reply_port *dm = (struct ofl_msg_multipart_reply_port *) malloc(sizeof(struct ofl_msg_multipart_reply_port));
+    struct ofl_msg_multipart_reply_port *dm = (struct ofl_msg_multipart_reply_port *) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_port));
     ofl_err error;
     size_t i;
 
@@ -1127,17 +1129,17 @@ ofl_msg_unpack_multipart_reply_port(struct ofp_multipart_reply *os, size_t *len,
 
     error = ofl_utils_count_ofp_port_stats(stat, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
 
-    dm->stats = (struct ofl_port_stats **)malloc(dm->stats_num * sizeof(struct ofl_port_stats *));
+    dm->stats = (struct ofl_port_stats **)ofl_malloc(dm->stats_num * sizeof(struct ofl_port_stats *));
 
     for (i = 0; i < dm->stats_num; i++) {
         error = ofl_structs_port_stats_unpack(stat, len, &(dm->stats[i]));
         if (error) {
             OFL_UTILS_FREE_ARR(dm->stats, i);
-            free(dm);
+            ofl_free(dm);
             return error;
         }
         stat = (struct ofp_port_stats *)((uint8_t *)stat + sizeof(struct ofp_port_stats));
@@ -1151,7 +1153,7 @@ static ofl_err
 ofl_msg_unpack_multipart_reply_queue(struct ofp_multipart_reply *os, size_t *len, struct ofl_msg_header **msg) {
     
     struct ofp_queue_stats *stat = (struct ofp_queue_stats *)os->body;
-    struct ofl_msg_multipart_reply_queue *dm = (struct ofl_msg_multipart_reply_queue *) malloc(sizeof(struct ofl_msg_multipart_reply_queue));
+    struct ofl_msg_multipart_reply_queue *dm = (struct ofl_msg_multipart_reply_queue *) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_queue));
     ofl_err error;
     size_t i;
 
@@ -1161,15 +1163,15 @@ ofl_msg_unpack_multipart_reply_queue(struct ofp_multipart_reply *os, size_t *len
 
     error = ofl_utils_count_ofp_queue_stats(stat, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->stats = (struct ofl_queue_stats **)malloc(dm->stats_num * sizeof(struct ofl_queue_stats *));
+    dm->stats = (struct ofl_queue_stats **)ofl_malloc(dm->stats_num * sizeof(struct ofl_queue_stats *));
     for (i = 0; i < dm->stats_num; i++) {
         error = ofl_structs_queue_stats_unpack(stat, len, &(dm->stats[i]));
         if (error) {
             OFL_UTILS_FREE_ARR(dm->stats, i);
-            free(dm);
+            ofl_free(dm);
             return error;
         }
         stat = (struct ofp_queue_stats *)((uint8_t *)stat + sizeof(struct ofp_queue_stats));
@@ -1190,14 +1192,14 @@ ofl_msg_unpack_multipart_reply_group(struct ofp_multipart_reply *os, size_t *len
     // ofp_multipart_reply was already checked and subtracted in unpack_multipart_reply
 
     stat = (struct ofp_group_stats *)os->body;
-    dm = (struct ofl_msg_multipart_reply_group *) malloc(sizeof(struct ofl_msg_multipart_reply_group));
+    dm = (struct ofl_msg_multipart_reply_group *) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_group));
 
     error = ofl_utils_count_ofp_group_stats(stat, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->stats = (struct ofl_group_stats **)malloc(dm->stats_num * sizeof(struct ofl_group_stats *));
+    dm->stats = (struct ofl_group_stats **)ofl_malloc(dm->stats_num * sizeof(struct ofl_group_stats *));
 
     for (i = 0; i < dm->stats_num; i++) {
         error = ofl_structs_group_stats_unpack(stat, len, &(dm->stats[i]));
@@ -1225,14 +1227,14 @@ ofl_msg_unpack_multipart_reply_group_desc(struct ofp_multipart_reply *os, size_t
     // ofp_multipart_reply was already checked and subtracted in unpack_multipart_reply
 
     stat = (struct ofp_group_desc_stats *)os->body;
-    dm = (struct ofl_msg_multipart_reply_group_desc *) malloc(sizeof(struct ofl_msg_multipart_reply_group_desc));
+    dm = (struct ofl_msg_multipart_reply_group_desc *) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_group_desc));
 
     error = ofl_utils_count_ofp_group_desc_stats(stat, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->stats = (struct ofl_group_desc_stats **)malloc(dm->stats_num * sizeof(struct ofl_group_desc_stats *));
+    dm->stats = (struct ofl_group_desc_stats **)ofl_malloc(dm->stats_num * sizeof(struct ofl_group_desc_stats *));
 
     for (i = 0; i < dm->stats_num; i++) {
         error = ofl_structs_group_desc_stats_unpack(stat, len, &(dm->stats[i]), exp);
@@ -1262,7 +1264,7 @@ ofl_msg_unpack_multipart_reply_group_features(struct ofp_multipart_reply *os, si
     *len -= sizeof(struct ofp_group_features);
 
     sm = (struct ofp_group_features *)os->body;
-    dm = (struct ofl_msg_multipart_reply_group_features *) malloc(sizeof(struct ofl_msg_multipart_reply_group_features));
+    dm = (struct ofl_msg_multipart_reply_group_features *) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_group_features));
     
     dm->types = ntohl(sm->types);
     dm->capabilities = ntohl(sm->capabilities);
@@ -1283,14 +1285,14 @@ ofl_msg_unpack_multipart_reply_table_features(struct ofp_multipart_reply *src, s
 	ofl_err error;
 	uint8_t *features; 
 	
-    dm = (struct ofl_msg_multipart_reply_table_features*) malloc(sizeof(struct ofl_msg_multipart_reply_table_features) );
+    dm = (struct ofl_msg_multipart_reply_table_features*) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_table_features) );
     
     error = ofl_utils_count_ofp_table_features((uint8_t*) src->body, *len, &dm->tables_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->table_features = (struct ofl_table_features **) malloc(sizeof(struct ofl_table_features *) * dm->tables_num);
+    dm->table_features = (struct ofl_table_features **) ofl_malloc(sizeof(struct ofl_table_features *) * dm->tables_num);
     features = (uint8_t* ) src->body;
 
     for(i = 0; i < dm->tables_num; i++){
@@ -1298,7 +1300,7 @@ ofl_msg_unpack_multipart_reply_table_features(struct ofp_multipart_reply *src, s
         if (error) {
             OFL_UTILS_FREE_ARR_FUN2(dm->table_features, i,
                                     ofl_structs_free_table_features, exp);
-            free(dm);
+            ofl_free(dm);
             return error;
         }
         features += ntohs(((struct ofp_table_features*) features)->length); 
@@ -1318,14 +1320,14 @@ ofl_msg_unpack_multipart_reply_meter_stats(struct ofp_multipart_reply *os, size_
     // ofp_multipart_reply was already checked and subtracted in unpack_multipart_reply
 
     stat = (struct ofp_meter_stats *)os->body;
-    dm = (struct ofl_msg_multipart_reply_meter *) malloc(sizeof(struct ofl_msg_multipart_reply_meter));
+    dm = (struct ofl_msg_multipart_reply_meter *) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_meter));
 
     error = ofl_utils_count_ofp_meter_stats(stat, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->stats = (struct ofl_meter_stats **)malloc(dm->stats_num * sizeof(struct ofl_meter_stats *));
+    dm->stats = (struct ofl_meter_stats **)ofl_malloc(dm->stats_num * sizeof(struct ofl_meter_stats *));
 
     for (i = 0; i < dm->stats_num; i++) {
         error = ofl_structs_meter_stats_unpack(stat, len, &(dm->stats[i]));
@@ -1351,15 +1353,15 @@ ofl_msg_unpack_multipart_reply_meter_config(struct ofp_multipart_reply *os, size
     size_t i;
     
     conf = (struct ofp_meter_config*) os->body;
-    dm =  (struct ofl_msg_multipart_reply_meter_conf *) malloc(sizeof(struct ofl_msg_multipart_reply_meter_conf));
+    dm =  (struct ofl_msg_multipart_reply_meter_conf *) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_meter_conf));
    
     error = ofl_utils_count_ofp_meter_config(conf, *len, &dm->stats_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }    
     
-    dm->stats = (struct ofl_meter_config **)malloc(dm->stats_num * sizeof(struct ofl_meter_config *));
+    dm->stats = (struct ofl_meter_config **)ofl_malloc(dm->stats_num * sizeof(struct ofl_meter_config *));
     
     for (i = 0; i < dm->stats_num; i++) {
         error = ofl_structs_meter_config_unpack(conf, len, &(dm->stats[i]));
@@ -1385,15 +1387,15 @@ ofl_msg_unpack_multipart_reply_port_desc(struct ofp_multipart_reply *src, size_t
     ofl_err error;
 	size_t i;
 	port = (struct ofp_port* )src->body;
-	pd = (struct ofl_msg_multipart_reply_port_desc*) malloc(sizeof(struct ofl_msg_multipart_reply_port_desc));
+	pd = (struct ofl_msg_multipart_reply_port_desc*) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_port_desc));
     
 	error = ofl_utils_count_ofp_ports(port, *len, &pd->stats_num);
     if (error) {
-        free(pd);
+        ofl_free(pd);
         return error;
     }    
     	
-    pd->stats = (struct ofl_port**) malloc(pd->stats_num * sizeof(struct ofl_port));
+    pd->stats = (struct ofl_port**) ofl_malloc(pd->stats_num * sizeof(struct ofl_port));
 	for(i = 0; i < pd->stats_num; i++){
 		error = ofl_structs_port_unpack(port, len, &pd->stats[i]); 
         if (error) {
@@ -1421,8 +1423,8 @@ ofl_msg_unpack_multipart_reply_meter_features(struct ofp_multipart_reply *os, si
 
     *len -= sizeof(struct ofp_meter_features);
     src = (struct ofp_meter_features*) os->body;
-    dst = (struct ofl_msg_multipart_reply_meter_features*) malloc(sizeof(struct ofl_msg_multipart_reply_meter_features));
-    dst->features = (struct ofl_meter_features*) malloc(sizeof(struct ofl_meter_features));
+    dst = (struct ofl_msg_multipart_reply_meter_features*) ofl_malloc(sizeof(struct ofl_msg_multipart_reply_meter_features));
+    dst->features = (struct ofl_meter_features*) ofl_malloc(sizeof(struct ofl_meter_features));
 
     dst->features->max_meter = ntohl(src->max_meter);
     dst->features->band_types = ntohl(src->band_types);
@@ -1548,7 +1550,7 @@ ofl_msg_unpack_queue_get_config_request(struct ofp_header *src, size_t *len, str
     }
     *len -= sizeof(struct ofp_queue_get_config_request);
 
-    dr = (struct ofl_msg_queue_get_config_request *)malloc(sizeof(struct ofl_msg_queue_get_config_request));
+    dr = (struct ofl_msg_queue_get_config_request *)ofl_malloc(sizeof(struct ofl_msg_queue_get_config_request));
 
     dr->port = ntohl(sr->port);
 
@@ -1572,16 +1574,16 @@ ofl_msg_unpack_queue_get_config_reply(struct ofp_header *src, size_t *len, struc
     *len -= sizeof(struct ofp_queue_get_config_reply);
 
     sr = (struct ofp_queue_get_config_reply *)src;
-    dr = (struct ofl_msg_queue_get_config_reply *)malloc(sizeof(struct ofl_msg_queue_get_config_reply));
+    dr = (struct ofl_msg_queue_get_config_reply *)ofl_malloc(sizeof(struct ofl_msg_queue_get_config_reply));
 
     dr->port = ntohl(sr->port);
 
     error = ofl_utils_count_ofp_packet_queues(&(sr->queues), *len, &dr->queues_num);
     if (error) {
-        free(dr);
+        ofl_free(dr);
         return error;
     }
-    dr->queues = (struct ofl_packet_queue **)malloc(dr->queues_num * sizeof(struct ofl_packet_queue *));
+    dr->queues = (struct ofl_packet_queue **)ofl_malloc(dr->queues_num * sizeof(struct ofl_packet_queue *));
 
     queue = sr->queues;
     for (i = 0; i < dr->queues_num; i++) {
@@ -1606,7 +1608,7 @@ ofl_msg_unpack_empty(struct ofp_header *src UNUSED, size_t *len, struct ofl_msg_
     // ofp_header length was checked at ofl_msg_unpack
     *len -= sizeof(struct ofp_header);
 
-    *msg = (struct ofl_msg_header *)malloc(sizeof(struct ofl_msg_header));
+    *msg = (struct ofl_msg_header *)ofl_malloc(sizeof(struct ofl_msg_header));
     return 0;
 }
 
@@ -1754,7 +1756,7 @@ ofl_msg_unpack(uint8_t *buf, size_t buf_len, struct ofl_msg_header **msg, uint32
 
             OFL_LOG_DBG(LOG_MODULE, "Error happened after processing %zu bytes of packet.", ntohs(oh->length) - len);
             OFL_LOG_DBG(LOG_MODULE, "\n%s\n", str);
-            free(str);
+            ofl_free(str);
         }
         return error;
     }
@@ -1769,7 +1771,7 @@ ofl_msg_unpack(uint8_t *buf, size_t buf_len, struct ofl_msg_header **msg, uint32
 
             OFL_LOG_DBG(LOG_MODULE, "Error happened after processing %zu bytes of packet.", ntohs(oh->length) - len);
             OFL_LOG_DBG(LOG_MODULE, "\n%s\n", str);
-            free(str);
+            ofl_free(str);
         }
     }
 
@@ -1777,3 +1779,13 @@ ofl_msg_unpack(uint8_t *buf, size_t buf_len, struct ofl_msg_header **msg, uint32
 
     return 0;
 }
+
+ofl_err
+ofl_msg_unpack_arena(uint8_t *buf, size_t buf_len, struct ofl_msg_header **msg,
+                     uint32_t *xid, struct ofl_exp *exp, struct ofl_arena *arena) {
+    struct ofl_arena *prev = ofl_arena_use(arena);
+    ofl_err error = ofl_msg_unpack(buf, buf_len, msg, xid, exp);
+
+    ofl_arena_use(prev);
+    return error;
+}
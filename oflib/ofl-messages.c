@@ -48,8 +48,8 @@ OFL_LOG_INIT(LOG_MODULE)
  * structures. */
 static int
 ofl_msg_free_error(struct ofl_msg_error *msg) {
-    free(msg->data);
-    free(msg);
+    ofl_free(msg->data);
+    ofl_free(msg);
 
     return 0;
 }
@@ -94,7 +94,7 @@ ofl_msg_free_multipart_request(struct ofl_msg_multipart_request_header *msg, str
         default:
             return -1;
     }
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
@@ -107,11 +107,11 @@ ofl_msg_free_multipart_reply(struct ofl_msg_multipart_reply_header *msg, struct
     switch (msg->type) {
         case OFPMP_DESC: {
             struct ofl_msg_reply_desc *stat = (struct ofl_msg_reply_desc *) msg;
-            free(stat->mfr_desc);
-            free(stat->hw_desc);
-            free(stat->sw_desc);
-            free(stat->serial_num);
-            free(stat->dp_desc);
+            ofl_free(stat->mfr_desc);
+            ofl_free(stat->hw_desc);
+            ofl_free(stat->sw_desc);
+            ofl_free(stat->serial_num);
+            ofl_free(stat->dp_desc);
             break;
         }
         case OFPMP_FLOW: {
@@ -158,7 +158,7 @@ ofl_msg_free_multipart_reply(struct ofl_msg_multipart_reply_header *msg, struct
         }
         case OFPMP_METER_FEATURES:{
             struct ofl_msg_multipart_reply_meter_features *feat = (struct ofl_msg_multipart_reply_meter_features *)msg;
-            free(feat->features);
+            ofl_free(feat->features);
             break;
         }
         case OFPMP_GROUP_DESC: {
@@ -180,7 +180,7 @@ ofl_msg_free_multipart_reply(struct ofl_msg_multipart_reply_header *msg, struct
             break;        
         }
         case OFPMP_EXPERIMENTER: {
-            if (exp == NULL || exp->stats || exp->stats->reply_free == NULL) {
+            if (exp == NULL || exp->stats == NULL || exp->stats->reply_free == NULL) {
                 OFL_LOG_WARN(LOG_MODULE, "Trying to free EXPERIMENTER stats reply, but no callback was given.");
                 break;
             }
@@ -195,7 +195,7 @@ ofl_msg_free_multipart_reply(struct ofl_msg_multipart_reply_header *msg, struct
         }
     }
 
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
@@ -211,7 +211,7 @@ ofl_msg_free(struct ofl_msg_header *msg, struct ofl_exp *exp) {
         }
         case OFPT_ECHO_REQUEST:
         case OFPT_ECHO_REPLY: {
-            free(((struct ofl_msg_echo *)msg)->data);
+            ofl_free(((struct ofl_msg_echo *)msg)->data);
             break;
         }
         case OFPT_EXPERIMENTER: {
@@ -232,16 +232,16 @@ ofl_msg_free(struct ofl_msg_header *msg, struct ofl_exp *exp) {
             break;
         }
         case OFPT_GET_CONFIG_REPLY: {
-            free(((struct ofl_msg_get_config_reply *)msg)->config);
+            ofl_free(((struct ofl_msg_get_config_reply *)msg)->config);
             break;
         }
         case OFPT_SET_CONFIG: {
-            free(((struct ofl_msg_set_config *)msg)->config);
+            ofl_free(((struct ofl_msg_set_config *)msg)->config);
             break;
         }
         case OFPT_PACKET_IN: {
             ofl_structs_free_match(((struct ofl_msg_packet_in *)msg)->match,NULL);
-            free(((struct ofl_msg_packet_in *)msg)->data);
+            ofl_free(((struct ofl_msg_packet_in *)msg)->data);
             break;
         }
         case OFPT_FLOW_REMOVED: {
@@ -249,7 +249,7 @@ ofl_msg_free(struct ofl_msg_header *msg, struct ofl_exp *exp) {
             break;
         }
         case OFPT_PORT_STATUS: {
-            free(((struct ofl_msg_port_status *)msg)->desc);
+            ofl_free(((struct ofl_msg_port_status *)msg)->desc);
             break;
         }
         case OFPT_PACKET_OUT: {
@@ -297,7 +297,7 @@ ofl_msg_free(struct ofl_msg_header *msg, struct ofl_exp *exp) {
         }
     }
     
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
@@ -307,19 +307,19 @@ ofl_msg_free_meter_mod(struct ofl_msg_meter_mod * msg, bool with_bands){
        OFL_UTILS_FREE_ARR_FUN(msg->bands, msg->meter_bands_num,
                                   ofl_structs_free_meter_bands);
     }
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
 int
 ofl_msg_free_packet_out(struct ofl_msg_packet_out *msg, bool with_data, struct ofl_exp *exp) {
     if (with_data) {
-        free(msg->data);
+        ofl_free(msg->data);
     }
     OFL_UTILS_FREE_ARR_FUN2(msg->actions, msg->actions_num,
                             ofl_actions_free, exp);
 
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
@@ -330,7 +330,7 @@ ofl_msg_free_group_mod(struct ofl_msg_group_mod *msg, bool with_buckets, struct
                                 ofl_structs_free_bucket, exp);
     }
 
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
@@ -344,17 +344,35 @@ ofl_msg_free_flow_mod(struct ofl_msg_flow_mod *msg, bool with_match, bool with_i
                                 ofl_structs_free_instruction, exp);
     }
 
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
+void
+ofl_msg_flow_mod_copy_out(struct ofl_msg_flow_mod *msg) {
+    size_t i;
+
+    msg->match = ofl_structs_match_copy_out(msg->match);
+    if (ofl_arena_owns(msg->instructions)) {
+        struct ofl_instruction_header **insts =
+                malloc(msg->instructions_num * sizeof(struct ofl_instruction_header *));
+
+        memcpy(insts, msg->instructions,
+               msg->instructions_num * sizeof(struct ofl_instruction_header *));
+        msg->instructions = insts;
+    }
+    for (i = 0; i < msg->instructions_num; i++) {
+        msg->instructions[i] = ofl_structs_instruction_copy_out(msg->instructions[i]);
+    }
+}
+
 
 int
 ofl_msg_free_flow_removed(struct ofl_msg_flow_removed *msg, bool with_stats, struct ofl_exp *exp) {
     if (with_stats) {
         ofl_structs_free_flow_stats(msg->stats, exp);
     }
-    free(msg);
+    ofl_free(msg);
     return 0;
 }
 
@@ -38,6 +38,7 @@
 
 #include "../include/openflow/openflow.h"
 #include "ofl.h"
+#include "ofl-arena.h"
 #include "ofl-structs.h"
 #include "ofl-actions.h"
 
@@ -485,6 +486,15 @@ struct ofl_msg_queue_get_config_reply {
 int
 ofl_msg_pack(struct ofl_msg_header *msg, uint32_t xid, uint8_t **buf, size_t *buf_len, struct ofl_exp *exp);
 
+/* Packs the message in msg at the end of buf, as ofl_msg_pack. Flow, port and
+ * group multipart replies are written in a single pass straight into buf, so
+ * a caller that reserves their length up front (as the flow stats dump does)
+ * gets them built with no reallocation and no intermediate copy. Other
+ * messages are packed with ofl_msg_pack and copied in. On error nothing is
+ * appended to buf. */
+int
+ofl_msg_pack_ofpbuf(struct ofl_msg_header *msg, uint32_t xid, struct ofpbuf *buf, struct ofl_exp *exp);
+
 /* Unpacks the wire format message in buf to a new OFLib message pointed at by
  * msg. If xid is not null, it will hold the transaction ID of the received
  * message. Returns zero on success. In case of experimenter features, the
@@ -493,6 +503,15 @@ ofl_err
 ofl_msg_unpack(uint8_t *buf, size_t buf_len,
                struct ofl_msg_header **msg, uint32_t *xid, struct ofl_exp *exp);
 
+/* As ofl_msg_unpack(), but the message and its oflib substructures are
+ * allocated from 'arena' (see ofl-arena.h). They are released all at once by
+ * ofl_arena_reset(); freeing the message before that is allowed and only
+ * releases the parts that are not in the arena. Experimenter structures are
+ * still unpacked on the heap. */
+ofl_err
+ofl_msg_unpack_arena(uint8_t *buf, size_t buf_len, struct ofl_msg_header **msg,
+                     uint32_t *xid, struct ofl_exp *exp, struct ofl_arena *arena);
+
 
 
 
@@ -529,6 +548,13 @@ ofl_msg_free_group_mod(struct ofl_msg_group_mod *msg, bool with_buckets, struct
 int
 ofl_msg_free_flow_mod(struct ofl_msg_flow_mod *msg, bool with_match, bool with_instructions, struct ofl_exp *exp);
 
+/* Moves the match and instructions of a flow_mod message unpacked into an
+ * arena to the heap, so that a flow entry can keep them once the arena is
+ * reset. The message can then be freed with ofl_msg_free_flow_mod() as
+ * usual. */
+void
+ofl_msg_flow_mod_copy_out(struct ofl_msg_flow_mod *msg);
+
 /* Calling this function frees the passed in flow_removed message. If
  * with_stats is true, the associated stats structure is also freed. In case of
  * experimenter features, it uses the passed in experimenter callback. */
@@ -15,8 +15,10 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <assert.h>
+#include <string.h>
 #include "ofl-structs.h"
-#include "lib/hash.h"
+#include "ofl-arena.h"
 #include "oxm-match.h"
 
 void
@@ -24,195 +26,164 @@ ofl_structs_match_init(struct ofl_match *match){
 
     match->header.type = OFPMT_OXM;
     match->header.length = 0;
-    match->match_fields = (struct hmap) HMAP_INITIALIZER(&match->match_fields);
+    match->present = 0;
 }
 
+static void
+match_release(struct ofl_match *match, unsigned int slot){
+    if (match->fields[slot].value != match->values[slot]) {
+        ofl_free(match->fields[slot].value);
+    }
+    match->header.length -= match->lengths[slot] + 4;
+    match->present &= ~(UINT64_C(1) << slot);
+}
 
-void
-ofl_structs_match_put8(struct ofl_match *match, uint32_t header, uint8_t value){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
-    int len = sizeof(uint8_t);
+/* Claims the slot of header for a field of len bytes of value and mask, and
+ * returns where they are to be written. */
+static uint8_t *
+match_claim(struct ofl_match *match, uint32_t header, size_t len){
+    unsigned int slot = OXM_FIELD(header);
+    struct ofl_match_tlv *f = &match->fields[slot];
 
-    m->header = header;
-    m->value = malloc(len);
-    memcpy(m->value, &value, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
+    assert(slot < OFL_MATCH_FIELDS);
+    if (match->present & (UINT64_C(1) << slot)) {
+        match_release(match, slot);
+    }
+    f->header = header;
+    f->value = len <= OFL_MATCH_INLINE ? match->values[slot] : ofl_malloc(len);
+    match->lengths[slot] = len;
+    match->present |= UINT64_C(1) << slot;
     match->header.length += len + 4;
+    return f->value;
 }
 
 void
-ofl_structs_match_put8m(struct ofl_match *match, uint32_t header, uint8_t value, uint8_t mask){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
-    int len = sizeof(uint8_t);
-
-    m->header = header;
-    m->value = malloc(len*2);
-    memcpy(m->value, &value, len);
-    memcpy(m->value + len, &mask, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len*2 + 4;
+ofl_structs_match_clear(struct ofl_match *match){
+    uint64_t bits;
+
+    for (bits = match->present; bits; bits &= bits - 1) {
+        match_release(match, __builtin_ctzll(bits));
+    }
+    match->header.length = 0;
 }
 
 void
-ofl_structs_match_put16(struct ofl_match *match, uint32_t header, uint16_t value){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
-    int len = sizeof(uint16_t);
+ofl_structs_match_copy(struct ofl_match *dst, const struct ofl_match *src){
+    struct ofl_match_tlv *f;
 
-    m->header = header;
-    m->value = malloc(len);
-    memcpy(m->value, &value, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len + 4;
+    ofl_structs_match_init(dst);
+    OFL_MATCH_FOR_EACH(f, src) {
+        unsigned int slot = f - src->fields;
+        memcpy(match_claim(dst, f->header, src->lengths[slot]), f->value, src->lengths[slot]);
+    }
+    dst->header = src->header;
 }
 
+void
+ofl_structs_match_put(struct ofl_match *match, uint32_t header, const void *value, size_t len){
+    memcpy(match_claim(match, header, len), value, len);
+}
 
 void
-ofl_structs_match_put16m(struct ofl_match *match, uint32_t header, uint16_t value, uint16_t mask){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
-    int len = sizeof(uint16_t);
-
-    m->header = header;
-    m->value = malloc(len*2);
-    memcpy(m->value, &value, len);
-    memcpy(m->value + len, &mask, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len*2 + 4;
+ofl_structs_match_remove(struct ofl_match *match, uint32_t header){
+    unsigned int slot = OXM_FIELD(header);
+
+    if (slot < OFL_MATCH_FIELDS && (match->present & (UINT64_C(1) << slot))) {
+        match_release(match, slot);
+    }
 }
 
 void
-ofl_structs_match_put32(struct ofl_match *match, uint32_t header, uint32_t value){
-    struct ofl_match_tlv *m = xmalloc(sizeof (struct ofl_match_tlv));
+ofl_structs_match_put8(struct ofl_match *match, uint32_t header, uint8_t value){
+    ofl_structs_match_put(match, header, &value, sizeof(uint8_t));
+}
 
-    int len = sizeof(uint32_t);
+void
+ofl_structs_match_put8m(struct ofl_match *match, uint32_t header, uint8_t value, uint8_t mask){
+    uint8_t *v = match_claim(match, header, sizeof(uint8_t) * 2);
 
-    m->header = header;
-    m->value = malloc(len);
-    memcpy(m->value, &value, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len + 4;
+    memcpy(v, &value, sizeof(uint8_t));
+    memcpy(v + sizeof(uint8_t), &mask, sizeof(uint8_t));
+}
 
+void
+ofl_structs_match_put16(struct ofl_match *match, uint32_t header, uint16_t value){
+    ofl_structs_match_put(match, header, &value, sizeof(uint16_t));
 }
 
 void
-ofl_structs_match_put32m(struct ofl_match *match, uint32_t header, uint32_t value, uint32_t mask){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
-    int len = sizeof(uint32_t);
+ofl_structs_match_put16m(struct ofl_match *match, uint32_t header, uint16_t value, uint16_t mask){
+    uint8_t *v = match_claim(match, header, sizeof(uint16_t) * 2);
 
-    m->header = header;
-    m->value = malloc(len*2);
-    memcpy(m->value, &value, len);
-    memcpy(m->value + len, &mask, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len*2 + 4;
+    memcpy(v, &value, sizeof(uint16_t));
+    memcpy(v + sizeof(uint16_t), &mask, sizeof(uint16_t));
+}
 
+void
+ofl_structs_match_put32(struct ofl_match *match, uint32_t header, uint32_t value){
+    ofl_structs_match_put(match, header, &value, sizeof(uint32_t));
 }
 
 void
-ofl_structs_match_put64(struct ofl_match *match, uint32_t header, uint64_t value){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
-    int len = sizeof(uint64_t);
+ofl_structs_match_put32m(struct ofl_match *match, uint32_t header, uint32_t value, uint32_t mask){
+    uint8_t *v = match_claim(match, header, sizeof(uint32_t) * 2);
 
-    m->header = header;
-    m->value = malloc(len);
-    memcpy(m->value, &value, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len + 4;
+    memcpy(v, &value, sizeof(uint32_t));
+    memcpy(v + sizeof(uint32_t), &mask, sizeof(uint32_t));
+}
 
+void
+ofl_structs_match_put64(struct ofl_match *match, uint32_t header, uint64_t value){
+    ofl_structs_match_put(match, header, &value, sizeof(uint64_t));
 }
 
 void
 ofl_structs_match_put64m(struct ofl_match *match, uint32_t header, uint64_t value, uint64_t mask){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
-    int len = sizeof(uint64_t);
-
-    m->header = header;
-    m->value = malloc(len*2);
-    memcpy(m->value, &value, len);
-    memcpy(m->value + len, &mask, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len*2 + 4;
+    uint8_t *v = match_claim(match, header, sizeof(uint64_t) * 2);
 
+    memcpy(v, &value, sizeof(uint64_t));
+    memcpy(v + sizeof(uint64_t), &mask, sizeof(uint64_t));
 }
 
 void
 ofl_structs_match_put_pbb_isid(struct ofl_match *match, uint32_t header, uint8_t value[PBB_ISID_LEN]){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
-    int len = OXM_LENGTH(header);
-
-    m->header = header;
-    m->value = malloc(len);
-    memcpy(m->value, value, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len + 4;
+    ofl_structs_match_put(match, header, value, OXM_LENGTH(header));
 }
 
 
 void
 ofl_structs_match_put_pbb_isidm(struct ofl_match *match, uint32_t header, uint8_t value[PBB_ISID_LEN], uint8_t mask[PBB_ISID_LEN]){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
     int len = OXM_LENGTH(header);
+    uint8_t *v = match_claim(match, header, len * 2);
 
-    m->header = header;
-    m->value = malloc(len*2);
-    memcpy(m->value, value, len);
-    memcpy(m->value + len, mask, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len*2 + 4;
+    memcpy(v, value, len);
+    memcpy(v + len, mask, len);
 }
 
 void
 ofl_structs_match_put_eth(struct ofl_match *match, uint32_t header, uint8_t value[ETH_ADDR_LEN]){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
-    int len = ETH_ADDR_LEN;
-
-    m->header = header;
-    m->value = malloc(len);
-    memcpy(m->value, value, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len + 4;
-
+    ofl_structs_match_put(match, header, value, ETH_ADDR_LEN);
 }
 
 void
 ofl_structs_match_put_eth_m(struct ofl_match *match, uint32_t header, uint8_t value[ETH_ADDR_LEN], uint8_t mask[ETH_ADDR_LEN]){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
-    int len = ETH_ADDR_LEN;
-
-    m->header = header;
-    m->value = malloc(len*2);
-    memcpy(m->value, value, len);
-    memcpy(m->value + len, mask, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len*2 + 4;
+    uint8_t *v = match_claim(match, header, ETH_ADDR_LEN * 2);
 
+    memcpy(v, value, ETH_ADDR_LEN);
+    memcpy(v + ETH_ADDR_LEN, mask, ETH_ADDR_LEN);
 }
 
 void
 ofl_structs_match_put_ipv6(struct ofl_match *match, uint32_t header, uint8_t value[IPv6_ADDR_LEN]){
-
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
-    int len = IPv6_ADDR_LEN;
-
-    m->header = header;
-    m->value = malloc(len);
-    memcpy(m->value, value, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len + 4;
-
+    ofl_structs_match_put(match, header, value, IPv6_ADDR_LEN);
 }
 
 void
 ofl_structs_match_put_ipv6m(struct ofl_match *match, uint32_t header, uint8_t value[IPv6_ADDR_LEN], uint8_t mask[IPv6_ADDR_LEN]){
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
-    int len = IPv6_ADDR_LEN;
-
-    m->header = header;
-    m->value = malloc(len*2);
-    memcpy(m->value, value, len);
-    memcpy(m->value + len, mask, len);
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len*2 + 4;
+    uint8_t *v = match_claim(match, header, IPv6_ADDR_LEN * 2);
 
+    memcpy(v, value, IPv6_ADDR_LEN);
+    memcpy(v + IPv6_ADDR_LEN, mask, IPv6_ADDR_LEN);
 }
 
 /*Modificacion UAH Discovery hybrid topologies, JAH-*/
@@ -227,43 +198,28 @@ static inline uint64_t ntoh642(uint64_t n) {
 
 void ofl_structs_match_put_macs(struct ofl_match *match, uint32_t header, uint64_t *  value)
 {
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint64_t)*DHT_MAX_ELEMENTS, index = 0;
+    uint8_t *v = match_claim(match, header, len);
     uint64_t dataaux=0;
-    
-    m->header = header;
-    m->value = malloc(len);
-    
+
     for (index=0;index<DHT_MAX_ELEMENTS;index++)
     {
         dataaux=ntoh642(value[index]);
-        memcpy((m->value+(index*sizeof(uint64_t))),&dataaux,sizeof(uint64_t));
+        memcpy((v+(index*sizeof(uint64_t))),&dataaux,sizeof(uint64_t));
     }
-    
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len + 4;
-    memcpy(&dataaux,m->value,sizeof(uint64_t));
 }
 
 void ofl_structs_match_put_port(struct ofl_match *match, uint32_t header, uint32_t *  value)
 {
-    struct ofl_match_tlv *m = malloc(sizeof (struct ofl_match_tlv));
     int len = sizeof(uint32_t)*DHT_MAX_ELEMENTS, index=0;
+    uint8_t *v = match_claim(match, header, len);
     uint32_t dataaux=0;
 
-    m->header = header;
-    m->value = malloc(len);
-    
     for (index=0;index<DHT_MAX_ELEMENTS;index++)
     {
         dataaux=ntohl(value[index]);
-        memcpy((m->value+(index*sizeof(uint32_t))),&dataaux,sizeof(uint32_t));
+        memcpy((v+(index*sizeof(uint32_t))),&dataaux,sizeof(uint32_t));
     }
-    
-    hmap_insert(&match->match_fields,&m->hmap_node,hash_int(header, 0));
-    match->header.length += len + 4;
-
-    memcpy(&dataaux,m->value,sizeof(uint32_t));
 }
 
 /*Fin modificacion UAH MDP Hybrid version, Diego Lopez*/
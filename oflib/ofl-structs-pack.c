@@ -520,19 +520,8 @@ ofl_structs_flow_stats_ofp_total_len(struct ofl_flow_stats ** stats, size_t stat
 
 
 
-size_t
-ofl_structs_flow_stats_pack(struct ofl_flow_stats *src, uint8_t *dst, struct ofl_exp *exp) {
-
-    struct ofp_flow_stats *flow_stats;
-    size_t total_len;
-    uint8_t *data;
-    size_t  i;
-
-    total_len = ROUND_UP(sizeof(struct ofp_flow_stats) -4 + src->match->length,8) +
-                ofl_structs_instructions_ofp_total_len(src->instructions, src->instructions_num, exp);
-
-    flow_stats = (struct ofp_flow_stats*) dst;
-
+static void
+flow_stats_pack_header(struct ofl_flow_stats *src, struct ofp_flow_stats *flow_stats, size_t total_len) {
     flow_stats->length = htons(total_len);
     flow_stats->table_id = src->table_id;
     flow_stats->pad = 0x00;
@@ -546,6 +535,21 @@ ofl_structs_flow_stats_pack(struct ofl_flow_stats *src, uint8_t *dst, struct ofl
     flow_stats->cookie = hton64(src->cookie);
     flow_stats->packet_count = hton64(src->packet_count);
     flow_stats->byte_count = hton64(src->byte_count);
+}
+
+size_t
+ofl_structs_flow_stats_pack(struct ofl_flow_stats *src, uint8_t *dst, struct ofl_exp *exp) {
+
+    struct ofp_flow_stats *flow_stats;
+    size_t total_len;
+    uint8_t *data;
+    size_t  i;
+
+    total_len = ROUND_UP(sizeof(struct ofp_flow_stats) -4 + src->match->length,8) +
+                ofl_structs_instructions_ofp_total_len(src->instructions, src->instructions_num, exp);
+
+    flow_stats = (struct ofp_flow_stats*) dst;
+    flow_stats_pack_header(src, flow_stats, total_len);
     data = (dst) + sizeof(struct ofp_flow_stats) - 4;
 
     ofl_structs_match_pack(src->match, &(flow_stats->match), data, exp);
@@ -557,6 +561,29 @@ ofl_structs_flow_stats_pack(struct ofl_flow_stats *src, uint8_t *dst, struct ofl
     return total_len;
 }
 
+size_t
+ofl_structs_flow_stats_put(struct ofl_flow_stats *src, struct ofpbuf *buf, struct ofl_exp *exp) {
+    struct ofp_flow_stats *flow_stats;
+    size_t start = buf->size;
+    size_t i;
+
+    flow_stats = ofl_utils_put_uninit(buf,
+            ROUND_UP(sizeof(struct ofp_flow_stats) - 4 + src->match->length, 8));
+    ofl_structs_match_pack(src->match, &(flow_stats->match), NULL, exp);
+
+    /* The instructions are sized one at a time, right before being written;
+     * the flow stats header is filled in once the total length is known. */
+    for (i=0; i < src->instructions_num; i++) {
+        size_t len = ofl_structs_instructions_ofp_len(src->instructions[i], exp);
+        ofl_structs_instructions_pack(src->instructions[i],
+                (struct ofp_instruction *)ofl_utils_put_uninit(buf, len), exp);
+    }
+
+    flow_stats = ofpbuf_at_assert(buf, start, sizeof(struct ofp_flow_stats));
+    flow_stats_pack_header(src, flow_stats, buf->size - start);
+    return buf->size - start;
+}
+
 size_t
 ofl_structs_group_stats_ofp_len(struct ofl_group_stats *stats) {
     return sizeof(struct ofp_group_stats) +
@@ -721,6 +748,29 @@ ofl_structs_group_desc_stats_pack(struct ofl_group_desc_stats *src, struct ofp_g
     return total_len;
 }
 
+size_t
+ofl_structs_group_desc_stats_put(struct ofl_group_desc_stats *src, struct ofpbuf *buf, struct ofl_exp *exp) {
+    struct ofp_group_desc_stats *dst;
+    size_t start = buf->size;
+    size_t i;
+
+    ofl_utils_put_uninit(buf, sizeof(struct ofp_group_desc_stats));
+
+    for (i=0; i<src->buckets_num; i++) {
+        size_t len = ofl_structs_buckets_ofp_len(src->buckets[i], exp);
+        ofl_structs_bucket_pack(src->buckets[i],
+                (struct ofp_bucket *)ofl_utils_put_uninit(buf, len), exp);
+    }
+
+    dst = ofpbuf_at_assert(buf, start, sizeof(struct ofp_group_desc_stats));
+    dst->length =       htons( buf->size - start);
+    dst->type =                src->type;
+    dst->pad = 0x00;
+    dst->group_id =     htonl( src->group_id);
+
+    return buf->size - start;
+}
+
 
 size_t
 ofl_structs_queue_prop_ofp_total_len(struct ofl_queue_prop_header ** props,
@@ -924,16 +974,17 @@ ofl_structs_match_pack(struct ofl_match_header *src, struct ofp_match *dst, uint
     switch (src->type) {
         case (OFPMT_OXM): {
             struct ofl_match *m = (struct ofl_match *)src;
-            struct ofpbuf *b = ofpbuf_new(0);
+            struct ofpbuf b;
             int oxm_len;
             dst->type = htons(m->header.type);
             oxm_fields = (uint8_t*) &dst->oxm_fields;
             dst->length = htons(sizeof(struct ofp_match) - 4);
             if (src->length){
-                oxm_len = oxm_put_match(b, m);
-                memcpy(oxm_fields, (uint8_t*) ofpbuf_pull(b,oxm_len), oxm_len);
+                /* The fields and their padding are written in place, in the
+                 * room the caller has for the padded match, so b never grows. */
+                ofpbuf_use(&b, oxm_fields, ROUND_UP(src->length + 4, 8) - 4);
+                oxm_len = oxm_put_match(&b, m);
                 dst->length = htons(oxm_len + ((sizeof(struct ofp_match )-4)));
-                ofpbuf_delete(b);
                 return ntohs(dst->length);
             }
             else return 0;
@@ -195,7 +195,7 @@ ofl_structs_oxm_match_print(FILE *stream, const struct ofl_match *omt) {
 	size_t 					size;
 	
 	if(omt->header.length > 4)
-	    size = hmap_count(&omt->match_fields);
+	    size = ofl_structs_match_count(omt);
 	else size = 0;
 	
 	fprintf(stream, "oxm{");
@@ -77,12 +77,12 @@ ofl_structs_instructions_unpack(struct ofp_instruction *src, size_t *len, struct
                 if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
                     char *ts = ofl_table_to_string(si->table_id);
                     OFL_LOG_WARN(LOG_MODULE, "Received GOTO_TABLE instruction has invalid table_id (%s).", ts);
-                    free(ts);
+                    ofl_free(ts);
                 }
                 return ofl_error(OFPET_BAD_INSTRUCTION, OFPBIC_BAD_TABLE_ID);
             }
 
-            di = (struct ofl_instruction_goto_table *)malloc(sizeof(struct ofl_instruction_goto_table));
+            di = (struct ofl_instruction_goto_table *)ofl_malloc(sizeof(struct ofl_instruction_goto_table));
 
             di->table_id = si->table_id;
 
@@ -101,7 +101,7 @@ ofl_structs_instructions_unpack(struct ofp_instruction *src, size_t *len, struct
             }
 
             si = (struct ofp_instruction_write_metadata *)src;
-            di = (struct ofl_instruction_write_metadata *)malloc(sizeof(struct ofl_instruction_write_metadata));
+            di = (struct ofl_instruction_write_metadata *)ofl_malloc(sizeof(struct ofl_instruction_write_metadata));
 
             di->metadata =      ntoh64(si->metadata);
             di->metadata_mask = ntoh64(si->metadata_mask);
@@ -125,14 +125,14 @@ ofl_structs_instructions_unpack(struct ofp_instruction *src, size_t *len, struct
             ilen -= sizeof(struct ofp_instruction_actions);
 
             si = (struct ofp_instruction_actions *)src;
-            di = (struct ofl_instruction_actions *)malloc(sizeof(struct ofl_instruction_actions));
+            di = (struct ofl_instruction_actions *)ofl_malloc(sizeof(struct ofl_instruction_actions));
 
             error = ofl_utils_count_ofp_actions((uint8_t *)si->actions, ilen, &di->actions_num);
             if (error) {
-                free(di);
+                ofl_free(di);
                 return error;
             }
-            di->actions = (struct ofl_action_header **)malloc(di->actions_num * sizeof(struct ofl_action_header *));
+            di->actions = (struct ofl_action_header **)ofl_malloc(di->actions_num * sizeof(struct ofl_action_header *));
 
             act = si->actions;
             for (i = 0; i < di->actions_num; i++) {
@@ -141,7 +141,7 @@ ofl_structs_instructions_unpack(struct ofp_instruction *src, size_t *len, struct
                     *len = *len - ntohs(src->len) + ilen;
                     OFL_UTILS_FREE_ARR_FUN2(di->actions, i,
                                             ofl_actions_free, exp);
-                    free(di);
+                    ofl_free(di);
                     return error;
                 }
                 act = (struct ofp_action_header *)((uint8_t *)act + ntohs(act->len));
@@ -156,7 +156,7 @@ ofl_structs_instructions_unpack(struct ofp_instruction *src, size_t *len, struct
                 return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
             }
 
-            inst = (struct ofl_instruction_header *)malloc(sizeof(struct ofl_instruction_header));
+            inst = (struct ofl_instruction_header *)ofl_malloc(sizeof(struct ofl_instruction_header));
             inst->type = (enum ofp_instruction_type)((int)ntohs(src->type));
 
             ilen -= sizeof(struct ofp_instruction_actions);
@@ -171,7 +171,7 @@ ofl_structs_instructions_unpack(struct ofp_instruction *src, size_t *len, struct
                 return ofl_error(OFPET_BAD_ACTION, OFPBRC_BAD_LEN);
             }
             si = (struct ofp_instruction_meter*)src;
-            di = (struct ofl_instruction_meter *)malloc(sizeof(struct ofl_instruction_meter));
+            di = (struct ofl_instruction_meter *)ofl_malloc(sizeof(struct ofl_instruction_meter));
 
             di->meter_id = ntohl(si->meter_id);
 
@@ -243,14 +243,14 @@ ofl_structs_table_properties_unpack(struct ofp_table_feature_prop_header * src,
                 return ofl_error(OFPET_TABLE_FEATURES_FAILED, OFPTFFC_BAD_LEN);
             }
 			
-			dp =  (struct ofl_table_feature_prop_instructions*) malloc(sizeof(struct ofl_table_feature_prop_instructions));		
+			dp =  (struct ofl_table_feature_prop_instructions*) ofl_malloc(sizeof(struct ofl_table_feature_prop_instructions));		
             ilen = plen - sizeof(struct ofp_table_feature_prop_instructions);
             error = ofl_utils_count_ofp_instructions((uint8_t*) sp->instruction_ids, ilen, &dp->ids_num);			
 			if(error){
-			    free(dp);
+			    ofl_free(dp);
 			    return error;
 			}
-			dp->instruction_ids = (struct ofl_instruction_header*) malloc(sizeof(struct ofl_instruction_header) * dp->ids_num);
+			dp->instruction_ids = (struct ofl_instruction_header*) ofl_malloc(sizeof(struct ofl_instruction_header) * dp->ids_num);
 
             ptr = (uint8_t*) sp->instruction_ids;	
 			for(i = 0; i < dp->ids_num; i++){
@@ -270,10 +270,10 @@ ofl_structs_table_properties_unpack(struct ofp_table_feature_prop_header * src,
                 OFL_LOG_WARN(LOG_MODULE, "Received NEXT TABLE feature has invalid length (%zu).", *len);
                 return ofl_error(OFPET_TABLE_FEATURES_FAILED, OFPTFFC_BAD_LEN);
             }			
-			dp = (struct ofl_table_feature_prop_next_tables*) malloc(sizeof(struct ofl_table_feature_prop_next_tables));		
+			dp = (struct ofl_table_feature_prop_next_tables*) ofl_malloc(sizeof(struct ofl_table_feature_prop_next_tables));		
 		    
 		    dp->table_num = ntohs(sp->length) - sizeof(struct ofp_table_feature_prop_next_tables);
-            dp->next_table_ids = (uint8_t*) malloc(sizeof(uint8_t) * dp->table_num);
+            dp->next_table_ids = (uint8_t*) ofl_malloc(sizeof(uint8_t) * dp->table_num);
             memcpy(dp->next_table_ids, sp->next_table_ids, dp->table_num);
             
             plen -= ntohs(sp->length);            		    
@@ -294,14 +294,14 @@ ofl_structs_table_properties_unpack(struct ofp_table_feature_prop_header * src,
                 return ofl_error(OFPET_TABLE_FEATURES_FAILED, OFPTFFC_BAD_LEN);
             }
             alen = plen - sizeof(struct ofp_table_feature_prop_actions);
-			dp = (struct ofl_table_feature_prop_actions*) malloc(sizeof(struct ofl_table_feature_prop_actions));		
+			dp = (struct ofl_table_feature_prop_actions*) ofl_malloc(sizeof(struct ofl_table_feature_prop_actions));		
 		    error = ofl_utils_count_ofp_actions((uint8_t*)sp->action_ids, alen, &dp->actions_num);
             if(error){
-			    free(dp);
+			    ofl_free(dp);
 			    return error;
 			}
 			
-			dp->action_ids = (struct ofl_action_header*) malloc(sizeof(struct ofl_action_header) * dp->actions_num);
+			dp->action_ids = (struct ofl_action_header*) ofl_malloc(sizeof(struct ofl_action_header) * dp->actions_num);
 			
 			ptr = (uint8_t*) sp->action_ids;	
 			for(i = 0; i < dp->actions_num; i++){
@@ -328,10 +328,10 @@ ofl_structs_table_properties_unpack(struct ofp_table_feature_prop_header * src,
                 return ofl_error(OFPET_TABLE_FEATURES_FAILED, OFPTFFC_BAD_LEN);
             }			
 			
-			dp = (struct ofl_table_feature_prop_oxm*) malloc(sizeof(struct ofl_table_feature_prop_oxm));		
+			dp = (struct ofl_table_feature_prop_oxm*) ofl_malloc(sizeof(struct ofl_table_feature_prop_oxm));		
 		    
 		    dp->oxm_num = (ntohs(sp->length) - sizeof(struct ofp_table_feature_prop_oxm))/sizeof(uint32_t);
-            dp->oxm_ids = (uint32_t*) malloc(sizeof(uint32_t) * dp->oxm_num);
+            dp->oxm_ids = (uint32_t*) ofl_malloc(sizeof(uint32_t) * dp->oxm_num);
             for(i = 0; i < dp->oxm_num; i++ ){
                     dp->oxm_ids[i] = ntohl(sp->oxm_ids[i]);
             }
@@ -379,11 +379,11 @@ ofl_structs_table_features_unpack(struct ofp_table_features *src,size_t *len, st
         return ofl_error(OFPET_BAD_ACTION, OFPBAC_BAD_LEN);
     }
     
-    feat = (struct ofl_table_features*) malloc(sizeof(struct ofl_table_features));
+    feat = (struct ofl_table_features*) ofl_malloc(sizeof(struct ofl_table_features));
 
     feat->length = ntohs(src->length);
     feat->table_id = src->table_id;
-    feat->name = malloc(OFP_MAX_TABLE_NAME_LEN);
+    feat->name = ofl_malloc(OFP_MAX_TABLE_NAME_LEN);
     strncpy(feat->name, src->name, OFP_MAX_TABLE_NAME_LEN);
     feat->metadata_match = ntoh64(src->metadata_match); 
     feat->metadata_write =  ntoh64(src->metadata_write);
@@ -393,10 +393,10 @@ ofl_structs_table_features_unpack(struct ofp_table_features *src,size_t *len, st
     plen = ntohs(src->length) - sizeof(struct ofp_table_features);
     error = ofl_utils_count_ofp_table_features_properties((uint8_t*) src->properties, plen, &feat->properties_num);
     if (error) {
-        free(feat);
+        ofl_free(feat);
         return error;
     }
-    feat->properties = (struct ofl_table_feature_prop_header**) malloc(sizeof(struct ofl_table_feature_prop_header *) * feat->properties_num);
+    feat->properties = (struct ofl_table_feature_prop_header**) ofl_malloc(sizeof(struct ofl_table_feature_prop_header *) * feat->properties_num);
     
     prop = (uint8_t*) src->properties;
     for(i = 0; i < feat->properties_num; i++){
@@ -405,7 +405,7 @@ ofl_structs_table_features_unpack(struct ofp_table_features *src,size_t *len, st
             *len = *len - ntohs(src->length) + plen;
             /*OFL_UTILS_FREE_ARR_FUN2(b->actions, i,
                                     ofl_actions_free, exp);*/
-            free(feat);
+            ofl_free(feat);
             return error;
         }
         prop += ROUND_UP(ntohs(((struct ofp_table_feature_prop_header*) prop)->length),8);
@@ -447,7 +447,7 @@ ofl_structs_bucket_unpack(struct ofp_bucket *src, size_t *len, uint8_t gtype, st
         return ofl_error(OFPET_GROUP_MOD_FAILED, OFPGMFC_INVALID_GROUP);
     }
 
-    b = (struct ofl_bucket *)malloc(sizeof(struct ofl_bucket));
+    b = (struct ofl_bucket *)ofl_malloc(sizeof(struct ofl_bucket));
 
     b->weight =      ntohs(src->weight);
     b->watch_port =  ntohl(src->watch_port);
@@ -455,10 +455,10 @@ ofl_structs_bucket_unpack(struct ofp_bucket *src, size_t *len, uint8_t gtype, st
 
     error = ofl_utils_count_ofp_actions((uint8_t *)src->actions, blen, &b->actions_num);
     if (error) {
-        free(b);
+        ofl_free(b);
         return error;
     }
-    b->actions = (struct ofl_action_header **)malloc(b->actions_num * sizeof(struct ofl_action_header *));
+    b->actions = (struct ofl_action_header **)ofl_malloc(b->actions_num * sizeof(struct ofl_action_header *));
 
     act = src->actions;
     for (i = 0; i < b->actions_num; i++) {
@@ -467,7 +467,7 @@ ofl_structs_bucket_unpack(struct ofp_bucket *src, size_t *len, uint8_t gtype, st
             *len = *len - ntohs(src->len) + blen;
             OFL_UTILS_FREE_ARR_FUN2(b->actions, i,
                                     ofl_actions_free, exp);
-            free(b);
+            ofl_free(b);
             return error;
         }
         act = (struct ofp_action_header *)((uint8_t *)act + ntohs(act->len));
@@ -507,14 +507,14 @@ ofl_structs_flow_stats_unpack(struct ofp_flow_stats *src, uint8_t *buf, size_t *
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
             char *ts = ofl_table_to_string(src->table_id);
             OFL_LOG_WARN(LOG_MODULE, "Received flow stats has invalid table_id (%s).", ts);
-            free(ts);
+            ofl_free(ts);
         }
         return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_TABLE_ID);
     }
 
     slen = ntohs(src->length) - (sizeof(struct ofp_flow_stats) - sizeof(struct ofp_match));
 
-    s = (struct ofl_flow_stats *)malloc(sizeof(struct ofl_flow_stats));
+    s = (struct ofl_flow_stats *)ofl_malloc(sizeof(struct ofl_flow_stats));
     s->table_id =             src->table_id;
     s->duration_sec =  ntohl( src->duration_sec);
     s->duration_nsec = ntohl( src->duration_nsec);
@@ -530,7 +530,7 @@ ofl_structs_flow_stats_unpack(struct ofp_flow_stats *src, uint8_t *buf, size_t *
 
     error = ofl_structs_match_unpack(&(src->match),buf + match_pos , &slen, &(s->match), exp);
     if (error) {
-        free(s);
+        ofl_free(s);
         return error;
     }
     error = ofl_utils_count_ofp_instructions((struct ofp_instruction *) (buf + ROUND_UP(match_pos + s->match->length,8)), 
@@ -538,10 +538,10 @@ ofl_structs_flow_stats_unpack(struct ofp_flow_stats *src, uint8_t *buf, size_t *
     
     if (error) {
         ofl_structs_free_match(s->match, exp);
-        free(s);
+        ofl_free(s);
         return error;
     }
-   s->instructions = (struct ofl_instruction_header **)malloc(s->instructions_num * sizeof(struct ofl_instruction_header *));
+   s->instructions = (struct ofl_instruction_header **)ofl_malloc(s->instructions_num * sizeof(struct ofl_instruction_header *));
 
    inst = (struct ofp_instruction *) (buf + ROUND_UP(match_pos + s->match->length,8));
    for (i = 0; i < s->instructions_num; i++) {
@@ -549,7 +549,7 @@ ofl_structs_flow_stats_unpack(struct ofp_flow_stats *src, uint8_t *buf, size_t *
         if (error) {
             OFL_UTILS_FREE_ARR_FUN2(s->instructions, i,
                                     ofl_structs_free_instruction, exp);
-            free(s);
+            ofl_free(s);
             return error;
         }
         inst = (struct ofp_instruction *)((uint8_t *)inst + ntohs(inst->len));
@@ -589,13 +589,13 @@ ofl_structs_group_stats_unpack(struct ofp_group_stats *src, size_t *len, struct
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
             char *gs = ofl_group_to_string(ntohl(src->group_id));
             OFL_LOG_WARN(LOG_MODULE, "Received group stats has invalid group_id (%s).", gs);
-            free(gs);
+            ofl_free(gs);
         }
         return ofl_error(OFPET_BAD_ACTION, OFPBRC_BAD_LEN);
     }
     slen = ntohs(src->length) - sizeof(struct ofp_group_stats);
 
-    s = (struct ofl_group_stats *)malloc(sizeof(struct ofl_group_stats));
+    s = (struct ofl_group_stats *)ofl_malloc(sizeof(struct ofl_group_stats));
     s->group_id = ntohl(src->group_id);
     s->ref_count = ntohl(src->ref_count);
     s->packet_count = ntoh64(src->packet_count);
@@ -605,17 +605,17 @@ ofl_structs_group_stats_unpack(struct ofp_group_stats *src, size_t *len, struct
 
     error = ofl_utils_count_ofp_bucket_counters(src->bucket_stats, slen, &s->counters_num);
     if (error) {
-        free(s);
+        ofl_free(s);
         return error;
     }
-    s->counters = (struct ofl_bucket_counter **)malloc(s->counters_num * sizeof(struct ofl_bucket_counter *));
+    s->counters = (struct ofl_bucket_counter **)ofl_malloc(s->counters_num * sizeof(struct ofl_bucket_counter *));
 
     c = src->bucket_stats;
     for (i = 0; i < s->counters_num; i++) {
         error = ofl_structs_bucket_counter_unpack(c, &slen, &(s->counters[i]));
         if (error) {
             OFL_UTILS_FREE_ARR(s->counters, i);
-            free(s);
+            ofl_free(s);
             return error;
         }
         c = (struct ofp_bucket_counter *)((uint8_t *)c + sizeof(struct ofp_bucket_counter));
@@ -643,7 +643,7 @@ ofl_structs_meter_band_stats_unpack(struct ofp_meter_band_stats *src, size_t *le
     }
     *len -= sizeof(struct ofp_meter_band_stats);
 
-    p = (struct ofl_meter_band_stats *)malloc(sizeof(struct ofl_meter_band_stats));
+    p = (struct ofl_meter_band_stats *)ofl_malloc(sizeof(struct ofl_meter_band_stats));
     p->packet_band_count = ntoh64(src->packet_band_count);
     p->byte_band_count =   ntoh64(src->byte_band_count);
 
@@ -672,7 +672,7 @@ ofl_structs_meter_stats_unpack(struct ofp_meter_stats *src, size_t *len, struct
 
     slen = ntohs(src->len) - sizeof(struct ofp_meter_stats);
 
-    s = (struct ofl_meter_stats *) malloc(sizeof(struct ofl_meter_stats));
+    s = (struct ofl_meter_stats *) ofl_malloc(sizeof(struct ofl_meter_stats));
     s->meter_id = ntohl(src->meter_id);
     s->len = ntohs(src->len);
     
@@ -684,17 +684,17 @@ ofl_structs_meter_stats_unpack(struct ofp_meter_stats *src, size_t *len, struct
 
     error = ofl_utils_count_ofp_meter_band_stats(src->band_stats, slen, &s->meter_bands_num);
     if (error) {
-        free(s);
+        ofl_free(s);
         return error;
     }
-    s->band_stats = (struct ofl_meter_band_stats **)malloc(s->meter_bands_num * sizeof(struct ofl_meter_band_stats *));
+    s->band_stats = (struct ofl_meter_band_stats **)ofl_malloc(s->meter_bands_num * sizeof(struct ofl_meter_band_stats *));
 
     c = src->band_stats;
     for (i = 0; i < s->meter_bands_num; i++) {
         error = ofl_structs_meter_band_stats_unpack(c, &slen, &(s->band_stats[i]));
         if (error) {
             OFL_UTILS_FREE_ARR(s->band_stats, i);
-            free(s);
+            ofl_free(s);
             return error;
         }
         c = (struct ofp_meter_band_stats *)((uint8_t *)c + sizeof(struct ofp_meter_band_stats));
@@ -731,7 +731,7 @@ ofl_structs_meter_config_unpack(struct ofp_meter_config *src, size_t *len, struc
 
     slen = ntohs(src->length) - sizeof(struct ofp_meter_config);
 
-    s = (struct ofl_meter_config *) malloc(sizeof(struct ofl_meter_config));
+    s = (struct ofl_meter_config *) ofl_malloc(sizeof(struct ofl_meter_config));
     s->meter_id = ntohl(src->meter_id);
     s->length = ntohs(src->length);
     
@@ -739,17 +739,17 @@ ofl_structs_meter_config_unpack(struct ofp_meter_config *src, size_t *len, struc
 
     error = ofl_utils_count_ofp_meter_bands(src->bands, slen, &s->meter_bands_num);
     if (error) {
-        free(s);
+        ofl_free(s);
         return error;
     }
-    s->bands = (struct ofl_meter_band_header **)malloc(s->meter_bands_num * sizeof(struct ofl_meter_band_header *));
+    s->bands = (struct ofl_meter_band_header **)ofl_malloc(s->meter_bands_num * sizeof(struct ofl_meter_band_header *));
 
     b= src->bands;
     for (i = 0; i < s->meter_bands_num; i++) {
         error = ofl_structs_meter_band_unpack(b, &slen, &(s->bands[i]));
         if (error) {
             OFL_UTILS_FREE_ARR(s->bands, i);
-            free(s);
+            ofl_free(s);
             return error;
         }
         b = (struct ofp_meter_band_header *)((uint8_t *)b + ntohs(b->len));
@@ -782,7 +782,7 @@ ofl_structs_queue_prop_unpack(struct ofp_queue_prop_header *src, size_t *len, st
     switch (ntohs(src->property)) {
         case OFPQT_MIN_RATE: {
             struct ofp_queue_prop_min_rate *sp = (struct ofp_queue_prop_min_rate *)src;
-            struct ofl_queue_prop_min_rate *dp = (struct ofl_queue_prop_min_rate *)malloc(sizeof(struct ofl_queue_prop_min_rate));
+            struct ofl_queue_prop_min_rate *dp = (struct ofl_queue_prop_min_rate *)ofl_malloc(sizeof(struct ofl_queue_prop_min_rate));
 
             if (*len < sizeof(struct ofp_queue_prop_min_rate)) {
                 OFL_LOG_WARN(LOG_MODULE, "Received MIN_RATE queue property has invalid length (%zu).", *len);
@@ -797,7 +797,7 @@ ofl_structs_queue_prop_unpack(struct ofp_queue_prop_header *src, size_t *len, st
         }
         case OFPQT_MAX_RATE:{
             struct ofp_queue_prop_max_rate *sp = (struct ofp_queue_prop_max_rate *)src;
-            struct ofl_queue_prop_max_rate *dp = (struct ofl_queue_prop_max_rate *)malloc(sizeof(struct ofl_queue_prop_max_rate));
+            struct ofl_queue_prop_max_rate *dp = (struct ofl_queue_prop_max_rate *)ofl_malloc(sizeof(struct ofl_queue_prop_max_rate));
             
             if (*len < sizeof(struct ofp_queue_prop_max_rate)) {
                 OFL_LOG_WARN(LOG_MODULE, "Received MAX_RATE queue property has invalid length (%zu).", *len);
@@ -812,7 +812,7 @@ ofl_structs_queue_prop_unpack(struct ofp_queue_prop_header *src, size_t *len, st
         }
         case OFPQT_EXPERIMENTER:{
             struct ofp_queue_prop_experimenter *sp = (struct ofp_queue_prop_experimenter *)src;
-            struct ofl_queue_prop_experimenter *dp = (struct ofl_queue_prop_experimenter *)malloc(sizeof(struct ofl_queue_prop_experimenter));
+            struct ofl_queue_prop_experimenter *dp = (struct ofl_queue_prop_experimenter *)ofl_malloc(sizeof(struct ofl_queue_prop_experimenter));
             
             if (*len < sizeof(struct ofp_queue_prop_experimenter)) {
                 OFL_LOG_WARN(LOG_MODULE, "Received EXPERIMENTER queue property has invalid length (%zu).", *len);
@@ -849,16 +849,16 @@ ofl_structs_packet_queue_unpack(struct ofp_packet_queue *src, size_t *len, struc
     }
     *len -= sizeof(struct ofp_packet_queue);
 
-    q = (struct ofl_packet_queue *)malloc(sizeof(struct ofl_packet_queue));
+    q = (struct ofl_packet_queue *)ofl_malloc(sizeof(struct ofl_packet_queue));
     q->queue_id = ntohl(src->queue_id);
 
     prop_len = ntohs(src->len) - sizeof(struct ofp_packet_queue);
     error = ofl_utils_count_ofp_queue_props((uint8_t *)src->properties, prop_len, &q->properties_num);
     if (error) {
-        free(q);
+        ofl_free(q);
         return error;
     }
-    q->properties = (struct ofl_queue_prop_header **)malloc(q->properties_num * sizeof(struct ofl_queue_prop_header *));
+    q->properties = (struct ofl_queue_prop_header **)ofl_malloc(q->properties_num * sizeof(struct ofl_queue_prop_header *));
 
     prop = src->properties;
     for (i = 0; i < q->properties_num; i++) {
@@ -884,16 +884,16 @@ ofl_structs_port_unpack(struct ofp_port *src, size_t *len, struct ofl_port **dst
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
             char *ps = ofl_port_to_string(ntohl(src->port_no));
             OFL_LOG_WARN(LOG_MODULE, "Received port has invalid port_id (%s).", ps);
-            free(ps);
+            ofl_free(ps);
         }
         return ofl_error(OFPET_BAD_ACTION, OFPBRC_BAD_LEN);
     }
     *len -= sizeof(struct ofp_port);
-    p = (struct ofl_port *)malloc(sizeof(struct ofl_port));
+    p = (struct ofl_port *)ofl_malloc(sizeof(struct ofl_port));
 
     p->port_no = ntohl(src->port_no);
     memcpy(p->hw_addr, src->hw_addr, ETH_ADDR_LEN);
-    p->name = strcpy((char *)malloc(strlen(src->name) + 1), src->name);
+    p->name = strcpy((char *)ofl_malloc(strlen(src->name) + 1), src->name);
     p->config = ntohl(src->config);
     p->state = ntohl(src->state);
     p->curr = ntohl(src->curr);
@@ -922,13 +922,13 @@ ofl_structs_table_stats_unpack(struct ofp_table_stats *src, size_t *len, struct
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
             char *ts = ofl_table_to_string(src->table_id);
             OFL_LOG_WARN(LOG_MODULE, "Received table stats has invalid table_id (%s).", ts);
-            free(ts);
+            ofl_free(ts);
         }
         return ofl_error(OFPET_BAD_ACTION, OFPBRC_BAD_LEN);
     }
     *len -= sizeof(struct ofp_table_stats);
 
-    p = (struct ofl_table_stats *)malloc(sizeof(struct ofl_table_stats));
+    p = (struct ofl_table_stats *)ofl_malloc(sizeof(struct ofl_table_stats));
     p->table_id =      src->table_id;
     p->active_count =  ntohl(src->active_count);
     p->lookup_count =  ntoh64(src->lookup_count);
@@ -951,13 +951,13 @@ ofl_structs_port_stats_unpack(struct ofp_port_stats *src, size_t *len, struct of
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
             char *ps = ofl_port_to_string(ntohl(src->port_no));
             OFL_LOG_WARN(LOG_MODULE, "Received port stats has invalid port_id (%s).", ps);
-            free(ps);
+            ofl_free(ps);
         }
         return ofl_error(OFPET_BAD_ACTION, OFPBRC_BAD_LEN);
     }
     *len -= sizeof(struct ofp_port_stats);
 
-    p = (struct ofl_port_stats *)malloc(sizeof(struct ofl_port_stats));
+    p = (struct ofl_port_stats *)ofl_malloc(sizeof(struct ofl_port_stats));
 
     p->port_no      = ntohl(src->port_no);
     p->rx_packets   = ntoh64(src->rx_packets);
@@ -991,13 +991,13 @@ ofl_structs_queue_stats_unpack(struct ofp_queue_stats *src, size_t *len, struct
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
             char *ps = ofl_port_to_string(ntohl(src->port_no));
             OFL_LOG_WARN(LOG_MODULE, "Received queue stats has invalid port_id (%s).", ps);
-            free(ps);
+            ofl_free(ps);
         }
         return ofl_error(OFPET_BAD_ACTION, OFPBRC_BAD_LEN);
     }
     *len -= sizeof(struct ofp_queue_stats);
 
-    p = (struct ofl_queue_stats *)malloc(sizeof(struct ofl_queue_stats));
+    p = (struct ofl_queue_stats *)ofl_malloc(sizeof(struct ofl_queue_stats));
 
     p->port_no =    ntohl(src->port_no);
     p->queue_id =   ntohl(src->queue_id);
@@ -1032,23 +1032,23 @@ ofl_structs_group_desc_stats_unpack(struct ofp_group_desc_stats *src, size_t *le
         if (OFL_LOG_IS_WARN_ENABLED(LOG_MODULE)) {
             char *gs = ofl_group_to_string(ntohl(src->group_id));
             OFL_LOG_WARN(LOG_MODULE, "Received group desc stats has invalid group_id (%s).", gs);
-            free(gs);
+            ofl_free(gs);
         }
         return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_LEN);
     }
     dlen = ntohs(src->length) - sizeof(struct ofp_group_desc_stats);
 
-    dm = (struct ofl_group_desc_stats *)malloc(sizeof(struct ofl_group_desc_stats));
+    dm = (struct ofl_group_desc_stats *)ofl_malloc(sizeof(struct ofl_group_desc_stats));
 
     dm->type = src->type;
     dm->group_id = ntohl(src->group_id);
 
     error = ofl_utils_count_ofp_buckets(src->buckets, dlen, &dm->buckets_num);
     if (error) {
-        free(dm);
+        ofl_free(dm);
         return error;
     }
-    dm->buckets = (struct ofl_bucket **)malloc(dm->buckets_num * sizeof(struct ofl_bucket *));
+    dm->buckets = (struct ofl_bucket **)ofl_malloc(dm->buckets_num * sizeof(struct ofl_bucket *));
 
     bucket = src->buckets;
     for (i = 0; i < dm->buckets_num; i++) {
@@ -1084,7 +1084,7 @@ ofl_structs_bucket_counter_unpack(struct ofp_bucket_counter *src, size_t *len, s
     }
     *len -= sizeof(struct ofp_bucket_counter);
 
-    p = (struct ofl_bucket_counter *)malloc(sizeof(struct ofl_bucket_counter));
+    p = (struct ofl_bucket_counter *)ofl_malloc(sizeof(struct ofl_bucket_counter));
     p->packet_count = ntoh64(src->packet_count);
     p->byte_count =   ntoh64(src->byte_count);
 
@@ -1102,7 +1102,7 @@ ofl_structs_meter_band_unpack(struct ofp_meter_band_header *src, size_t *len, st
 	}
 	switch (ntohs(src->type)){
 		case OFPMBT_DROP:{
-			struct ofl_meter_band_drop *b = (struct ofl_meter_band_drop *)malloc(sizeof(struct ofl_meter_band_drop));
+			struct ofl_meter_band_drop *b = (struct ofl_meter_band_drop *)ofl_malloc(sizeof(struct ofl_meter_band_drop));
 			b->type = ntohs(src->type);
 			b->rate = ntohl(src->rate);
 			b->burst_size = ntohl(src->burst_size);
@@ -1111,7 +1111,7 @@ ofl_structs_meter_band_unpack(struct ofp_meter_band_header *src, size_t *len, st
 			break;
 		}
 		case OFPMBT_DSCP_REMARK:{
-			struct ofl_meter_band_dscp_remark *b = (struct ofl_meter_band_dscp_remark *)malloc(sizeof(struct ofl_meter_band_dscp_remark));
+			struct ofl_meter_band_dscp_remark *b = (struct ofl_meter_band_dscp_remark *)ofl_malloc(sizeof(struct ofl_meter_band_dscp_remark));
 			struct ofp_meter_band_dscp_remark *s = (struct ofp_meter_band_dscp_remark*)src;
 			b->type = ntohs(s->type);
 			b->rate = ntohl(s->rate);
@@ -1122,7 +1122,7 @@ ofl_structs_meter_band_unpack(struct ofp_meter_band_header *src, size_t *len, st
 			break;
 		}
 		case OFPMBT_EXPERIMENTER:{
-			struct ofl_meter_band_experimenter *b = (struct ofl_meter_band_experimenter *)malloc(sizeof(struct ofl_meter_band_experimenter));
+			struct ofl_meter_band_experimenter *b = (struct ofl_meter_band_experimenter *)ofl_malloc(sizeof(struct ofl_meter_band_experimenter));
 			struct ofp_meter_band_experimenter *s = (struct ofp_meter_band_experimenter*) src;
 			b->type = ntohs(s->type);
 			b->rate = ntohl(s->rate);
@@ -1143,20 +1143,21 @@ static ofl_err
 ofl_structs_oxm_match_unpack(struct ofp_match* src, uint8_t* buf, size_t *len, struct ofl_match **dst){
 
      int error = 0;
-     struct ofpbuf *b = ofpbuf_new(0);
-     struct ofl_match *m = (struct ofl_match *) malloc(sizeof(struct ofl_match));
+     struct ofpbuf b;
+     struct ofl_match *m = (struct ofl_match *) ofl_malloc(sizeof(struct ofl_match));
     *len -= ROUND_UP(ntohs(src->length),8);
      if(ntohs(src->length) > sizeof(struct ofp_match)){
-         ofpbuf_put(b, buf, ntohs(src->length) - (sizeof(struct ofp_match) -4)); 
-         error = oxm_pull_match(b, m, ntohs(src->length) - (sizeof(struct ofp_match) -4));
+         size_t match_len = ntohs(src->length) - (sizeof(struct ofp_match) -4);
+         /* The fields are parsed in place, the buffer is only read. */
+         ofpbuf_use(&b, buf, match_len);
+         b.size = match_len;
+         error = oxm_pull_match(&b, m, match_len);
          m->header.length = ntohs(src->length) - 4;
      }
     else {
-		 m->header.length = 0;
+		 ofl_structs_match_init(m);
 		 m->header.type = ntohs(src->type);
-         m->match_fields = (struct hmap) HMAP_INITIALIZER(&m->match_fields);	
 	}
-    ofpbuf_delete(b);    
     *dst = m;
     return error;
 }
@@ -38,6 +38,7 @@
 #include "ofl-utils.h"
 #include "ofl-log.h"
 #include "hmap.h"
+#include "oxm-match.h"
 #include "openflow/openflow.h"
 
 #define UNUSED __attribute__((__unused__))
@@ -357,7 +358,7 @@ void
 ofl_structs_free_packet_queue(struct ofl_packet_queue *queue) {
     OFL_UTILS_FREE_ARR(queue->properties, queue->properties_num);
     
-    free(queue);
+    ofl_free(queue);
 }
 
 void
@@ -387,18 +388,18 @@ ofl_structs_free_instruction(struct ofl_instruction_header *inst, struct ofl_exp
             }
         }
     }
-    free(inst);
+    ofl_free(inst);
 }
 
 void ofl_structs_free_meter_bands(struct ofl_meter_band_header *meter_band){
     
-    free(meter_band);
+    ofl_free(meter_band);
 }
 
 void
 ofl_structs_free_meter_band_stats(struct ofl_meter_band_stats* s){
     
-    free(s);
+    ofl_free(s);
  }
 
 void
@@ -406,7 +407,7 @@ ofl_structs_free_meter_stats(struct ofl_meter_stats *stats){
     
     OFL_UTILS_FREE_ARR_FUN(stats->band_stats, stats->meter_bands_num,
                             ofl_structs_free_meter_band_stats);
-    free(stats);
+    ofl_free(stats);
 }
 
 void
@@ -414,13 +415,13 @@ ofl_structs_free_meter_config(struct ofl_meter_config *conf){
     
     OFL_UTILS_FREE_ARR_FUN(conf->bands, conf->meter_bands_num,
                             ofl_structs_free_meter_bands);
-    free(conf);
+    ofl_free(conf);
 }
 
 void
 ofl_structs_free_table_stats(struct ofl_table_stats *stats) {
     
-    free(stats);
+    ofl_free(stats);
 }
 
 void
@@ -428,7 +429,7 @@ ofl_structs_free_bucket(struct ofl_bucket *bucket, struct ofl_exp *exp) {
     
     OFL_UTILS_FREE_ARR_FUN2(bucket->actions, bucket->actions_num,
                             ofl_actions_free, exp);
-    free(bucket);
+    ofl_free(bucket);
 }
 
 
@@ -438,21 +439,21 @@ ofl_structs_free_flow_stats(struct ofl_flow_stats *stats, struct ofl_exp *exp) {
     OFL_UTILS_FREE_ARR_FUN2(stats->instructions, stats->instructions_num,
                             ofl_structs_free_instruction, exp);
     ofl_structs_free_match(stats->match, exp);
-    free(stats);
+    ofl_free(stats);
 }
 
 void
 ofl_structs_free_port(struct ofl_port *port) {
     
-    free(port->name);
-    free(port);
+    ofl_free(port->name);
+    ofl_free(port);
 }
 
 void
 ofl_structs_free_group_stats(struct ofl_group_stats *stats) {
     
     OFL_UTILS_FREE_ARR(stats->counters, stats->counters_num);
-    free(stats);
+    ofl_free(stats);
 }
 
 void
@@ -460,7 +461,7 @@ ofl_structs_free_group_desc_stats(struct ofl_group_desc_stats *stats, struct ofl
     
     OFL_UTILS_FREE_ARR_FUN2(stats->buckets, stats->buckets_num,
                             ofl_structs_free_bucket, exp);
-    free(stats);
+    ofl_free(stats);
 }
 
 void
@@ -472,8 +473,8 @@ ofl_structs_free_table_features(struct ofl_table_features* features, struct ofl_
 
     OFL_UTILS_FREE_ARR_FUN2(features->properties, features->properties_num,
                             ofl_structs_free_table_properties, exp);
-    free(features->name);
-    free(features);
+    ofl_free(features->name);
+    ofl_free(features);
 }
 
 void
@@ -483,13 +484,13 @@ ofl_structs_free_table_properties(struct ofl_table_feature_prop_header *prop, st
         case (OFPTFPT_INSTRUCTIONS):
         case (OFPTFPT_INSTRUCTIONS_MISS):{
             struct ofl_table_feature_prop_instructions *inst = (struct ofl_table_feature_prop_instructions *)prop;
-            free(inst->instruction_ids);
+            ofl_free(inst->instruction_ids);
             break;
         }
         case (OFPTFPT_NEXT_TABLES_MISS):
         case (OFPTFPT_NEXT_TABLES):{
             struct ofl_table_feature_prop_next_tables *tables = (struct ofl_table_feature_prop_next_tables *)prop ;
-            free(tables->next_table_ids);
+            ofl_free(tables->next_table_ids);
             break;
         }
         case (OFPTFPT_WRITE_ACTIONS):
@@ -497,7 +498,7 @@ ofl_structs_free_table_properties(struct ofl_table_feature_prop_header *prop, st
         case (OFPTFPT_APPLY_ACTIONS):
         case (OFPTFPT_APPLY_ACTIONS_MISS):{
             struct ofl_table_feature_prop_actions *act = (struct ofl_table_feature_prop_actions *)prop;
-            free(act->action_ids);
+            ofl_free(act->action_ids);
             break;
         }
         case (OFPTFPT_APPLY_SETFIELD):
@@ -507,11 +508,55 @@ ofl_structs_free_table_properties(struct ofl_table_feature_prop_header *prop, st
         case (OFPTFPT_WILDCARDS):
         case (OFPTFPT_MATCH):{
             struct ofl_table_feature_prop_oxm *oxm = (struct ofl_table_feature_prop_oxm *)prop;
-            free(oxm->oxm_ids);
+            ofl_free(oxm->oxm_ids);
             break;
         }
     }
-    free(prop);
+    ofl_free(prop);
+}
+
+struct ofl_instruction_header *
+ofl_structs_instruction_copy_out(struct ofl_instruction_header *inst) {
+    size_t size;
+
+    if (!ofl_arena_owns(inst)) {
+        return inst;
+    }
+    switch (inst->type) {
+        case OFPIT_WRITE_ACTIONS:
+        case OFPIT_APPLY_ACTIONS: {
+            struct ofl_instruction_actions *ia = (struct ofl_instruction_actions *)inst;
+            struct ofl_instruction_actions *c = malloc(sizeof(struct ofl_instruction_actions));
+            size_t i;
+
+            c->header = ia->header;
+            c->actions_num = ia->actions_num;
+            c->actions = malloc(ia->actions_num * sizeof(struct ofl_action_header *));
+            for (i = 0; i < ia->actions_num; i++) {
+                c->actions[i] = ofl_actions_copy_out(ia->actions[i]);
+            }
+            return (struct ofl_instruction_header *)c;
+        }
+        case OFPIT_GOTO_TABLE:     size = sizeof(struct ofl_instruction_goto_table); break;
+        case OFPIT_WRITE_METADATA: size = sizeof(struct ofl_instruction_write_metadata); break;
+        case OFPIT_METER:          size = sizeof(struct ofl_instruction_meter); break;
+        case OFPIT_CLEAR_ACTIONS:
+        case OFPIT_EXPERIMENTER:
+        default:                   size = sizeof(struct ofl_instruction_header); break;
+    }
+    return memcpy(malloc(size), inst, size);
+}
+
+struct ofl_match_header *
+ofl_structs_match_copy_out(struct ofl_match_header *match) {
+    struct ofl_match *dst;
+
+    if (!ofl_arena_owns(match)) {
+        return match;
+    }
+    dst = malloc(sizeof(struct ofl_match));
+    ofl_structs_match_copy(dst, (struct ofl_match *)match);
+    return (struct ofl_match_header *)dst;
 }
 
 void
@@ -519,24 +564,15 @@ ofl_structs_free_match(struct ofl_match_header *match, struct ofl_exp *exp) {
     
     switch (match->type) {
         case (OFPMT_OXM): {
-            if (match->length > sizeof(struct ofp_match)){
-                struct ofl_match *m = (struct ofl_match*) match;
-                struct ofl_match_tlv *tlv, *next;
-                HMAP_FOR_EACH_SAFE(tlv, next, struct ofl_match_tlv, hmap_node, &m->match_fields){
-                    free(tlv->value);
-                    free(tlv);
-                }
-                hmap_destroy(&m->match_fields);
-                free(m);
-            }
-            else free(match);
+            ofl_structs_match_clear((struct ofl_match *) match);
+            ofl_free(match);
 
             break;
         }
         default: {
             if (exp == NULL || exp->match == NULL || exp->match->free == NULL) {
                 OFL_LOG_WARN(LOG_MODULE, "Trying to free experimented instruction, but no callback was given.");
-                free(match);
+                ofl_free(match);
             } else {
                 exp->match->free(match);
             }
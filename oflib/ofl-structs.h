@@ -44,6 +44,7 @@
 
 
 struct ofl_exp;
+struct ofpbuf;
 
 /****************************************************************************
  * Supplementary structure definitions.
@@ -229,18 +230,78 @@ struct ofl_match_header {
     uint16_t   length;           /* Match length */
 };
 
-struct ofl_match {
-    struct ofl_match_header   header; /* Match header */
-    struct hmap match_fields;         /* Match fields. Contain OXM TLV's  */
-};
-
 struct ofl_match_tlv{
-
-    struct hmap_node hmap_node;
     uint32_t header;    /* TLV header */
     uint8_t *value;     /* TLV value */
 };
 
+/* Number of field slots in a match: one for each field of the OpenFlow basic
+ * class, the DHT fields of HDDP included. */
+#define OFL_MATCH_FIELDS (OFPXMT_OFB_DHT_OUT_PORTS + 1)
+
+/* Bytes of value and mask kept in the slot itself. Only masked IPv6
+ * addresses and the DHT fields need more, and are allocated apart. */
+#define OFL_MATCH_INLINE 16
+
+/* The fields of a match are kept in a slot each, indexed by their OXM field
+ * id, so looking a field up does not hash nor allocate. The value of a field
+ * points to the inline storage of its slot, which makes a match not movable:
+ * it is copied with ofl_structs_match_copy, never by assignment. The wire
+ * format TLVs are only built when packing (oxm_put_match) and parsed when
+ * unpacking (oxm_pull_match). */
+struct ofl_match {
+    struct ofl_match_header   header; /* Match header */
+    uint64_t                  present; /* Bit i is set if slot i holds a field. */
+    struct ofl_match_tlv      fields[OFL_MATCH_FIELDS];
+    uint16_t                  lengths[OFL_MATCH_FIELDS]; /* value + mask. */
+    uint8_t                   values[OFL_MATCH_FIELDS][OFL_MATCH_INLINE];
+};
+
+/* Returns the field of match with the given header (the has-mask bit and
+ * the length included), or NULL if the match has no such field. */
+static inline struct ofl_match_tlv *
+ofl_structs_match_lookup(const struct ofl_match *match, uint32_t header) {
+    unsigned int slot = (header >> 9) & 0x7f;
+
+    if (slot < OFL_MATCH_FIELDS && (match->present & (UINT64_C(1) << slot))
+        && match->fields[slot].header == header) {
+        return (struct ofl_match_tlv *)&match->fields[slot];
+    }
+    return NULL;
+}
+
+/* Returns the field of match in the slot of field id, whatever its mask, or
+ * NULL if the slot is empty. */
+static inline struct ofl_match_tlv *
+ofl_structs_match_slot(const struct ofl_match *match, unsigned int field) {
+    if (field < OFL_MATCH_FIELDS && (match->present & (UINT64_C(1) << field))) {
+        return (struct ofl_match_tlv *)&match->fields[field];
+    }
+    return NULL;
+}
+
+/* Returns the field of match that follows f in field id order, or the first
+ * one if f is NULL. */
+static inline struct ofl_match_tlv *
+ofl_structs_match_next(const struct ofl_match *match, const struct ofl_match_tlv *f) {
+    uint64_t bits = match->present;
+
+    if (f != NULL) {
+        bits &= ~((UINT64_C(2) << (f - match->fields)) - 1);
+    }
+    return bits ? (struct ofl_match_tlv *)&match->fields[__builtin_ctzll(bits)] : NULL;
+}
+
+/* Iterates F over the fields of MATCH. The current field may be removed. */
+#define OFL_MATCH_FOR_EACH(F, MATCH)                             \
+    for ((F) = ofl_structs_match_next(MATCH, NULL); (F) != NULL; \
+         (F) = ofl_structs_match_next(MATCH, F))
+
+static inline size_t
+ofl_structs_match_count(const struct ofl_match *match) {
+    return __builtin_popcountll(match->present);
+}
+
 
 /* Common header for all meter bands */
 struct ofl_meter_band_header {
@@ -403,12 +464,29 @@ struct ofl_meter_features {
 /****************************************************************************
  * Utility functions to match structure
  ****************************************************************************/
-void
-ofl_structs_match_init(struct ofl_match *match);
-
 #ifdef __cplusplus
 extern "C" {
 #endif
+void
+ofl_structs_match_init(struct ofl_match *match);
+
+/* Frees the values that match allocated and empties it. */
+void
+ofl_structs_match_clear(struct ofl_match *match);
+
+/* Initializes dst with a copy of the fields of src. */
+void
+ofl_structs_match_copy(struct ofl_match *dst, const struct ofl_match *src);
+
+/* Sets the field with the given header to the len bytes of value and mask
+ * at value, replacing the field in the same slot, if any. */
+void
+ofl_structs_match_put(struct ofl_match *match, uint32_t header, const void *value, size_t len);
+
+/* Removes the field in the slot of the given header, if any. */
+void
+ofl_structs_match_remove(struct ofl_match *match, uint32_t header);
+
 void
 ofl_structs_match_put8(struct ofl_match *match, uint32_t header, uint8_t value);
 
@@ -496,6 +574,12 @@ ofl_structs_bucket_pack(struct ofl_bucket *src, struct ofp_bucket *dst, struct o
 size_t
 ofl_structs_flow_stats_pack(struct ofl_flow_stats *src, uint8_t *dst, struct ofl_exp *exp);
 
+/* Appends the wire format of the flow stats in src to buf, writing the match
+ * and the instructions straight into it. Returns the number of bytes
+ * appended. */
+size_t
+ofl_structs_flow_stats_put(struct ofl_flow_stats *src, struct ofpbuf *buf, struct ofl_exp *exp);
+
 size_t
 ofl_structs_group_stats_pack(struct ofl_group_stats *src, struct ofp_group_stats *dst);
 
@@ -522,6 +606,11 @@ ofl_structs_queue_stats_pack(struct ofl_queue_stats *src, struct ofp_queue_stats
 size_t
 ofl_structs_group_desc_stats_pack(struct ofl_group_desc_stats *src, struct ofp_group_desc_stats *dst, struct ofl_exp *exp);
 
+/* Appends the wire format of the group description in src to buf, as
+ * ofl_structs_flow_stats_put. */
+size_t
+ofl_structs_group_desc_stats_put(struct ofl_group_desc_stats *src, struct ofpbuf *buf, struct ofl_exp *exp);
+
 size_t
 ofl_structs_bucket_counter_pack(struct ofl_bucket_counter *src, struct ofp_bucket_counter *dst);
 
@@ -616,6 +705,16 @@ ofl_structs_free_group_desc_stats(struct ofl_group_desc_stats *stats, struct ofl
 void
 ofl_structs_free_match(struct ofl_match_header *match, struct ofl_exp *exp);
 
+/* Return a copy on the heap of an instruction or match that was unpacked into
+ * an arena, or the structure itself if it was not. The original must not be
+ * freed afterwards: the arena reclaims it, and parts that were already on the
+ * heap are moved to the copy. */
+struct ofl_instruction_header *
+ofl_structs_instruction_copy_out(struct ofl_instruction_header *inst);
+
+struct ofl_match_header *
+ofl_structs_match_copy_out(struct ofl_match_header *match);
+
 void
 ofl_structs_free_meter_band_stats(struct ofl_meter_band_stats* s);
 
@@ -34,6 +34,8 @@
 
 
 #include <netinet/in.h>
+#include "ofl-arena.h"
+#include "ofpbuf.h"
 
 
 /* Given an array of pointers _elem_, and the number of elements in the array
@@ -43,9 +45,9 @@
 {                                               \
      size_t _iter;                              \
      for (_iter=0; _iter<ELEM_NUM; _iter++) {   \
-         free(ELEMS[_iter]);                    \
+         ofl_free(ELEMS[_iter]);                    \
      }                                          \
-     free(ELEMS);                               \
+     ofl_free(ELEMS);                               \
 }
 
  /* Given an array of pointers _elem_, and the number of elements in the array
@@ -57,7 +59,7 @@
      for (_iter=0; _iter<ELEM_NUM; _iter++) {   \
          FREE_FUN(ELEMS[_iter]);                \
      }                                          \
-     free(ELEMS);                               \
+     ofl_free(ELEMS);                               \
 }
 
 #define OFL_UTILS_FREE_ARR_FUN2(ELEMS, ELEM_NUM, FREE_FUN, ARG2) \
@@ -66,7 +68,7 @@
      for (_iter=0; _iter<ELEM_NUM; _iter++) {    \
          FREE_FUN(ELEMS[_iter], ARG2);           \
      }                                           \
-     free(ELEMS);                                \
+     ofl_free(ELEMS);                                \
 }
 
 
@@ -118,5 +120,16 @@ ntoh64(uint64_t n) {
 #endif
 }
 
+/* Appends size uninitialized bytes to buf, as ofpbuf_put_uninit. When buf has
+ * to grow its capacity is at least doubled, so that packing into a buffer
+ * that was not reserved large enough does not reallocate on every element. */
+static inline void *
+ofl_utils_put_uninit(struct ofpbuf *buf, size_t size) {
+    if (size > ofpbuf_tailroom(buf)) {
+        ofpbuf_prealloc_tailroom(buf, size > buf->size ? size : buf->size);
+    }
+    return ofpbuf_put_uninit(buf, size);
+}
+
 
 #endif /* OFL_UTILS_H */
@@ -194,29 +194,14 @@ oxm_field_lookup(uint32_t header)
 struct ofl_match_tlv *
 oxm_match_lookup(uint32_t header, const struct ofl_match *omt)
 {
-    struct ofl_match_tlv *f;
-
-    HMAP_FOR_EACH_WITH_HASH(f, struct ofl_match_tlv, hmap_node, hash_int(header, 0),
-    					    &omt->match_fields) {
-        if (f->header == header) {
-            return f;
-        }
-    }
-    return NULL;
+    return ofl_structs_match_lookup(omt, header);
 }
 
 
 static bool
 check_present_prereq(const struct ofl_match *match, uint32_t header){
 
-    struct ofl_match_tlv *omt;
-
-    /* Check for header */
-    HMAP_FOR_EACH_WITH_HASH (omt, struct ofl_match_tlv, hmap_node, hash_int(header, 0),
-          &match->match_fields) {
-         return true;
-    }
-    return false;
+    return ofl_structs_match_lookup(match, header) != NULL;
 }
 
 bool
@@ -228,8 +213,8 @@ oxm_prereqs_ok(const struct oxm_field *field, const struct ofl_match *rule)
     /*Check ICMP type*/
     if (field->header == OXM_OF_IPV6_ND_SLL || field->header == OXM_OF_IPV6_ND_TARGET ){
         
-        HMAP_FOR_EACH_WITH_HASH (omt, struct ofl_match_tlv, hmap_node, hash_int(OXM_OF_ICMPV6_TYPE, 0),
-              &rule->match_fields) {
+        omt = ofl_structs_match_lookup(rule, OXM_OF_ICMPV6_TYPE);
+        if (omt != NULL) {
             if (*(omt)->value != ICMPV6_NEIGHSOL){
                 return false;
             }
@@ -240,8 +225,8 @@ oxm_prereqs_ok(const struct oxm_field *field, const struct ofl_match *rule)
     }
     /*Check ICMP type*/
     if ((field->header == OXM_OF_IPV6_ND_TLL || field->header == OXM_OF_IPV6_ND_TARGET) && !found){
-        HMAP_FOR_EACH_WITH_HASH (omt, struct ofl_match_tlv, hmap_node, hash_int(OXM_OF_ICMPV6_TYPE, 0),
-              &rule->match_fields) {
+        omt = ofl_structs_match_lookup(rule, OXM_OF_ICMPV6_TYPE);
+        if (omt != NULL) {
             if (*omt->value != ICMPV6_NEIGHADV){
                 return false;
             }
@@ -253,16 +238,13 @@ oxm_prereqs_ok(const struct oxm_field *field, const struct ofl_match *rule)
 
     /*Check for IP_PROTO */
     if (field->nw_proto){
-        found =  false;
-        HMAP_FOR_EACH_WITH_HASH (omt, struct ofl_match_tlv, hmap_node, hash_int(OXM_OF_IP_PROTO, 0),
-            &rule->match_fields) {
-            uint8_t ip_proto;
-            memcpy(&ip_proto,omt->value, sizeof(uint8_t));
-            if (field->nw_proto != ip_proto)
-                return false;
-            found = true;
-        }
-        if(!found)
+        uint8_t ip_proto;
+
+        omt = ofl_structs_match_lookup(rule, OXM_OF_IP_PROTO);
+        if (omt == NULL)
+            return false;
+        memcpy(&ip_proto,omt->value, sizeof(uint8_t));
+        if (field->nw_proto != ip_proto)
             return false;
     }
 
@@ -270,8 +252,8 @@ oxm_prereqs_ok(const struct oxm_field *field, const struct ofl_match *rule)
     if (!field->dl_type[0])
         return true;
     else {
-        HMAP_FOR_EACH_WITH_HASH (omt, struct ofl_match_tlv, hmap_node, hash_int(OXM_OF_ETH_TYPE, 0),
-              &rule->match_fields) {
+        omt = ofl_structs_match_lookup(rule, OXM_OF_ETH_TYPE);
+        if (omt != NULL) {
               uint16_t eth_type;
               memcpy(&eth_type, omt->value, sizeof(uint16_t));
               if (field->dl_type[0] == htons(eth_type)) {
@@ -285,27 +267,18 @@ oxm_prereqs_ok(const struct oxm_field *field, const struct ofl_match *rule)
     return false;
 }
 
+/* A field may appear once in a match, masked or not. */
 static bool
 check_oxm_dup(struct ofl_match *match,const struct oxm_field *om){
 
-    struct ofl_match_tlv *t;
-    HMAP_FOR_EACH_WITH_HASH(t, struct ofl_match_tlv, hmap_node ,hash_int(om->header, 0),
-                             &match->match_fields) {
-        return true;
-    }
-    return false;
-
+    return ofl_structs_match_slot(match, OXM_FIELD(om->header)) != NULL;
 }
 
 static uint8_t* get_oxm_value(struct ofl_match *m, uint32_t header){
 
-     struct ofl_match_tlv *t;
-     HMAP_FOR_EACH_WITH_HASH (t, struct ofl_match_tlv, hmap_node, hash_int(header, 0),
-          &m->match_fields) {
-         return t->value;
-     }
+     struct ofl_match_tlv *t = ofl_structs_match_lookup(m, header);
 
-     return NULL;
+     return t != NULL ? t->value : NULL;
 }
 
 static int
@@ -576,7 +549,7 @@ parse_oxm_entry(struct ofl_match *match, const struct oxm_field *f,
 /* oxm_pull_match() and helpers. */
 
 
-/* Puts the match in a hash_map structure */
+/* Parses the OXM TLVs of a match into the field slots of match_dst */
 int
 oxm_pull_match(struct ofpbuf *buf, struct ofl_match * match_dst, int match_len)
 {
@@ -593,7 +566,7 @@ oxm_pull_match(struct ofpbuf *buf, struct ofl_match * match_dst, int match_len)
         return ofp_mkerr(OFPET_BAD_MATCH, OFPBRC_BAD_LEN);
     }
 
-    /* Initialize the match hashmap */
+    /* Initialize the match slots */
     ofl_structs_match_init(match_dst);
 
     while ((header = oxm_entry_ok(p, match_len)) != 0) {
@@ -851,8 +824,7 @@ int oxm_put_match(struct ofpbuf *buf, struct ofl_match *omt){
 
     /* We put all pre-requisites fields first */
     /* In port present */
-    HMAP_FOR_EACH_WITH_HASH(oft, struct ofl_match_tlv, hmap_node, hash_int(OXM_OF_IN_PORT, 0),
-          &omt->match_fields) {
+    if ((oft = ofl_structs_match_lookup(omt, OXM_OF_IN_PORT)) != NULL) {
         uint32_t value;
         memcpy(&value, oft->value,sizeof(uint32_t));
         oxm_put_32(buf,oft->header, htonl(value));
@@ -861,38 +833,34 @@ int oxm_put_match(struct ofpbuf *buf, struct ofl_match *omt){
     /* L2 Pre-requisites */
 
     /* Ethernet type */
-    HMAP_FOR_EACH_WITH_HASH(oft, struct ofl_match_tlv, hmap_node, hash_int(OXM_OF_ETH_TYPE, 0),
-          &omt->match_fields) {
+    if ((oft = ofl_structs_match_lookup(omt, OXM_OF_ETH_TYPE)) != NULL) {
         uint16_t value;
         memcpy(&value, oft->value,sizeof(uint16_t));
         oxm_put_16(buf,oft->header, htons(value));
     }
 
      /* VLAN ID */
-    HMAP_FOR_EACH_WITH_HASH(oft, struct ofl_match_tlv, hmap_node, hash_int(OXM_OF_VLAN_VID, 0),
-          &omt->match_fields) {
+    if ((oft = ofl_structs_match_lookup(omt, OXM_OF_VLAN_VID)) != NULL) {
          uint16_t value;
          memcpy(&value, oft->value,sizeof(uint16_t));
          oxm_put_16(buf,oft->header, htons(value));
     }
 
     /* L3 Pre-requisites */
-     HMAP_FOR_EACH_WITH_HASH(oft, struct ofl_match_tlv, hmap_node, hash_int(OXM_OF_IP_PROTO, 0),
-          &omt->match_fields) {
+     if ((oft = ofl_structs_match_lookup(omt, OXM_OF_IP_PROTO)) != NULL) {
          uint8_t value;
          memcpy(&value, oft->value,sizeof(uint8_t));
          oxm_put_8(buf,oft->header, value);
     }
 
-    HMAP_FOR_EACH_WITH_HASH(oft, struct ofl_match_tlv, hmap_node, hash_int(OXM_OF_ICMPV6_TYPE, 0),
-          &omt->match_fields) {
+    if ((oft = ofl_structs_match_lookup(omt, OXM_OF_ICMPV6_TYPE)) != NULL) {
          uint8_t value;
          memcpy(&value, oft->value,sizeof(uint8_t));
          oxm_put_8(buf,oft->header, value);
     }
 
     /* Loop through the remaining fields */
-    HMAP_FOR_EACH(oft, struct ofl_match_tlv, hmap_node, &omt->match_fields){
+    OFL_MATCH_FOR_EACH(oft, omt) {
 
         if (is_requisite(oft->header))
             /*We already inserted  fields that are pre requisites to others */
@@ -16,12 +16,22 @@ udatapath_ofdatapath_SOURCES = \
 	udatapath/dp_actions.h \
 	udatapath/dp_buffers.c \
 	udatapath/dp_buffers.h \
+	udatapath/dp_counters.c \
+	udatapath/dp_counters.h \
+	udatapath/dp_bundle.c \
+	udatapath/dp_bundle.h \
+	udatapath/dp_latency.c \
+	udatapath/dp_latency.h \
+	udatapath/dp_hddp.c \
+	udatapath/dp_hddp.h \
 	udatapath/dp_control.c \
 	udatapath/dp_control.h \
 	udatapath/dp_exp.c \
 	udatapath/dp_exp.h \
 	udatapath/dp_ports.c \
 	udatapath/dp_ports.h \
+	udatapath/dp_sched.c \
+	udatapath/dp_sched.h \
 	udatapath/flow_table.c \
 	udatapath/flow_table.h \
 	udatapath/flow_entry.c \
@@ -78,10 +88,20 @@ udatapath_libudatapath_a_SOURCES = \
 	udatapath/dp_actions.h \
 	udatapath/dp_buffers.c \
 	udatapath/dp_buffers.h \
+	udatapath/dp_counters.c \
+	udatapath/dp_counters.h \
+	udatapath/dp_bundle.c \
+	udatapath/dp_bundle.h \
+	udatapath/dp_latency.c \
+	udatapath/dp_latency.h \
+	udatapath/dp_hddp.c \
+	udatapath/dp_hddp.h \
 	udatapath/dp_control.c \
 	udatapath/dp_control.h \
 	udatapath/dp_exp.c \
 	udatapath/dp_exp.h \
+	udatapath/dp_sched.c \
+	udatapath/dp_sched.h \
 	udatapath/flow_table.c \
 	udatapath/flow_table.h \
 	udatapath/flow_entry.c \
@@ -104,3 +124,24 @@ udatapath_libudatapath_a_CPPFLAGS = $(AM_CPPFLAGS)
 udatapath_libudatapath_a_CPPFLAGS += -DOF_HW_PLAT -DUDATAPATH_AS_LIB -g -lnbee_link
 
 endif
+
+#
+# Build udatapath as a library for the datapath benchmark and simulator
+#
+
+noinst_LIBRARIES += udatapath/libudatapath_bench.a
+
+udatapath_libudatapath_bench_a_SOURCES = $(udatapath_ofdatapath_SOURCES)
+udatapath_libudatapath_bench_a_CPPFLAGS = $(AM_CPPFLAGS) -DUDATAPATH_AS_LIB
+
+noinst_PROGRAMS += udatapath/dp-bench
+
+udatapath_dp_bench_SOURCES = udatapath/dp-bench.c
+udatapath_dp_bench_LDADD = udatapath/libudatapath_bench.a lib/libopenflow.a oflib/liboflib.a oflib-exp/liboflib_exp.a nbee_link/libnbee_link.a $(SSL_LIBS) $(FAULT_LIBS)
+nodist_EXTRA_udatapath_dp_bench_SOURCES = dummy.cxx
+
+noinst_PROGRAMS += udatapath/hddp-sim
+
+udatapath_hddp_sim_SOURCES = udatapath/hddp-sim.c
+udatapath_hddp_sim_LDADD = udatapath/libudatapath_bench.a lib/libopenflow.a oflib/liboflib.a oflib-exp/liboflib_exp.a nbee_link/libnbee_link.a $(SSL_LIBS) $(FAULT_LIBS)
+nodist_EXTRA_udatapath_hddp_sim_SOURCES = dummy.cxx
@@ -30,20 +30,26 @@
 #include <unistd.h>
 #include "csum.h"
 #include "dp_buffers.h"
+#include "dp_bundle.h"
 #include "dp_control.h"
+#include "dp_latency.h"
 #include "ofp.h"
 #include "ofpbuf.h"
 #include "group_table.h"
 #include "meter_table.h"
 #include "oflib/ofl.h"
+#include "oflib/ofl-arena.h"
 #include "oflib-exp/ofl-exp.h"
 #include "oflib-exp/ofl-exp-nicira.h"
 #include "oflib/ofl-messages.h"
 #include "oflib/ofl-log.h"
+#include "oflib/ofl-utils.h"
+#include "oflib/oxm-match.h"
 #include "openflow/openflow.h"
 #include "openflow/nicira-ext.h"
 #include "openflow/private-ext.h"
 #include "openflow/openflow-ext.h"
+#include "packet.h"
 #include "pipeline.h"
 #include "poll-loop.h"
 #include "rconn.h"
@@ -71,6 +77,9 @@ static void remote_destroy(struct remote *);
 #define MAIN_CONNECTION 0
 #define PTIN_CONNECTION 1
 
+/* Chunk size of the arena for unpacked flow mods and packet outs. */
+#define MSG_ARENA_CHUNK 16384
+
 
 /* Callbacks for processing experimenter messages in OFLib. */
 static struct ofl_exp_msg dp_exp_msg =
@@ -79,11 +88,21 @@ static struct ofl_exp_msg dp_exp_msg =
          .free      = ofl_exp_msg_free,
          .to_string = ofl_exp_msg_to_string};
 
+static struct ofl_exp_stats dp_exp_multipart =
+        {.req_pack        = ofl_exp_stats_req_pack,
+         .req_unpack      = ofl_exp_stats_req_unpack,
+         .req_free        = ofl_exp_stats_req_free,
+         .req_to_string   = ofl_exp_stats_req_to_string,
+         .reply_pack      = ofl_exp_stats_reply_pack,
+         .reply_unpack    = ofl_exp_stats_reply_unpack,
+         .reply_free      = ofl_exp_stats_reply_free,
+         .reply_to_string = ofl_exp_stats_reply_to_string};
+
 static struct ofl_exp dp_exp =
         {.act   = NULL,
          .inst  = NULL,
          .match = NULL,
-         .stats = NULL,
+         .stats = &dp_exp_multipart,
          .msg   = &dp_exp_msg};
 
 /* Generates and returns a random datapath id. */
@@ -127,15 +146,31 @@ dp_new(void) {
     dp->local_port = NULL;
 
     dp->buffers = dp_buffers_create(dp);
+    dp_counters_init(&dp->counters);
     dp->pipeline = pipeline_create(dp);
     dp->groups = group_table_create(dp);
     dp->meters = meter_table_create(dp);
 
     list_init(&dp->port_list);
     dp->ports_num = 0;
+    dp->all_ports_num = 0;
+    dp->flood_ports_num = 0;
+    dp->out_ports_stale = true;
+    dp->link_monitor = NULL;
+    memset(&dp->hddp_stats, 0x00, sizeof(struct hddp_stats));
+    memset(&dp->hddp_seen, 0x00, sizeof(struct hddp_seen_cache));
+    memset(&dp->hddp_delta, 0x00, sizeof(struct hddp_delta));
+    dp->hddp_delta.full_every = HDDP_DELTA_FULL_EVERY;
+    dp->hddp_events_num = 0;
+    ds_init(&dp->hddp_trace);
+    dp_hddp_init(dp);
+    dp_latency_init();
     dp->max_queues = NETDEV_MAX_QUEUES;
+    dp->sched_mode = DP_SCHED_NONE;
+    dp->sched_rate = 0;
 
     dp->exp = &dp_exp;
+    dp->msg_arena = ofl_arena_create(MSG_ARENA_CHUNK);
 
     dp->config.flags         = OFPC_FRAG_NORMAL;
     dp->config.miss_send_len = OFP_DEFAULT_MISS_SEND_LEN;
@@ -169,6 +204,20 @@ dp_add_pvconn(struct datapath *dp, struct pvconn *pvconn, struct pvconn *pvconn_
     dp->listeners_aux[dp->n_listeners_aux++] = pvconn_aux;
 }
 
+/* Corks or uncorks the connections of all remotes. */
+static void
+remotes_cork(struct datapath *dp, bool cork) {
+    struct remote *r;
+
+    LIST_FOR_EACH (r, struct remote, node, &dp->remotes) {
+        void (*fn)(struct rconn *) = cork ? rconn_cork : rconn_uncork;
+        fn(r->rconn);
+        if (r->rconn_aux != NULL) {
+            fn(r->rconn_aux);
+        }
+    }
+}
+
 void
 dp_run(struct datapath *dp) {
     time_t now = time_now();
@@ -182,12 +231,19 @@ dp_run(struct datapath *dp) {
     }
 
     poll_timer_wait(100);
+
+    /* Packet-ins and replies produced in this round are queued and written
+     * to each connection in batches once it is over. */
+    remotes_cork(dp, true);
     dp_ports_run(dp);
+    dp_hddp_run(dp);
+    hddp_neighbor_flush(dp);
 
     /* Talk to remotes. */
     LIST_FOR_EACH_SAFE (r, rn, struct remote, node, &dp->remotes) {
         remote_run(dp, r);
     }
+    remotes_cork(dp, false);
 
     for (i = 0; i < dp->n_listeners; ) {
         struct pvconn *pvconn = dp->listeners[i];
@@ -233,6 +289,24 @@ remote_run(struct datapath *dp, struct remote *r)
     remote_rconn_run(dp, r, PTIN_CONNECTION);
 }
 
+/* Returns the length of the frame carried by a PACKET_OUT message which does
+ * not refer to a buffered packet, or 0 for any other message. */
+static size_t
+packet_out_frame_len(struct ofpbuf *buffer) {
+    struct ofp_packet_out *po = (struct ofp_packet_out *)buffer->data;
+    size_t hdr_len;
+
+    if (buffer->size < sizeof(struct ofp_packet_out) ||
+        po->header.version != OFP_VERSION ||
+        po->header.type != OFPT_PACKET_OUT ||
+        ntohs(po->header.length) != buffer->size ||
+        po->buffer_id != htonl(OFP_NO_BUFFER)) {
+        return 0;
+    }
+    hdr_len = sizeof(struct ofp_packet_out) + ntohs(po->actions_len);
+    return hdr_len < buffer->size ? buffer->size - hdr_len : 0;
+}
+
 static void
 remote_rconn_run(struct datapath *dp, struct remote *r, uint8_t conn_id) {
     struct rconn *rconn = NULL;
@@ -257,14 +331,43 @@ remote_rconn_run(struct datapath *dp, struct remote *r, uint8_t conn_id) {
             } else {
                 struct ofl_msg_header *msg;
 
-                struct sender sender = {.remote = r, .conn_id = conn_id};
-
-                error = ofl_msg_unpack(buffer->data, buffer->size, &msg, &(sender.xid), dp->exp);
+                struct sender sender = {.remote = r, .conn_id = conn_id,
+                                        .buffer = buffer};
+                size_t frame_len = packet_out_frame_len(buffer);
+                uint8_t type = ((struct ofp_header *)buffer->data)->type;
+
+                if (frame_len > 0) {
+                    /* The frame is left out of the unpacked message: it
+                     * stays in the received buffer, which the packet built
+                     * from it adopts instead of a copy of the data. */
+                    struct ofp_header *oh = (struct ofp_header *)buffer->data;
+                    oh->length = htons(buffer->size - frame_len);
+                    error = ofl_msg_unpack_arena(buffer->data, buffer->size - frame_len,
+                                                 &msg, &(sender.xid), dp->exp, dp->msg_arena);
+                    oh->length = htons(buffer->size);
+                    if (!error) {
+                        struct ofl_msg_packet_out *po = (struct ofl_msg_packet_out *)msg;
+                        po->data_length = frame_len;
+                        po->data = (uint8_t *)ofpbuf_tail(buffer) - frame_len;
+                    }
+                } else if (type == OFPT_FLOW_MOD || type == OFPT_PACKET_OUT) {
+                    /* Nothing of these is kept once they are handled, but
+                     * the match and instructions of flow entries, which
+                     * pipeline_handle_flow_mod() copies out. */
+                    error = ofl_msg_unpack_arena(buffer->data, buffer->size, &msg,
+                                                 &(sender.xid), dp->exp, dp->msg_arena);
+                } else {
+                    error = ofl_msg_unpack(buffer->data, buffer->size, &msg, &(sender.xid), dp->exp);
+                }
 
                 if (!error) {
                     error = handle_control_msg(dp, msg, &sender);
 
                     if (error) {
+                        if (frame_len > 0) {
+                            /* The frame is not owned by the message. */
+                            ((struct ofl_msg_packet_out *)msg)->data = NULL;
+                        }
                         ofl_msg_free(msg, dp->exp);
                     }
                 }
@@ -279,6 +382,7 @@ remote_rconn_run(struct datapath *dp, struct remote *r, uint8_t conn_id) {
                     dp_send_message(dp, (struct ofl_msg_header *)&err, &sender);
                 }
 
+                ofl_arena_reset(dp->msg_arena);
                 ofpbuf_delete(buffer);
             }
         } else {
@@ -326,6 +430,7 @@ remote_destroy(struct remote *r)
 	if(r->mp_req_msg != NULL) {
 	  ofl_msg_free((struct ofl_msg_header *) r->mp_req_msg, NULL);
 	}
+        dp_bundle_discard_all(r);
         free(r);
     }
 }
@@ -343,6 +448,7 @@ remote_create(struct datapath *dp, struct rconn *rconn, struct rconn *rconn_aux)
     remote->mp_req_msg = NULL;
     remote->mp_req_xid = 0;  /* Currently not needed. Jean II. */
     remote->role = OFPCR_ROLE_EQUAL;
+    list_init(&remote->bundles);
     /* Set the remote configuration to receive any asynchronous message*/
     for(i = 0; i < 2; i++){
         memset(&remote->config.packet_in_mask[i], 0x7, sizeof(uint32_t));
@@ -364,8 +470,17 @@ dp_wait(struct datapath *dp)
         if (IS_HW_PORT(p)) {
             continue;
         }
-        netdev_recv_wait(p->netdev);
+        if (p->netdev != NULL) {
+            netdev_recv_wait(p->netdev);
+        }
+        if (p->sched != NULL) {
+            dp_sched_wait(p->sched, time_msec());
+        }
     }
+    if (dp->link_monitor != NULL) {
+        netdev_monitor_wait(dp->link_monitor);
+    }
+    dp_hddp_wait(dp);
     LIST_FOR_EACH (r, struct remote, node, &dp->remotes) {
         remote_wait(r);
     }
@@ -414,6 +529,12 @@ dp_set_max_queues(struct datapath *dp, uint32_t max_queues) {
     dp->max_queues = max_queues;
 }
 
+void
+dp_set_sched(struct datapath *dp, enum dp_sched_mode mode, uint64_t rate) {
+    dp->sched_mode = mode;
+    dp->sched_rate = rate;
+}
+
 
 static int
 send_openflow_buffer_to_remote(struct ofpbuf *buffer, struct remote *remote) {
@@ -524,9 +645,14 @@ send_openflow_buffer(struct datapath *dp, struct ofpbuf *buffer,
 int
 dp_send_message(struct datapath *dp, struct ofl_msg_header *msg,
                      const struct sender *sender) {
+    return dp_send_message_sized(dp, msg, sender, 0);
+}
+
+int
+dp_send_message_sized(struct datapath *dp, struct ofl_msg_header *msg,
+                      const struct sender *sender, size_t len_hint) {
     struct ofpbuf *ofpbuf;
-    uint8_t *buf;
-    size_t buf_size;
+    uint32_t xid = sender == NULL ? 0 : sender->xid;
     int error;
 
     if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
@@ -535,14 +661,29 @@ dp_send_message(struct datapath *dp, struct ofl_msg_header *msg,
         free(msg_str);
     }
 
-    error = ofl_msg_pack(msg, sender == NULL ? 0 : sender->xid, &buf, &buf_size, dp->exp);
+    if (msg->type == OFPT_MULTIPART_REPLY) {
+        /* Replies are written straight into the buffer queued on the
+         * connection, which is reserved with the length the caller expects. */
+        ofpbuf = ofpbuf_new(len_hint);
+        error = ofl_msg_pack_ofpbuf(msg, xid, ofpbuf, dp->exp);
+        if (error) {
+            ofpbuf_delete(ofpbuf);
+        }
+    } else {
+        uint8_t *buf;
+        size_t buf_size;
+
+        error = ofl_msg_pack(msg, xid, &buf, &buf_size, dp->exp);
+        if (!error) {
+            ofpbuf = ofpbuf_new(0);
+            ofpbuf_use(ofpbuf, buf, buf_size);
+            ofpbuf_put_uninit(ofpbuf, buf_size);
+        }
+    }
     if (error) {
         VLOG_WARN_RL(LOG_MODULE, &rl, "There was an error packing the message!");
         return error;
     }
-    ofpbuf = ofpbuf_new(0);
-    ofpbuf_use(ofpbuf, buf, buf_size);
-    ofpbuf_put_uninit(ofpbuf, buf_size);
 
     /* Choose the connection to send the packet to.
        1) By default, we send it to the main connection
@@ -564,6 +705,76 @@ dp_send_message(struct datapath *dp, struct ofl_msg_header *msg,
     return 0;
 }
 
+/* Writes the PACKET_IN header and the OXM match of the packet at dst, which
+ * must have room for hdr_len bytes. The frame is expected right after them. */
+static void
+packet_in_put_header(uint8_t *dst, size_t hdr_len, struct packet *pkt,
+                     uint8_t reason, uint8_t table_id, uint64_t cookie,
+                     size_t data_len) {
+    struct ofp_packet_in *pi = (struct ofp_packet_in *)dst;
+    struct ofl_match *m = &pkt->handle_std->match;
+    struct ofpbuf oxm;
+
+    pi->header.version = OFP_VERSION;
+    pi->header.type    = OFPT_PACKET_IN;
+    pi->header.length  = htons(hdr_len + data_len);
+    pi->header.xid     = 0;
+    pi->buffer_id      = htonl(pkt->buffer_id);
+    pi->total_len      = htons(pkt->buffer->size);
+    pi->reason         = reason;
+    pi->table_id       = table_id;
+    pi->cookie         = hton64(cookie);
+    pi->match.type     = htons(OFPMT_OXM);
+
+    /* The OXM fields go straight after the match header; the space left up
+     * to the frame is the match padding plus the two alignment bytes. */
+    ofpbuf_use(&oxm, dst + sizeof(struct ofp_packet_in) - 4,
+               hdr_len - (sizeof(struct ofp_packet_in) - 4));
+    pi->match.length = htons(oxm_put_match(&oxm, m) + 4);
+    ofpbuf_put_zeros(&oxm, ofpbuf_tailroom(&oxm));
+}
+
+int
+dp_send_packet_in(struct datapath *dp, struct packet *pkt, uint8_t reason,
+                  uint8_t table_id, uint64_t cookie, size_t data_len) {
+    struct ofpbuf *buffer;
+    struct ofpbuf *ofpbuf;
+    size_t hdr_len;
+
+    if (!pkt->handle_std->valid) {
+        packet_handle_std_validate(pkt->handle_std);
+    }
+    /* The controller gets the frame with its checksum done, which is written
+     * into the frame, so other packets sharing it must not see that. */
+    if ((pkt->buffer->offload.flags & OFPBUF_OFFLOAD_NEEDS_CSUM)
+        && pkt->buffer->offload.gso_type == OFPBUF_GSO_NONE) {
+        packet_make_writable(pkt);
+        ofpbuf_finish_csum(pkt->buffer);
+    }
+    buffer = pkt->buffer;
+
+    /* Header, match padded to 64 bits and 2 bytes to align the IP header. */
+    hdr_len = ROUND_UP(sizeof(struct ofp_packet_in) - 4 +
+                       pkt->handle_std->match.header.length, 8) + 2;
+    data_len = MIN(data_len, buffer->size);
+
+    if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
+        VLOG_DBG_RL(LOG_MODULE, &rl, "sending: PACKET_IN{buffer=\"0x%08x\", "
+                    "tlen=\"%zu\", dlen=\"%zu\", reason=\"%u\", table=\"%u\"}",
+                    pkt->buffer_id, buffer->size, data_len, reason, table_id);
+    }
+
+    /* The packet may still be buffered or go through further actions, so
+     * the connection gets its own copy of the frame, behind the header. */
+    ofpbuf = ofpbuf_new(hdr_len + data_len);
+    packet_in_put_header(ofpbuf_put_uninit(ofpbuf, hdr_len), hdr_len,
+                         pkt, reason, table_id, cookie, data_len);
+    ofpbuf_put(ofpbuf, buffer->data, data_len);
+    ofpbuf->conn_id = PTIN_CONNECTION;
+
+    return send_openflow_buffer(dp, ofpbuf, NULL);
+}
+
 ofl_err
 dp_handle_set_desc(struct datapath *dp, struct ofl_exp_openflow_msg_set_dp_desc *msg,
                                             const struct sender *sender UNUSED) {
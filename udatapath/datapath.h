@@ -27,7 +27,10 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "dp_buffers.h"
+#include "dp_counters.h"
 #include "dp_ports.h"
+#include "dp_hddp.h"
+#include "dynamic-string.h"
 #include "openflow/nicira-ext.h"
 #include "ofpbuf.h"
 #include "oflib/ofl.h"
@@ -42,6 +45,7 @@
 struct rconn;
 struct pvconn;
 struct sender;
+struct packet;
 
 /****************************************************************************
  * The datapath
@@ -73,6 +77,8 @@ struct datapath {
 
     struct dp_buffers *buffers;
 
+    struct dp_counters counters; /* Packet counters of tables, flows, ports. */
+
     struct pipeline *pipeline;  /* Pipeline with multi-tables. */
 
     struct group_table *groups; /* Group tables */
@@ -84,14 +90,52 @@ struct datapath {
     /* Switch ports. */
     /* NOTE: ports are numbered starting at 1 in OF 1.1 */
     uint32_t         max_queues; /* used when creating ports */
+    enum dp_sched_mode sched_mode; /* likewise; DP_SCHED_NONE uses tc */
+    uint64_t         sched_rate; /* link rate of the schedulers in bytes/s,
+                                  * 0 to take it from the port speed */
     struct sw_port   ports[DP_MAX_PORTS + 1];
     struct sw_port  *local_port;  /* OFPP_LOCAL port, if any. */
     struct list      port_list; /* All ports, including local_port. */
     size_t           ports_num;
 
+    /* Ports an output to ALL or FLOOD goes to, in port_list order. They are
+     * rebuilt when ports are added or their configuration changes. */
+    struct sw_port  *all_ports[DP_MAX_PORTS + 2];
+    size_t           all_ports_num;
+    struct sw_port  *flood_ports[DP_MAX_PORTS + 2];
+    size_t           flood_ports_num;
+    bool             out_ports_stale;
+
+    /* Link state changes of the ports, from a single rtnetlink socket. */
+    struct netdev_monitor *link_monitor;
+
+    /*Modificacion UAH Discovery hybrid topologies, JAH-*/
+    /* Counters of the HDDP discovery, and trace messages waiting to be
+     * written to the trace file out of the packet path. */
+    struct hddp_stats hddp_stats;
+    struct hddp_seen_cache hddp_seen; /* Requests HDDP ya tratados */
+    struct hddp_delta hddp_delta;     /* Replies HDDP ya informados */
+    /* Cambios de vecinos pendientes de notificar al controlador */
+    struct ofl_exp_openflow_neighbor hddp_events[HDDP_NEIGHBOR_EVENTS];
+    size_t            hddp_events_num;
+    struct ds         hddp_trace;
+    /* Temporizadores y rol configurables (dp_hddp.c) */
+    struct hddp_config hddp_config;
+    struct hddp_timer  hddp_timers[HDDP_TIMER_N];
+    struct list        hddp_timer_queue; /* Ordenada por vencimiento */
+    /* Sensores vecinos (hellos) y puerto hacia cada controlador (requests) */
+    struct mac_to_port neighbor_table;
+    struct mac_to_port bt_table;
+    struct packet     *pkt_hello; /* HELLO que se inunda, NULL hasta el primero */
+    /*Fin Modificacion UAH Discovery hybrid topologies, JAH-*/
+
     /* Experimenter handling. */
     struct ofl_exp  *exp;
 
+    /* Flow mods and packet outs are unpacked into this arena, which is reset
+     * once each of them is handled. */
+    struct ofl_arena *msg_arena;
+
 #if defined(OF_HW_PLAT)
     /* Although the chain maintains the pointer to the HW driver
      * for flow operations, the datapath needs the port functions
@@ -107,6 +151,7 @@ struct sender {
     struct remote *remote;      /* The device that sent the message. */
     uint8_t conn_id;            /* The connection that sent the message */
     uint32_t xid;               /* The OpenFlow transaction ID. */
+    struct ofpbuf *buffer;      /* The buffer the message was received in. */
 };
 
 /* A connection to a secure channel. */
@@ -115,7 +160,6 @@ struct remote {
     struct rconn *rconn;
     struct rconn *rconn_aux;
     
-#define TXQ_LIMIT 128           /* Max number of packets to queue for tx. */
     int n_txq;                  /* Number of packets queued for tx on rconn. */
 
     /* Support for reliable, multi-message replies to requests.
@@ -134,6 +178,8 @@ struct remote {
     /* Multipart request message pending reassembly. */
     struct ofl_msg_multipart_request_header *mp_req_msg; /* Message. */
     uint32_t mp_req_xid;     /* Multipart request OpenFlow transaction ID. */
+
+    struct list bundles;     /* Open bundles, see dp_bundle.h. */
 };
 
 /* Creates a new datapath */
@@ -177,6 +223,9 @@ dp_set_serial_num(struct datapath *dp, char *serial_num);
 void
 dp_set_max_queues(struct datapath *dp, uint32_t max_queues);
 
+void
+dp_set_sched(struct datapath *dp, enum dp_sched_mode mode, uint64_t rate);
+
 
 /* Sends the given OFLib message to the connection represented by sender,
  * or to all open connections, if sender is null. */
@@ -184,6 +233,22 @@ int
 dp_send_message(struct datapath *dp, struct ofl_msg_header *msg,
                      const struct sender *sender);
 
+/* Sends the given OFLib message as dp_send_message, reserving len_hint bytes
+ * for it when it is packed in a single pass (see ofl_msg_pack_ofpbuf). */
+int
+dp_send_message_sized(struct datapath *dp, struct ofl_msg_header *msg,
+                      const struct sender *sender, size_t len_hint);
+
+/* Sends a PACKET_IN carrying the first data_len bytes of the packet to all
+ * open connections. The OpenFlow header and the OXM match are written into a
+ * new buffer, followed by a copy of the frame, so the packet data is not
+ * marshalled through an intermediate OFLib message and the packet is left
+ * as it was, apart from its checksum being done. The buffer_id of the message
+ * is the packet's one. */
+int
+dp_send_packet_in(struct datapath *dp, struct packet *pkt, uint8_t reason,
+                  uint8_t table_id, uint64_t cookie, size_t data_len);
+
 
 
 /* Handles a set description (openflow experimenter) message */
@@ -0,0 +1,883 @@
+/* 
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/HDDP).
+ * Copyright (c) 2020.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Benchmarks the datapath: flow mod installation, forwarding, packet-in
+ * generation and HDDP request/reply storms, run through the real pipeline.
+ *
+ * Usage: dp-bench [OPTIONS] [BENCH...]
+ *
+ * BENCH is "flowmod", "forward", "packetin" or "hddp"; with none, all of them
+ * run in that order. Frames are handed to pipeline_process_packet() in fresh
+ * buffers, as dp_ports_run() does with what it receives, coming in from port
+ * 1 of a datapath whose ports are null ports. Flow mods and packet-ins go
+ * through the OpenFlow connection to a stand-in controller on a unix socket.
+ *
+ * Each benchmark prints a JSON object on a line of its own, with the rate of
+ * operations per second, the percentiles of the latency of an operation in
+ * ns, and the memory allocations per operation. An operation is a frame, but
+ * for "flowmod", where it is a flow mod and the latency is that of a batch of
+ * flow mods up to the barrier reply that follows it.
+ *
+ * The packet parser reads customnetpdl.xml from the current directory, so
+ * run it from the top of the tree. */
+
+#include <config.h>
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "command-line.h"
+#include "csum.h"
+#include "datapath.h"
+#include "dp_hddp.h"
+#include "dp_ports.h"
+#include "dynamic-string.h"
+#include "flow_table.h"
+#include "list.h"
+#include "ofp.h"
+#include "ofpbuf.h"
+#include "oflib/ofl.h"
+#include "oflib/ofl-actions.h"
+#include "oflib/ofl-messages.h"
+#include "oflib/ofl-structs.h"
+#include "openflow/openflow.h"
+#include "packet.h"
+#include "packets.h"
+#include "pcap.h"
+#include "pipeline.h"
+#include "poll-loop.h"
+#include "rconn.h"
+#include "timeval.h"
+#include "util.h"
+#include "vconn.h"
+#include "vlog.h"
+
+/* Headroom of the buffers dp_ports_run() receives into. */
+#define HEADROOM (256 + 2)
+
+/* Lifetime of the HDDP table entries set up by the benchmark, in ms. */
+#define HDDP_LIFETIME (1000ULL * 1000 * 1000)
+
+/* Paths to other controllers in bt_table, ahead of the benchmark's own. */
+#define HDDP_OTHER_PATHS 64
+
+static unsigned long n_packets = 1000000;
+static unsigned long n_flow_mods = 100000;
+static unsigned int n_flows = 1000;
+static unsigned int n_ports = 4;
+static unsigned int n_sensors = 8;
+static unsigned int batch = 64;
+static size_t frame_size = 64;
+static char *pcap_file;
+
+static void parse_options(int argc, char *argv[]);
+static void usage(void) NO_RETURN;
+
+/* Allocation counting. */
+
+static unsigned long long n_allocs;
+
+#ifdef __GLIBC__
+/* Every allocation of the process is counted on its way to glibc. */
+#define ALLOCS_COUNTED 1
+
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+
+void *
+malloc(size_t size)
+{
+    n_allocs++;
+    return __libc_malloc(size);
+}
+
+void *
+calloc(size_t n, size_t size)
+{
+    n_allocs++;
+    return __libc_calloc(n, size);
+}
+
+void *
+realloc(void *p, size_t size)
+{
+    n_allocs++;
+    return __libc_realloc(p, size);
+}
+#else
+#define ALLOCS_COUNTED 0
+#endif
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* The datapath under test and its stand-in controller. */
+struct bench {
+    struct datapath *dp;
+    struct rconn *rc;
+    int n_queued;                 /* Messages queued in 'rc'. */
+    uint32_t xid;                 /* Last xid sent. */
+    uint32_t barrier_xid;         /* Barrier waited for. */
+    bool barrier_seen;
+
+    unsigned long packet_ins;     /* Packet-ins received. */
+    unsigned long errors;         /* Errors received. */
+    bool flows_installed;         /* Whether the forwarding flows are. */
+
+    struct ofpbuf **frames;       /* Frames for "forward" and "packetin". */
+    size_t n_frames;
+    uint32_t *lat;                /* Latency of each operation, in ns. */
+};
+
+/* Reporting. */
+
+static int
+compare_u32(const void *a_, const void *b_)
+{
+    uint32_t a = *(const uint32_t *) a_;
+    uint32_t b = *(const uint32_t *) b_;
+
+    return a < b ? -1 : a > b;
+}
+
+/* Returns the 'p' percentile of the 'n' sorted values of 'lat'. */
+static uint32_t
+percentile(const uint32_t *lat, size_t n, double p)
+{
+    return n ? lat[(size_t) ((n - 1) * p / 100.0 + 0.5)] : 0;
+}
+
+/* Prints the results of benchmark 'name', which took 'ns' to do 'ops'
+ * operations with 'allocs' allocations; the latencies of the 'n_lat'
+ * operations timed are in 'lat', and 'extra' holds more fields, if any. */
+static void
+report(const char *name, unsigned long ops, uint64_t ns,
+       unsigned long long allocs, uint32_t *lat, size_t n_lat,
+       struct ds *extra)
+{
+    double seconds = ns / 1e9;
+
+    qsort(lat, n_lat, sizeof *lat, compare_u32);
+    printf("{\"bench\":\"%s\",\"ops\":%lu,\"seconds\":%.6f,\"rate\":%.0f,"
+           "\"latency_ns\":{\"p50\":%"PRIu32",\"p90\":%"PRIu32","
+           "\"p99\":%"PRIu32",\"p999\":%"PRIu32",\"max\":%"PRIu32"},",
+           name, ops, seconds, seconds > 0 ? ops / seconds : 0,
+           percentile(lat, n_lat, 50), percentile(lat, n_lat, 90),
+           percentile(lat, n_lat, 99), percentile(lat, n_lat, 99.9),
+           n_lat ? lat[n_lat - 1] : 0);
+    if (ALLOCS_COUNTED) {
+        printf("\"allocs_per_op\":%.2f", ops ? (double) allocs / ops : 0);
+    } else {
+        printf("\"allocs_per_op\":null");
+    }
+    printf("%s}\n", extra != NULL ? ds_cstr(extra) : "");
+    fflush(stdout);
+}
+
+/* The stand-in controller. */
+
+/* Runs the datapath and the controller once, and takes in what the
+ * controller received. Neither blocks: the poll loop is only run for the
+ * callbacks that finish partial writes. */
+static void
+pump(struct bench *b)
+{
+    struct ofpbuf *msg;
+
+    dp_run(b->dp);
+    rconn_run(b->rc);
+    dp_wait(b->dp);
+    rconn_run_wait(b->rc);
+    poll_immediate_wake();
+    poll_block();
+    while ((msg = rconn_recv(b->rc)) != NULL) {
+        const struct ofp_header *oh = msg->data;
+
+        switch (oh->type) {
+        case OFPT_PACKET_IN:
+            b->packet_ins++;
+            break;
+        case OFPT_BARRIER_REPLY:
+            if (ntohl(oh->xid) == b->barrier_xid) {
+                b->barrier_seen = true;
+            }
+            break;
+        case OFPT_ERROR:
+            b->errors++;
+            break;
+        case OFPT_ECHO_REQUEST:
+            rconn_send(b->rc, make_echo_reply(oh), NULL);
+            break;
+        default:
+            break;
+        }
+        ofpbuf_delete(msg);
+    }
+}
+
+/* Sends 'buf' to the datapath, waiting for room in the queue. */
+static void
+send_buffer(struct bench *b, struct ofpbuf *buf)
+{
+    int retval;
+
+    while (b->n_queued >= TXQ_LIMIT) {
+        pump(b);
+    }
+    retval = rconn_send(b->rc, buf, &b->n_queued);
+    if (retval) {
+        ofp_fatal(retval, "sending to the datapath");
+    }
+}
+
+static struct ofpbuf *
+pack(struct bench *b, struct ofl_msg_header *msg)
+{
+    struct ofpbuf *buf = ofpbuf_new(0);
+
+    if (ofl_msg_pack_ofpbuf(msg, ++b->xid, buf, NULL)) {
+        ofp_fatal(0, "could not pack a message");
+    }
+    return buf;
+}
+
+/* Sends a barrier request and waits for its reply. */
+static void
+barrier(struct bench *b)
+{
+    struct ofl_msg_header msg = {.type = OFPT_BARRIER_REQUEST};
+    long long int deadline;
+
+    send_buffer(b, pack(b, &msg));
+    b->barrier_xid = b->xid;
+    b->barrier_seen = false;
+    deadline = time_msec() + 10000;
+    while (!b->barrier_seen) {
+        pump(b);
+        if (time_msec() > deadline) {
+            ofp_fatal(0, "no barrier reply from the datapath");
+        }
+    }
+}
+
+/* Packs a flow mod adding to table 0 an entry of 'priority' that matches
+ * 'match' and outputs to 'port'. */
+static struct ofpbuf *
+make_flow_add(struct bench *b, struct ofl_match *match, uint16_t priority,
+              uint32_t port)
+{
+    struct ofl_action_output output = {{.type = OFPAT_OUTPUT}, .port = port,
+                                       .max_len = OFPCML_NO_BUFFER};
+    struct ofl_action_header *actions[] = {&output.header};
+    struct ofl_instruction_actions apply = {{.type = OFPIT_APPLY_ACTIONS},
+                                            .actions_num = 1,
+                                            .actions = actions};
+    struct ofl_instruction_header *insts[] = {&apply.header};
+    struct ofl_msg_flow_mod fm;
+
+    memset(&fm, 0x00, sizeof fm);
+    fm.header.type = OFPT_FLOW_MOD;
+    fm.table_id = 0;
+    fm.command = OFPFC_ADD;
+    fm.priority = priority;
+    fm.buffer_id = OFP_NO_BUFFER;
+    fm.out_port = OFPP_ANY;
+    fm.out_group = OFPG_ANY;
+    fm.match = &match->header;
+    fm.instructions_num = 1;
+    fm.instructions = insts;
+    return pack(b, &fm.header);
+}
+
+/* Packs the flow mod of the i-th forwarding flow, which sends the frames to
+ * 10.0.0.0 + i to one of the ports but the first. */
+static struct ofpbuf *
+make_forward_flow(struct bench *b, unsigned int i)
+{
+    struct ofl_match match;
+
+    ofl_structs_match_init(&match);
+    ofl_structs_match_put16(&match, OXM_OF_ETH_TYPE, ETH_TYPE_IP);
+    ofl_structs_match_put32(&match, OXM_OF_IPV4_DST, htonl(0x0a000000 + i));
+    return make_flow_add(b, &match, 100, 2 + i % (n_ports - 1));
+}
+
+/* Installs the forwarding flows, if they are not. */
+static void
+install_flows(struct bench *b)
+{
+    unsigned int i;
+
+    if (!b->flows_installed) {
+        for (i = 0; i < n_flows; i++) {
+            send_buffer(b, make_forward_flow(b, i));
+        }
+        barrier(b);
+        b->flows_installed = true;
+    }
+}
+
+/* Deletes all the flow entries. */
+static void
+delete_flows(struct bench *b)
+{
+    struct ofl_match match;
+    struct ofl_msg_flow_mod fm;
+
+    ofl_structs_match_init(&match);
+    memset(&fm, 0x00, sizeof fm);
+    fm.header.type = OFPT_FLOW_MOD;
+    fm.table_id = 0xff;
+    fm.command = OFPFC_DELETE;
+    fm.buffer_id = OFP_NO_BUFFER;
+    fm.out_port = OFPP_ANY;
+    fm.out_group = OFPG_ANY;
+    fm.match = &match.header;
+    send_buffer(b, pack(b, &fm.header));
+    barrier(b);
+    b->flows_installed = false;
+}
+
+/* Traffic. */
+
+static const uint8_t host_mac[ETH_ADDR_LEN] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+static const uint8_t peer_mac[ETH_ADDR_LEN] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x02};
+static const uint8_t controller_mac[ETH_ADDR_LEN] = {0x02, 0xc0, 0x00, 0x00, 0x00, 0x01};
+
+/* Returns an Ethernet, IPv4 and UDP frame of 'frame_size' bytes from port
+ * 'src_port' to 'ip_dst'. */
+static struct ofpbuf *
+make_udp_frame(uint32_t ip_dst, uint16_t src_port)
+{
+    struct ofpbuf *buf = ofpbuf_new(frame_size);
+    struct eth_header *eth = ofpbuf_put_zeros(buf, frame_size);
+    struct ip_header *ip = (struct ip_header *) (eth + 1);
+    struct udp_header *udp = (struct udp_header *) (ip + 1);
+
+    memcpy(eth->eth_dst, peer_mac, ETH_ADDR_LEN);
+    memcpy(eth->eth_src, host_mac, ETH_ADDR_LEN);
+    eth->eth_type = htons(ETH_TYPE_IP);
+    ip->ip_ihl_ver = IP_IHL_VER(5, 4);
+    ip->ip_tot_len = htons(frame_size - ETH_HEADER_LEN);
+    ip->ip_ttl = 64;
+    ip->ip_proto = IP_TYPE_UDP;
+    ip->ip_src = htonl(0x0a800001);
+    ip->ip_dst = htonl(ip_dst);
+    ip->ip_csum = csum(ip, IP_HEADER_LEN);
+    udp->udp_src = htons(src_port);
+    udp->udp_dst = htons(5001);
+    udp->udp_len = htons(frame_size - ETH_HEADER_LEN - IP_HEADER_LEN);
+    return buf;
+}
+
+/* Returns a DHT frame with 'opcode' and 'seq' from 'src' to 'dst', carrying
+ * 'src' as the only device when it is a reply. */
+static struct ofpbuf *
+make_dht_frame(uint16_t opcode, const uint8_t dst[ETH_ADDR_LEN],
+               const uint8_t src[ETH_ADDR_LEN], uint32_t seq)
+{
+    size_t size = ETH_HEADER_LEN + sizeof(struct dht_header);
+    struct ofpbuf *buf = ofpbuf_new(size);
+    struct eth_header *eth = ofpbuf_put_zeros(buf, size);
+    struct dht_header *dht = (struct dht_header *) (eth + 1);
+
+    memcpy(eth->eth_dst, dst, ETH_ADDR_LEN);
+    memcpy(eth->eth_src, src, ETH_ADDR_LEN);
+    eth->eth_type = htons(ETH_TYPE_DHT);
+    dht->opcode = htons(opcode);
+    if (opcode == 2) {
+        dht->num_devices = htons(1);
+        dht->type_devices[0] = htons(NODO_NO_SDN);
+        dht->macs[0] = bigtolittle64(mac2int(src));
+        dht->in_ports[0] = htonl(1);
+        dht->out_ports[0] = htonl(1);
+    }
+    dht->seq = htonl(seq);
+    return buf;
+}
+
+/* Reads the frames of the benchmark, from the pcap file or generated, one to
+ * each forwarding flow. */
+static void
+load_frames(struct bench *b)
+{
+    size_t allocated = 0;
+
+    if (pcap_file != NULL) {
+        FILE *file = pcap_open(pcap_file, "rb");
+        struct ofpbuf *frame;
+        int retval;
+
+        if (file == NULL) {
+            ofp_fatal(errno, "%s: open failed", pcap_file);
+        }
+        while (!(retval = pcap_read(file, &frame))) {
+            if (b->n_frames >= allocated) {
+                b->frames = x2nrealloc(b->frames, &allocated, sizeof *b->frames);
+            }
+            b->frames[b->n_frames++] = frame;
+        }
+        if (retval != EOF) {
+            ofp_fatal(retval, "%s: read failed", pcap_file);
+        }
+        fclose(file);
+        if (b->n_frames == 0) {
+            ofp_fatal(0, "%s: no frames", pcap_file);
+        }
+    } else {
+        unsigned int i;
+
+        b->frames = xmalloc(n_flows * sizeof *b->frames);
+        for (i = 0; i < n_flows; i++) {
+            b->frames[b->n_frames++] = make_udp_frame(0x0a000000 + i, 1024 + i);
+        }
+    }
+}
+
+/* Hands a copy of 'frame' to the pipeline as received on 'in_port'. Returns
+ * the time taken, in ns, and adds the allocations made to '*allocs'. */
+static uint32_t
+inject(struct bench *b, const struct ofpbuf *frame, uint32_t in_port,
+       unsigned long long *allocs)
+{
+    unsigned long long allocs_start = n_allocs;
+    uint64_t start = now_ns();
+    struct ofpbuf *buf;
+
+    buf = ofpbuf_clone_with_headroom(frame, HEADROOM);
+    pipeline_process_packet(b->dp->pipeline,
+                            packet_create(b->dp, in_port, buf, false));
+    *allocs += n_allocs - allocs_start;
+    return now_ns() - start;
+}
+
+/* Returns the frames sent by all the ports. */
+static uint64_t
+tx_packets(struct datapath *dp)
+{
+    uint64_t n = 0;
+    unsigned int i;
+
+    for (i = 1; i <= n_ports; i++) {
+        n += dp->ports[i].stats->tx_packets
+             + dp_counter(&dp->counters, dp->ports[i].counters + SW_PORT_TX)->packets;
+    }
+    return n;
+}
+
+/* Benchmarks. */
+
+static void
+bench_flowmod(struct bench *b)
+{
+    struct ofpbuf **mods = xmalloc(n_flow_mods * sizeof *mods);
+    unsigned long long allocs_start;
+    unsigned long i, n_batches = 0;
+    unsigned long errors = b->errors;
+    uint64_t start;
+    struct ds extra = DS_EMPTY_INITIALIZER;
+
+    for (i = 0; i < n_flow_mods; i++) {
+        mods[i] = make_forward_flow(b, i % n_flows);
+    }
+
+    allocs_start = n_allocs;
+    start = now_ns();
+    for (i = 0; i < n_flow_mods; ) {
+        uint64_t batch_start = now_ns();
+        unsigned long end = MIN(i + batch, n_flow_mods);
+
+        for (; i < end; i++) {
+            send_buffer(b, mods[i]);
+        }
+        barrier(b);
+        b->lat[n_batches++] = now_ns() - batch_start;
+    }
+    b->flows_installed = true;
+
+    ds_put_format(&extra, ",\"flows\":%u,\"batch\":%u,\"errors\":%lu",
+                  n_flows, batch, b->errors - errors);
+    report("flowmod", n_flow_mods, now_ns() - start, n_allocs - allocs_start,
+           b->lat, n_batches, &extra);
+    ds_destroy(&extra);
+    free(mods);
+}
+
+static void
+bench_forward(struct bench *b)
+{
+    unsigned long long allocs = 0;
+    uint64_t tx = tx_packets(b->dp);
+    uint64_t start;
+    struct ds extra = DS_EMPTY_INITIALIZER;
+    unsigned long i;
+
+    install_flows(b);
+
+    start = now_ns();
+    for (i = 0; i < n_packets; i++) {
+        b->lat[i] = inject(b, b->frames[i % b->n_frames], 1, &allocs);
+    }
+
+    ds_put_format(&extra, ",\"flows\":%u,\"frames\":%zu,\"tx\":%"PRIu64,
+                  n_flows, b->n_frames, tx_packets(b->dp) - tx);
+    report("forward", n_packets, now_ns() - start, allocs, b->lat, n_packets,
+           &extra);
+    ds_destroy(&extra);
+}
+
+static void
+bench_packetin(struct bench *b)
+{
+    struct ofl_match match;
+    struct remote *r;
+    unsigned long long allocs = 0;
+    unsigned long packet_ins;
+    long long int deadline;
+    uint64_t start;
+    struct ds extra = DS_EMPTY_INITIALIZER;
+    unsigned long i;
+
+    /* Everything misses into the controller. */
+    delete_flows(b);
+    ofl_structs_match_init(&match);
+    send_buffer(b, make_flow_add(b, &match, 0, OFPP_CONTROLLER));
+    barrier(b);
+    r = CONTAINER_OF(list_front(&b->dp->remotes), struct remote, node);
+    packet_ins = b->packet_ins;
+
+    start = now_ns();
+    for (i = 0; i < n_packets; i++) {
+        /* Packet-ins beyond TXQ_LIMIT would be dropped. */
+        while (r->n_txq >= TXQ_LIMIT) {
+            pump(b);
+        }
+        b->lat[i] = inject(b, b->frames[i % b->n_frames], 1, &allocs);
+    }
+    deadline = time_msec() + 10000;
+    while (b->packet_ins - packet_ins < n_packets && time_msec() < deadline) {
+        pump(b);
+    }
+
+    ds_put_format(&extra, ",\"delivered\":%lu", b->packet_ins - packet_ins);
+    report("packetin", n_packets, now_ns() - start, allocs, b->lat, n_packets,
+           &extra);
+    ds_destroy(&extra);
+    delete_flows(b);
+}
+
+static void
+bench_hddp(struct bench *b)
+{
+    struct hddp_stats before = b->dp->hddp_stats;
+    const struct hddp_stats *after = &b->dp->hddp_stats;
+    struct ofpbuf *request, **replies;
+    unsigned long long allocs = 0;
+    unsigned int per_round = 2 + (n_ports - 1);
+    unsigned long i, ops = 0;
+    uint32_t seq = 0;
+    uint64_t start;
+    struct ds extra = DS_EMPTY_INITIALIZER;
+    char *error;
+
+    /* A gateway with sensors hanging from all its ports but the first, which
+     * leads to this controller and to others. */
+    error = dp_hddp_configure(b->dp, "role=gateway,sensor-to-sensor=off");
+    if (error != NULL) {
+        ofp_fatal(0, "%s", error);
+    }
+    for (i = 0; i < n_sensors; i++) {
+        uint8_t mac[ETH_ADDR_LEN] = {0x02, 0x5e, 0x00, 0x00, i >> 8, i};
+
+        mac_to_port_add(&b->dp->neighbor_table, mac, 1 + i % 4,
+                        2 + i % (n_ports - 1), HDDP_LIFETIME);
+    }
+    for (i = 0; i < HDDP_OTHER_PATHS; i++) {
+        uint8_t mac[ETH_ADDR_LEN] = {0x02, 0xc1, 0x00, 0x00, i >> 8, i};
+
+        mac_to_port_add(&b->dp->bt_table, mac, 1, 1 + i % n_ports, HDDP_LIFETIME);
+    }
+    mac_to_port_add(&b->dp->bt_table, (uint8_t *) controller_mac, 1, 1,
+                    HDDP_LIFETIME);
+
+    /* A round is the request of the controller, coming in through port 1 and
+     * flooded, then a copy coming back through port 2, which is answered with
+     * a reply for each sensor, and a reply from behind each port but the
+     * first, relayed to the controller. */
+    request = make_dht_frame(1, eth_addr_broadcast, controller_mac, 0);
+    replies = xmalloc((n_ports - 1) * sizeof *replies);
+    for (i = 0; i < n_ports - 1; i++) {
+        uint8_t mac[ETH_ADDR_LEN] = {0x02, 0x5f, 0x00, 0x00, 0x00, i};
+
+        replies[i] = make_dht_frame(2, controller_mac, mac, 0);
+    }
+
+    start = now_ns();
+    while (ops < n_packets) {
+        struct dht_header *dht;
+
+        seq++;
+        dht = (struct dht_header *) ((struct eth_header *) request->data + 1);
+        dht->seq = htonl(seq);
+        for (i = 0; i < per_round && ops < n_packets; i++, ops++) {
+            if (i < 2) {
+                b->lat[ops] = inject(b, request, 1 + i, &allocs);
+            } else {
+                dht = (struct dht_header *) ((struct eth_header *) replies[i - 2]->data + 1);
+                dht->seq = htonl(seq);
+                b->lat[ops] = inject(b, replies[i - 2], i, &allocs);
+            }
+        }
+    }
+
+    ds_put_format(&extra, ",\"sensors\":%u,\"rounds\":%"PRIu32
+                  ",\"requests\":%"PRIu64",\"requests_fwd\":%"PRIu64
+                  ",\"requests_answered\":%"PRIu64",\"replies_tx\":%"PRIu64
+                  ",\"replies_relayed\":%"PRIu64",\"replies_dropped\":%"PRIu64,
+                  n_sensors, seq, after->requests_rx - before.requests_rx,
+                  after->requests_fwd - before.requests_fwd,
+                  after->requests_answered - before.requests_answered,
+                  after->replies_tx - before.replies_tx,
+                  after->replies_relayed - before.replies_relayed,
+                  after->replies_dropped - before.replies_dropped);
+    report("hddp", ops, now_ns() - start, allocs, b->lat, ops, &extra);
+    ds_destroy(&extra);
+
+    for (i = 0; i < n_ports - 1; i++) {
+        ofpbuf_delete(replies[i]);
+    }
+    free(replies);
+    ofpbuf_delete(request);
+}
+
+struct bench_class {
+    const char *name;
+    void (*run)(struct bench *);
+};
+
+static const struct bench_class benches[] = {
+    {"flowmod", bench_flowmod},
+    {"forward", bench_forward},
+    {"packetin", bench_packetin},
+    {"hddp", bench_hddp},
+};
+
+#define N_BENCHES (sizeof benches / sizeof *benches)
+
+int
+main(int argc, char *argv[])
+{
+    bool selected[N_BENCHES];
+    struct bench b;
+    struct pvconn *pvconn;
+    char path[64], name[80];
+    size_t i;
+    int retval;
+
+    set_program_name(argv[0]);
+    time_init();
+    vlog_init();
+    vlog_set_levels(VLM_ANY_MODULE, VLF_ANY_FACILITY, VLL_WARN);
+    /* Reading a pcap file to its end is not worth a warning. */
+    vlog_set_levels(VLM_pcap, VLF_ANY_FACILITY, VLL_ERR);
+    parse_options(argc, argv);
+
+    memset(selected, 0x00, sizeof selected);
+    for (i = optind; i < (size_t) argc; i++) {
+        size_t j;
+
+        for (j = 0; j < N_BENCHES; j++) {
+            if (!strcmp(argv[i], benches[j].name)) {
+                selected[j] = true;
+                break;
+            }
+        }
+        if (j == N_BENCHES) {
+            ofp_fatal(0, "unknown benchmark \"%s\" (use --help for help)",
+                      argv[i]);
+        }
+    }
+    if (optind == argc) {
+        for (i = 0; i < N_BENCHES; i++) {
+            selected[i] = true;
+        }
+    }
+
+    memset(&b, 0x00, sizeof b);
+    b.dp = dp_new();
+    dp_set_dpid(b.dp, 1);
+    for (i = 1; i <= n_ports; i++) {
+        uint8_t mac[ETH_ADDR_LEN] = {0x02, 0x00, 0x00, 0x00, 0x01, i};
+
+        snprintf(name, sizeof name, "null%zu", i);
+        retval = dp_ports_add_null(b.dp, name, mac);
+        if (retval) {
+            ofp_fatal(retval, "adding %s", name);
+        }
+    }
+
+    snprintf(path, sizeof path, "/tmp/dp-bench.%ld", (long int) getpid());
+    snprintf(name, sizeof name, "punix:%s", path);
+    retval = pvconn_open(name, &pvconn);
+    if (retval) {
+        ofp_fatal(retval, "%s", name);
+    }
+    dp_add_pvconn(b.dp, pvconn, NULL);
+
+    b.rc = rconn_create(0, 1);
+    snprintf(name, sizeof name, "unix:%s", path);
+    rconn_connect(b.rc, name);
+    while (!rconn_is_connected(b.rc) || list_is_empty(&b.dp->remotes)) {
+        pump(&b);
+    }
+
+    load_frames(&b);
+    b.lat = xmalloc(MAX(MAX(n_packets, n_flow_mods), 1) * sizeof *b.lat);
+
+    for (i = 0; i < N_BENCHES; i++) {
+        if (selected[i]) {
+            benches[i].run(&b);
+        }
+    }
+
+    rconn_destroy(b.rc);
+    unlink(path);
+    return 0;
+}
+
+static void
+parse_options(int argc, char *argv[])
+{
+    static struct option long_options[] = {
+        {"packets",   required_argument, 0, 'n'},
+        {"flow-mods", required_argument, 0, 'm'},
+        {"flows",     required_argument, 0, 'f'},
+        {"ports",     required_argument, 0, 'p'},
+        {"sensors",   required_argument, 0, 'S'},
+        {"batch",     required_argument, 0, 'b'},
+        {"size",      required_argument, 0, 's'},
+        {"pcap",      required_argument, 0, 'r'},
+        {"help",      no_argument, 0, 'h'},
+        {0, 0, 0, 0},
+    };
+    char *short_options = long_options_to_short_options(long_options);
+
+    for (;;) {
+        int indexptr;
+        int c;
+
+        c = getopt_long(argc, argv, short_options, long_options, &indexptr);
+        if (c == -1) {
+            break;
+        }
+
+        switch (c) {
+        case 'n':
+            n_packets = strtoul(optarg, NULL, 10);
+            break;
+
+        case 'm':
+            n_flow_mods = strtoul(optarg, NULL, 10);
+            break;
+
+        case 'f':
+            n_flows = atoi(optarg);
+            if (n_flows < 1 || n_flows > FLOW_TABLE_MAX_ENTRIES - 1) {
+                ofp_fatal(0, "argument to -f or --flows must be between 1 "
+                          "and %d", FLOW_TABLE_MAX_ENTRIES - 1);
+            }
+            break;
+
+        case 'p':
+            n_ports = atoi(optarg);
+            if (n_ports < 2 || n_ports >= DP_MAX_PORTS) {
+                ofp_fatal(0, "argument to -p or --ports must be between 2 "
+                          "and %d", DP_MAX_PORTS - 1);
+            }
+            break;
+
+        case 'S':
+            n_sensors = atoi(optarg);
+            break;
+
+        case 'b':
+            batch = atoi(optarg);
+            if (batch < 1) {
+                ofp_fatal(0, "argument to -b or --batch must be at least 1");
+            }
+            break;
+
+        case 's':
+            frame_size = atoi(optarg);
+            if (frame_size < ETH_HEADER_LEN + IP_HEADER_LEN + UDP_HEADER_LEN
+                || frame_size > ETH_TOTAL_MAX) {
+                ofp_fatal(0, "argument to -s or --size must be between %d "
+                          "and %d", ETH_HEADER_LEN + IP_HEADER_LEN + UDP_HEADER_LEN,
+                          ETH_TOTAL_MAX);
+            }
+            break;
+
+        case 'r':
+            pcap_file = optarg;
+            break;
+
+        case 'h':
+            usage();
+
+        case '?':
+            exit(EXIT_FAILURE);
+
+        default:
+            abort();
+        }
+    }
+    free(short_options);
+}
+
+static void
+usage(void)
+{
+    printf("%s: datapath benchmark\n"
+           "usage: %s [OPTIONS] [BENCH...]\n"
+           "where BENCH is one of flowmod, forward, packetin and hddp;\n"
+           "all of them run when none is given.\n"
+           "\nOptions:\n"
+           "  -n, --packets=N         frames for each benchmark (default: %lu)\n"
+           "  -m, --flow-mods=N       flow mods for flowmod (default: %lu)\n"
+           "  -f, --flows=N           forwarding flows (default: %u)\n"
+           "  -p, --ports=N           null ports of the datapath (default: %u)\n"
+           "  -S, --sensors=N         HDDP sensors of the gateway (default: %u)\n"
+           "  -b, --batch=N           flow mods for each barrier (default: %u)\n"
+           "  -s, --size=BYTES        size of the generated frames (default: %zu)\n"
+           "  -r, --pcap=FILE         inject the frames of FILE instead\n"
+           "  -h, --help              display this help message\n",
+           program_name, program_name, n_packets, n_flow_mods, n_flows,
+           n_ports, n_sensors, batch, frame_size);
+    exit(EXIT_SUCCESS);
+}
@@ -53,6 +53,33 @@ output(struct packet *pkt, struct ofl_action_output *action) {
     }
 }
 
+/* Whether the transport checksum of the packet is left for the device to do
+ * (see struct ofpbuf_offload). It then holds the sum of the pseudo header
+ * alone instead of the complement of the whole sum: a new address changes it
+ * the other way round, and a new port, summed by the device, not at all. */
+static inline bool
+l4_csum_partial(const struct packet *pkt) {
+    return (pkt->buffer->offload.flags & OFPBUF_OFFLOAD_NEEDS_CSUM) != 0;
+}
+
+static uint16_t
+recalc_l4_csum32(const struct packet *pkt, uint16_t csum, uint32_t old_u32,
+                 uint32_t new_u32) {
+    if (l4_csum_partial(pkt)) {
+        return ~recalc_csum32(~csum, old_u32, new_u32);
+    }
+    return recalc_csum32(csum, old_u32, new_u32);
+}
+
+static uint16_t
+recalc_l4_csum128(const struct packet *pkt, uint16_t csum,
+                  uint8_t old_u128[16], uint8_t new_u128[16]) {
+    if (l4_csum_partial(pkt)) {
+        return ~recalc_csum128(~csum, old_u128, new_u128);
+    }
+    return recalc_csum128(csum, old_u128, new_u128);
+}
+
 /* Executes a set field action.
 TODO: if we use the the index structure to the packet fields
 revalidation is not needed  */
@@ -152,11 +179,11 @@ set_field(struct packet *pkt, struct ofl_action_set_field *act )
                 /*Reconstruct TCP or UDP checksum*/
                 if (pkt->handle_std->proto->tcp != NULL) {
                     struct tcp_header *tcp = pkt->handle_std->proto->tcp;
-                    tcp->tcp_csum = recalc_csum32(tcp->tcp_csum,
+                    tcp->tcp_csum = recalc_l4_csum32(pkt, tcp->tcp_csum,
                         ipv4->ip_src, *((uint32_t*) act->field->value));
                 } else if (pkt->handle_std->proto->udp != NULL) {
                     struct udp_header *udp = pkt->handle_std->proto->udp;
-                    udp->udp_csum = recalc_csum32(udp->udp_csum,
+                    udp->udp_csum = recalc_l4_csum32(pkt, udp->udp_csum,
                         ipv4->ip_src, *((uint32_t*) act->field->value));
                 }
 
@@ -172,11 +199,11 @@ set_field(struct packet *pkt, struct ofl_action_set_field *act )
                 /*Reconstruct TCP or UDP checksum*/
                 if (pkt->handle_std->proto->tcp != NULL) {
                     struct tcp_header *tcp = pkt->handle_std->proto->tcp;
-                    tcp->tcp_csum = recalc_csum32(tcp->tcp_csum,
+                    tcp->tcp_csum = recalc_l4_csum32(pkt, tcp->tcp_csum,
                         ipv4->ip_dst, *((uint32_t*) act->field->value));
                 } else if (pkt->handle_std->proto->udp != NULL) {
                     struct udp_header *udp = pkt->handle_std->proto->udp;
-                    udp->udp_csum = recalc_csum32(udp->udp_csum,
+                    udp->udp_csum = recalc_l4_csum32(pkt, udp->udp_csum,
                         ipv4->ip_dst, *((uint32_t*) act->field->value));
                 }
 
@@ -189,28 +216,36 @@ set_field(struct packet *pkt, struct ofl_action_set_field *act )
             case OXM_OF_TCP_SRC:{
                 struct tcp_header *tcp = pkt->handle_std->proto->tcp;
                 uint16_t v = htons(*(uint16_t*) act->field->value);
-                tcp->tcp_csum = recalc_csum16(tcp->tcp_csum, tcp->tcp_src, v);
+                if (!l4_csum_partial(pkt)) {
+                    tcp->tcp_csum = recalc_csum16(tcp->tcp_csum, tcp->tcp_src, v);
+                }
                 tcp->tcp_src = v;
                 break;
             }
             case OXM_OF_TCP_DST:{
                 struct tcp_header *tcp = pkt->handle_std->proto->tcp;
                 uint16_t v = htons(*(uint16_t*) act->field->value);
-                tcp->tcp_csum = recalc_csum16(tcp->tcp_csum, tcp->tcp_dst, v);
+                if (!l4_csum_partial(pkt)) {
+                    tcp->tcp_csum = recalc_csum16(tcp->tcp_csum, tcp->tcp_dst, v);
+                }
                 tcp->tcp_dst = v;
                 break;
             }
             case OXM_OF_UDP_SRC:{
                 struct udp_header *udp = pkt->handle_std->proto->udp;
                 uint16_t v = htons(*(uint16_t*) act->field->value);
-                udp->udp_csum = recalc_csum16(udp->udp_csum, udp->udp_src, v);
+                if (!l4_csum_partial(pkt)) {
+                    udp->udp_csum = recalc_csum16(udp->udp_csum, udp->udp_src, v);
+                }
                 udp->udp_src = v;
                 break;
             }
             case OXM_OF_UDP_DST:{
                 struct udp_header *udp = pkt->handle_std->proto->udp;
                 uint16_t v = htons(*(uint16_t*) act->field->value);
-                udp->udp_csum = recalc_csum16(udp->udp_csum, udp->udp_dst, v);
+                if (!l4_csum_partial(pkt)) {
+                    udp->udp_csum = recalc_csum16(udp->udp_csum, udp->udp_dst, v);
+                }
                 udp->udp_dst = v;
                 break;
             }
@@ -292,11 +327,11 @@ set_field(struct packet *pkt, struct ofl_action_set_field *act )
                  /*Reconstruct TCP or UDP checksum*/
                 if (pkt->handle_std->proto->tcp != NULL) {
                     struct tcp_header *tcp = pkt->handle_std->proto->tcp;
-                    tcp->tcp_csum = recalc_csum128(tcp->tcp_csum,
+                    tcp->tcp_csum = recalc_l4_csum128(pkt, tcp->tcp_csum,
                         ipv6->ipv6_src.s6_addr,  act->field->value);
                 } else if (pkt->handle_std->proto->udp != NULL) {
                     struct udp_header *udp = pkt->handle_std->proto->udp;
-                    udp->udp_csum = recalc_csum128(udp->udp_csum,
+                    udp->udp_csum = recalc_l4_csum128(pkt, udp->udp_csum,
                         ipv6->ipv6_src.s6_addr, act->field->value);
                 }
                 memcpy(&pkt->handle_std->proto->ipv6->ipv6_src,
@@ -308,11 +343,11 @@ set_field(struct packet *pkt, struct ofl_action_set_field *act )
                  /*Reconstruct TCP or UDP checksum*/
                 if (pkt->handle_std->proto->tcp != NULL) {
                     struct tcp_header *tcp = pkt->handle_std->proto->tcp;
-                    tcp->tcp_csum = recalc_csum128(tcp->tcp_csum,
+                    tcp->tcp_csum = recalc_l4_csum128(pkt, tcp->tcp_csum,
                         ipv6->ipv6_dst.s6_addr,  act->field->value);
                 } else if (pkt->handle_std->proto->udp != NULL) {
                     struct udp_header *udp = pkt->handle_std->proto->udp;
-                    udp->udp_csum = recalc_csum128(udp->udp_csum,
+                    udp->udp_csum = recalc_l4_csum128(pkt, udp->udp_csum,
                         ipv6->ipv6_dst.s6_addr, act->field->value);
                 }
                 memcpy(&pkt->handle_std->proto->ipv6->ipv6_dst,
@@ -398,8 +433,8 @@ set_field(struct packet *pkt, struct ofl_action_set_field *act )
             }
             case OXM_OF_TUNNEL_ID :{
                 struct  ofl_match_tlv *f;
-                HMAP_FOR_EACH_WITH_HASH(f, struct ofl_match_tlv,
-                    hmap_node, hash_int(OXM_OF_TUNNEL_ID, 0), &(pkt)->handle_std->match.match_fields){
+                f = ofl_structs_match_lookup(&pkt->handle_std->match, OXM_OF_TUNNEL_ID);
+                if (f != NULL) {
                     uint64_t *tunnel_id = (uint64_t*) f->value;
                     *tunnel_id = *((uint64_t*) act->field->value);
                 }
@@ -409,67 +444,55 @@ set_field(struct packet *pkt, struct ofl_action_set_field *act )
             case OXM_OF_DHT_OPCODE :
             {
                 struct  ofl_match_tlv *f;
-                HMAP_FOR_EACH_WITH_HASH(f, struct ofl_match_tlv,
-                     hmap_node, hash_int(OXM_OF_DHT_OPCODE, 0), 
-                     &(pkt)->handle_std->match.match_fields)
-                     {
-                        memcpy(&pkt->handle_std->proto->dht->opcode,act->field->value, sizeof(uint16_t));
-                     }
+                f = ofl_structs_match_lookup(&pkt->handle_std->match, OXM_OF_DHT_OPCODE);
+                if (f != NULL) {
+                    memcpy(&pkt->handle_std->proto->dht->opcode,act->field->value, sizeof(uint16_t));
+                }
                 break;
             }
             case OXM_OF_DHT_NUM_DEVICE:
             {
                 struct  ofl_match_tlv *f;
-                HMAP_FOR_EACH_WITH_HASH(f, struct ofl_match_tlv,
-                     hmap_node, hash_int(OXM_OF_DHT_NUM_DEVICE, 0), 
-                     &(pkt)->handle_std->match.match_fields)
-                     {
-                        memcpy(&pkt->handle_std->proto->dht->num_devices,act->field->value, sizeof(uint16_t));
-                     }
+                f = ofl_structs_match_lookup(&pkt->handle_std->match, OXM_OF_DHT_NUM_DEVICE);
+                if (f != NULL) {
+                    memcpy(&pkt->handle_std->proto->dht->num_devices,act->field->value, sizeof(uint16_t));
+                }
                 break;
             }
             case OXM_OF_DHT_TYPE_DEVICE:
             {
                 struct  ofl_match_tlv *f;
-                HMAP_FOR_EACH_WITH_HASH(f, struct ofl_match_tlv,
-                     hmap_node, hash_int(OXM_OF_DHT_TYPE_DEVICE, 0), 
-                     &(pkt)->handle_std->match.match_fields)
-                     {
-                        memcpy(&pkt->handle_std->proto->dht->type_devices,act->field->value, sizeof(uint16_t));
-                     }
+                f = ofl_structs_match_lookup(&pkt->handle_std->match, OXM_OF_DHT_TYPE_DEVICE);
+                if (f != NULL) {
+                    memcpy(&pkt->handle_std->proto->dht->type_devices,act->field->value, sizeof(uint16_t));
+                }
                 break;
             }
             case OXM_OF_DHT_MACS:
             {
                 struct  ofl_match_tlv *f;
-                HMAP_FOR_EACH_WITH_HASH(f, struct ofl_match_tlv,
-                     hmap_node, hash_int(OXM_OF_DHT_MACS, 0), 
-                     &(pkt)->handle_std->match.match_fields)
-                     {
-                        memcpy(&pkt->handle_std->proto->dht->macs,act->field->value, sizeof(uint64_t)*DHT_MAX_ELEMENTS);
-                     }
+                f = ofl_structs_match_lookup(&pkt->handle_std->match, OXM_OF_DHT_MACS);
+                if (f != NULL) {
+                    memcpy(&pkt->handle_std->proto->dht->macs,act->field->value, sizeof(uint64_t)*DHT_MAX_ELEMENTS);
+                }
                 break;
             }
             case OXM_OF_DHT_OUT_PORTS:
             {
                 struct  ofl_match_tlv *f;
-                HMAP_FOR_EACH_WITH_HASH(f, struct ofl_match_tlv,
-                     hmap_node, hash_int(OXM_OF_DHT_OUT_PORTS, 0), 
-                     &(pkt)->handle_std->match.match_fields)
-                     {
-                        memcpy(&pkt->handle_std->proto->dht->out_ports,act->field->value, sizeof(uint32_t)*DHT_MAX_ELEMENTS);
-                     }
+                f = ofl_structs_match_lookup(&pkt->handle_std->match, OXM_OF_DHT_OUT_PORTS);
+                if (f != NULL) {
+                    memcpy(&pkt->handle_std->proto->dht->out_ports,act->field->value, sizeof(uint32_t)*DHT_MAX_ELEMENTS);
+                }
                 break;
             }
             case OXM_OF_DHT_IN_PORTS:
             {
                 struct  ofl_match_tlv *f;
-                HMAP_FOR_EACH_WITH_HASH(f, struct ofl_match_tlv,
-                     hmap_node, hash_int(OXM_OF_DHT_IN_PORTS, 0), 
-                     &(pkt)->handle_std->match.match_fields)
-                     {
-                        memcpy(&pkt->handle_std->proto->dht->in_ports,act->field->value, sizeof(uint32_t)*DHT_MAX_ELEMENTS);
-                     }
+                f = ofl_structs_match_lookup(&pkt->handle_std->match, OXM_OF_DHT_IN_PORTS);
+                if (f != NULL) {
+                    memcpy(&pkt->handle_std->proto->dht->in_ports,act->field->value, sizeof(uint32_t)*DHT_MAX_ELEMENTS);
+                }
                 break;
             }
             /*Fin Modificacion UAH Discovery hybrid topologies, JAH-*/
@@ -1005,6 +1028,12 @@ dp_execute_action(struct packet *pkt,
         free(a);
     }
 
+    /* Clones share their buffer until one of them modifies it. */
+    if (action->type != OFPAT_OUTPUT && action->type != OFPAT_SET_QUEUE &&
+        action->type != OFPAT_GROUP) {
+        packet_make_writable(pkt);
+    }
+
     switch (action->type) {
         case (OFPAT_SET_FIELD): {
             set_field(pkt,(struct ofl_action_set_field*) action);
@@ -1149,32 +1178,18 @@ dp_actions_output_port(struct packet *pkt, uint32_t out_port, uint32_t out_queue
             break;
         }
         case (OFPP_CONTROLLER): {
-            struct ofl_msg_packet_in msg;
-            msg.header.type = OFPT_PACKET_IN;
-            msg.total_len   = pkt->buffer->size;
-            msg.reason = pkt->handle_std->table_miss? OFPR_NO_MATCH:OFPR_ACTION;
-            msg.table_id = pkt->table_id;
-            msg.data        = pkt->buffer->data;
-            msg.cookie = cookie;
+            size_t data_len = pkt->buffer->size;
 
             if (pkt->dp->config.miss_send_len != OFPCML_NO_BUFFER){
                 dp_buffers_save(pkt->dp->buffers, pkt);
-                msg.buffer_id = pkt->buffer_id;
-                msg.data_length = MIN(max_len, pkt->buffer->size);
-            }
-            else {
-                msg.buffer_id = OFP_NO_BUFFER;
-                msg.data_length =  pkt->buffer->size;
-            }
-
-            if (!pkt->handle_std->valid){
-                packet_handle_std_validate(pkt->handle_std);
+                data_len = MIN(max_len, pkt->buffer->size);
             }
             /* In this implementation the fields in_port and in_phy_port
                 always will be the same, because we are not considering logical
                 ports*/
-            msg.match = (struct ofl_match_header*) &pkt->handle_std->match;
-            dp_send_message(pkt->dp, (struct ofl_msg_header *)&msg, NULL);
+            dp_send_packet_in(pkt->dp, pkt,
+                              pkt->handle_std->table_miss? OFPR_NO_MATCH:OFPR_ACTION,
+                              pkt->table_id, cookie, data_len);
             break;
         }
         case (OFPP_FLOOD):
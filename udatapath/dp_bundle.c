@@ -0,0 +1,376 @@
+/* 
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/HDDP).
+ * Copyright (c) 2020.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "datapath.h"
+#include "dp_buffers.h"
+#include "dp_bundle.h"
+#include "flow_table.h"
+#include "flow_entry.h"
+#include "match_std.h"
+#include "packet.h"
+#include "pipeline.h"
+#include "oflib/ofl.h"
+#include "oflib/ofl-messages.h"
+#include "oflib-exp/ofl-exp-openflow.h"
+#include "openflow/openflow.h"
+#include "openflow/openflow-ext.h"
+#include "vlog.h"
+
+#define LOG_MODULE VLM_dp_bundle
+
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
+
+struct bundle {
+    struct list                node;      /* In the bundles of the remote. */
+    uint32_t                   id;
+    uint16_t                   flags;     /* OFPEBF_* */
+    bool                       closed;
+    bool                       failed;    /* A message added was rejected. */
+
+    struct ofl_msg_flow_mod  **mods;      /* Staged flow mods, in order. */
+    size_t                     mods_num;
+    size_t                     mods_size;
+};
+
+static struct bundle *
+bundle_find(struct remote *remote, uint32_t id) {
+    struct bundle *b;
+
+    LIST_FOR_EACH (b, struct bundle, node, &remote->bundles) {
+        if (b->id == id) {
+            return b;
+        }
+    }
+    return NULL;
+}
+
+static void
+bundle_destroy(struct bundle *b) {
+    size_t i;
+
+    for (i = 0; i < b->mods_num; i++) {
+        if (b->mods[i] != NULL) {
+            ofl_msg_free((struct ofl_msg_header *)b->mods[i], NULL);
+        }
+    }
+    list_remove(&b->node);
+    free(b->mods);
+    free(b);
+}
+
+static int
+bundle_reply(struct datapath *dp, const struct sender *sender,
+             uint32_t id, uint16_t type, uint16_t flags) {
+    struct ofl_exp_openflow_msg_bundle_ctrl reply =
+            {{{{.type = OFPT_EXPERIMENTER},
+               .experimenter_id = OPENFLOW_VENDOR_ID},
+              .type = OFP_EXT_BUNDLE_CONTROL},
+             .bundle_id = id,
+             .type      = type,
+             .flags     = flags};
+
+    return dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+}
+
+/* Checks that the flow mods of the bundle can all be applied, so that the
+ * commit either applies all of them or none. The checks which depend on the
+ * contents of the tables are conservative: the entries deleted by earlier
+ * flow mods of the bundle are not taken into account. */
+static ofl_err
+bundle_check(struct datapath *dp, struct bundle *b) {
+    size_t adds[PIPELINE_TABLES];
+    ofl_err error;
+    size_t i, j;
+
+    memset(adds, 0, sizeof(adds));
+    for (i = 0; i < b->mods_num; i++) {
+        struct ofl_msg_flow_mod *mod = b->mods[i];
+        struct flow_table *table;
+        struct flow_entry *entry;
+
+        error = pipeline_validate_flow_mod(dp->pipeline, mod);
+        if (error) {
+            return error;
+        }
+        if (mod->command != OFPFC_ADD) {
+            continue;
+        }
+
+        table = dp->pipeline->tables[mod->table_id];
+        if (table->stats->active_count + ++adds[mod->table_id] > FLOW_TABLE_MAX_ENTRIES) {
+            return ofl_error(OFPET_FLOW_MOD_FAILED, OFPFMFC_TABLE_FULL);
+        }
+
+        if ((mod->flags & OFPFF_CHECK_OVERLAP) == 0) {
+            continue;
+        }
+        LIST_FOR_EACH (entry, struct flow_entry, match_node, &table->match_entries) {
+            if (flow_entry_overlaps(entry, mod)) {
+                return ofl_error(OFPET_FLOW_MOD_FAILED, OFPFMFC_OVERLAP);
+            }
+        }
+        for (j = 0; j < i; j++) {
+            struct ofl_msg_flow_mod *prev = b->mods[j];
+
+            if (prev->command == OFPFC_ADD && prev->table_id == mod->table_id &&
+                prev->priority == mod->priority &&
+                match_std_overlap((struct ofl_match *)prev->match,
+                                  (struct ofl_match *)mod->match)) {
+                return ofl_error(OFPET_FLOW_MOD_FAILED, OFPFMFC_OVERLAP);
+            }
+        }
+    }
+    return 0;
+}
+
+/* Applies a flow mod of a committed bundle, which has been checked already,
+ * and frees the parts of it not taken over by the tables. */
+static void
+bundle_apply_one(struct datapath *dp, struct ofl_msg_flow_mod *mod) {
+    bool match_kept = false, insts_kept = false;
+    ofl_err error = 0;
+    size_t i;
+
+    if (mod->table_id == 0xff) {
+        for (i = 0; i < PIPELINE_TABLES && !error; i++) {
+            error = flow_table_flow_mod(dp->pipeline->tables[i], mod, &match_kept, &insts_kept);
+        }
+    } else {
+        error = flow_table_flow_mod(dp->pipeline->tables[mod->table_id], mod, &match_kept, &insts_kept);
+    }
+    if (error) {
+        /* Cannot happen after bundle_check; the flow mod is dropped. */
+        VLOG_WARN_RL(LOG_MODULE, &rl, "Flow mod of a committed bundle failed.");
+    }
+    ofl_msg_free_flow_mod(mod, !match_kept, !insts_kept, dp->exp);
+}
+
+/* Applies the flow mods of the bundle in order. Runs of consecutive ADD flow
+ * mods on a table go in with a single pass over the table. Packets buffered
+ * by the flow mods are sent through the pipeline once all of them are in. */
+static void
+bundle_commit(struct datapath *dp, struct bundle *b) {
+    uint32_t *buffer_ids = xmalloc(sizeof(uint32_t) * (b->mods_num + 1));
+    bool *kept = xmalloc(sizeof(bool) * (b->mods_num + 1));
+    size_t buffers_num = 0;
+    size_t i, j, k;
+
+    for (i = 0; i < b->mods_num; i = j) {
+        struct ofl_msg_flow_mod *mod = b->mods[i];
+
+        if (mod->buffer_id != NO_BUFFER && mod->command != OFPFC_DELETE &&
+            mod->command != OFPFC_DELETE_STRICT) {
+            buffer_ids[buffers_num++] = mod->buffer_id;
+        }
+        j = i + 1;
+
+        if (mod->command != OFPFC_ADD || (mod->flags & OFPFF_CHECK_OVERLAP)) {
+            bundle_apply_one(dp, mod);
+            b->mods[i] = NULL;
+            continue;
+        }
+
+        while (j < b->mods_num && b->mods[j]->command == OFPFC_ADD &&
+               (b->mods[j]->flags & OFPFF_CHECK_OVERLAP) == 0 &&
+               b->mods[j]->table_id == mod->table_id) {
+            if (b->mods[j]->buffer_id != NO_BUFFER) {
+                buffer_ids[buffers_num++] = b->mods[j]->buffer_id;
+            }
+            j++;
+        }
+        if (flow_table_bulk_add(dp->pipeline->tables[mod->table_id],
+                                &b->mods[i], j - i, kept)) {
+            /* Cannot happen after bundle_check. */
+            VLOG_WARN_RL(LOG_MODULE, &rl, "Flow mods of a committed bundle failed.");
+            memset(kept, 0, sizeof(bool) * (j - i));
+        }
+        for (k = i; k < j; k++) {
+            ofl_msg_free_flow_mod(b->mods[k], !kept[k - i], !kept[k - i], dp->exp);
+            b->mods[k] = NULL;
+        }
+    }
+
+    for (i = 0; i < buffers_num; i++) {
+        struct packet *pkt = dp_buffers_retrieve(dp->buffers, buffer_ids[i]);
+
+        if (pkt != NULL) {
+            pipeline_process_packet(dp->pipeline, pkt);
+        } else {
+            VLOG_WARN_RL(LOG_MODULE, &rl, "The buffer flow_mod referred to was empty (%u).", buffer_ids[i]);
+        }
+    }
+    free(buffer_ids);
+    free(kept);
+}
+
+ofl_err
+dp_bundle_handle_control(struct datapath *dp, struct ofl_exp_openflow_msg_bundle_ctrl *msg,
+                         const struct sender *sender) {
+    struct remote *remote = sender->remote;
+    struct bundle *b;
+    uint16_t reply_type;
+    ofl_err error;
+
+    if (remote->role == OFPCR_ROLE_SLAVE) {
+        return ofl_error(OFPET_BAD_REQUEST, OFPBRC_IS_SLAVE);
+    }
+    if (msg->flags & ~(OFPEBF_ATOMIC | OFPEBF_ORDERED)) {
+        return ofl_error(OFPET_EXT_BUNDLE_FAILED, OFPEBFC_BAD_FLAGS);
+    }
+
+    b = bundle_find(remote, msg->bundle_id);
+    switch (msg->type) {
+        case (OFPEBCT_OPEN_REQUEST): {
+            if (b != NULL) {
+                return ofl_error(OFPET_EXT_BUNDLE_FAILED, OFPEBFC_BUNDLE_EXIST);
+            }
+            if (list_size(&remote->bundles) >= BUNDLES_MAX) {
+                return ofl_error(OFPET_EXT_BUNDLE_FAILED, OFPEBFC_OUT_OF_BUNDLES);
+            }
+            b = xmalloc(sizeof(struct bundle));
+            b->id        = msg->bundle_id;
+            b->flags     = msg->flags;
+            b->closed    = false;
+            b->failed    = false;
+            b->mods_size = 16;
+            b->mods_num  = 0;
+            b->mods      = xmalloc(sizeof(struct ofl_msg_flow_mod *) * b->mods_size);
+            list_push_back(&remote->bundles, &b->node);
+            reply_type = OFPEBCT_OPEN_REPLY;
+            break;
+        }
+        case (OFPEBCT_CLOSE_REQUEST): {
+            if (b == NULL) {
+                return ofl_error(OFPET_EXT_BUNDLE_FAILED, OFPEBFC_BAD_ID);
+            }
+            if (b->closed) {
+                return ofl_error(OFPET_EXT_BUNDLE_FAILED, OFPEBFC_BUNDLE_CLOSED);
+            }
+            if (b->flags != msg->flags) {
+                return ofl_error(OFPET_EXT_BUNDLE_FAILED, OFPEBFC_BAD_FLAGS);
+            }
+            b->closed = true;
+            reply_type = OFPEBCT_CLOSE_REPLY;
+            break;
+        }
+        case (OFPEBCT_COMMIT_REQUEST): {
+            if (b == NULL) {
+                return ofl_error(OFPET_EXT_BUNDLE_FAILED, OFPEBFC_BAD_ID);
+            }
+            if (b->flags != msg->flags) {
+                return ofl_error(OFPET_EXT_BUNDLE_FAILED, OFPEBFC_BAD_FLAGS);
+            }
+            /* A bundle which fails to commit is discarded, as in OpenFlow 1.4. */
+            if (b->failed) {
+                VLOG_DBG_RL(LOG_MODULE, &rl, "Bundle %u had a message rejected.", b->id);
+                bundle_destroy(b);
+                return ofl_error(OFPET_EXT_BUNDLE_FAILED, OFPEBFC_MSG_FAILED);
+            }
+            error = bundle_check(dp, b);
+            if (error) {
+                VLOG_DBG_RL(LOG_MODULE, &rl, "Bundle %u failed its commit.", b->id);
+                bundle_destroy(b);
+                return error;
+            }
+            bundle_commit(dp, b);
+            bundle_destroy(b);
+            reply_type = OFPEBCT_COMMIT_REPLY;
+            break;
+        }
+        case (OFPEBCT_DISCARD_REQUEST): {
+            if (b == NULL) {
+                return ofl_error(OFPET_EXT_BUNDLE_FAILED, OFPEBFC_BAD_ID);
+            }
+            bundle_destroy(b);
+            reply_type = OFPEBCT_DISCARD_REPLY;
+            break;
+        }
+        default: {
+            return ofl_error(OFPET_EXT_BUNDLE_FAILED, OFPEBFC_BAD_TYPE);
+        }
+    }
+
+    bundle_reply(dp, sender, msg->bundle_id, reply_type, msg->flags);
+    ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
+    return 0;
+}
+
+/* Checks that a message can be added to the bundle. */
+static ofl_err
+bundle_add_check(struct datapath *dp, struct bundle *b,
+                 struct ofl_exp_openflow_msg_bundle_add *msg) {
+    if (b->closed) {
+        return ofl_error(OFPET_EXT_BUNDLE_FAILED, OFPEBFC_BUNDLE_CLOSED);
+    }
+    if (b->flags != msg->flags) {
+        return ofl_error(OFPET_EXT_BUNDLE_FAILED, OFPEBFC_BAD_FLAGS);
+    }
+    if (msg->message->type != OFPT_FLOW_MOD) {
+        return ofl_error(OFPET_EXT_BUNDLE_FAILED, OFPEBFC_MSG_UNSUP);
+    }
+    if (b->mods_num == BUNDLE_MSGS_MAX) {
+        return ofl_error(OFPET_EXT_BUNDLE_FAILED, OFPEBFC_MSG_TOO_MANY);
+    }
+
+    /* Report what can be known already; the checks run again on commit. */
+    return pipeline_validate_flow_mod(dp->pipeline,
+                                      (struct ofl_msg_flow_mod *)msg->message);
+}
+
+ofl_err
+dp_bundle_handle_add(struct datapath *dp, struct ofl_exp_openflow_msg_bundle_add *msg,
+                     const struct sender *sender) {
+    struct remote *remote = sender->remote;
+    struct bundle *b;
+    ofl_err error;
+
+    if (remote->role == OFPCR_ROLE_SLAVE) {
+        return ofl_error(OFPET_BAD_REQUEST, OFPBRC_IS_SLAVE);
+    }
+    b = bundle_find(remote, msg->bundle_id);
+    if (b == NULL) {
+        return ofl_error(OFPET_EXT_BUNDLE_FAILED, OFPEBFC_BAD_ID);
+    }
+    /* A rejected message leaves the bundle short of what the controller
+     * meant it to hold, so its commit fails. */
+    error = bundle_add_check(dp, b, msg);
+    if (error) {
+        b->failed = true;
+        return error;
+    }
+
+    if (b->mods_num == b->mods_size) {
+        b->mods_size *= 2;
+        b->mods = xrealloc(b->mods, sizeof(struct ofl_msg_flow_mod *) * b->mods_size);
+    }
+    b->mods[b->mods_num++] = (struct ofl_msg_flow_mod *)msg->message;
+
+    msg->message = NULL;
+    ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
+    return 0;
+}
+
+void
+dp_bundle_discard_all(struct remote *remote) {
+    struct bundle *b, *next;
+
+    LIST_FOR_EACH_SAFE (b, next, struct bundle, node, &remote->bundles) {
+        bundle_destroy(b);
+    }
+}
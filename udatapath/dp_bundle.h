@@ -0,0 +1,54 @@
+/* 
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/HDDP).
+ * Copyright (c) 2020.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DP_BUNDLE_H
+#define DP_BUNDLE_H 1
+
+#include "list.h"
+#include "oflib/ofl.h"
+#include "oflib-exp/ofl-exp-openflow.h"
+
+struct datapath;
+struct remote;
+struct sender;
+
+/****************************************************************************
+ * Bundles of flow mods, staged by a controller and applied as a single
+ * transaction on commit: either every flow mod of the bundle is applied or,
+ * if any of them fails, none is. A bundle which had a message rejected when
+ * it was added fails its commit. Bundles belong to the connection they were
+ * opened on, and are discarded with it.
+ ****************************************************************************/
+
+#define BUNDLES_MAX      16      /* Open bundles per connection. */
+#define BUNDLE_MSGS_MAX  65536   /* Flow mods per bundle. */
+
+/* Handles a bundle control message: open, close, commit or discard. */
+ofl_err
+dp_bundle_handle_control(struct datapath *dp, struct ofl_exp_openflow_msg_bundle_ctrl *msg,
+                         const struct sender *sender);
+
+/* Handles a message added to a bundle. */
+ofl_err
+dp_bundle_handle_add(struct datapath *dp, struct ofl_exp_openflow_msg_bundle_add *msg,
+                     const struct sender *sender);
+
+/* Discards the bundles of a connection. */
+void
+dp_bundle_discard_all(struct remote *remote);
+
+#endif /* DP_BUNDLE_H */
@@ -126,10 +126,21 @@ handle_control_packet_out(struct datapath *dp, struct ofl_msg_packet_out *msg,
         if (!msg->data_length){
              return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_PACKET);
         }
-        /* NOTE: the created packet will take the ownership of data in msg. */
-        buf = ofpbuf_new(0);
-        ofpbuf_use(buf, msg->data, msg->data_length);
-        ofpbuf_put_uninit(buf, msg->data_length);        
+        if (sender->buffer != NULL && msg->data ==
+                (uint8_t *)ofpbuf_tail(sender->buffer) - msg->data_length) {
+            /* The frame was left in the received buffer: the packet adopts
+             * that buffer, and the OpenFlow header in front of the frame
+             * becomes headroom for pushing tags. */
+            buf = xmemdup(sender->buffer, sizeof(struct ofpbuf));
+            ofpbuf_pull(buf, buf->size - msg->data_length);
+            buf->l2 = buf->l3 = buf->l4 = buf->l7 = NULL;
+            ofpbuf_init(sender->buffer, 0);
+        } else {
+            /* NOTE: the created packet will take the ownership of data in msg. */
+            buf = ofpbuf_new(0);
+            ofpbuf_use(buf, msg->data, msg->data_length);
+            ofpbuf_put_uninit(buf, msg->data_length);
+        }
         pkt = packet_create(dp, msg->in_port, buf, true);        
     } else {
         /* NOTE: in this case packet should not have data */
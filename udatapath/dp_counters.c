@@ -0,0 +1,105 @@
+/* 
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/HDDP).
+ * Copyright (c) 2020.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <config.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dp_counters.h"
+#include "util.h"
+
+/* Terminates the free lists. */
+#define NO_RUN UINT32_MAX
+
+/* Counters allocated at first. */
+#define INITIAL_COUNTERS 256
+
+void
+dp_counters_init(struct dp_counters *c)
+{
+    size_t i;
+
+    c->array = NULL;
+    c->allocated = 0;
+    c->used = 0;
+    for (i = 0; i <= DP_COUNTERS_MAX_RUN; i++) {
+        c->free[i] = NO_RUN;
+    }
+}
+
+void
+dp_counters_destroy(struct dp_counters *c)
+{
+    free(c->array);
+    dp_counters_init(c);
+}
+
+/* Doubles the size of the array, which keeps its alignment. */
+static void
+grow(struct dp_counters *c)
+{
+    uint32_t allocated = c->allocated ? c->allocated * 2 : INITIAL_COUNTERS;
+    void *array;
+
+    if (posix_memalign(&array, DP_COUNTERS_LINE,
+                       allocated * sizeof(struct dp_counter))) {
+        out_of_memory();
+    }
+    if (c->array != NULL) {
+        memcpy(array, c->array, c->used * sizeof(struct dp_counter));
+        free(c->array);
+    }
+    c->array = array;
+    c->allocated = allocated;
+}
+
+void
+dp_counters_free(struct dp_counters *c, uint32_t idx, uint32_t n)
+{
+    c->array[idx].packets = c->free[n];
+    c->free[n] = idx;
+}
+
+uint32_t
+dp_counters_alloc(struct dp_counters *c, uint32_t n)
+{
+    uint32_t idx, left;
+
+    assert(n > 0 && n <= DP_COUNTERS_MAX_RUN);
+
+    if (c->free[n] != NO_RUN) {
+        idx = c->free[n];
+        c->free[n] = c->array[idx].packets;
+    } else {
+        /* The rest of a line too short for the run is kept for shorter
+         * ones. */
+        left = DP_COUNTERS_MAX_RUN - c->used % DP_COUNTERS_MAX_RUN;
+        if (left < n) {
+            dp_counters_free(c, c->used, left);
+            c->used += left;
+        }
+        if (c->used + n > c->allocated) {
+            grow(c);
+        }
+        idx = c->used;
+        c->used += n;
+    }
+    memset(&c->array[idx], 0, n * sizeof(struct dp_counter));
+    return idx;
+}
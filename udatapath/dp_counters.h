@@ -0,0 +1,105 @@
+/* 
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/HDDP).
+ * Copyright (c) 2020.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DP_COUNTERS_H
+#define DP_COUNTERS_H 1
+
+#include <stdint.h>
+
+
+/****************************************************************************
+ * Packet and byte counters of the datapath.
+ *
+ * The counters updated for every packet (those of the flow entries, tables,
+ * ports and queues) are kept together in one array, away from the statistics
+ * structures they belong to, so that counting a packet touches a few cache
+ * lines holding nothing but counters. Runs of up to a cache line of counters
+ * are handed out, which never straddle two lines. The owners refer to their
+ * counters by index, as the array moves when it grows, and fold them into
+ * their statistics when these are requested.
+ *
+ * The datapath runs in a single thread, so there is one array and the
+ * counters are updated without atomics.
+ ****************************************************************************/
+
+#define DP_COUNTERS_LINE 64
+
+struct dp_counter {
+    uint64_t packets;
+    uint64_t bytes;
+};
+
+/* Longest run of counters that can be allocated: one cache line. */
+#define DP_COUNTERS_MAX_RUN (DP_COUNTERS_LINE / sizeof(struct dp_counter))
+
+struct dp_counters {
+    struct dp_counter *array;   /* Aligned to DP_COUNTERS_LINE. */
+    uint32_t allocated;
+    uint32_t used;              /* Counters ever handed out, or skipped. */
+    /* Freed runs of each length. The index of the next run of a list is kept
+     * in the packets of the first counter of a run. */
+    uint32_t free[DP_COUNTERS_MAX_RUN + 1];
+};
+
+void
+dp_counters_init(struct dp_counters *c);
+
+void
+dp_counters_destroy(struct dp_counters *c);
+
+/* Allocates 'n' contiguous counters, 1 to DP_COUNTERS_MAX_RUN, in the same
+ * cache line, set to zero. Returns the index of the first one. */
+uint32_t
+dp_counters_alloc(struct dp_counters *c, uint32_t n);
+
+/* Frees the 'n' counters starting at 'idx', as allocated together. */
+void
+dp_counters_free(struct dp_counters *c, uint32_t idx, uint32_t n);
+
+/* Returns the counter at 'idx'. The pointer is only good until the next
+ * allocation. */
+static inline struct dp_counter *
+dp_counter(struct dp_counters *c, uint32_t idx)
+{
+    return &c->array[idx];
+}
+
+/* Counts a packet of 'size' bytes. */
+static inline void
+dp_counter_add(struct dp_counters *c, uint32_t idx, uint64_t size)
+{
+    struct dp_counter *counter = &c->array[idx];
+
+    counter->packets++;
+    counter->bytes += size;
+}
+
+/* Adds the counter at 'idx' to '*packets' and '*bytes', and zeroes it. */
+static inline void
+dp_counter_fold(struct dp_counters *c, uint32_t idx,
+                uint64_t *packets, uint64_t *bytes)
+{
+    struct dp_counter *counter = &c->array[idx];
+
+    *packets += counter->packets;
+    *bytes   += counter->bytes;
+    counter->packets = 0;
+    counter->bytes   = 0;
+}
+
+#endif /* DP_COUNTERS_H */
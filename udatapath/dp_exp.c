@@ -18,7 +18,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include "datapath.h"
+#include "dp_bundle.h"
 #include "dp_exp.h"
+#include "dp_hddp.h"
+#include "dp_latency.h"
 #include "packet.h"
 #include "oflib/ofl.h"
 #include "oflib/ofl-actions.h"
@@ -45,12 +48,67 @@ dp_exp_inst(struct packet *pkt UNUSED, struct ofl_instruction_experimenter *inst
 	VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to execute unknown experimenter instruction (%u).", inst->experimenter_id);
 }
 
+/* Handles an HDDP stats request. */
+static ofl_err
+hddp_stats(struct datapath *dp, struct ofl_exp_openflow_msg_multipart_request *msg,
+           const struct sender *sender) {
+    struct hddp_stats *stats = &dp->hddp_stats;
+    uint64_t round_last = stats->rounds > 0 ? stats->round_end - stats->round_start : 0;
+    uint64_t finished = stats->rounds > 0 ? stats->rounds - 1 : 0;
+
+    struct ofl_exp_openflow_msg_multipart_reply_hddp reply =
+            {{{{.type = OFPT_MULTIPART_REPLY},
+               .type = OFPMP_EXPERIMENTER, .flags = 0x0000},
+              .experimenter_id = OPENFLOW_VENDOR_ID,
+              .type            = OFPEMP_HDDP},
+             .requests_rx       = stats->requests_rx,
+             .requests_fwd      = stats->requests_fwd,
+             .requests_answered = stats->requests_answered,
+             .requests_dup      = stats->requests_dup,
+             .replies_tx        = stats->replies_tx,
+             .replies_relayed   = stats->replies_relayed,
+             .replies_dropped   = stats->replies_dropped,
+             .replies_overflow  = stats->replies_overflow,
+             .replies_suppressed = stats->replies_suppressed,
+             .hellos_rx         = stats->hellos_rx,
+             .neighbor_expired  = stats->neighbor_expired,
+             .bt_expired        = stats->bt_expired,
+             .neighbor_entries  = dp->neighbor_table.num_element,
+             .bt_entries        = dp->bt_table.num_element,
+             .rounds            = stats->rounds,
+             .round_last        = round_last,
+             .round_max         = MAX(stats->round_max, round_last),
+             .round_mean        = finished > 0 ? stats->round_sum / finished : round_last};
+
+    dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+
+    ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
+    return 0;
+}
+
 ofl_err
-dp_exp_stats(struct datapath *dp UNUSED,
+dp_exp_stats(struct datapath *dp,
                                   struct ofl_msg_multipart_request_experimenter *msg,
-                                  const struct sender *sender UNUSED) {
-	VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to handle unknown experimenter stats (%u).", msg->experimenter_id);
-    return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXPERIMENTER);
+                                  const struct sender *sender) {
+    switch (msg->experimenter_id) {
+        case (OPENFLOW_VENDOR_ID): {
+            struct ofl_exp_openflow_msg_multipart_request *exp = (struct ofl_exp_openflow_msg_multipart_request *)msg;
+
+            switch (exp->type) {
+                case (OFPEMP_HDDP): {
+                    return hddp_stats(dp, exp, sender);
+                }
+                default: {
+                    VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to handle unknown experimenter stats type (%u).", exp->type);
+                    return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXP_TYPE);
+                }
+            }
+        }
+        default: {
+            VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to handle unknown experimenter stats (%u).", msg->experimenter_id);
+            return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXPERIMENTER);
+        }
+    }
 }
 
 
@@ -73,6 +131,18 @@ dp_exp_message(struct datapath *dp,
                 case (OFP_EXT_SET_DESC): {
                     return dp_handle_set_desc(dp, (struct ofl_exp_openflow_msg_set_dp_desc *)msg, sender);
                 }
+                case (OFP_EXT_BUNDLE_CONTROL): {
+                    return dp_bundle_handle_control(dp, (struct ofl_exp_openflow_msg_bundle_ctrl *)msg, sender);
+                }
+                case (OFP_EXT_BUNDLE_ADD_MESSAGE): {
+                    return dp_bundle_handle_add(dp, (struct ofl_exp_openflow_msg_bundle_add *)msg, sender);
+                }
+                case (OFP_EXT_LATENCY_REQUEST): {
+                    return dp_latency_handle_request(dp, (struct ofl_exp_openflow_msg_latency_request *)msg, sender);
+                }
+                case (OFP_EXT_HDDP_CONFIG_REQUEST): {
+                    return dp_hddp_handle_config(dp, (struct ofl_exp_openflow_msg_hddp_config *)msg, sender);
+                }
                 default: {
                 	VLOG_WARN_RL(LOG_MODULE, &rl, "Trying to handle unknown experimenter type (%u).", exp->type);
                     return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXPERIMENTER);
@@ -0,0 +1,295 @@
+/* 
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/HDDP).
+ * Copyright (c) 2020.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "datapath.h"
+#include "dp_hddp.h"
+#include "dp_ports.h"
+#include "packet.h"
+#include "poll-loop.h"
+#include "timeval.h"
+#include "oflib/ofl.h"
+#include "oflib/ofl-messages.h"
+#include "oflib-exp/ofl-exp-openflow.h"
+#include "openflow/openflow.h"
+#include "openflow/openflow-ext.h"
+#include "vlog.h"
+
+#define LOG_MODULE VLM_dp_hddp
+
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
+
+#define HDDP_CONFIG_ALL (OFPEHC_HELLO_INTERVAL | OFPEHC_HELLO_LIFETIME | \
+                         OFPEHC_BT_LIFETIME | OFPEHC_NEIGHBOR_SWEEP | \
+                         OFPEHC_BT_SWEEP | OFPEHC_SENSOR_TYPE | \
+                         OFPEHC_ROLE | OFPEHC_SENSOR_TO_SENSOR)
+
+bool
+dp_hddp_is_sensor(const struct datapath *dp) {
+    return dp->hddp_config.role == OFPEHR_SENSOR
+           || (dp->hddp_config.role == OFPEHR_AUTO && dp->id >= 0x1000);
+}
+
+bool
+dp_hddp_is_gateway(const struct datapath *dp) {
+    return dp->hddp_config.role == OFPEHR_GATEWAY
+           || (dp->hddp_config.role == OFPEHR_AUTO && dp->id < 0x100);
+}
+
+/* Timer callbacks. */
+
+static void
+hddp_hello(struct datapath *dp) {
+    if (!dp_hddp_is_sensor(dp) || dp->hddp_config.sensor_to_sensor) {
+        return;
+    }
+    if (dp->pkt_hello == NULL) {
+        /* Carries the sensor type, so it is rebuilt when that changes. */
+        dp->pkt_hello = packet_hello_create(dp, 0, 1);
+    }
+    VLOG_DBG_RL(LOG_MODULE, &rl, "Sending hello to the gateway.");
+    packet_hello_send(dp);
+}
+
+static void
+hddp_neighbor_sweep(struct datapath *dp) {
+    if (dp->hddp_config.sensor_to_sensor) {
+        return;
+    }
+    /* Sensors that stopped saying hello may have moved elsewhere. */
+    dp->hddp_stats.neighbor_expired +=
+            mac_to_port_delete_timeout(&dp->neighbor_table, hddp_neighbor_expired, dp);
+}
+
+static void
+hddp_bt_sweep(struct datapath *dp) {
+    dp->hddp_stats.bt_expired += mac_to_port_delete_timeout(&dp->bt_table, NULL, NULL);
+}
+
+static void
+hddp_trace_timer(struct datapath *dp) {
+    hddp_trace_flush(dp);
+}
+
+/* Timer queue. */
+
+static void
+timer_insert(struct datapath *dp, struct hddp_timer *t) {
+    struct hddp_timer *iter;
+
+    LIST_FOR_EACH (iter, struct hddp_timer, node, &dp->hddp_timer_queue) {
+        if (iter->when > t->when) {
+            list_insert(&iter->node, &t->node);
+            return;
+        }
+    }
+    list_push_back(&dp->hddp_timer_queue, &t->node);
+}
+
+/* Takes the intervals from the configuration and restarts every timer. */
+static void
+timers_reset(struct datapath *dp) {
+    const uint32_t intervals[HDDP_TIMER_N] = {
+        [HDDP_TIMER_HELLO]          = dp->hddp_config.hello_interval,
+        [HDDP_TIMER_NEIGHBOR_SWEEP] = dp->hddp_config.neighbor_sweep,
+        [HDDP_TIMER_BT_SWEEP]       = dp->hddp_config.bt_sweep,
+        [HDDP_TIMER_TRACE]          = HDDP_TRACE_INTERVAL,
+    };
+    long long int now = time_msec();
+    size_t i;
+
+    list_init(&dp->hddp_timer_queue);
+    for (i = 0; i < HDDP_TIMER_N; i++) {
+        struct hddp_timer *t = &dp->hddp_timers[i];
+
+        t->interval = intervals[i];
+        t->when = now + t->interval;
+        timer_insert(dp, t);
+    }
+}
+
+void
+dp_hddp_run(struct datapath *dp) {
+    long long int now = time_msec();
+
+    while (!list_is_empty(&dp->hddp_timer_queue)) {
+        struct hddp_timer *t = CONTAINER_OF(list_front(&dp->hddp_timer_queue),
+                                            struct hddp_timer, node);
+        if (t->when > now) {
+            break;
+        }
+        list_remove(&t->node);
+        t->run(dp);
+
+        /* Do not catch up on deadlines missed while blocked. */
+        t->when += t->interval;
+        if (t->when <= now) {
+            t->when = now + t->interval;
+        }
+        timer_insert(dp, t);
+    }
+}
+
+void
+dp_hddp_wait(struct datapath *dp) {
+    if (!list_is_empty(&dp->hddp_timer_queue)) {
+        struct hddp_timer *t = CONTAINER_OF(list_front(&dp->hddp_timer_queue),
+                                            struct hddp_timer, node);
+        long long int delay = t->when - time_msec();
+
+        poll_timer_wait(delay > 0 ? delay : 0);
+    }
+}
+
+/* Configuration. */
+
+void
+dp_hddp_init(struct datapath *dp) {
+    dp->hddp_config.hello_interval   = HDDP_HELLO_INTERVAL;
+    dp->hddp_config.hello_lifetime   = HDDP_HELLO_LIFETIME;
+    dp->hddp_config.bt_lifetime      = HDDP_BT_LIFETIME;
+    dp->hddp_config.neighbor_sweep   = HDDP_NEIGHBOR_SWEEP;
+    dp->hddp_config.bt_sweep         = HDDP_BT_SWEEP;
+    dp->hddp_config.sensor_type      = 0;
+    dp->hddp_config.role             = OFPEHR_AUTO;
+    dp->hddp_config.sensor_to_sensor = true;
+
+    dp->hddp_timers[HDDP_TIMER_HELLO].run          = hddp_hello;
+    dp->hddp_timers[HDDP_TIMER_NEIGHBOR_SWEEP].run = hddp_neighbor_sweep;
+    dp->hddp_timers[HDDP_TIMER_BT_SWEEP].run       = hddp_bt_sweep;
+    dp->hddp_timers[HDDP_TIMER_TRACE].run          = hddp_trace_timer;
+    list_init(&dp->hddp_timer_queue);
+
+    mac_to_port_new(&dp->neighbor_table);
+    mac_to_port_new(&dp->bt_table);
+    dp->pkt_hello = NULL;
+}
+
+/* Checks the fields of 'c' that are set. Returns NULL, or a description of
+ * the first invalid one. */
+static const char *
+config_check(const struct ofl_exp_openflow_msg_hddp_config *c) {
+    if (((c->fields & OFPEHC_HELLO_INTERVAL) && c->hello_interval == 0)
+        || ((c->fields & OFPEHC_NEIGHBOR_SWEEP) && c->neighbor_sweep == 0)
+        || ((c->fields & OFPEHC_BT_SWEEP) && c->bt_sweep == 0)) {
+        return "intervals must be positive";
+    }
+    if ((c->fields & OFPEHC_ROLE) && c->role > OFPEHR_SENSOR) {
+        return "unknown role";
+    }
+    return NULL;
+}
+
+static void
+config_apply(struct datapath *dp, const struct ofl_exp_openflow_msg_hddp_config *c) {
+    struct hddp_config *cfg = &dp->hddp_config;
+    bool was_sensor = dp_hddp_is_sensor(dp);
+
+    if (c->fields & OFPEHC_HELLO_INTERVAL)   cfg->hello_interval   = c->hello_interval;
+    if (c->fields & OFPEHC_HELLO_LIFETIME)   cfg->hello_lifetime   = c->hello_lifetime;
+    if (c->fields & OFPEHC_BT_LIFETIME)      cfg->bt_lifetime      = c->bt_lifetime;
+    if (c->fields & OFPEHC_NEIGHBOR_SWEEP)   cfg->neighbor_sweep   = c->neighbor_sweep;
+    if (c->fields & OFPEHC_BT_SWEEP)         cfg->bt_sweep         = c->bt_sweep;
+    if (c->fields & OFPEHC_SENSOR_TYPE)      cfg->sensor_type      = c->sensor_type;
+    if (c->fields & OFPEHC_ROLE)             cfg->role             = c->role;
+    if (c->fields & OFPEHC_SENSOR_TO_SENSOR) cfg->sensor_to_sensor = c->sensor_to_sensor;
+
+    if (dp_hddp_is_sensor(dp) && cfg->sensor_type == 0) {
+        cfg->sensor_type = (rand() % HDDP_SENSOR_TYPES) + NODO_SENSOR;
+    }
+    if (dp_hddp_is_sensor(dp) != was_sensor || (c->fields & OFPEHC_SENSOR_TYPE)) {
+        if (dp->pkt_hello != NULL) {
+            packet_destroy(dp->pkt_hello);
+            dp->pkt_hello = NULL;
+        }
+    }
+}
+
+char *
+dp_hddp_configure(struct datapath *dp, const char *options) {
+    struct ofl_exp_openflow_msg_hddp_config c;
+    const char *invalid;
+    char *error;
+
+    memset(&c, 0x00, sizeof c);
+    error = ofl_exp_openflow_hddp_config_parse(options, &c);
+    if (error != NULL) {
+        return error;
+    }
+    invalid = config_check(&c);
+    if (invalid != NULL) {
+        return xstrdup(invalid);
+    }
+    config_apply(dp, &c);
+    return NULL;
+}
+
+void
+dp_hddp_start(struct datapath *dp) {
+    struct ofl_exp_openflow_msg_hddp_config none;
+
+    memset(&none, 0x00, sizeof none);
+    config_apply(dp, &none);
+    if (dp_hddp_is_sensor(dp)) {
+        VLOG_INFO(LOG_MODULE, "Sensor of type %u with id %"PRIu64".",
+                  dp->hddp_config.sensor_type, dp->id);
+    }
+    timers_reset(dp);
+}
+
+ofl_err
+dp_hddp_handle_config(struct datapath *dp, struct ofl_exp_openflow_msg_hddp_config *msg,
+                      const struct sender *sender) {
+    struct hddp_config *cfg = &dp->hddp_config;
+    const char *invalid;
+
+    if (msg->fields != 0 && sender->remote->role == OFPCR_ROLE_SLAVE) {
+        return ofl_error(OFPET_BAD_REQUEST, OFPBRC_IS_SLAVE);
+    }
+    invalid = config_check(msg);
+    if (invalid != NULL) {
+        VLOG_WARN_RL(LOG_MODULE, &rl, "Rejected HDDP configuration: %s.", invalid);
+        return ofl_error(OFPET_BAD_REQUEST, OFPBRC_EPERM);
+    }
+
+    if (msg->fields != 0) {
+        config_apply(dp, msg);
+        timers_reset(dp);
+    }
+
+    {
+        struct ofl_exp_openflow_msg_hddp_config reply =
+                {{{{.type = OFPT_EXPERIMENTER},
+                   .experimenter_id = OPENFLOW_VENDOR_ID},
+                  .type = OFP_EXT_HDDP_CONFIG_REPLY},
+                 .fields           = HDDP_CONFIG_ALL,
+                 .hello_interval   = cfg->hello_interval,
+                 .hello_lifetime   = cfg->hello_lifetime,
+                 .bt_lifetime      = cfg->bt_lifetime,
+                 .neighbor_sweep   = cfg->neighbor_sweep,
+                 .bt_sweep         = cfg->bt_sweep,
+                 .sensor_type      = cfg->sensor_type,
+                 .role             = cfg->role,
+                 .sensor_to_sensor = cfg->sensor_to_sensor};
+
+        dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+    }
+
+    ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
+    return 0;
+}
@@ -0,0 +1,108 @@
+/* 
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/HDDP).
+ * Copyright (c) 2020.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DP_HDDP_H
+#define DP_HDDP_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "list.h"
+#include "oflib/ofl.h"
+#include "oflib-exp/ofl-exp-openflow.h"
+#include "openflow/openflow-ext.h"
+
+struct datapath;
+struct sender;
+
+/****************************************************************************
+ * Parameters of the HDDP discovery and the timers that drive it. They used
+ * to be compile-time constants; they can now be given on the command line
+ * (--hddp=KEY=VALUE,...) and changed at runtime with an
+ * OFP_EXT_HDDP_CONFIG_REQUEST. Times are in milliseconds.
+ ****************************************************************************/
+
+#define HDDP_HELLO_INTERVAL   1000  /* Between hellos of a sensor. */
+#define HDDP_HELLO_LIFETIME   1500  /* Of a sensor in neighbor_table. */
+#define HDDP_BT_LIFETIME     20000  /* Of a controller in bt_table, must be
+                                       shorter than the controller refresh. */
+#define HDDP_NEIGHBOR_SWEEP   1500  /* Between sweeps of neighbor_table. */
+#define HDDP_BT_SWEEP         5000  /* Between sweeps of bt_table. */
+#define HDDP_TRACE_INTERVAL   1000  /* Between writes of the trace file. */
+#define HDDP_SENSOR_TYPES       13  /* Sensor types picked at random. */
+
+struct hddp_config {
+    uint32_t   hello_interval;
+    uint32_t   hello_lifetime;
+    uint32_t   bt_lifetime;
+    uint32_t   neighbor_sweep;
+    uint32_t   bt_sweep;
+    uint16_t   sensor_type;      /* 0 until picked at random. */
+    uint8_t    role;             /* OFPEHR_* */
+    bool       sensor_to_sensor; /* Whether sensors discover each other,
+                                    instead of saying hello to a gateway. */
+};
+
+enum hddp_timer_id {
+    HDDP_TIMER_HELLO,
+    HDDP_TIMER_NEIGHBOR_SWEEP,
+    HDDP_TIMER_BT_SWEEP,
+    HDDP_TIMER_TRACE,
+    HDDP_TIMER_N
+};
+
+/* A periodic timer, kept in a queue sorted by deadline. */
+struct hddp_timer {
+    struct list       node;      /* In datapath's 'hddp_timer_queue'. */
+    long long int     when;      /* Next deadline, in time_msec(). */
+    uint32_t          interval;
+    void            (*run)(struct datapath *);
+};
+
+/* Sets the default configuration. */
+void
+dp_hddp_init(struct datapath *dp);
+
+/* Applies "KEY=VALUE[,KEY=VALUE]..." from the command line. Returns NULL, or
+ * an error message that the caller must free. */
+char *
+dp_hddp_configure(struct datapath *dp, const char *options);
+
+/* Starts the timers, once the ports have been added. */
+void
+dp_hddp_start(struct datapath *dp);
+
+/* Runs the timers that are due. */
+void
+dp_hddp_run(struct datapath *dp);
+
+/* Arranges for the poll loop to wake up at the next deadline. */
+void
+dp_hddp_wait(struct datapath *dp);
+
+bool
+dp_hddp_is_sensor(const struct datapath *dp);
+
+bool
+dp_hddp_is_gateway(const struct datapath *dp);
+
+/* Handles an HDDP configuration request: applies its fields and replies with
+ * the whole configuration. */
+ofl_err
+dp_hddp_handle_config(struct datapath *dp, struct ofl_exp_openflow_msg_hddp_config *msg,
+                      const struct sender *sender);
+
+#endif /* DP_HDDP_H */
@@ -0,0 +1,204 @@
+/* 
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/HDDP).
+ * Copyright (c) 2020.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "datapath.h"
+#include "dp_latency.h"
+#include "oflib/ofl.h"
+#include "oflib/ofl-messages.h"
+#include "oflib-exp/ofl-exp-openflow.h"
+#include "openflow/openflow.h"
+#include "openflow/openflow-ext.h"
+#include "vlog.h"
+
+#define LOG_MODULE VLM_dp_latency
+
+static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
+
+/* Every power of two is divided in 2^SUB_BITS buckets. */
+#define SUB_BITS     4
+#define SUB_BUCKETS  (1 << SUB_BITS)
+#define BUCKETS      ((64 - SUB_BITS + 1) * SUB_BUCKETS)
+
+struct histogram {
+    uint64_t   count;
+    uint64_t   sum;
+    uint64_t   min;
+    uint64_t   max;
+    uint64_t   buckets[BUCKETS];
+};
+
+bool dp_latency_enabled = false;
+
+static struct histogram histograms[OFPELS_COUNT];
+
+/* Reference point of the calibration of the time stamp counter. */
+static uint64_t ref_ticks;
+static uint64_t ref_ns;
+
+static uint64_t
+monotonic_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline size_t
+bucket_index(uint64_t v) {
+    int e;
+
+    if (v < SUB_BUCKETS) {
+        return v;
+    }
+    e = 63 - __builtin_clzll(v) - SUB_BITS;
+    return (e + 1) * SUB_BUCKETS + ((v >> e) & (SUB_BUCKETS - 1));
+}
+
+/* Returns the value in the middle of the bucket. */
+static uint64_t
+bucket_value(size_t idx) {
+    int e;
+
+    if (idx < SUB_BUCKETS) {
+        return idx;
+    }
+    e = idx / SUB_BUCKETS - 1;
+    return ((uint64_t)(SUB_BUCKETS + idx % SUB_BUCKETS) << e) + (((uint64_t)1 << e) - 1) / 2;
+}
+
+void
+dp_latency_record(enum ofp_ext_latency_stage stage, uint64_t ticks) {
+    struct histogram *h = &histograms[stage];
+
+    if (h->count == 0 || ticks < h->min) {
+        h->min = ticks;
+    }
+    if (ticks > h->max) {
+        h->max = ticks;
+    }
+    h->count++;
+    h->sum += ticks;
+    h->buckets[bucket_index(ticks)]++;
+}
+
+void
+dp_latency_init(void) {
+    ref_ticks = dp_latency_now();
+    ref_ns = monotonic_ns();
+}
+
+static void
+latency_reset(void) {
+    memset(histograms, 0x00, sizeof(histograms));
+}
+
+/* Returns the value below which the 'permille' of the samples fall. */
+static uint64_t
+histogram_percentile(struct histogram *h, unsigned int permille) {
+    uint64_t rank = (h->count * permille + 999) / 1000;
+    uint64_t seen = 0;
+    size_t i;
+
+    for (i = 0; i < BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank && seen > 0) {
+            uint64_t v = bucket_value(i);
+            return v < h->min ? h->min : v > h->max ? h->max : v;
+        }
+    }
+    return h->max;
+}
+
+static void
+histogram_summary(struct histogram *h, double ns_per_tick,
+                  struct ofl_exp_openflow_latency_stage *st) {
+    st->count = h->count;
+    if (h->count == 0) {
+        st->min = st->max = st->mean = 0;
+        st->p50 = st->p90 = st->p99 = st->p999 = 0;
+        return;
+    }
+    st->min  = h->min * ns_per_tick;
+    st->max  = h->max * ns_per_tick;
+    st->mean = (double)h->sum / h->count * ns_per_tick;
+    st->p50  = histogram_percentile(h, 500) * ns_per_tick;
+    st->p90  = histogram_percentile(h, 900) * ns_per_tick;
+    st->p99  = histogram_percentile(h, 990) * ns_per_tick;
+    st->p999 = histogram_percentile(h, 999) * ns_per_tick;
+}
+
+ofl_err
+dp_latency_handle_request(struct datapath *dp, struct ofl_exp_openflow_msg_latency_request *msg,
+                          const struct sender *sender) {
+    struct ofl_exp_openflow_latency_stage stages[OFPELS_COUNT];
+    uint64_t ticks, ns;
+    double ns_per_tick;
+    size_t i;
+
+    if (msg->command != OFPELC_GET && sender->remote->role == OFPCR_ROLE_SLAVE) {
+        return ofl_error(OFPET_BAD_REQUEST, OFPBRC_IS_SLAVE);
+    }
+
+    switch (msg->command) {
+        case (OFPELC_GET): {
+            break;
+        }
+        case (OFPELC_ENABLE): {
+            dp_latency_enabled = true;
+            break;
+        }
+        case (OFPELC_DISABLE): {
+            dp_latency_enabled = false;
+            break;
+        }
+        case (OFPELC_RESET): {
+            latency_reset();
+            break;
+        }
+        default: {
+            VLOG_WARN_RL(LOG_MODULE, &rl, "Received latency request with unknown command (%u).", msg->command);
+            return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_EXP_TYPE);
+        }
+    }
+
+    /* The longer the switch runs, the more accurate the calibration. */
+    ticks = dp_latency_now() - ref_ticks;
+    ns = monotonic_ns() - ref_ns;
+    ns_per_tick = ticks == 0 ? 1.0 : (double)ns / ticks;
+
+    for (i = 0; i < OFPELS_COUNT; i++) {
+        stages[i].stage = i;
+        histogram_summary(&histograms[i], ns_per_tick, &stages[i]);
+    }
+
+    {
+        struct ofl_exp_openflow_msg_latency_reply reply =
+                {{{{.type = OFPT_EXPERIMENTER},
+                   .experimenter_id = OPENFLOW_VENDOR_ID},
+                  .type = OFP_EXT_LATENCY_REPLY},
+                 .enabled    = dp_latency_enabled,
+                 .stages_num = OFPELS_COUNT,
+                 .stages     = stages};
+
+        dp_send_message(dp, (struct ofl_msg_header *)&reply, sender);
+    }
+
+    ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
+    return 0;
+}
@@ -26,6 +26,7 @@
 #include <errno.h>
 #include <inttypes.h>
 #include "dp_exp.h"
+#include "dp_latency.h"
 #include "dp_ports.h"
 #include "datapath.h"
 #include "packets.h"
@@ -41,6 +42,8 @@
 
 static struct vlog_rate_limit rl = VLOG_RATE_LIMIT_INIT(60, 60);
 
+static void dp_port_sched_run(struct sw_port *p);
+
 #if defined(OF_HW_PLAT)
 #include <openflow/of_hw_api.h>
 #include <pthread.h>
@@ -209,6 +212,66 @@ process_buffer(struct datapath *dp, struct sw_port *p, struct ofpbuf *buffer) {
     pipeline_process_packet(dp->pipeline, pkt);
 }
 
+/* Reads the link state of the port after the monitor reported a change on its
+ * interface; the monitor may report changes which are not. */
+static void
+dp_port_link_update(struct datapath *dp, struct sw_port *p) {
+    enum netdev_flags flags;
+    uint32_t state;
+
+    if (netdev_get_flags(p->netdev, &flags)) {
+        return;
+    }
+    state = (flags & NETDEV_UP) ? (p->conf->state & ~OFPPS_LINK_DOWN)
+                                : (p->conf->state | OFPPS_LINK_DOWN);
+    if (state == p->conf->state) {
+        return;
+    }
+    p->conf->state = state;
+    dp_port_live_update(p);
+
+    /*Modificacion UAH Discovery hybrid topologies, JAH-*/
+    if (state & OFPPS_LINK_DOWN) {
+        /* Neighbors and paths learnt through the port are gone with it. */
+        mac_to_port_delete_port(&dp->neighbor_table, p->stats->port_no,
+                                hddp_neighbor_expired, dp);
+        mac_to_port_delete_port(&dp->bt_table, p->stats->port_no, NULL, NULL);
+    }
+    /*Fin Modificacion UAH Discovery hybrid topologies, JAH-*/
+
+    {
+    /* Notify the controllers that the port status has changed */
+    struct ofl_msg_port_status msg =
+            {{.type = OFPT_PORT_STATUS},
+             .reason = OFPPR_MODIFY, .desc = p->conf};
+
+        dp_send_message(dp, (struct ofl_msg_header *)&msg, NULL/*sender*/);
+    }
+}
+
+/* Hands the interfaces of the ports to the link monitor of the datapath. */
+static void
+dp_ports_monitor_update(struct datapath *dp) {
+    char *names[DP_MAX_PORTS + 2];
+    struct sw_port *p;
+    size_t n = 0;
+
+    if (dp->link_monitor == NULL) {
+        int error = netdev_monitor_create(&dp->link_monitor);
+        if (error) {
+            VLOG_WARN(LOG_MODULE, "port link state changes will not be tracked: %s",
+                      strerror(error));
+            return;
+        }
+    }
+    LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
+        if (!IS_HW_PORT(p) && p->netdev != NULL) {
+            names[n++] = (char *)netdev_get_name(p->netdev);
+        }
+    }
+    netdev_monitor_set_devices(dp->link_monitor, names, n);
+}
+
 void
 dp_ports_run(struct datapath *dp) {
     // static, so an unused buffer can be reused at the dp_ports_run call
@@ -235,46 +298,68 @@ dp_ports_run(struct datapath *dp) {
     // find largest MTU on our interfaces
     // buffer is shared among all (idle) interfaces...
     LIST_FOR_EACH_SAFE (p, pn, struct sw_port, node, &dp->port_list) {        
-        const int mtu = netdev_get_mtu(p->netdev);
-        if (IS_HW_PORT(p)) 
+        int mtu;
+        if (IS_HW_PORT(p) || p->netdev == NULL) 
             continue;
+        mtu = netdev_get_mtu(p->netdev);
         if (mtu > max_mtu)
             max_mtu = mtu;
     }
 
+    /* Check for interface state changes */
+    if (dp->link_monitor != NULL) {
+        const char *name;
+
+        while ((name = netdev_monitor_poll(dp->link_monitor)) != NULL) {
+            LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
+                if (!IS_HW_PORT(p) && p->netdev != NULL
+                    && !strcmp(netdev_get_name(p->netdev), name)) {
+                    dp_port_link_update(dp, p);
+                    break;
+                }
+            }
+        }
+    }
+
     LIST_FOR_EACH_SAFE (p, pn, struct sw_port, node, &dp->port_list) {
+        uint64_t start;
         int error;
-        /* Check for interface state change */
-        enum netdev_link_state link_state = netdev_link_state(p->netdev);
-        if (link_state == NETDEV_LINK_UP){
-            p->conf->state &= ~OFPPS_LINK_DOWN;
-            dp_port_live_update(p);
-        }
-        else if (link_state == NETDEV_LINK_DOWN){
-            p->conf->state |= OFPPS_LINK_DOWN;
-            dp_port_live_update(p);
-        }
+        int n;
 
         if (IS_HW_PORT(p)) {
             continue;
         }
-        if (buffer == NULL) {
-            /* Allocate buffer with some headroom to add headers in forwarding
-             * to the controller or adding a vlan tag, plus an extra 2 bytes to
-             * allow IP headers to be aligned on a 4-byte boundary.  */
-            const int headroom = 128 + 2;
-            buffer = ofpbuf_new_with_headroom(VLAN_ETH_HEADER_LEN + max_mtu, headroom);
+        if (p->sched != NULL) {
+            dp_port_sched_run(p);
         }
-        error = netdev_recv(p->netdev, buffer, VLAN_ETH_HEADER_LEN + max_mtu);
-        if (!error) {
-            p->stats->rx_packets++;
-            p->stats->rx_bytes += buffer->size;
+        if (p->netdev == NULL) {
+            continue;
+        }
+        for (n = 0; n < DP_PORT_RX_BATCH; n++) {
+            if (buffer == NULL) {
+                /* Allocate buffer with some headroom to add headers in
+                 * forwarding to the controller or adding a vlan tag, plus an
+                 * extra 2 bytes to allow IP headers to be aligned on a 4-byte
+                 * boundary.  */
+                const int headroom = 128 + 2;
+                buffer = ofpbuf_new_with_headroom(
+                                VLAN_ETH_HEADER_LEN + max_mtu, headroom);
+            }
+            start = dp_latency_start();
+            error = netdev_recv(p->netdev, buffer);
+            if (error) {
+                if (error != EAGAIN) {
+                    VLOG_ERR_RL(LOG_MODULE, &rl, "error receiving data from %s: %s",
+                                netdev_get_name(p->netdev), strerror(error));
+                }
+                break;
+            }
+            /* Empty reads are not counted, they would hide the real ones. */
+            dp_latency_end(OFPELS_RECEIVE, start);
+            dp_counter_add(&dp->counters, p->counters + SW_PORT_RX, buffer->size);
             // process_buffer takes ownership of ofpbuf buffer
             process_buffer(dp, p, buffer);
             buffer = NULL;
-        } else if (error != EAGAIN) {
-            VLOG_ERR_RL(LOG_MODULE, &rl, "error receiving data from %s: %s",
-                        netdev_get_name(p->netdev), strerror(error));
         }
     }
 
@@ -296,6 +381,10 @@ static uint32_t port_speed(uint32_t conf) {
     return 0;
 }
 
+static void init_port(struct datapath *dp, struct sw_port *port, uint32_t port_no,
+                      const char *name, const uint8_t hw_addr[ETH_ADDR_LEN],
+                      struct netdev *netdev, uint32_t max_queues);
+
 /* Creates a new port, with queues. */
 static int
 new_port(struct datapath *dp, struct sw_port *port, uint32_t port_no,
@@ -305,9 +394,6 @@ new_port(struct datapath *dp, struct sw_port *port, uint32_t port_no,
     struct in6_addr in6;
     struct in_addr in4;
     int error;
-    uint64_t now;
-
-    now = time_msec();
 
     max_queues = MIN(max_queues, NETDEV_MAX_QUEUES);
 
@@ -344,7 +430,7 @@ new_port(struct datapath *dp, struct sw_port *port, uint32_t port_no,
                  netdev_name, in6_name);
     }
 
-    if (max_queues > 0) {
+    if (max_queues > 0 && dp->sched_mode == DP_SCHED_NONE) {
         error = netdev_setup_slicing(netdev, max_queues);
         if (error) {
             VLOG_ERR(LOG_MODULE, "failed to configure slicing on %s device: "\
@@ -356,6 +442,21 @@ new_port(struct datapath *dp, struct sw_port *port, uint32_t port_no,
         }
     }
 
+    init_port(dp, port, port_no, netdev_name, netdev_get_etheraddr(netdev),
+              netdev, max_queues);
+    return 0;
+}
+
+/* Fills in the port and announces it to the controllers. A null 'netdev'
+ * makes a null port, which has no device behind it: it receives nothing and
+ * what is output to it is counted and dropped. */
+static void
+init_port(struct datapath *dp, struct sw_port *port, uint32_t port_no,
+          const char *name, const uint8_t hw_addr[ETH_ADDR_LEN],
+          struct netdev *netdev, uint32_t max_queues)
+{
+    uint64_t now = time_msec();
+
     /* NOTE: port struct is already allocated in struct dp */
     memset(port, '\0', sizeof *port);
 
@@ -363,14 +464,21 @@ new_port(struct datapath *dp, struct sw_port *port, uint32_t port_no,
 
     port->conf = xmalloc(sizeof(struct ofl_port));
     port->conf->port_no    = port_no;
-    memcpy(port->conf->hw_addr, netdev_get_etheraddr(netdev), ETH_ADDR_LEN);
-    port->conf->name       = strcpy(xmalloc(strlen(netdev_name) + 1), netdev_name);
+    memcpy(port->conf->hw_addr, hw_addr, ETH_ADDR_LEN);
+    port->conf->name       = strcpy(xmalloc(strlen(name) + 1), name);
     port->conf->config     = 0x00000000;
     port->conf->state      = 0x00000000 | OFPPS_LIVE;
-    port->conf->curr       = netdev_get_features(netdev, NETDEV_FEAT_CURRENT);
-    port->conf->advertised = netdev_get_features(netdev, NETDEV_FEAT_ADVERTISED);
-    port->conf->supported  = netdev_get_features(netdev, NETDEV_FEAT_SUPPORTED);
-    port->conf->peer       = netdev_get_features(netdev, NETDEV_FEAT_PEER);
+    if (netdev != NULL) {
+        port->conf->curr       = netdev_get_features(netdev, NETDEV_FEAT_CURRENT);
+        port->conf->advertised = netdev_get_features(netdev, NETDEV_FEAT_ADVERTISED);
+        port->conf->supported  = netdev_get_features(netdev, NETDEV_FEAT_SUPPORTED);
+        port->conf->peer       = netdev_get_features(netdev, NETDEV_FEAT_PEER);
+    } else {
+        port->conf->curr       = 0;
+        port->conf->advertised = 0;
+        port->conf->supported  = 0;
+        port->conf->peer       = 0;
+    }
     port->conf->curr_speed = port_speed(port->conf->curr);
     port->conf->max_speed  = port_speed(port->conf->supported);
 
@@ -413,6 +521,7 @@ new_port(struct datapath *dp, struct sw_port *port, uint32_t port_no,
     port->stats->collisions   = 0;
     port->stats->duration_sec = 0;
     port->stats->duration_nsec = 0;
+    port->counters = dp_counters_alloc(&dp->counters, SW_PORT_N_COUNTERS);
     port->flags |= SWP_USED;
     port->netdev = netdev;
     port->max_queues = max_queues;
@@ -421,8 +530,23 @@ new_port(struct datapath *dp, struct sw_port *port, uint32_t port_no,
 
     memset(port->queues, 0x00, sizeof(port->queues));
 
+    if (max_queues > 0 && netdev != NULL && dp->sched_mode != DP_SCHED_NONE) {
+        /* Queues are scheduled in userspace; links of unknown speed are
+         * taken to be 1 Gbps, as netdev does. */
+        uint64_t rate = dp->sched_rate;
+
+        if (rate == 0) {
+            rate = port->conf->curr_speed ? (uint64_t) port->conf->curr_speed * 1000 / 8
+                                          : 1000000000 / 8;
+        }
+        port->sched = dp_sched_create(dp->sched_mode, max_queues, rate,
+                                      netdev_get_mtu(netdev) + VLAN_ETH_HEADER_LEN);
+    }
+
     list_push_back(&dp->port_list, &port->node);
     dp->ports_num++;
+    dp->out_ports_stale = true;
+    dp_ports_monitor_update(dp);
 
     {
     /* Notify the controllers that this port has been added */
@@ -432,8 +556,6 @@ new_port(struct datapath *dp, struct sw_port *port, uint32_t port_no,
 
         dp_send_message(dp, (struct ofl_msg_header *)&msg, NULL/*sender*/);
     }
-
-    return 0;
 }
 
 
@@ -466,6 +588,7 @@ dp_ports_add(struct datapath *dp, const char *port_name)
                 port->num_queues = 0;
                 strncpy(port->hw_name, port_name, sizeof(port->hw_name));
                 list_push_back(&dp->port_list, &port->node);
+                dp->out_ports_stale = true;
 
                 struct ofl_msg_port_status msg =
                         {{.type = OFPT_PORT_STATUS},
@@ -493,7 +616,7 @@ dp_ports_add(struct datapath *dp, const char *netdev)
     uint32_t port_no;
     for (port_no = 1; port_no < DP_MAX_PORTS; port_no++) {
         struct sw_port *port = &dp->ports[port_no];
-        if (port->netdev == NULL) {
+        if (!PORT_IN_USE(port)) {
             return new_port(dp, port, port_no, netdev, NULL, dp->max_queues);
         }
     }
@@ -501,6 +624,35 @@ dp_ports_add(struct datapath *dp, const char *netdev)
 }
 #endif /* OF_HW_PLAT */
 
+int
+dp_ports_add_null(struct datapath *dp, const char *name,
+                  const uint8_t hw_addr[ETH_ADDR_LEN])
+{
+    uint32_t port_no;
+    for (port_no = 1; port_no < DP_MAX_PORTS; port_no++) {
+        struct sw_port *port = &dp->ports[port_no];
+        if (!PORT_IN_USE(port)) {
+            init_port(dp, port, port_no, name, hw_addr, NULL, 0);
+            return 0;
+        }
+    }
+    return EXFULL;
+}
+
+void
+dp_ports_set_link(struct sw_port *p, dp_port_link_cb *cb, void *aux)
+{
+    p->link_cb = cb;
+    p->link_aux = aux;
+}
+
+void
+dp_ports_receive(struct sw_port *p, struct ofpbuf *buffer)
+{
+    dp_counter_add(&p->dp->counters, p->counters + SW_PORT_RX, buffer->size);
+    process_buffer(p->dp, p, buffer);
+}
+
 int
 dp_ports_add_local(struct datapath *dp, const char *netdev)
 {
@@ -557,6 +709,77 @@ dp_ports_lookup_queue(struct sw_port *p, uint32_t queue_id)
     return NULL;
 }
 
+/* Sends the buffer on the netdev of the port, on the given queue. A null
+ * port takes it as sent, after handing it to its link, if it has one, with
+ * its checksum done as a device would. The buffer may be shared with other
+ * packets, so the checksum is done on a copy. */
+static inline void
+dp_port_send(struct sw_port *p, struct ofpbuf *buffer, struct sw_queue *q,
+             uint16_t class_id)
+{
+    uint64_t start = dp_latency_start();
+    int error = 0;
+
+    if (p->netdev != NULL) {
+        error = netdev_send(p->netdev, buffer, class_id);
+    } else if (p->link_cb != NULL) {
+        if ((buffer->offload.flags & OFPBUF_OFFLOAD_NEEDS_CSUM)
+            && buffer->offload.gso_type == OFPBUF_GSO_NONE) {
+            struct ofpbuf *copy = ofpbuf_clone(buffer);
+
+            ofpbuf_finish_csum(copy);
+            p->link_cb(p, copy, p->link_aux);
+            ofpbuf_delete(copy);
+        } else {
+            p->link_cb(p, buffer, p->link_aux);
+        }
+    }
+    if (!error) {
+        dp_counter_add(&p->dp->counters, p->counters + SW_PORT_TX, buffer->size);
+        if (q != NULL) {
+            dp_counter_add(&p->dp->counters, q->counters + SW_QUEUE_TX, buffer->size);
+        }
+    } else {
+        dp_counter(&p->dp->counters, p->counters + SW_PORT_TX_DROPPED)->packets++;
+        if (q != NULL) {
+            dp_counter(&p->dp->counters, q->counters + SW_QUEUE_TX_ERRORS)->packets++;
+        }
+    }
+    dp_latency_end(OFPELS_TRANSMIT, start);
+}
+
+/* Sends the buffer through the userspace scheduler of the port: right away if
+ * nothing is waiting and the queue is within its rates, otherwise a copy of it
+ * waits in the queue until dp_port_sched_run() lets it out. Packets dropped
+ * because the queue is full count as transmit errors of the queue. */
+static void
+dp_port_sched_output(struct sw_port *p, struct ofpbuf *buffer,
+                     struct sw_queue *q, uint32_t queue_id)
+{
+    if (dp_sched_admit(p->sched, queue_id, buffer->size, time_msec())) {
+        dp_port_send(p, buffer, q, 0);
+    } else if (!dp_sched_enqueue(p->sched, queue_id, buffer)) {
+        dp_counter(&p->dp->counters, p->counters + SW_PORT_TX_DROPPED)->packets++;
+        if (q != NULL) {
+            dp_counter(&p->dp->counters, q->counters + SW_QUEUE_TX_ERRORS)->packets++;
+        }
+    }
+}
+
+/* Sends the packets the scheduler of the port lets out. */
+static void
+dp_port_sched_run(struct sw_port *p)
+{
+    long long int now = time_msec();
+    struct ofpbuf *buffer;
+    uint32_t queue_id;
+
+    while ((buffer = dp_sched_dequeue(p->sched, now, &queue_id)) != NULL) {
+        dp_port_send(p, buffer, dp_ports_lookup_queue(p, queue_id), 0);
+        ofpbuf_delete(buffer);
+    }
+}
+
 void
 dp_ports_output(struct datapath *dp, struct ofpbuf *buffer, uint32_t out_port,
               uint32_t queue_id)
@@ -591,8 +814,17 @@ dp_ports_output(struct datapath *dp, struct ofpbuf *buffer, uint32_t out_port,
 
     /* Fall through to software controlled ports if not HW port */
 #endif
-    if (p != NULL && p->netdev != NULL) {
+    if (PORT_IN_USE(p)) {
         if (!(p->conf->config & OFPPC_PORT_DOWN)) {
+            if (p->sched != NULL) {
+                /* best-effort traffic goes to queue 0 of the scheduler */
+                q = dp_ports_lookup_queue(p, queue_id);
+                if (q == NULL && queue_id != 0) {
+                    goto error;
+                }
+                dp_port_sched_output(p, buffer, q, queue_id);
+                return;
+            }
             /* avoid the queue lookup for best-effort traffic */
             if (queue_id == 0) {
                 q = NULL;
@@ -609,16 +841,7 @@ dp_ports_output(struct datapath *dp, struct ofpbuf *buffer, uint32_t out_port,
                 }
             }
 
-            if (!netdev_send(p->netdev, buffer, class_id)) {
-                p->stats->tx_packets++;
-                p->stats->tx_bytes += buffer->size;
-                if (q != NULL) {
-                    q->stats->tx_packets++;
-                    q->stats->tx_bytes += buffer->size;
-                }
-            } else {
-                p->stats->tx_dropped++;
-            }
+            dp_port_send(p, buffer, q, class_id);
         }
         /* NOTE: no need to delete buffer, it is deleted along with the packet in caller. */
         return;
@@ -630,19 +853,57 @@ dp_ports_output(struct datapath *dp, struct ofpbuf *buffer, uint32_t out_port,
                 queue_id);
 }
 
-int
-dp_ports_output_all(struct datapath *dp, struct ofpbuf *buffer, int in_port, bool flood)
+/* Rebuilds the sets of ports an output to ALL or FLOOD goes to. Ports which
+ * are administratively down are left out, as dp_ports_output() would not
+ * send on them either. */
+static void
+dp_ports_update_out_ports(struct datapath *dp)
 {
     struct sw_port *p;
 
+    dp->all_ports_num = 0;
+    dp->flood_ports_num = 0;
     LIST_FOR_EACH (p, struct sw_port, node, &dp->port_list) {
+        if (!IS_HW_PORT(p) && (p->conf->config & OFPPC_PORT_DOWN)) {
+            continue;
+        }
+        dp->all_ports[dp->all_ports_num++] = p;
+        if (!(p->conf->config & OFPPC_NO_FWD)) {
+            dp->flood_ports[dp->flood_ports_num++] = p;
+        }
+    }
+    dp->out_ports_stale = false;
+}
+
+int
+dp_ports_output_all(struct datapath *dp, struct ofpbuf *buffer, int in_port, bool flood)
+{
+    struct sw_port **ports;
+    size_t ports_num, i;
+
+    if (dp->out_ports_stale) {
+        dp_ports_update_out_ports(dp);
+    }
+    ports     = flood ? dp->flood_ports : dp->all_ports;
+    ports_num = flood ? dp->flood_ports_num : dp->all_ports_num;
+
+    for (i = 0; i < ports_num; i++) {
+        struct sw_port *p = ports[i];
+
         if (p->stats->port_no == in_port) {
             continue;
         }
-        if (flood && p->conf->config & OFPPC_NO_FWD) {
+#if defined(OF_HW_PLAT) && !defined(USE_NETDEV)
+        if (IS_HW_PORT(p)) {
+            dp_ports_output(dp, buffer, p->stats->port_no, 0);
+            continue;
+        }
+#endif
+        if (p->sched != NULL) {
+            dp_port_sched_output(p, buffer, dp_ports_lookup_queue(p, 0), 0);
             continue;
         }
-        dp_ports_output(dp, buffer, p->stats->port_no, 0);
+        dp_port_send(p, buffer, NULL, 0);
     }
 
     return 0;
@@ -665,8 +926,7 @@ dp_ports_handle_port_mod(struct datapath *dp, struct ofl_msg_port_mod *msg,
     }
 
     /* Make sure the port id hasn't changed since this was sent */
-    if (memcmp(msg->hw_addr, netdev_get_etheraddr(p->netdev),
-                     ETH_ADDR_LEN) != 0) {
+    if (memcmp(msg->hw_addr, p->conf->hw_addr, ETH_ADDR_LEN) != 0) {
         return ofl_error(OFPET_PORT_MOD_FAILED, OFPPMFC_BAD_HW_ADDR);
     }
 
@@ -675,6 +935,7 @@ dp_ports_handle_port_mod(struct datapath *dp, struct ofl_msg_port_mod *msg,
         p->conf->config &= ~msg->mask;
         p->conf->config |= msg->config & msg->mask;
         dp_port_live_update(p);
+        dp->out_ports_stale = true;
     }
 
     /*Notify all controllers that the port status has changed*/
@@ -688,6 +949,14 @@ dp_ports_handle_port_mod(struct datapath *dp, struct ofl_msg_port_mod *msg,
 
 static void
 dp_port_stats_update(struct sw_port *port) {
+    struct dp_counters *c = &port->dp->counters;
+
+    dp_counter_fold(c, port->counters + SW_PORT_RX,
+                    &port->stats->rx_packets, &port->stats->rx_bytes);
+    dp_counter_fold(c, port->counters + SW_PORT_TX,
+                    &port->stats->tx_packets, &port->stats->tx_bytes);
+    port->stats->tx_dropped += dp_counter(c, port->counters + SW_PORT_TX_DROPPED)->packets;
+    dp_counter(c, port->counters + SW_PORT_TX_DROPPED)->packets = 0;
     port->stats->duration_sec  =  (time_msec() - port->created) / 1000;
     port->stats->duration_nsec = ((time_msec() - port->created) % 1000) * 1000000;
 }
@@ -780,6 +1049,12 @@ dp_ports_handle_port_desc_request(struct datapath *dp,
 
 static void
 dp_ports_queue_update(struct sw_queue *queue) {
+    struct dp_counters *c = &queue->port->dp->counters;
+
+    dp_counter_fold(c, queue->counters + SW_QUEUE_TX,
+                    &queue->stats->tx_packets, &queue->stats->tx_bytes);
+    queue->stats->tx_errors += dp_counter(c, queue->counters + SW_QUEUE_TX_ERRORS)->packets;
+    dp_counter(c, queue->counters + SW_QUEUE_TX_ERRORS)->packets = 0;
     queue->stats->duration_sec  =  (time_msec() - queue->created) / 1000;
     queue->stats->duration_nsec = ((time_msec() - queue->created) % 1000) * 1000000;
 }
@@ -954,6 +1229,7 @@ new_queue(struct sw_port * port, struct sw_queue * queue,
     queue->stats->tx_errors = 0;
     queue->stats->duration_sec = 0;
     queue->stats->duration_nsec = 0;
+    queue->counters = dp_counters_alloc(&port->dp->counters, SW_QUEUE_N_COUNTERS);
 
     /* class_id is the internal mapping to class. It is the offset
      * in the array of queues for each port. Note that class_id is
@@ -992,11 +1268,26 @@ port_add_queue(struct sw_port *p, uint32_t queue_id,
 static int
 port_delete_queue(struct sw_port *p, struct sw_queue *q)
 {
+    dp_counters_free(&p->dp->counters, q->counters, SW_QUEUE_N_COUNTERS);
     memset(q,'\0', sizeof *q);
     p->num_queues--;
     return 0;
 }
 
+/* Returns the maximum rate property of the queue, or OFPQ_MAX_RATE_UNCFG. */
+static uint16_t
+queue_max_rate(const struct ofl_packet_queue *queue)
+{
+    size_t i;
+
+    for (i = 0; i < queue->properties_num; i++) {
+        if (queue->properties[i]->type == OFPQT_MAX_RATE) {
+            return ((struct ofl_queue_prop_max_rate *)queue->properties[i])->rate;
+        }
+    }
+    return OFPQ_MAX_RATE_UNCFG;
+}
+
 ofl_err
 dp_ports_handle_queue_modify(struct datapath *dp, struct ofl_exp_openflow_msg_queue *msg,
         const struct sender *sender UNUSED) {
@@ -1011,8 +1302,14 @@ dp_ports_handle_queue_modify(struct datapath *dp, struct ofl_exp_openflow_msg_qu
         q = dp_ports_lookup_queue(p, msg->queue->queue_id);
         if (q != NULL) {
             /* queue exists - modify it */
-            error = netdev_change_class(p->netdev,q->class_id,
+            if (p->sched != NULL) {
+                dp_sched_set_queue(p->sched, msg->queue->queue_id,
+                                   ((struct ofl_queue_prop_min_rate *)msg->queue->properties[0])->rate,
+                                   queue_max_rate(msg->queue));
+            } else {
+                error = netdev_change_class(p->netdev,q->class_id,
                                  ((struct ofl_queue_prop_min_rate *)msg->queue->properties[0])->rate);
+            }
              if (error) {
                  VLOG_ERR(LOG_MODULE, "Failed to update queue %d", msg->queue->queue_id);
                  return ofl_error(OFPET_QUEUE_OP_FAILED, OFPQOFC_EPERM);
@@ -1031,12 +1328,18 @@ dp_ports_handle_queue_modify(struct datapath *dp, struct ofl_exp_openflow_msg_qu
             }
 
             q = dp_ports_lookup_queue(p, msg->queue->queue_id);
+            if (p->sched != NULL) {
+                dp_sched_set_queue(p->sched, msg->queue->queue_id,
+                                   ((struct ofl_queue_prop_min_rate *)msg->queue->properties[0])->rate,
+                                   queue_max_rate(msg->queue));
+            } else {
                 error = netdev_setup_class(p->netdev,q->class_id,
                                 ((struct ofl_queue_prop_min_rate *)msg->queue->properties[0])->rate);
                 if (error) {
                     VLOG_ERR(LOG_MODULE, "Failed to configure queue %d", msg->queue->queue_id);
                     return ofl_error(OFPET_QUEUE_OP_FAILED, OFPQOFC_BAD_QUEUE);
                 }
+            }
         }
 
     } else {
@@ -1070,7 +1373,11 @@ dp_ports_handle_queue_delete(struct datapath *dp, struct ofl_exp_openflow_msg_qu
     if (p != NULL && p->netdev != NULL) {
         q = dp_ports_lookup_queue(p, msg->queue->queue_id);
         if (q != NULL) {
-            netdev_delete_class(p->netdev,q->class_id);
+            if (p->sched != NULL) {
+                dp_sched_clear_queue(p->sched, msg->queue->queue_id);
+            } else {
+                netdev_delete_class(p->netdev,q->class_id);
+            }
             port_delete_queue(p, q);
 
             ofl_msg_free((struct ofl_msg_header *)msg, dp->exp);
@@ -1139,7 +1446,7 @@ void mac_to_port_new(struct mac_to_port *mac_port)
 }
 
 int mac_to_port_add(struct mac_to_port *mac_port, uint8_t Mac[ETH_ADDR_LEN], uint16_t type, 
-    uint16_t port_in, int time)
+    uint16_t port_in, uint64_t time_ms)
 {
     struct mac_port_time *nuevo_elemento = NULL;
     struct mac_port_time *actual = mac_port->fin;
@@ -1149,7 +1456,7 @@ int mac_to_port_add(struct mac_to_port *mac_port, uint8_t Mac[ETH_ADDR_LEN], uin
 
     nuevo_elemento->port_in = port_in;
     //guardamos el momento en que la entrada deja de ser valida
-    nuevo_elemento->valid_time_entry = time_msec() + time * 1000;
+    nuevo_elemento->valid_time_entry = time_msec() + time_ms;
     memcpy(nuevo_elemento->Mac, Mac, ETH_ADDR_LEN);
     nuevo_elemento->type = type;
     nuevo_elemento->next = NULL;
@@ -1166,7 +1473,7 @@ int mac_to_port_add(struct mac_to_port *mac_port, uint8_t Mac[ETH_ADDR_LEN], uin
 
 //update element
 int mac_to_port_update(struct mac_to_port *mac_port, uint8_t Mac[ETH_ADDR_LEN], uint16_t type, 
-    uint16_t port_in, int time) 
+    uint16_t port_in, uint64_t time_ms) 
 {
     struct mac_port_time *aux = mac_port->inicio;
     
@@ -1178,9 +1485,9 @@ int mac_to_port_update(struct mac_to_port *mac_port, uint8_t Mac[ETH_ADDR_LEN],
                 aux->port_in = port_in;
                 aux->type = type;
                 //miramos cual si el tiempo guardado + la actualizacion
-                if (time_msec() + (time * 1000) >= aux->valid_time_entry)
+                if (time_msec() + time_ms >= aux->valid_time_entry)
                     // le metemos el tiempo correspondiente
-                    aux->valid_time_entry = time_msec() + (time * 1000); 
+                    aux->valid_time_entry = time_msec() + time_ms; 
                 //todo correcto
                 return 0; 
             }
@@ -1190,7 +1497,7 @@ int mac_to_port_update(struct mac_to_port *mac_port, uint8_t Mac[ETH_ADDR_LEN],
     return 1;//no se encontro la mac
 }
 
-int mac_to_port_time_refresh(struct mac_to_port *mac_port, uint8_t Mac[ETH_ADDR_LEN], uint64_t time) //update element
+int mac_to_port_time_refresh(struct mac_to_port *mac_port, uint8_t Mac[ETH_ADDR_LEN], uint64_t time_ms) //update element
 {
     struct mac_port_time *aux = mac_port->inicio;
    
@@ -1200,8 +1507,8 @@ int mac_to_port_time_refresh(struct mac_to_port *mac_port, uint8_t Mac[ETH_ADDR_
             if(memcmp(aux->Mac, Mac, ETH_ADDR_LEN) == 0)
             {
                 //miramos cual si el tiempo guardado + la actualizacion
-                if (time_msec() + (time * 1000) > aux->valid_time_entry)
-                    aux->valid_time_entry = time_msec() + (time * 1000); // le metemos el tiempo correspondiente
+                if (time_msec() + time_ms > aux->valid_time_entry)
+                    aux->valid_time_entry = time_msec() + time_ms; // le metemos el tiempo correspondiente
                 return 0; //todo correcto
             }
             aux = aux->next; //pasamos al siguiente elemento de la lista
@@ -1237,6 +1544,17 @@ int mac_to_port_found_port(struct mac_to_port *mac_port, uint8_t Mac[ETH_ADDR_LE
     return port_select; //si no existe tal puerto
 }
 
+//devuelve la entrada de una mac, caducada o no, o NULL si no existe
+struct mac_port_time *mac_to_port_lookup(struct mac_to_port *mac_port, const uint8_t Mac[ETH_ADDR_LEN])
+{
+    struct mac_port_time *aux;
+
+    for (aux = mac_port->inicio; aux != NULL; aux = aux->next)
+        if (memcmp(aux->Mac, Mac, ETH_ADDR_LEN) == 0)
+            return aux;
+    return NULL;
+}
+
 int mac_to_port_found_port_position(struct mac_to_port *mac_port, uint64_t position)
 //chequemos si existe una mac y devolvemos un puerto
 {
@@ -1309,11 +1627,13 @@ int mac_to_port_check_timeout(struct mac_to_port *mac_port, uint8_t Mac[ETH_ADDR
     return 2; //no existe la pareja mac -> port_in
 }
 
-int mac_to_port_delete_timeout(struct mac_to_port *mac_port)
+int mac_to_port_delete_timeout(struct mac_to_port *mac_port,
+    void (*deleted)(const struct mac_port_time *, void *aux), void *aux)
 {
     struct mac_port_time *anterior = mac_port->inicio;
     struct mac_port_time *actual = mac_port->inicio;
     uint64_t marca_tiempo_msec = time_msec();
+    int borrados = 0;
     
     //Buscamos si tenemos elementos que buscar
     
@@ -1346,7 +1666,10 @@ int mac_to_port_delete_timeout(struct mac_to_port *mac_port)
                 anterior->next = actual->next;
             }
             if (actual != NULL){
+                if (deleted != NULL)
+                    deleted(actual, aux);
                 free(actual);
+                borrados++;
                 VLOG_INFO(LOG_MODULE, "Actual liberado correctamente");
             }
             if (mac_port->num_element > 0 ){
@@ -1366,64 +1689,51 @@ int mac_to_port_delete_timeout(struct mac_to_port *mac_port)
         
         VLOG_INFO(LOG_MODULE, "Pasamos al siguiente");
     }
-    return 0;
+    return borrados;
 }
 
-int mac_to_port_delete_port(struct mac_to_port *mac_port, int port)
+int mac_to_port_delete_port(struct mac_to_port *mac_port, int port,
+    void (*deleted)(const struct mac_port_time *, void *aux), void *aux)
 {
-    struct mac_port_time *anterior = mac_port->inicio;
-    struct mac_port_time *actual = mac_port->inicio;
+    struct mac_port_time **pp = &mac_port->inicio;
+    struct mac_port_time *actual;
+    int borrados = 0;
 
-    
-    while (actual != NULL && mac_port->num_element > 0)
+    mac_port->fin = NULL;
+    while ((actual = *pp) != NULL)
     {
-        if ( actual->port_in == port )
+        if (actual->port_in == port)
         {
-            if(actual == mac_port->inicio)
-            {
-                mac_port->inicio = actual->next;
-                if(mac_port->num_element == 1)
-                {
-                    mac_port->fin = NULL;
-                    mac_port->inicio = NULL;
-                }
-                anterior = mac_port->inicio;
-            }
-            else if(actual == mac_port->fin)
-            {
-                anterior->next = NULL;
-                mac_port->fin = anterior;
-            }
-            else
-                anterior->next = actual->next;
-            if (actual != NULL)
-                free(actual);
-            if (mac_port->num_element > 0 )
-                mac_port->num_element--;
+            //desenlazamos el elemento y seguimos desde el mismo enlace
+            *pp = actual->next;
+            if (deleted != NULL)
+                deleted(actual, aux);
+            free(actual);
+            mac_port->num_element--;
+            borrados++;
         }
         else
         {
-            anterior = anterior->next;
+            mac_port->fin = actual;
+            pp = &actual->next;
         }
-        actual = anterior->next;
     }
-    
-
-    return 0;
+    return borrados;
 }
 
 int num_port_available(struct mac_to_port * table, struct datapath * dp){
     int num_port_inactivos = 0, i = 0;
+    /* El puerto local, si lo hay, no lleva a ningun vecino */
+    int num_ports = dp->local_port ? (int)dp->ports_num - 1 : (int)dp->ports_num;
 
-    for (i = 1; i<(int)dp->ports_num; i++){
+    for (i = 1; i <= num_ports; i++){
         if (dp->ports[i].conf->state & OFPPS_LINK_DOWN)
             num_port_inactivos++;
         else
             VLOG_INFO(LOG_MODULE, "El puerto %d esta activo(OFPPS_LINK_DOWN == %lu): %lu", 
                 i,(long unsigned int)OFPPS_LINK_DOWN, (long unsigned int)dp->ports[i].conf->state);
     } 
-    /** Le restamos uno ya que el puerto del controller tampoco cuenta con habilitado */
-    return ((int)dp->ports_num - (table->num_element) - num_port_inactivos - 1);
+    return (num_ports - (table->num_element) - num_port_inactivos);
 
 }
 
@@ -1469,28 +1779,35 @@ void visualizar_tabla(struct mac_to_port *mac_port, int64_t id_datapath)
 	log_uah(mac_tabla,id_datapath);
 }
 
-void log_count_request_pks(const void *Mensaje){
+static void
+log_count_request_pks_write(const void *Mensaje, size_t size UNUSED)
+{
     FILE * file;
-	
-	VLOG_DBG_RL(LOG_MODULE, &rl, "Traza UAH -> Entro a Crear Log");
+
     file=fopen("/tmp/count_request_packets.log","a");
 	if(file != NULL)
 	{
-        file = fopen( "/tmp/count_request_packets.log" , "a" );
 		fputs(Mensaje, file);
 		fclose(file);
     }
-	else
-		VLOG_DBG_RL(LOG_MODULE, &rl, "Traza UAH -> Archivo no abierto");
 }
 
-void log_uah(const void *Mensaje, int64_t id)
-{
+/* La escritura se hace desde el hilo de log si --log-async esta activo */
+void log_count_request_pks(const void *Mensaje){
+	VLOG_DBG_RL(LOG_MODULE, &rl, "Traza UAH -> Entro a Crear Log");
+	vlog_defer(log_count_request_pks_write, Mensaje, strlen(Mensaje) + 1);
+}
 
+/* 'data' es el id del datapath seguido del mensaje */
+static void
+log_uah_write(const void *data, size_t size UNUSED)
+{
 	FILE * file;
 	char nombre[90], nombre2[90];
+	int64_t id;
+	const char *Mensaje = (const char *)data + sizeof id;
 
-	VLOG_DBG_RL(LOG_MODULE, &rl, "Traza UAH -> Entro a Crear Log");
+	memcpy(&id, data, sizeof id);
 	sprintf(nombre,"/tmp/DHT_switch_%d.log",(int)id);
 	
 	file=fopen(nombre,"a");
@@ -1502,13 +1819,158 @@ void log_uah(const void *Mensaje, int64_t id)
 			fclose(file);
 			sprintf(nombre2,"/tmp/DHT_switch_%d-%lu.log",(int)id,(long)time_msec());
 			rename(nombre,nombre2);
+			file = fopen( nombre , "a" );
+			if (file == NULL)
+				return;
 		}
-		file = fopen( nombre , "a" );
 		fputs(Mensaje, file);
 		fclose(file);
 	}
+}
+
+void log_uah(const void *Mensaje, int64_t id)
+{
+	VLOG_DBG_RL(LOG_MODULE, &rl, "Traza UAH -> Entro a Crear Log");
+	vlog_defer_with_header(log_uah_write, &id, sizeof id, Mensaje, strlen(Mensaje) + 1);
+}
+
+/* Devuelve true si ya se trato una copia del request (mac, seq) llegada por
+ * 'in_port'; si no, la anota. */
+bool hddp_seen_check(struct hddp_seen_cache *cache, const uint8_t mac[ETH_ADDR_LEN],
+                     uint32_t seq, uint32_t in_port)
+{
+	struct hddp_seen *entry;
+	uint32_t bit = 1u << (in_port % 32);
+	size_t i;
+
+	if (seq == 0 || in_port > DP_MAX_PORTS)
+		return false;
+
+	for (i = 0; i < HDDP_SEEN_ENTRIES; i++) {
+		entry = &cache->entries[i];
+		if (entry->seq == seq && eth_addr_equals(entry->mac, mac)) {
+			if (entry->ports[in_port / 32] & bit)
+				return true;
+			entry->ports[in_port / 32] |= bit;
+			return false;
+		}
+	}
+
+	//ronda nueva, reemplazamos la entrada mas antigua
+	entry = &cache->entries[cache->next];
+	cache->next = (cache->next + 1) % HDDP_SEEN_ENTRIES;
+	memset(entry, 0x00, sizeof *entry);
+	memcpy(entry->mac, mac, ETH_ADDR_LEN);
+	entry->seq = seq;
+	entry->ports[in_port / 32] |= bit;
+	return false;
+}
+
+/* Abre la ronda 'seq' del controlador y decide si se contesta entera: con el
+ * modo delta desactivado, sin secuencia, cada 'full_every' rondas o si la
+ * secuencia vuelve atras (el controlador se ha reiniciado). */
+void hddp_delta_round(struct hddp_delta *delta, uint32_t seq)
+{
+	if (delta->seq == seq && seq != 0)
+		return;
+
+	delta->seq = seq;
+	delta->full = !delta->enabled || seq == 0 || seq < delta->full_seq
+	              || seq - delta->full_seq >= delta->full_every;
+	if (delta->full)
+		delta->full_seq = seq;
+}
+
+/* Devuelve true si hay que enviar el reply que informa de 'mac' (de tipo 'type'
+ * en el puerto 'out_port') por 'in_port', y lo anota como informado. */
+bool hddp_delta_report(struct hddp_delta *delta, uint32_t in_port, uint64_t mac,
+                       uint32_t out_port, uint16_t type)
+{
+	struct hddp_report *report = NULL, *oldest = NULL;
+	size_t i;
+
+	for (i = 0; i < delta->n_reports; i++) {
+		struct hddp_report *r = &delta->reports[i];
+		if (r->in_port == in_port && r->mac == mac) {
+			report = r;
+			break;
+		}
+		if (oldest == NULL || r->seq < oldest->seq)
+			oldest = r;
+	}
+
+	if (report != NULL) {
+		if (!delta->full && report->out_port == out_port && report->type == type)
+			return false;
+	}
+	else if (delta->n_reports < HDDP_DELTA_REPORTS)
+		report = &delta->reports[delta->n_reports++];
 	else
-		VLOG_DBG_RL(LOG_MODULE, &rl, "Traza UAH -> Archivo no abierto");
+		report = oldest; //tabla llena, se olvida la entrada mas antigua
+
+	report->in_port = in_port;
+	report->mac = mac;
+	report->out_port = out_port;
+	report->type = type;
+	report->seq = delta->seq;
+	return true;
+}
+
+/* Anota un cambio de un vecino para el proximo mensaje de estado */
+void hddp_neighbor_event(struct datapath *dp, uint8_t reason, const uint8_t mac[ETH_ADDR_LEN],
+                         uint16_t type, uint32_t port)
+{
+	struct ofl_exp_openflow_neighbor *ev;
+
+	if (dp->hddp_events_num == HDDP_NEIGHBOR_EVENTS)
+		hddp_neighbor_flush(dp);
+
+	ev = &dp->hddp_events[dp->hddp_events_num++];
+	memcpy(ev->mac, mac, ETH_ADDR_LEN);
+	ev->type = type;
+	ev->port_no = port;
+	ev->reason = reason;
+}
+
+/* Callback de mac_to_port_delete_timeout() y mac_to_port_delete_port() para
+ * neighbor_table */
+void hddp_neighbor_expired(const struct mac_port_time *entry, void *dp_)
+{
+	hddp_neighbor_event(dp_, OFPENR_DELETE, entry->Mac, entry->type, entry->port_in);
+}
+
+/* Envia a los controladores los cambios acumulados */
+void hddp_neighbor_flush(struct datapath *dp)
+{
+	struct ofl_exp_openflow_msg_neighbor_status msg =
+		{{{{.type = OFPT_EXPERIMENTER}, .experimenter_id = OPENFLOW_VENDOR_ID},
+		  .type = OFP_EXT_NEIGHBOR_STATUS},
+		 .neighbors_num = dp->hddp_events_num,
+		 .neighbors = dp->hddp_events};
+
+	if (dp->hddp_events_num == 0)
+		return;
+
+	dp_send_message(dp, (struct ofl_msg_header *)&msg, NULL);
+	dp->hddp_events_num = 0;
+}
+
+/* Bound of the queued trace, a flush rotates the file at 16000 bytes anyway. */
+#define HDDP_TRACE_MAX 65536
+
+void hddp_trace(struct datapath *dp, const char *msg)
+{
+	if (dp->hddp_trace.length < HDDP_TRACE_MAX)
+		ds_put_cstr(&dp->hddp_trace, msg);
+}
+
+void hddp_trace_flush(struct datapath *dp)
+{
+	if (dp->hddp_trace.length == 0)
+		return;
+	log_uah(ds_cstr(&dp->hddp_trace), dp->id);
+	visualizar_tabla(&dp->bt_table, dp->id);
+	ds_clear(&dp->hddp_trace);
 }
 
 
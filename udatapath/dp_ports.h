@@ -27,6 +27,7 @@
 #include "list.h"
 #include "netdev.h"
 #include "dp_exp.h"
+#include "dp_sched.h"
 #include "oflib/ofl.h"
 #include "oflib/ofl-structs.h"
 #include "oflib/ofl-messages.h"
@@ -45,6 +46,12 @@
 
 
 struct sender;
+struct sw_port;
+
+/* Called with each frame output to a null port that has a link set, which
+ * keeps ownership of 'buffer'. */
+typedef void dp_port_link_cb(struct sw_port *port, const struct ofpbuf *buffer,
+                             void *aux);
 
 struct sw_queue {
     struct sw_port *port; /* reference to the parent port */
@@ -52,6 +59,14 @@ struct sw_queue {
     uint64_t created;
     struct ofl_queue_stats *stats;
     struct ofl_packet_queue *props;
+    uint32_t counters; /* SW_QUEUE_N_COUNTERS datapath counters */
+};
+
+/* Counters of a queue in the datapath counters. */
+enum sw_queue_counter {
+    SW_QUEUE_TX,            /* Packets sent. */
+    SW_QUEUE_TX_ERRORS,     /* Packets dropped, in packets. */
+    SW_QUEUE_N_COUNTERS
 };
 
 
@@ -81,6 +96,19 @@ struct sw_port {
     uint16_t num_queues;
     uint64_t created;
     struct sw_queue queues[NETDEV_MAX_QUEUES];
+    struct dp_sched *sched; /* Userspace scheduler of the queues, if any. */
+    dp_port_link_cb *link_cb;   /* Where a null port sends to, if anywhere. */
+    void *link_aux;
+    uint32_t counters;  /* SW_PORT_N_COUNTERS datapath counters, not yet in
+                         * stats. */
+};
+
+/* Counters of a port in the datapath counters. */
+enum sw_port_counter {
+    SW_PORT_RX,             /* Packets received. */
+    SW_PORT_TX,             /* Packets sent. */
+    SW_PORT_TX_DROPPED,     /* Packets dropped on output, in packets. */
+    SW_PORT_N_COUNTERS
 };
 
 
@@ -109,22 +137,124 @@ struct mac_to_port{
     int num_element;
 };
 
-//matriz de vecinos
-struct mac_to_port neighbor_table, bt_table;
-uint16_t type_sensor;
-uint8_t SENSOR_TO_SENSOR; // 0 = no se permite conexiones entre sensores; 1 = se permite conexiones entre sensores
-
-/*Fin Modificacion UAH Discovery hybrid topologies, JAH-*/
+/* Counters of the HDDP discovery. A round starts with the first request of
+ * a controller that is not in the blocking table, and ends with the last
+ * reply this switch sends or relays before the next round starts. */
+struct hddp_stats {
+    uint64_t requests_rx;       /* Requests received. */
+    uint64_t requests_fwd;      /* Requests flooded. */
+    uint64_t requests_answered; /* Requests answered with replies. */
+    uint64_t requests_dup;      /* Duplicated requests dropped. */
+    uint64_t replies_tx;        /* Replies originated. */
+    uint64_t replies_relayed;   /* Replies forwarded to the controller. */
+    uint64_t replies_dropped;   /* Replies with no valid output port. */
+    uint64_t replies_overflow;  /* Replies with no room left. */
+    uint64_t replies_suppressed;/* Replies unchanged since last reported. */
+    uint64_t hellos_rx;         /* Hellos received from sensors. */
+    uint64_t neighbor_expired;  /* Entries expired from neighbor_table. */
+    uint64_t bt_expired;        /* Entries expired from bt_table. */
+
+    uint64_t rounds;            /* Rounds started. */
+    uint64_t round_start;       /* time_msec() of the current round start. */
+    uint64_t round_end;         /* time_msec() of its last reply. */
+    uint64_t round_sum;         /* Durations of the finished rounds, in ms. */
+    uint64_t round_max;
+};
 
 #define DP_MAX_PORTS 255
 BUILD_ASSERT_DECL(DP_MAX_PORTS <= OFPP_MAX);
 
+/* Frames read from each port in a call to dp_ports_run(), so that a busy port
+ * does not wait a whole poll loop for each of them nor starve the others. */
+#define DP_PORT_RX_BATCH 32
+
+/* Cache de requests ya tratados. Un request se identifica por la MAC del
+ * controlador y su numero de secuencia (una secuencia por ronda); de cada
+ * ronda solo se trata la primera copia que llega por cada puerto, el resto
+ * son copias de caminos redundantes. La secuencia 0 no se cachea. */
+#define HDDP_SEEN_ENTRIES 8
+
+struct hddp_seen {
+    uint8_t mac[ETH_ADDR_LEN];
+    uint32_t seq;                                /* 0 = entrada libre */
+    uint32_t ports[DP_MAX_PORTS / 32 + 1];       /* Puertos ya vistos */
+};
+
+struct hddp_seen_cache {
+    struct hddp_seen entries[HDDP_SEEN_ENTRIES];
+    size_t next;                                 /* Entrada a reemplazar */
+};
+
+bool hddp_seen_check(struct hddp_seen_cache *cache, const uint8_t mac[ETH_ADDR_LEN],
+                     uint32_t seq, uint32_t in_port);
+
+/* Modo delta: cada switch recuerda lo que contesto por cada puerto en rondas
+ * anteriores y solo vuelve a enviar los replies que han cambiado (puerto o
+ * tipo de dispositivo, o que no se enviaron antes). Cada 'full_every' rondas
+ * se contesta todo para que el controlador refresque los enlaces, por lo que
+ * full_every * periodo de ronda debe ser menor que el tiempo de borrado de
+ * dispositivos del controlador. */
+#define HDDP_DELTA_REPORTS 64
+#define HDDP_DELTA_FULL_EVERY 4
+
+struct hddp_report {
+    uint32_t in_port;           /* Puerto por el que se contesto */
+    uint64_t mac;               /* Dispositivo informado */
+    uint32_t out_port;          /* Puerto del dispositivo */
+    uint16_t type;              /* Tipo del dispositivo */
+    uint32_t seq;               /* Ronda en la que se informo */
+};
+
+struct hddp_delta {
+    bool enabled;
+    unsigned int full_every;    /* Rondas entre refrescos completos */
+    uint32_t seq;               /* Ronda en curso */
+    uint32_t full_seq;          /* Ultima ronda completa */
+    bool full;                  /* La ronda en curso se contesta entera */
+    size_t n_reports;
+    struct hddp_report reports[HDDP_DELTA_REPORTS];
+};
+
+void hddp_delta_round(struct hddp_delta *delta, uint32_t seq);
+bool hddp_delta_report(struct hddp_delta *delta, uint32_t in_port, uint64_t mac,
+                       uint32_t out_port, uint16_t type);
+
+/* Notificaciones de cambios en neighbor_table (OFP_EXT_NEIGHBOR_STATUS). Los
+ * eventos se acumulan y se envian en un solo mensaje por ciclo de poll. */
+#define HDDP_NEIGHBOR_EVENTS 64
+
+void hddp_neighbor_event(struct datapath *dp, uint8_t reason, const uint8_t mac[ETH_ADDR_LEN],
+                         uint16_t type, uint32_t port);
+void hddp_neighbor_expired(const struct mac_port_time *entry, void *dp_);
+void hddp_neighbor_flush(struct datapath *dp);
+
+/*Fin Modificacion UAH Discovery hybrid topologies, JAH-*/
+
 
 
 /* Adds a port to the datapath. */
 int
 dp_ports_add(struct datapath *dp, const char *netdev);
 
+/* Adds a null port to the datapath: a port with no device behind it, which
+ * never receives and counts and drops what is output to it, unless it is
+ * given a link with dp_ports_set_link(). */
+int
+dp_ports_add_null(struct datapath *dp, const char *name,
+                  const uint8_t hw_addr[ETH_ADDR_LEN]);
+
+/* Makes the null port 'p' hand what is output to it to 'cb', instead of
+ * dropping it, as a link to something outside of the datapath. A null 'cb'
+ * takes the link down. */
+void
+dp_ports_set_link(struct sw_port *p, dp_port_link_cb *cb, void *aux);
+
+/* Runs 'buffer' through the pipeline as received on port 'p', as
+ * dp_ports_run() does with what a netdev receives. Takes ownership of
+ * 'buffer'. */
+void
+dp_ports_receive(struct sw_port *p, struct ofpbuf *buffer);
+
 /* Adds a local port to the datapath. */
 int
 dp_ports_add_local(struct datapath *dp, const char *netdev);
@@ -215,23 +345,26 @@ int num_port_available(struct mac_to_port * num_element, struct datapath * dp);
 //se crea una nueva tabla mac_to_port en cada switch
 void mac_to_port_new(struct mac_to_port *mac_port);
 //add generic element
-int mac_to_port_add(struct mac_to_port *mac_port, uint8_t Mac[ETH_ADDR_LEN], uint16_t type, uint16_t port_in, int time);
+int mac_to_port_add(struct mac_to_port *mac_port, uint8_t Mac[ETH_ADDR_LEN], uint16_t type, uint16_t port_in, uint64_t time_ms);
 //update element (time and port) 
-int mac_to_port_update(struct mac_to_port *mac_port, uint8_t Mac[ETH_ADDR_LEN], uint16_t type, uint16_t port_in, int time);
+int mac_to_port_update(struct mac_to_port *mac_port, uint8_t Mac[ETH_ADDR_LEN], uint16_t type, uint16_t port_in, uint64_t time_ms);
 //refresh time in table
-int mac_to_port_time_refresh(struct mac_to_port *mac_port, uint8_t Mac[ETH_ADDR_LEN], uint64_t time);
+int mac_to_port_time_refresh(struct mac_to_port *mac_port, uint8_t Mac[ETH_ADDR_LEN], uint64_t time_ms);
 //found if is posible the out port of the mac
 int mac_to_port_found_port(struct mac_to_port *mac_port, uint8_t Mac[ETH_ADDR_LEN]);
+struct mac_port_time *mac_to_port_lookup(struct mac_to_port *mac_port, const uint8_t Mac[ETH_ADDR_LEN]);
 //found if is posible the out port of the mac with the position on table
 int mac_to_port_found_port_position(struct mac_to_port *mac_port, uint64_t position);
 //found if is posible the out port of the mac with the position on table
 int mac_to_port_found_mac_position(struct mac_to_port *mac_port, uint64_t position, uint8_t Mac[ETH_ADDR_LEN]);
 //check de timeout of the mac and port
 int mac_to_port_check_timeout(struct mac_to_port *mac_port, uint8_t Mac[ETH_ADDR_LEN]);
-//check de timeout of the mac and port
-int mac_to_port_delete_timeout(struct mac_to_port *mac_port);
-//chect port and delete of table
-int mac_to_port_delete_port(struct mac_to_port *mac_port, int port);
+//delete the entries that timed out, returns how many
+int mac_to_port_delete_timeout(struct mac_to_port *mac_port,
+    void (*deleted)(const struct mac_port_time *, void *aux), void *aux);
+//delete the entries learnt through the port, returns how many
+int mac_to_port_delete_port(struct mac_to_port *mac_port, int port,
+    void (*deleted)(const struct mac_port_time *, void *aux), void *aux);
 
 
 /*Debug function */
@@ -239,6 +372,11 @@ int mac_to_port_delete_port(struct mac_to_port *mac_port, int port);
 void log_count_request_pks(const void *Mensaje);
 void visualizar_tabla(struct mac_to_port *mac_port, int64_t id_datapath);
 void log_uah(const void *Mensaje, int64_t id);
+/* Queues a message for the trace file of the switch, written by
+ * hddp_trace_flush() out of the packet path. */
+void hddp_trace(struct datapath *dp, const char *msg);
+/* Writes the queued messages and the blocking table to the trace file. */
+void hddp_trace_flush(struct datapath *dp);
 /*Fin Modificacion UAH Discovery hybrid topologies, JAH-*/
 
 #endif /* DP_PORTS_H */
@@ -0,0 +1,339 @@
+/* 
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/HDDP).
+ * Copyright (c) 2020.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include "dp_sched.h"
+#include "openflow/openflow.h"
+#include "ofpbuf.h"
+#include "poll-loop.h"
+#include "util.h"
+
+/* Token buckets count thousandths of a byte, so that a rate in bytes per
+ * second adds 'rate' tokens every millisecond. A packet may be sent while its
+ * buckets are positive; its size is then taken away, which may leave them
+ * negative, down to minus their depth or the size of the packet, whichever is
+ * larger, so that a frame to be segmented is paid for in full. */
+struct bucket {
+    uint64_t rate;      /* In bytes per second. */
+    int64_t  depth;
+    int64_t  tokens;
+};
+
+/* Milliseconds of traffic a bucket holds at its rate. It must cover at least
+ * one poll loop iteration for the link to be kept busy. */
+#define BUCKET_MSEC 4
+
+struct sched_queue {
+    struct bucket min;      /* Guaranteed rate. */
+    struct bucket max;      /* Ceiling. */
+    int64_t quantum;        /* Bytes a round robin turn adds to deficit. */
+    int64_t deficit;
+    size_t head;
+    size_t n_pkts;
+    struct ofpbuf *ring[DP_SCHED_QUEUE_LEN];
+};
+
+struct dp_sched {
+    enum dp_sched_mode mode;
+    uint64_t link_rate;         /* In bytes per second. */
+    size_t max_pkt;
+    struct bucket link;
+    long long int last_fill;    /* time_msec() of the last refill. */
+    size_t n_pkts;              /* Packets waiting in all queues. */
+    size_t drr_next;            /* Queue whose round robin turn it is. */
+    size_t n_queues;
+    struct sched_queue *queues;
+};
+
+static void
+bucket_set(struct bucket *b, uint64_t rate, size_t max_pkt) {
+    b->rate = rate;
+    b->depth = MAX(rate * BUCKET_MSEC, (uint64_t) max_pkt * 1000);
+    b->tokens = rate ? MIN(b->tokens, b->depth) : MIN(b->tokens, 0);
+}
+
+static void
+bucket_fill(struct bucket *b, long long int msec) {
+    b->tokens = MIN(b->tokens + (int64_t) b->rate * msec, b->depth);
+}
+
+static void
+bucket_charge(struct bucket *b, size_t size) {
+    int64_t charge = (int64_t) size * 1000;
+
+    b->tokens = MAX(b->tokens - charge, -MAX(b->depth, charge));
+}
+
+/* Returns the milliseconds until the bucket is positive again. */
+static long long int
+bucket_wait(const struct bucket *b) {
+    if (b->tokens > 0) {
+        return 0;
+    }
+    return b->rate ? -b->tokens / (int64_t) b->rate + 1 : LLONG_MAX;
+}
+
+static void
+queue_set(struct dp_sched *s, struct sched_queue *q,
+          uint16_t min_rate, uint16_t max_rate) {
+    uint64_t min = min_rate > 1000 ? 0 : s->link_rate * min_rate / 1000;
+    uint64_t max = max_rate > 1000 ? s->link_rate
+                                   : s->link_rate * max_rate / 1000;
+
+    bucket_set(&q->min, min, s->max_pkt);
+    bucket_set(&q->max, max, s->max_pkt);
+    /* Spare bandwidth is shared in proportion to the minimum rates: a turn
+     * is worth a full packet per percent of the link, and at least one. */
+    q->quantum = s->max_pkt * MAX(1, min_rate > 1000 ? 0 : min_rate / 10);
+}
+
+struct dp_sched *
+dp_sched_create(enum dp_sched_mode mode, size_t n_queues, uint64_t link_rate,
+                size_t max_pkt) {
+    struct dp_sched *s = xcalloc(1, sizeof *s);
+    size_t i;
+
+    s->mode = mode;
+    s->link_rate = link_rate;
+    s->max_pkt = max_pkt;
+    bucket_set(&s->link, link_rate, max_pkt);
+    s->link.tokens = s->link.depth;
+    s->n_queues = n_queues;
+    s->queues = xcalloc(n_queues, sizeof *s->queues);
+    for (i = 0; i < n_queues; i++) {
+        queue_set(s, &s->queues[i], OFPQ_MIN_RATE_UNCFG, OFPQ_MAX_RATE_UNCFG);
+        s->queues[i].max.tokens = s->queues[i].max.depth;
+    }
+    return s;
+}
+
+void
+dp_sched_destroy(struct dp_sched *s) {
+    size_t i;
+
+    for (i = 0; i < s->n_queues; i++) {
+        dp_sched_clear_queue(s, i);
+    }
+    free(s->queues);
+    free(s);
+}
+
+void
+dp_sched_set_queue(struct dp_sched *s, uint32_t queue_id,
+                   uint16_t min_rate, uint16_t max_rate) {
+    assert(queue_id < s->n_queues);
+    queue_set(s, &s->queues[queue_id], min_rate, max_rate);
+}
+
+void
+dp_sched_clear_queue(struct dp_sched *s, uint32_t queue_id) {
+    struct sched_queue *q;
+
+    assert(queue_id < s->n_queues);
+    q = &s->queues[queue_id];
+    while (q->n_pkts) {
+        ofpbuf_delete(q->ring[q->head]);
+        q->head = (q->head + 1) % DP_SCHED_QUEUE_LEN;
+        q->n_pkts--;
+        s->n_pkts--;
+    }
+    q->deficit = 0;
+    queue_set(s, q, OFPQ_MIN_RATE_UNCFG, OFPQ_MAX_RATE_UNCFG);
+}
+
+static void
+sched_fill(struct dp_sched *s, long long int now) {
+    long long int msec = now - s->last_fill;
+    size_t i;
+
+    if (msec <= 0) {
+        return;
+    }
+    s->last_fill = now;
+    msec = MIN(msec, 1000);
+    bucket_fill(&s->link, msec);
+    for (i = 0; i < s->n_queues; i++) {
+        bucket_fill(&s->queues[i].min, msec);
+        bucket_fill(&s->queues[i].max, msec);
+    }
+}
+
+static void
+sched_charge(struct dp_sched *s, struct sched_queue *q, size_t size) {
+    bucket_charge(&s->link, size);
+    bucket_charge(&q->min, size);
+    bucket_charge(&q->max, size);
+}
+
+static inline size_t
+queue_head_size(const struct sched_queue *q) {
+    return q->ring[q->head]->size;
+}
+
+/* Returns the queue to send the next packet from, or null if every queue
+ * with packets waiting is over its maximum rate. */
+static struct sched_queue *
+sched_pick(struct dp_sched *s) {
+    struct sched_queue *q;
+    size_t i;
+
+    /* Queues below their minimum rate go first. */
+    for (i = 0; i < s->n_queues; i++) {
+        q = &s->queues[i];
+        if (q->n_pkts && q->min.tokens > 0 && q->max.tokens > 0) {
+            return q;
+        }
+    }
+
+    if (s->mode == DP_SCHED_STRICT) {
+        for (i = 0; i < s->n_queues; i++) {
+            q = &s->queues[i];
+            if (q->n_pkts && q->max.tokens > 0) {
+                return q;
+            }
+        }
+        return NULL;
+    }
+
+    for (i = 0; i < s->n_queues; i++) {
+        q = &s->queues[i];
+        if (q->n_pkts && q->max.tokens > 0) {
+            break;
+        }
+    }
+    if (i == s->n_queues) {
+        return NULL;
+    }
+
+    /* The queue whose turn it is keeps sending while its deficit covers the
+     * packet at its head; then the turn passes on and the next queue gets its
+     * quantum. Frames offloaded for segmentation may be larger than a
+     * quantum, so a queue saves up turns until its head fits; some queue can
+     * send, so this ends. */
+    for (;;) {
+        q = &s->queues[s->drr_next];
+        if (q->n_pkts && q->max.tokens > 0
+            && q->deficit >= (int64_t) queue_head_size(q)) {
+            q->deficit -= queue_head_size(q);
+            return q;
+        }
+        if (!q->n_pkts) {
+            q->deficit = 0;
+        }
+        s->drr_next = (s->drr_next + 1) % s->n_queues;
+        q = &s->queues[s->drr_next];
+        if (q->n_pkts && q->max.tokens > 0) {
+            q->deficit += q->quantum;
+        } else if (q->n_pkts) {
+            /* A queue held back by its ceiling does not save up turns. */
+            q->deficit = MIN(q->deficit, (int64_t) s->max_pkt);
+        }
+    }
+}
+
+bool
+dp_sched_admit(struct dp_sched *s, uint32_t queue_id, size_t size,
+               long long int now) {
+    struct sched_queue *q;
+
+    assert(queue_id < s->n_queues);
+    if (s->n_pkts) {
+        return false;
+    }
+    sched_fill(s, now);
+    q = &s->queues[queue_id];
+    if (s->link.tokens <= 0 || q->max.tokens <= 0) {
+        return false;
+    }
+    sched_charge(s, q, size);
+    return true;
+}
+
+bool
+dp_sched_enqueue(struct dp_sched *s, uint32_t queue_id,
+                 const struct ofpbuf *buffer) {
+    struct sched_queue *q;
+
+    assert(queue_id < s->n_queues);
+    q = &s->queues[queue_id];
+    if (q->n_pkts == DP_SCHED_QUEUE_LEN) {
+        return false;
+    }
+    q->ring[(q->head + q->n_pkts) % DP_SCHED_QUEUE_LEN] = ofpbuf_clone(buffer);
+    q->n_pkts++;
+    s->n_pkts++;
+    return true;
+}
+
+struct ofpbuf *
+dp_sched_dequeue(struct dp_sched *s, long long int now, uint32_t *queue_id) {
+    struct sched_queue *q;
+    struct ofpbuf *buffer;
+
+    if (!s->n_pkts) {
+        return NULL;
+    }
+    sched_fill(s, now);
+    if (s->link.tokens <= 0) {
+        return NULL;
+    }
+    q = sched_pick(s);
+    if (q == NULL) {
+        return NULL;
+    }
+
+    buffer = q->ring[q->head];
+    q->head = (q->head + 1) % DP_SCHED_QUEUE_LEN;
+    q->n_pkts--;
+    s->n_pkts--;
+    sched_charge(s, q, buffer->size);
+    *queue_id = q - s->queues;
+    return buffer;
+}
+
+size_t
+dp_sched_backlog(const struct dp_sched *s) {
+    return s->n_pkts;
+}
+
+void
+dp_sched_wait(struct dp_sched *s, long long int now) {
+    long long int msec = LLONG_MAX;
+    size_t i;
+
+    if (!s->n_pkts) {
+        return;
+    }
+    sched_fill(s, now);
+    /* Some queue can send as soon as the link and its ceiling allow. */
+    for (i = 0; i < s->n_queues; i++) {
+        if (s->queues[i].n_pkts) {
+            msec = MIN(msec, bucket_wait(&s->queues[i].max));
+        }
+    }
+    if (msec == LLONG_MAX) {
+        return;
+    }
+    msec = MAX(msec, bucket_wait(&s->link));
+    if (msec) {
+        poll_timer_wait(MIN(msec, INT_MAX));
+    } else {
+        poll_immediate_wake();
+    }
+}
@@ -0,0 +1,99 @@
+/* 
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/HDDP).
+ * Copyright (c) 2020.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DP_SCHED_H
+#define DP_SCHED_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/****************************************************************************
+ * Userspace egress scheduler of a port.
+ *
+ * Packets sent to a queue of the port wait in that queue until the scheduler
+ * lets them out. The port is shaped to the rate of its link. Queues below
+ * their minimum rate are served first, in queue id order, and the bandwidth
+ * left is shared among the queues below their maximum rate, either by
+ * deficit round robin weighted by the minimum rates or in queue id order.
+ * Rates are given in tenths of a percent of the link rate, as in the
+ * OpenFlow queue properties. Queue 0 carries best-effort traffic and exists
+ * from the start, with no minimum rate.
+ ****************************************************************************/
+
+struct ofpbuf;
+
+enum dp_sched_mode {
+    DP_SCHED_NONE,      /* Queues are tc classes of the kernel. */
+    DP_SCHED_DRR,       /* Spare bandwidth shared by deficit round robin. */
+    DP_SCHED_STRICT     /* Spare bandwidth given in queue id order. */
+};
+
+/* Packets each queue holds; packets beyond that are dropped. */
+#define DP_SCHED_QUEUE_LEN 256
+
+/* Creates a scheduler with 'n_queues' queues for a link of 'link_rate' bytes
+ * per second, on which packets are at most 'max_pkt' bytes long. */
+struct dp_sched *
+dp_sched_create(enum dp_sched_mode mode, size_t n_queues, uint64_t link_rate,
+                size_t max_pkt);
+
+/* Destroys the scheduler, and the packets waiting in it. */
+void
+dp_sched_destroy(struct dp_sched *sched);
+
+/* Sets the minimum and maximum rates of the given queue. Rates above 1000
+ * mean not configured. */
+void
+dp_sched_set_queue(struct dp_sched *sched, uint32_t queue_id,
+                   uint16_t min_rate, uint16_t max_rate);
+
+/* Drops the packets waiting in the given queue and resets its rates. */
+void
+dp_sched_clear_queue(struct dp_sched *sched, uint32_t queue_id);
+
+/* Returns true if a packet of 'size' bytes for the given queue can be sent
+ * right away, because nothing is waiting and the queue is within its rates,
+ * and charges it to the rates in that case. */
+bool
+dp_sched_admit(struct dp_sched *sched, uint32_t queue_id, size_t size,
+               long long int now);
+
+/* Queues a copy of the packet on the given queue. Returns false if the queue
+ * is full and the packet was dropped. */
+bool
+dp_sched_enqueue(struct dp_sched *sched, uint32_t queue_id,
+                 const struct ofpbuf *buffer);
+
+/* Returns the next packet to send at time 'now' (in ms), storing its queue
+ * in 'queue_id', or null if none can be sent yet. The caller owns the
+ * returned buffer. */
+struct ofpbuf *
+dp_sched_dequeue(struct dp_sched *sched, long long int now,
+                 uint32_t *queue_id);
+
+/* Returns the number of packets waiting in the scheduler. */
+size_t
+dp_sched_backlog(const struct dp_sched *sched);
+
+/* Makes the poll loop wake up when the next waiting packet can be sent. */
+void
+dp_sched_wait(struct dp_sched *sched, long long int now);
+
+
+#endif /* DP_SCHED_H */
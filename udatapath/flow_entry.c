@@ -143,6 +143,8 @@ flow_entry_modify_stats(struct flow_entry *entry,
 
     /* Reset flow counters as needed. Jean II */
     if ((mod->flags & OFPFF_RESET_COUNTS) != 0) {
+        flow_table_uncount_entry(entry->table, entry);
+        /* The counter was folded into the stats. */
         if (!(entry->no_pkt_count))
             entry->stats->packet_count     = 0;
         if (!(entry->no_byt_count))
@@ -177,6 +179,8 @@ flow_entry_hard_timeout(struct flow_entry *entry) {
 
 void
 flow_entry_update(struct flow_entry *entry) {
+    dp_counter_fold(&entry->dp->counters, entry->counter,
+                    &entry->stats->packet_count, &entry->stats->byte_count);
     entry->stats->duration_sec  =  (time_msec() - entry->created) / 1000;
     entry->stats->duration_nsec = ((time_msec() - entry->created) % 1000) * 1000000;
 }
@@ -335,6 +339,7 @@ flow_entry_create(struct datapath *dp, struct flow_table *table, struct ofl_msg_
     entry->stats->cookie           = mod->cookie;
     entry->no_pkt_count = ((mod->flags & OFPFF_NO_PKT_COUNTS) != 0 );
     entry->no_byt_count = ((mod->flags & OFPFF_NO_BYT_COUNTS) != 0 ); 
+    entry->counter = dp_counters_alloc(&dp->counters, 1);
     if (entry->no_pkt_count)
         entry->stats->packet_count     = 0xffffffffffffffff;
     else 
@@ -349,6 +354,8 @@ flow_entry_create(struct datapath *dp, struct flow_table *table, struct ofl_msg_
     entry->stats->instructions     = mod->instructions;
 
     entry->match = mod->match; /* TODO: MOD MATCH? */
+    entry->fields = entry->match->type == OFPMT_OXM
+                    ? match_std_fields((struct ofl_match *)entry->match) : 0;
 
     entry->created      = now;
     entry->remove_at    = mod->hard_timeout == 0 ? 0
@@ -374,6 +381,7 @@ flow_entry_destroy(struct flow_entry *entry) {
     //       flow; but it won't be a problem.
     del_group_refs(entry);
     del_meter_refs(entry);
+    dp_counters_free(&entry->dp->counters, entry->counter, 1);
     ofl_structs_free_flow_stats(entry->stats, entry->dp->exp);
     // assumes it is a standard match
     //free(entry->match);
@@ -394,6 +402,9 @@ flow_entry_remove(struct flow_entry *entry, uint8_t reason) {
         }
     }
 
+    flow_table_cursors_skip(entry->table, entry, NULL);
+    flow_table_uncount_entry(entry->table, entry);
+    flow_table_summary_remove(entry->table, entry);
     list_remove(&entry->match_node);
     list_remove(&entry->hard_node);
     list_remove(&entry->idle_node);
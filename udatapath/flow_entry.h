@@ -51,6 +51,10 @@ struct flow_entry {
 
     bool                     no_pkt_count; /* true if doesn't keep track of flow matched packets*/     
     bool                     no_byt_count; /* true if doesn't keep track of flow matched bytes*/
+    uint64_t                 fields;      /* fields a packet must have to match,
+                                             see match_std_fields(). */
+    uint32_t                 counter;     /* packets and bytes matched since the
+                                             stats were last updated. */
     struct list              group_refs;  /* list of groups referencing the flow. */
     struct list              meter_refs;  /* list of meters referencing the flow. */
 };
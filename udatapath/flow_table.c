@@ -18,11 +18,14 @@
 #include <stdbool.h>
 #include <string.h>
 #include "dynamic-string.h"
+#include "hash.h"
+#include "hmap.h"
 #include "datapath.h"
 #include "flow_table.h"
 #include "flow_entry.h"
 #include "oflib/ofl.h"
 #include "oflib/oxm-match.h"
+#include "match_std.h"
 #include "time.h"
 #include "dp_capabilities.h"
 //#include "packet_handle_std.h"
@@ -96,6 +99,39 @@ add_to_timeout_lists(struct flow_table *table, struct flow_entry *entry) {
     }
 }
 
+/* Adds the entry to the summary of the table, as it joins the table. */
+static void
+summary_add(struct flow_table *table, struct flow_entry *entry) {
+    struct flow_table_summary *s = &table->summary;
+    size_t i;
+
+    s->required = s->entries_num == 0 ? entry->fields : s->required & entry->fields;
+    s->entries_num++;
+    for (i = 0; i < 64; i++) {
+        if (entry->fields & ((uint64_t) 1 << i)) {
+            s->refs[i]++;
+        }
+    }
+}
+
+void
+flow_table_summary_remove(struct flow_table *table, struct flow_entry *entry) {
+    struct flow_table_summary *s = &table->summary;
+    size_t i;
+
+    s->entries_num--;
+    s->required = 0;
+    for (i = 0; i < 64; i++) {
+        if (entry->fields & ((uint64_t) 1 << i)) {
+            s->refs[i]--;
+        }
+        /* Fields required by all the entries left. */
+        if (s->entries_num > 0 && s->refs[i] == s->entries_num) {
+            s->required |= (uint64_t) 1 << i;
+        }
+    }
+}
+
 /* Handles flow mod messages with ADD command. */
 static ofl_err
 flow_table_add(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool check_overlap, bool *match_kept, bool *insts_kept) {
@@ -114,6 +150,10 @@ flow_table_add(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool chec
             *insts_kept = true;
 
             /* NOTE: no flow removed message should be generated according to spec. */
+            flow_table_cursors_skip(table, entry, new_entry);
+            flow_table_uncount_entry(table, entry);
+            flow_table_summary_remove(table, entry);
+            summary_add(table, new_entry);
             list_replace(&new_entry->match_node, &entry->match_node);
             list_remove(&entry->hard_node);
             list_remove(&entry->idle_node);
@@ -137,6 +177,7 @@ flow_table_add(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool chec
     *insts_kept = true;
 
     list_insert(&entry->match_node, &new_entry->match_node);
+    summary_add(table, new_entry);
     add_to_timeout_lists(table, new_entry);
 
     return 0;
@@ -202,15 +243,179 @@ flow_table_flow_mod(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool
 }
 
 
+/* Hashes a match so that matches which are equal for a strict flow mod hash
+ * equally. The values of masked fields are left out, as the strict
+ * comparison of masked fields is not a plain comparison of their bytes. */
+static uint32_t
+flow_table_match_hash(struct ofl_match *match, uint16_t priority) {
+    struct ofl_match_tlv *f;
+    uint32_t hash = hash_int(priority, match->header.length);
+
+    /* Fields are summed up, so that the hash does not depend on their order. */
+    OFL_MATCH_FOR_EACH(f, match) {
+        hash += OXM_HASMASK(f->header) ? hash_int(f->header, 0)
+                    : hash_bytes(f->value, OXM_LENGTH(f->header), f->header);
+    }
+    return hash;
+}
+
+/* A distinct match in a bulk add: an entry already in the table, the flow
+ * mod replacing or adding it, or both. */
+struct bulk_slot {
+    struct hmap_node   node;
+    struct flow_entry *entry;   /* Entry in the table, or NULL. */
+    size_t             first;   /* Flow mod which added the match. */
+    size_t             winner;  /* Last flow mod with the match, or SIZE_MAX. */
+    struct flow_entry *created; /* Entry created for the winner. */
+};
+
+static int
+bulk_slot_compare(const void *a, const void *b) {
+    const struct bulk_slot *sa = *(const struct bulk_slot **)a;
+    const struct bulk_slot *sb = *(const struct bulk_slot **)b;
+
+    if (sa->created->stats->priority != sb->created->stats->priority) {
+        return sa->created->stats->priority > sb->created->stats->priority ? -1 : 1;
+    }
+    return sa->first < sb->first ? -1 : sa->first > sb->first;
+}
+
+ofl_err
+flow_table_bulk_add(struct flow_table *table, struct ofl_msg_flow_mod **mods,
+                    size_t mods_num, bool *kept) {
+    struct bulk_slot *slots, **fresh;
+    size_t slots_num = 0, fresh_num = 0;
+    struct flow_entry *entry;
+    struct hmap index;
+    struct list *pos;
+    size_t i;
+
+    /* Index the entries of the table by match. */
+    slots = xmalloc(sizeof(struct bulk_slot) * (table->stats->active_count + mods_num));
+    hmap_init(&index);
+    LIST_FOR_EACH (entry, struct flow_entry, match_node, &table->match_entries) {
+        struct bulk_slot *s = &slots[slots_num++];
+
+        s->entry = entry;
+        s->winner = SIZE_MAX;
+        s->created = NULL;
+        hmap_insert(&index, &s->node,
+                    flow_table_match_hash((struct ofl_match *)entry->stats->match,
+                                          entry->stats->priority));
+    }
+
+    /* Find which entry, or earlier flow mod, each flow mod replaces. */
+    for (i = 0; i < mods_num; i++) {
+        struct ofl_msg_flow_mod *mod = mods[i];
+        uint32_t hash = flow_table_match_hash((struct ofl_match *)mod->match, mod->priority);
+        struct bulk_slot *s, *found = NULL;
+
+        kept[i] = false;
+        HMAP_FOR_EACH_WITH_HASH (s, struct bulk_slot, node, hash, &index) {
+            if (s->winner != SIZE_MAX
+                ? (mods[s->winner]->priority == mod->priority &&
+                   match_std_strict((struct ofl_match *)mod->match,
+                                    (struct ofl_match *)mods[s->winner]->match))
+                : flow_entry_matches(s->entry, mod, true/*strict*/, false/*check_cookie*/)) {
+                found = s;
+                break;
+            }
+        }
+        if (found == NULL) {
+            found = &slots[slots_num++];
+            found->entry = NULL;
+            found->first = i;
+            found->created = NULL;
+            hmap_insert(&index, &found->node, hash);
+            fresh_num++;
+        }
+        found->winner = i;
+    }
+    hmap_destroy(&index);
+
+    if (table->stats->active_count + fresh_num > FLOW_TABLE_MAX_ENTRIES) {
+        free(slots);
+        return ofl_error(OFPET_FLOW_MOD_FAILED, OFPFMFC_TABLE_FULL);
+    }
+
+    /* Replace entries in place; collect the new ones. */
+    fresh = xmalloc(sizeof(struct bulk_slot *) * (fresh_num + 1));
+    fresh_num = 0;
+    for (i = 0; i < slots_num; i++) {
+        struct bulk_slot *s = &slots[i];
+
+        if (s->winner == SIZE_MAX) {
+            continue;
+        }
+        s->created = flow_entry_create(table->dp, table, mods[s->winner]);
+        kept[s->winner] = true;
+
+        if (s->entry != NULL) {
+            /* NOTE: no flow removed message should be generated according to spec. */
+            flow_table_cursors_skip(table, s->entry, s->created);
+            flow_table_uncount_entry(table, s->entry);
+            flow_table_summary_remove(table, s->entry);
+            summary_add(table, s->created);
+            list_replace(&s->created->match_node, &s->entry->match_node);
+            list_remove(&s->entry->hard_node);
+            list_remove(&s->entry->idle_node);
+            flow_entry_destroy(s->entry);
+            add_to_timeout_lists(table, s->created);
+        } else {
+            fresh[fresh_num++] = s;
+        }
+    }
+
+    /* Merge the new entries in a single pass; they are placed behind those
+     * with equal priority, in the order of their flow mods. */
+    qsort(fresh, fresh_num, sizeof(struct bulk_slot *), bulk_slot_compare);
+    pos = table->match_entries.next;
+    for (i = 0; i < fresh_num; i++) {
+        struct flow_entry *new_entry = fresh[i]->created;
+
+        while (pos != &table->match_entries &&
+               CONTAINER_OF(pos, struct flow_entry, match_node)->stats->priority
+                                            >= new_entry->stats->priority) {
+            pos = pos->next;
+        }
+        list_insert(pos, &new_entry->match_node);
+        summary_add(table, new_entry);
+        add_to_timeout_lists(table, new_entry);
+    }
+    table->stats->active_count += fresh_num;
+
+    free(fresh);
+    free(slots);
+    return 0;
+}
+
+
 struct flow_entry *
 flow_table_lookup(struct flow_table *table, struct packet *pkt) {
+    struct dp_counters *c = &table->dp->counters;
     struct flow_entry *entry;
+    uint64_t fields;
 
-    table->stats->lookup_count++;
+    dp_counter(c, table->counters + FLOW_TABLE_LOOKUPS)->packets++;
+
+    /* Packets lacking a field all the entries require match none of them,
+     * nor do those which cannot be parsed. */
+    if (table->summary.entries_num == 0) {
+        return NULL;
+    }
+    fields = packet_handle_std_fields(pkt->handle_std);
+    if ((table->summary.required & ~fields) != 0) {
+        return NULL;
+    }
 
     LIST_FOR_EACH(entry, struct flow_entry, match_node, &table->match_entries) {
         struct ofl_match_header *m;
 
+        if ((entry->fields & ~fields) != 0) {
+            /* The packet lacks a field the entry requires. */
+            continue;
+        }
+
         m = entry->match == NULL ? entry->stats->match : entry->match;
 
         /* select appropriate handler, based on match type of flow entry. */
@@ -218,13 +423,20 @@ flow_table_lookup(struct flow_table *table, struct packet *pkt) {
             case (OFPMT_OXM): {
                if (packet_handle_std_match(pkt->handle_std,
                                             (struct ofl_match *)m)) {
-                    if (!entry->no_byt_count)                                            
-                        entry->stats->byte_count += pkt->buffer->size;
-                    if (!entry->no_pkt_count)
-                        entry->stats->packet_count++;
+                    struct dp_counter *sum = dp_counter(c, table->counters + FLOW_TABLE_ENTRIES);
+                    struct dp_counter *counter = dp_counter(c, entry->counter);
+
+                    if (!entry->no_byt_count) {
+                        counter->bytes += pkt->buffer->size;
+                        sum->bytes += pkt->buffer->size;
+                    }
+                    if (!entry->no_pkt_count) {
+                        counter->packets++;
+                        sum->packets++;
+                    }
                     entry->last_used = time_msec();
 
-                    table->stats->matched_count++;
+                    dp_counter(c, table->counters + FLOW_TABLE_MATCHES)->packets++;
 
                     return entry;
                 }
@@ -385,6 +597,9 @@ flow_table_create(struct datapath *dp, uint8_t table_id) {
     table->stats->active_count  = 0;
     table->stats->lookup_count  = 0;
     table->stats->matched_count = 0;
+    table->packet_count = 0;
+    table->byte_count   = 0;
+    table->counters = dp_counters_alloc(&dp->counters, FLOW_TABLE_N_COUNTERS);
 
     /* Init Table features */
     table->features = xmalloc(sizeof(struct ofl_table_features));
@@ -399,6 +614,8 @@ flow_table_create(struct datapath *dp, uint8_t table_id) {
     list_init(&table->match_entries);
     list_init(&table->hard_entries);
     list_init(&table->idle_entries);
+    list_init(&table->cursors);
+    memset(&table->summary, 0x00, sizeof(struct flow_table_summary));
 
     return table;
 }
@@ -410,22 +627,82 @@ flow_table_destroy(struct flow_table *table) {
     LIST_FOR_EACH_SAFE (entry, next, struct flow_entry, match_node, &table->match_entries) {
         flow_entry_destroy(entry);
     }
+    dp_counters_free(&table->dp->counters, table->counters, FLOW_TABLE_N_COUNTERS);
     free(table->features);
     free(table->stats);
     free(table);
 }
 
 void
-flow_table_stats(struct flow_table *table, struct ofl_msg_multipart_request_flow *msg,
+flow_table_update(struct flow_table *table) {
+    struct dp_counters *c = &table->dp->counters;
+
+    table->stats->lookup_count  += dp_counter(c, table->counters + FLOW_TABLE_LOOKUPS)->packets;
+    table->stats->matched_count += dp_counter(c, table->counters + FLOW_TABLE_MATCHES)->packets;
+    dp_counter(c, table->counters + FLOW_TABLE_LOOKUPS)->packets = 0;
+    dp_counter(c, table->counters + FLOW_TABLE_MATCHES)->packets = 0;
+    dp_counter_fold(c, table->counters + FLOW_TABLE_ENTRIES,
+                    &table->packet_count, &table->byte_count);
+}
+
+void
+flow_table_uncount_entry(struct flow_table *table, struct flow_entry *entry) {
+    /* Both sides are folded, for the sums to take the counter of the entry
+     * away. */
+    flow_table_update(table);
+    flow_entry_update(entry);
+    if (!entry->no_pkt_count) {
+        table->packet_count -= entry->stats->packet_count;
+    }
+    if (!entry->no_byt_count) {
+        table->byte_count -= entry->stats->byte_count;
+    }
+}
+
+void
+flow_table_cursor_open(struct flow_table *table, struct flow_table_cursor *cursor) {
+    cursor->entry = list_is_empty(&table->match_entries) ? NULL :
+                    CONTAINER_OF(list_front(&table->match_entries), struct flow_entry, match_node);
+    list_push_back(&table->cursors, &cursor->node);
+}
+
+void
+flow_table_cursor_close(struct flow_table_cursor *cursor) {
+    list_remove(&cursor->node);
+}
+
+void
+flow_table_cursors_skip(struct flow_table *table, struct flow_entry *entry,
+                        struct flow_entry *replacement) {
+    struct flow_table_cursor *cursor;
+
+    if (replacement == NULL && entry->match_node.next != &table->match_entries) {
+        replacement = CONTAINER_OF(entry->match_node.next, struct flow_entry, match_node);
+    }
+    LIST_FOR_EACH (cursor, struct flow_table_cursor, node, &table->cursors) {
+        if (cursor->entry == entry) {
+            cursor->entry = replacement;
+        }
+    }
+}
+
+bool
+flow_table_stats(struct flow_table *table, struct flow_table_cursor *cursor,
+                 struct ofl_msg_multipart_request_flow *msg, size_t max_len, size_t *len,
                  struct ofl_flow_stats ***stats, size_t *stats_size, size_t *stats_num) {
-    struct flow_entry *entry;
+    struct flow_entry *entry = cursor->entry;
 
-    LIST_FOR_EACH(entry, struct flow_entry, match_node, &table->match_entries) {
+    while (entry != NULL) {
         if ((msg->out_port == OFPP_ANY || flow_entry_has_out_port(entry, msg->out_port)) &&
             (msg->out_group == OFPG_ANY || flow_entry_has_out_group(entry, msg->out_group)) &&
             match_std_nonstrict((struct ofl_match *)msg->match,
                                 (struct ofl_match *)entry->stats->match)) {
+            size_t entry_len = ofl_structs_flow_stats_ofp_len(entry->stats, table->dp->exp);
 
+            /* A part holds at least one entry, whatever its length. */
+            if (*stats_num > 0 && *len + entry_len > max_len) {
+                break;
+            }
             flow_entry_update(entry);
             if ((*stats_size) == (*stats_num)) {
                 (*stats) = xrealloc(*stats, (sizeof(struct ofl_flow_stats *)) * (*stats_size) * 2);
@@ -433,8 +710,13 @@ flow_table_stats(struct flow_table *table, struct ofl_msg_multipart_request_flow
             }
             (*stats)[(*stats_num)] = entry->stats;
             (*stats_num)++;
+            *len += entry_len;
         }
+        entry = entry->match_node.next == &table->match_entries ? NULL :
+                CONTAINER_OF(entry->match_node.next, struct flow_entry, match_node);
     }
+    cursor->entry = entry;
+    return entry == NULL;
 }
 
 void
@@ -442,17 +724,30 @@ flow_table_aggregate_stats(struct flow_table *table, struct ofl_msg_multipart_re
                            uint64_t *packet_count, uint64_t *byte_count, uint32_t *flow_count) {
     struct flow_entry *entry;
 
+    if (msg->out_port == OFPP_ANY && msg->out_group == OFPG_ANY &&
+        msg->cookie_mask == 0 && msg->match->length == 0) {
+        /* Nothing is filtered out: the table keeps the sums up to date. */
+        flow_table_update(table);
+        (*packet_count) += table->packet_count;
+        (*byte_count)   += table->byte_count;
+        (*flow_count)   += table->stats->active_count;
+        return;
+    }
+
     LIST_FOR_EACH(entry, struct flow_entry, match_node, &table->match_entries) {
         if ((msg->out_port == OFPP_ANY || flow_entry_has_out_port(entry, msg->out_port)) &&
-            (msg->out_group == OFPG_ANY || flow_entry_has_out_group(entry, msg->out_group))) {
-			
-			if (!entry->no_pkt_count)
-            	(*packet_count) += entry->stats->packet_count;
-			if (!entry->no_byt_count)            
-				(*byte_count)   += entry->stats->byte_count;
+            (msg->out_group == OFPG_ANY || flow_entry_has_out_group(entry, msg->out_group)) &&
+            (entry->stats->cookie & msg->cookie_mask) == (msg->cookie & msg->cookie_mask) &&
+            match_std_nonstrict((struct ofl_match *)msg->match,
+                                (struct ofl_match *)entry->stats->match)) {
+
+            flow_entry_update(entry);
+            if (!entry->no_pkt_count)
+                (*packet_count) += entry->stats->packet_count;
+            if (!entry->no_byt_count)
+                (*byte_count)   += entry->stats->byte_count;
             (*flow_count)++;
         }
     }
-
 }
 
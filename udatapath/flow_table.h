@@ -33,6 +33,15 @@
  ****************************************************************************/
 
 
+/* Summary of the matches of the entries of a table, kept up to date as
+ * entries come and go, for lookups to tell without going through the entries
+ * that a packet cannot match any of them. */
+struct flow_table_summary {
+    size_t     entries_num;
+    uint64_t   required;      /* fields all the entries require. */
+    uint32_t   refs[64];      /* entries requiring each field. */
+};
+
 struct flow_table {
     struct datapath           *dp;
     bool                       disabled;      /* Don't use that table. */
@@ -44,6 +53,30 @@ struct flow_table {
                                                 ordered by their timeout times. */
     struct list               idle_entries;   /* unordered list of entries with
                                                 idle timeout. */
+    struct list               cursors;        /* cursors of ongoing dumps. */
+    struct flow_table_summary summary;
+
+    uint64_t                   packet_count;  /* sum of the packet counters of
+                                                the entries which keep one. */
+    uint64_t                   byte_count;    /* sum of the byte counters of
+                                                the entries which keep one. */
+    uint32_t                   counters;      /* FLOW_TABLE_N_COUNTERS datapath
+                                                counters, not yet in the above. */
+};
+
+/* Counters of a flow table in the datapath counters. */
+enum flow_table_counter {
+    FLOW_TABLE_LOOKUPS,     /* Lookups, in packets. */
+    FLOW_TABLE_MATCHES,     /* Lookups that matched, in packets. */
+    FLOW_TABLE_ENTRIES,     /* Sum of the counters of the entries. */
+    FLOW_TABLE_N_COUNTERS
+};
+
+/* A position in the entries of a flow table, for dumps spanning several
+ * poll iterations. It stays valid as entries are removed from the table. */
+struct flow_table_cursor {
+    struct list        node;    /* In the table's cursors list. */
+    struct flow_entry *entry;   /* Next entry to visit, NULL at the end. */
 };
 
 extern uint32_t oxm_ids[];
@@ -57,6 +90,16 @@ extern struct ofl_action_header actions[];
 ofl_err
 flow_table_flow_mod(struct flow_table *table, struct ofl_msg_flow_mod *mod, bool *match_kept, bool *insts_kept);
 
+/* Applies a run of ADD flow mods, none of which checks for overlaps, with a
+ * single pass over the entries of the table. The result is the same as
+ * applying them one after the other, except that nothing is changed if the
+ * table would overflow. kept[i] is set when the match and instructions of
+ * mods[i] are taken over by the table; otherwise the mod was replaced by a
+ * later one of the run. */
+ofl_err
+flow_table_bulk_add(struct flow_table *table, struct ofl_msg_flow_mod **mods,
+                    size_t mods_num, bool *kept);
+
 /* Finds the flow entry with the highest priority, which matches the packet. */
 struct flow_entry *
 flow_table_lookup(struct flow_table *table, struct packet *pkt);
@@ -73,9 +116,40 @@ flow_table_create(struct datapath *dp, uint8_t table_id);
 void
 flow_table_destroy(struct flow_table *table);
 
-/* Collects statistics of the flow entries of the table. */
+/* Folds the counters of the table into its stats and sums. */
+void
+flow_table_update(struct flow_table *table);
+
+/* Takes the entry out of the summary of the table, as it leaves the table. */
+void
+flow_table_summary_remove(struct flow_table *table, struct flow_entry *entry);
+
+/* Takes the counters of the entry out of the aggregate counters of the
+ * table, as the entry leaves the table or has its counters reset. */
+void
+flow_table_uncount_entry(struct flow_table *table, struct flow_entry *entry);
+
+/* Places the cursor on the first entry of the table. */
+void
+flow_table_cursor_open(struct flow_table *table, struct flow_table_cursor *cursor);
+
+/* Releases the cursor from the table. */
+void
+flow_table_cursor_close(struct flow_table_cursor *cursor);
+
+/* Moves the cursors standing on the entry, which is leaving the table, to its
+ * replacement, or to the entry following it if replacement is NULL. */
 void
-flow_table_stats(struct flow_table *table, struct ofl_msg_multipart_request_flow *msg,
+flow_table_cursors_skip(struct flow_table *table, struct flow_entry *entry,
+                        struct flow_entry *replacement);
+
+/* Collects statistics of the flow entries of the table from the cursor on,
+ * while their packed length, accumulated in *len, stays within max_len.
+ * Advances the cursor past the collected entries; returns true once it
+ * reaches the end of the table. */
+bool
+flow_table_stats(struct flow_table *table, struct flow_table_cursor *cursor,
+                 struct ofl_msg_multipart_request_flow *msg, size_t max_len, size_t *len,
                  struct ofl_flow_stats ***stats, size_t *stats_size, size_t *stats_num);
 
 /* Collects aggregate statistics of the flow entries of the table. */
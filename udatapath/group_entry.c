@@ -131,8 +131,8 @@ static void
 execute_all(struct group_entry *entry, struct packet *pkt) {
     size_t i;
 
-    /* TODO Zoltan: Currently packets are always cloned. However it should
-     * be possible to see if cloning is necessary, or not, based on bucket actions. */
+    /* Clones share the buffer of the packet; only the buckets whose actions
+     * modify the packet end up copying it. */
     for (i=0; i<entry->desc->buckets_num; i++) {
         struct ofl_bucket *bucket = entry->desc->buckets[i];
         struct packet *p = packet_clone(pkt);
@@ -21,6 +21,7 @@
 #include "datapath.h"
 #include "dp_actions.h"
 #include "dp_capabilities.h"
+#include "dp_latency.h"
 #include "hmap.h"
 #include "list.h"
 #include "packet.h"
@@ -299,6 +300,7 @@ group_table_handle_stats_request_group_features(struct group_table *table,
 void
 group_table_execute(struct group_table *table, struct packet *packet, uint32_t group_id) {
     struct group_entry *entry;
+    uint64_t start;
 
     entry = group_table_find(table, group_id);
 
@@ -307,7 +309,9 @@ group_table_execute(struct group_table *table, struct packet *packet, uint32_t g
         return;
     }
 
-   group_entry_execute(entry, packet);
+    start = dp_latency_start();
+    group_entry_execute(entry, packet);
+    dp_latency_end(OFPELS_GROUP, start);
 }
 
 struct group_table *
@@ -0,0 +1,680 @@
+/* 
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/HDDP).
+ * Copyright (c) 2020.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Simulates a network of HDDP switches in one process, to see how discovery
+ * scales with the size of the network.
+ *
+ * Usage: hddp-sim [OPTIONS]
+ *
+ * Builds a topology of datapaths whose ports are null ports linked to one
+ * another, and a stand-in controller linked to a port of the first one. In
+ * each discovery round the controller sends a DHT request there, which the
+ * datapaths flood and answer as they would on the wire, and takes in the
+ * replies that come back. Frames in flight wait in a single queue, so they
+ * cross the links in order of hops, one hop being the unit of simulated
+ * time, and a round ends when no frame is left in flight. The timers of the
+ * datapaths are not run: a round is over well before the tables expire.
+ *
+ * Prints a JSON object on a line of its own for the network, one for each
+ * round and one for the whole run. A round converges when the controller has
+ * learnt the last of the nodes and links it learns in it, which is reported
+ * both in hops and in seconds; messages are the frames sent over the links,
+ * and memory is the growth of the resident set of the process per node.
+ *
+ * The packet parser reads customnetpdl.xml from the current directory, so
+ * run it from the top of the tree. */
+
+#include <config.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "command-line.h"
+#include "datapath.h"
+#include "dp_hddp.h"
+#include "dp_ports.h"
+#include "dynamic-string.h"
+#include "list.h"
+#include "ofpbuf.h"
+#include "packet.h"
+#include "packets.h"
+#include "timeval.h"
+#include "util.h"
+#include "vlog.h"
+
+/* Headroom of the buffers dp_ports_run() receives into. */
+#define HEADROOM (256 + 2)
+
+static unsigned int n_nodes = 1000;
+static const char *topology = "random";
+static unsigned int degree = 4;
+static unsigned int n_rounds = 3;
+static const char *hddp_options;
+static unsigned int delta_full_every; /* 0 to send all the replies. */
+static unsigned int seed = 1;
+
+static void parse_options(int argc, char *argv[]);
+static void usage(void) NO_RETURN;
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Returns the resident set of the process, in bytes. */
+static uint64_t
+rss_bytes(void)
+{
+    unsigned long size, resident = 0;
+    FILE *file = fopen("/proc/self/statm", "r");
+
+    if (file != NULL) {
+        if (fscanf(file, "%lu %lu", &size, &resident) != 2) {
+            resident = 0;
+        }
+        fclose(file);
+    }
+    return (uint64_t) resident * sysconf(_SC_PAGESIZE);
+}
+
+/* The network. */
+
+/* Stands for the controller in place of a node. */
+#define CONTROLLER UINT_MAX
+
+/* A link between two ports; link 0 joins the controller to node 0. */
+struct link {
+    unsigned int nodes[2];
+    struct sw_port *ports[2];   /* Null for the controller. */
+    unsigned int learnt;        /* Last round the controller learnt it in. */
+};
+
+/* A datapath and the link of each of its ports. */
+struct node {
+    struct datapath *dp;
+    struct link **links;        /* Indexed by port number. */
+    size_t allocated;
+    unsigned int learnt;        /* Last round the controller learnt it in. */
+};
+
+/* A frame on its way to 'port', after crossing 'hops' links. */
+struct frame {
+    struct list node;
+    struct sw_port *port;
+    struct ofpbuf *buffer;
+    unsigned int hops;
+};
+
+static struct node *nodes;
+static struct link *links;
+static size_t n_links;
+
+/* Frames in flight, in the order they were sent. */
+static struct list queue = LIST_INITIALIZER(&queue);
+
+/* The round being run. */
+struct round {
+    uint32_t seq;
+    uint64_t start;             /* In ns. */
+    unsigned int hops;          /* Of the frame being received. */
+    unsigned int max_hops;
+    uint64_t frames;            /* Sent over the links. */
+    unsigned long replies;      /* Received by the controller. */
+    unsigned int nodes_learnt;
+    unsigned int links_learnt;
+    unsigned int converged_hops;
+    uint64_t converged_ns;
+};
+
+static struct round round;
+
+static const uint8_t controller_mac[ETH_ADDR_LEN] = {0x02, 0xc0, 0x00, 0x00, 0x00, 0x01};
+
+/* Returns the MAC address of port 'port_no' of node 'i'. The last four bytes
+ * tell the node, so they are the same for all its ports. */
+static void
+node_mac(unsigned int i, uint32_t port_no, uint8_t mac[ETH_ADDR_LEN])
+{
+    mac[0] = 0x02;
+    mac[1] = port_no;
+    mac[2] = i >> 24;
+    mac[3] = i >> 16;
+    mac[4] = i >> 8;
+    mac[5] = i;
+}
+
+/* The stand-in controller. */
+
+/* Notes that the controller learnt something that it did not know in this
+ * round, at the current hop. */
+static void
+learnt(unsigned int *round_learnt, unsigned int *count)
+{
+    if (*round_learnt != round.seq) {
+        *round_learnt = round.seq;
+        (*count)++;
+        round.converged_hops = round.hops + 1;
+        round.converged_ns = now_ns() - round.start;
+    }
+}
+
+/* Returns the node a device of a reply stands for, or CONTROLLER if it is none
+ * of the network. */
+static unsigned int
+reply_node(const struct dht_header *dht, unsigned int k)
+{
+    uint64_t mac = bigtolittle64(dht->macs[k]);
+    unsigned int i = mac & 0xffffffff;
+
+    return (mac >> 40) == 0x02 && i < n_nodes ? i : CONTROLLER;
+}
+
+/* Returns the link of port 'port_no' of node 'i', if any. */
+static struct link *
+node_link(unsigned int i, uint32_t port_no)
+{
+    if (i == CONTROLLER || port_no >= nodes[i].allocated) {
+        return NULL;
+    }
+    return nodes[i].links[port_no];
+}
+
+/* Takes in a reply: its devices are the path from the node that sent it to
+ * node 0, each with the port it got the reply on and the one it sent it on,
+ * so each device and the next one are joined by a link. */
+static void
+controller_receive(const struct ofpbuf *buffer)
+{
+    const struct eth_header *eth = buffer->data;
+    const struct dht_header *dht = (const struct dht_header *) (eth + 1);
+    unsigned int k, n;
+
+    if (buffer->size < ETH_HEADER_LEN + sizeof *dht
+        || eth->eth_type != htons(ETH_TYPE_DHT) || ntohs(dht->opcode) != 2
+        || ntohl(dht->seq) != round.seq) {
+        return;
+    }
+    round.replies++;
+
+    n = MIN(ntohs(dht->num_devices), DHT_MAX_ELEMENTS);
+    for (k = 0; k < n; k++) {
+        unsigned int i = reply_node(dht, k);
+        struct link *link;
+
+        if (i == CONTROLLER) {
+            continue;
+        }
+        learnt(&nodes[i].learnt, &round.nodes_learnt);
+
+        link = node_link(i, ntohl(dht->out_ports[k]));
+        if (link == NULL) {
+            continue;
+        }
+        if (k + 1 < n) {
+            unsigned int j = reply_node(dht, k + 1);
+
+            if (link != node_link(j, ntohl(dht->in_ports[k + 1]))) {
+                continue;
+            }
+        } else if (link != &links[0]) {
+            continue;
+        }
+        learnt(&link->learnt, &round.links_learnt);
+    }
+}
+
+/* Links. */
+
+/* Sends what is output to a port over its link: to the controller, or into
+ * the queue of frames in flight to the port at the other end. */
+static void
+link_send(struct sw_port *port, const struct ofpbuf *buffer, void *link_)
+{
+    struct link *link = link_;
+    struct sw_port *peer = link->ports[link->ports[0] == port ? 1 : 0];
+    struct frame *frame;
+
+    round.frames++;
+    if (peer == NULL) {
+        controller_receive(buffer);
+        return;
+    }
+    frame = xmalloc(sizeof *frame);
+    frame->port = peer;
+    frame->buffer = ofpbuf_clone_with_headroom(buffer, HEADROOM);
+    frame->hops = round.hops + 1;
+    list_push_back(&queue, &frame->node);
+}
+
+/* Adds a null port to node 'i' and joins it to 'link', at its end 'end'. */
+static void
+link_attach(struct link *link, int end, unsigned int i)
+{
+    struct node *node = &nodes[i];
+    uint32_t port_no = node->dp->ports_num + 1;
+    uint8_t mac[ETH_ADDR_LEN];
+    char name[32];
+    int retval;
+
+    node_mac(i, port_no, mac);
+    snprintf(name, sizeof name, "sim%u-%"PRIu32, i, port_no);
+    retval = dp_ports_add_null(node->dp, name, mac);
+    if (retval || !PORT_IN_USE(&node->dp->ports[port_no])) {
+        ofp_fatal(retval, "adding port %"PRIu32" to node %u", port_no, i);
+    }
+    while (port_no >= node->allocated) {
+        node->links = x2nrealloc(node->links, &node->allocated,
+                                 sizeof *node->links);
+    }
+    node->links[port_no] = link;
+
+    link->nodes[end] = i;
+    link->ports[end] = &node->dp->ports[port_no];
+    dp_ports_set_link(link->ports[end], link_send, link);
+}
+
+/* Topologies, as pairs of nodes to link. */
+
+struct edges {
+    unsigned int (*pairs)[2];
+    size_t n, allocated;
+    unsigned int *degrees;
+};
+
+static void
+edge_add(struct edges *e, unsigned int a, unsigned int b)
+{
+    /* Node 0 has a port more, for the controller. */
+    if (a == b || e->degrees[a] + !a >= DP_MAX_PORTS - 1
+        || e->degrees[b] + !b >= DP_MAX_PORTS - 1) {
+        return;
+    }
+    if (e->n >= e->allocated) {
+        e->pairs = x2nrealloc(e->pairs, &e->allocated, sizeof *e->pairs);
+    }
+    e->pairs[e->n][0] = a;
+    e->pairs[e->n][1] = b;
+    e->n++;
+    e->degrees[a]++;
+    e->degrees[b]++;
+}
+
+static void
+make_line(struct edges *e)
+{
+    unsigned int i;
+
+    for (i = 1; i < n_nodes; i++) {
+        edge_add(e, i - 1, i);
+    }
+}
+
+static void
+make_ring(struct edges *e)
+{
+    make_line(e);
+    if (n_nodes > 2) {
+        edge_add(e, n_nodes - 1, 0);
+    }
+}
+
+/* A binary tree, with the controller at its root. */
+static void
+make_tree(struct edges *e)
+{
+    unsigned int i;
+
+    for (i = 1; i < n_nodes; i++) {
+        edge_add(e, (i - 1) / 2, i);
+    }
+}
+
+/* A square grid, row by row; the last row may be short. */
+static void
+make_grid(struct edges *e)
+{
+    unsigned int width = 1, i;
+
+    while (width * width < n_nodes) {
+        width++;
+    }
+    for (i = 0; i < n_nodes; i++) {
+        if (i % width + 1 < width && i + 1 < n_nodes) {
+            edge_add(e, i, i + 1);
+        }
+        if (i + width < n_nodes) {
+            edge_add(e, i, i + width);
+        }
+    }
+}
+
+/* A random tree, to keep the network connected, with random links added on
+ * top of it until the average degree of the nodes is 'degree'. */
+static void
+make_random(struct edges *e)
+{
+    size_t target = (size_t) n_nodes * degree / 2;
+    size_t tries;
+    unsigned int i;
+
+    for (i = 1; i < n_nodes; i++) {
+        edge_add(e, random() % i, i);
+    }
+    for (tries = 0; e->n < target && tries < 4 * target; tries++) {
+        edge_add(e, random() % n_nodes, random() % n_nodes);
+    }
+}
+
+struct topology_class {
+    const char *name;
+    void (*make)(struct edges *);
+};
+
+static const struct topology_class topologies[] = {
+    {"line", make_line},
+    {"ring", make_ring},
+    {"tree", make_tree},
+    {"grid", make_grid},
+    {"random", make_random},
+};
+
+#define N_TOPOLOGIES (sizeof topologies / sizeof *topologies)
+
+/* Creates the datapaths and links them as 'make' says. */
+static void
+build(void (*make)(struct edges *))
+{
+    struct edges e;
+    unsigned int i;
+    size_t j;
+
+    memset(&e, 0x00, sizeof e);
+    e.degrees = xcalloc(n_nodes, sizeof *e.degrees);
+    srandom(seed);
+    make(&e);
+
+    nodes = xcalloc(n_nodes, sizeof *nodes);
+    for (i = 0; i < n_nodes; i++) {
+        nodes[i].dp = dp_new();
+        dp_set_dpid(nodes[i].dp, i + 1);
+        if (hddp_options != NULL) {
+            char *error = dp_hddp_configure(nodes[i].dp, hddp_options);
+
+            if (error != NULL) {
+                ofp_fatal(0, "%s", error);
+            }
+        }
+        if (delta_full_every) {
+            nodes[i].dp->hddp_delta.enabled = true;
+            nodes[i].dp->hddp_delta.full_every = delta_full_every;
+        }
+    }
+
+    n_links = e.n + 1;
+    links = xcalloc(n_links, sizeof *links);
+    links[0].nodes[0] = CONTROLLER;
+    link_attach(&links[0], 1, 0);
+    for (j = 0; j < e.n; j++) {
+        link_attach(&links[j + 1], 0, e.pairs[j][0]);
+        link_attach(&links[j + 1], 1, e.pairs[j][1]);
+    }
+
+    free(e.pairs);
+    free(e.degrees);
+}
+
+/* Discovery. */
+
+/* Returns a DHT request of the controller for round 'seq'. */
+static struct ofpbuf *
+make_request(uint32_t seq)
+{
+    size_t size = ETH_HEADER_LEN + sizeof(struct dht_header);
+    struct ofpbuf *buf = ofpbuf_new_with_headroom(size, HEADROOM);
+    struct eth_header *eth = ofpbuf_put_zeros(buf, size);
+    struct dht_header *dht = (struct dht_header *) (eth + 1);
+
+    memcpy(eth->eth_dst, eth_addr_broadcast, ETH_ADDR_LEN);
+    memcpy(eth->eth_src, controller_mac, ETH_ADDR_LEN);
+    eth->eth_type = htons(ETH_TYPE_DHT);
+    dht->opcode = htons(1);
+    dht->seq = htonl(seq);
+    return buf;
+}
+
+/* Adds up the counters of the replies the nodes could not send. */
+static void
+sum_reply_losses(uint64_t *dropped, uint64_t *overflow)
+{
+    unsigned int i;
+
+    *dropped = *overflow = 0;
+    for (i = 0; i < n_nodes; i++) {
+        *dropped += nodes[i].dp->hddp_stats.replies_dropped;
+        *overflow += nodes[i].dp->hddp_stats.replies_overflow;
+    }
+}
+
+/* Runs discovery round 'seq' to its end and reports it. Adds the frames sent
+ * to '*frames' and the time taken to converge, in ns, to '*converged_ns'. */
+static void
+run_round(uint32_t seq, uint64_t *frames, uint64_t *converged_ns)
+{
+    uint64_t dropped, overflow, dropped_end, overflow_end;
+    uint64_t elapsed;
+    unsigned int i;
+
+    sum_reply_losses(&dropped, &overflow);
+    memset(&round, 0x00, sizeof round);
+    round.seq = seq;
+    round.start = now_ns();
+
+    /* The request comes in to node 0 over link 0. */
+    dp_ports_receive(links[0].ports[1], make_request(seq));
+    round.frames++;
+    while (!list_is_empty(&queue)) {
+        struct frame *frame = CONTAINER_OF(list_pop_front(&queue),
+                                           struct frame, node);
+
+        round.hops = frame->hops;
+        round.max_hops = MAX(round.max_hops, frame->hops);
+        dp_ports_receive(frame->port, frame->buffer);
+        free(frame);
+    }
+    elapsed = now_ns() - round.start;
+
+    /* The trace is for a switch of its own, and it is never flushed here. */
+    for (i = 0; i < n_nodes; i++) {
+        ds_clear(&nodes[i].dp->hddp_trace);
+    }
+    sum_reply_losses(&dropped_end, &overflow_end);
+
+    printf("{\"round\":%"PRIu32",\"seconds\":%.6f,\"hops\":%u,"
+           "\"converged_hops\":%u,\"converged_seconds\":%.6f,"
+           "\"frames\":%"PRIu64",\"frames_per_node\":%.2f,\"replies\":%lu,"
+           "\"nodes_learnt\":%u,\"links_learnt\":%u,"
+           "\"replies_dropped\":%"PRIu64",\"replies_overflow\":%"PRIu64"}\n",
+           seq, elapsed / 1e9, round.max_hops, round.converged_hops,
+           round.converged_ns / 1e9, round.frames,
+           (double) round.frames / n_nodes, round.replies,
+           round.nodes_learnt, round.links_learnt,
+           dropped_end - dropped, overflow_end - overflow);
+    fflush(stdout);
+
+    *frames += round.frames;
+    *converged_ns += round.converged_ns;
+}
+
+int
+main(int argc, char *argv[])
+{
+    const struct topology_class *t = NULL;
+    uint64_t rss_start, rss_built, start, build_ns;
+    uint64_t frames = 0, converged_ns = 0;
+    uint32_t seq;
+    size_t i;
+
+    set_program_name(argv[0]);
+    time_init();
+    vlog_init();
+    vlog_set_levels(VLM_ANY_MODULE, VLF_ANY_FACILITY, VLL_WARN);
+    parse_options(argc, argv);
+
+    for (i = 0; i < N_TOPOLOGIES; i++) {
+        if (!strcmp(topology, topologies[i].name)) {
+            t = &topologies[i];
+            break;
+        }
+    }
+    if (t == NULL) {
+        ofp_fatal(0, "unknown topology \"%s\" (use --help for help)",
+                  topology);
+    }
+
+    rss_start = rss_bytes();
+    start = now_ns();
+    build(t->make);
+    build_ns = now_ns() - start;
+    rss_built = rss_bytes();
+
+    printf("{\"topology\":\"%s\",\"nodes\":%u,\"links\":%zu,"
+           "\"build_seconds\":%.6f,\"datapath_bytes\":%zu,"
+           "\"memory_per_node\":%.0f}\n",
+           t->name, n_nodes, n_links - 1, build_ns / 1e9,
+           sizeof(struct datapath),
+           (double) (rss_built - rss_start) / n_nodes);
+    fflush(stdout);
+
+    for (seq = 1; seq <= n_rounds; seq++) {
+        run_round(seq, &frames, &converged_ns);
+    }
+
+    printf("{\"rounds\":%u,\"converged_seconds\":%.6f,"
+           "\"frames_per_node\":%.2f,\"memory_per_node\":%.0f}\n",
+           n_rounds, n_rounds ? converged_ns / 1e9 / n_rounds : 0,
+           n_rounds ? (double) frames / n_rounds / n_nodes : 0,
+           (double) (rss_bytes() - rss_start) / n_nodes);
+    return 0;
+}
+
+static void
+parse_options(int argc, char *argv[])
+{
+    static struct option long_options[] = {
+        {"nodes",    required_argument, 0, 'n'},
+        {"topology", required_argument, 0, 't'},
+        {"degree",   required_argument, 0, 'd'},
+        {"rounds",   required_argument, 0, 'r'},
+        {"hddp",     required_argument, 0, 'o'},
+        {"delta",    required_argument, 0, 'D'},
+        {"seed",     required_argument, 0, 's'},
+        {"help",     no_argument, 0, 'h'},
+        {0, 0, 0, 0},
+    };
+    char *short_options = long_options_to_short_options(long_options);
+
+    for (;;) {
+        int indexptr;
+        int c;
+
+        c = getopt_long(argc, argv, short_options, long_options, &indexptr);
+        if (c == -1) {
+            break;
+        }
+
+        switch (c) {
+        case 'n':
+            n_nodes = atoi(optarg);
+            if (n_nodes < 1) {
+                ofp_fatal(0, "argument to -n or --nodes must be at least 1");
+            }
+            break;
+
+        case 't':
+            topology = optarg;
+            break;
+
+        case 'd':
+            degree = atoi(optarg);
+            if (degree < 2 || degree >= DP_MAX_PORTS - 1) {
+                ofp_fatal(0, "argument to -d or --degree must be between 2 "
+                          "and %d", DP_MAX_PORTS - 2);
+            }
+            break;
+
+        case 'r':
+            n_rounds = atoi(optarg);
+            break;
+
+        case 'o':
+            hddp_options = optarg;
+            break;
+
+        case 'D':
+            delta_full_every = atoi(optarg);
+            if (delta_full_every < 1) {
+                ofp_fatal(0, "argument to -D or --delta must be at least 1");
+            }
+            break;
+
+        case 's':
+            seed = atoi(optarg);
+            break;
+
+        case 'h':
+            usage();
+
+        case '?':
+            exit(EXIT_FAILURE);
+
+        default:
+            abort();
+        }
+    }
+    free(short_options);
+}
+
+static void
+usage(void)
+{
+    printf("%s: in-process HDDP network simulator\n"
+           "usage: %s [OPTIONS]\n"
+           "\nOptions:\n"
+           "  -n, --nodes=N           datapaths in the network (default: %u)\n"
+           "  -t, --topology=NAME     line, ring, tree, grid or random "
+           "(default: %s)\n"
+           "  -d, --degree=N          average degree of random (default: %u)\n"
+           "  -r, --rounds=N          discovery rounds (default: %u)\n"
+           "  -o, --hddp=OPTIONS      HDDP options of all the datapaths, as\n"
+           "                          for ofdatapath --hddp\n"
+           "  -D, --delta=N           only send the replies that changed,\n"
+           "                          all of them every N rounds\n"
+           "  -s, --seed=N            seed of random (default: %u)\n"
+           "  -h, --help              display this help message\n",
+           program_name, program_name, n_nodes, topology, degree, n_rounds,
+           seed);
+    exit(EXIT_SUCCESS);
+}
@@ -165,7 +165,7 @@ packet_match(struct ofl_match *flow_match, struct ofl_match *packet){
     }
 
     /* Loop over the flow entry's match fields */
-    HMAP_FOR_EACH(f, struct ofl_match_tlv, hmap_node, &flow_match->match_fields)
+    OFL_MATCH_FOR_EACH(f, flow_match)
     {
         /* Check presence of match field in packet */
         has_mask = OXM_HASMASK(f->header);
@@ -320,6 +320,22 @@ packet_match(struct ofl_match *flow_match, struct ofl_match *packet){
     return true;
 }
 
+uint64_t
+match_std_fields(struct ofl_match *flow_match) {
+    struct ofl_match_tlv *f;
+    uint64_t fields = 0;
+
+    OFL_MATCH_FOR_EACH(f, flow_match) {
+        if (f->header == OXM_OF_VLAN_VID &&
+            *((uint16_t *) f->value) == OFPVID_NONE) {
+            /* Matches packets without a VLAN tag. */
+            continue;
+        }
+        fields |= match_std_field_bit(f->header);
+    }
+    return fields;
+}
+
 
 static inline bool
 strict_mask8(uint8_t *a, uint8_t *b, uint8_t *am, uint8_t *bm) {
@@ -408,7 +424,7 @@ match_std_strict(struct ofl_match *a, struct ofl_match *b) {
         return false;
 
     /* Loop through the flow_mod match fields */
-    HMAP_FOR_EACH(flow_mod_match, struct ofl_match_tlv, hmap_node, &a->match_fields)
+    OFL_MATCH_FOR_EACH(flow_mod_match, a)
     {
         /* Check presence of match field in flow entry */
         flow_entry_match = oxm_match_lookup(flow_mod_match->header, b);
@@ -621,7 +637,7 @@ match_std_nonstrict(struct ofl_match *a, struct ofl_match *b)
         return true;
 
     /* Loop through the match fields in flow entry a */
-    HMAP_FOR_EACH(flow_mod_match, struct ofl_match_tlv, hmap_node, &a->match_fields)
+    OFL_MATCH_FOR_EACH(flow_mod_match, a)
     {
         /* Check presence of match field in flow entry */
         flow_entry_match = oxm_match_lookup(flow_mod_match->header, b);
@@ -794,7 +810,7 @@ match_std_overlap(struct ofl_match *a, struct ofl_match *b)
     uint8_t *val_b, *mask_b;
 
     /* Loop through the match fields in flow entry a */
-    HMAP_FOR_EACH(f_a, struct ofl_match_tlv, hmap_node, &a->match_fields)
+    OFL_MATCH_FOR_EACH(f_a, a)
     {
         field_len = OXM_LENGTH(f_a->header);
         val_a = f_a->value;
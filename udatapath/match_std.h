@@ -19,7 +19,9 @@
 #define MATCH_EXT_H 1
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "oflib/ofl-structs.h"
+#include "oflib/oxm-match.h"
 
 /****************************************************************************
  * Functions for comparing two extended match structures.
@@ -39,6 +41,21 @@ match_std_strict(struct ofl_match *a, struct ofl_match *b);
 bool
 match_std_nonstrict(struct ofl_match *a, struct ofl_match *b);
 
+/* Returns the bit of the given OXM field in a set of fields. Fields of other
+ * classes than the OpenFlow basic one share the last bit. */
+static inline uint64_t
+match_std_field_bit(uint32_t header) {
+    uint32_t field = OXM_FIELD(header);
+
+    return OXM_VENDOR(header) == OFPXMC_OPENFLOW_BASIC && field < 63
+           ? (uint64_t) 1 << field : (uint64_t) 1 << 63;
+}
+
+/* Returns the set of fields a packet must have for the flow match to match
+ * it: a packet lacking any of them is not matched by packet_match(). */
+uint64_t
+match_std_fields(struct ofl_match *flow_match);
+
 
 
 #endif /* MATCH_STD_H */
@@ -210,6 +210,7 @@ meter_entry_apply(struct meter_entry *entry, struct packet **pkt){
                 break;
             }
             case OFPMBT_DSCP_REMARK:{
+            	packet_make_writable(*pkt);
             	packet_handle_std_validate((*pkt)->handle_std);
     		if ((*pkt)->handle_std->valid)
     		{
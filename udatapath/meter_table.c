@@ -20,6 +20,7 @@
 #include "meter_table.h"
 #include "datapath.h"
 #include "dp_actions.h"
+#include "dp_latency.h"
 #include "hmap.h"
 #include "list.h"
 #include "packet.h"
@@ -84,6 +85,7 @@ meter_table_find(struct meter_table *table, uint32_t meter_id) {
 void
 meter_table_apply(struct meter_table *table, struct packet **packet, uint32_t meter_id) {
     struct meter_entry *entry;
+    uint64_t start;
 
     entry = meter_table_find(table, meter_id);
 
@@ -92,7 +94,9 @@ meter_table_apply(struct meter_table *table, struct packet **packet, uint32_t me
         return;
     }
 
+   start = dp_latency_start();
    meter_entry_apply(entry, packet);
+   dp_latency_end(OFPELS_METER, start);
 }
 
 
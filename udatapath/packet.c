@@ -22,6 +22,7 @@
 #include "datapath.h"
 #include "dp_buffers.h"
 #include "dp_actions.h"
+#include "dp_latency.h"
 #include "packet.h"
 #include "packets.h"
 #include "action_set.h"
@@ -35,11 +36,13 @@ struct packet *
 packet_create(struct datapath *dp, uint32_t in_port,
     struct ofpbuf *buf, bool packet_out) {
     struct packet *pkt;
+    uint64_t start;
 
     pkt = xmalloc(sizeof(struct packet));
 
     pkt->dp         = dp;
     pkt->buffer     = buf;
+    pkt->buffer_refs = NULL;
     pkt->in_port    = in_port;
     pkt->action_set = action_set_create(dp->exp);
 
@@ -51,7 +54,9 @@ packet_create(struct datapath *dp, uint32_t in_port,
     pkt->buffer_id        = NO_BUFFER;
     pkt->table_id         = 0;
 
+    start = dp_latency_start();
     pkt->handle_std = packet_handle_std_create(pkt);
+    dp_latency_end(OFPELS_PARSE, start);
     return pkt;
 }
 
@@ -61,7 +66,14 @@ packet_clone(struct packet *pkt) {
 
     clone = xmalloc(sizeof(struct packet));
     clone->dp         = pkt->dp;
-    clone->buffer     = ofpbuf_clone(pkt->buffer);
+    /* The buffer is copied on write, see packet_make_writable(). */
+    if (pkt->buffer_refs == NULL) {
+        pkt->buffer_refs = xmalloc(sizeof(unsigned int));
+        *pkt->buffer_refs = 1;
+    }
+    (*pkt->buffer_refs)++;
+    clone->buffer      = pkt->buffer;
+    clone->buffer_refs = pkt->buffer_refs;
     clone->in_port    = pkt->in_port;
     /* There is no case we need to keep the action-set, but if it's needed
      * we could add a parameter to the function... Jean II
@@ -99,11 +111,34 @@ packet_destroy(struct packet *pkt) {
     }
 
     action_set_destroy(pkt->action_set);
-    ofpbuf_delete(pkt->buffer);
+    if (pkt->buffer_refs == NULL) {
+        ofpbuf_delete(pkt->buffer);
+    } else if (--(*pkt->buffer_refs) == 0) {
+        ofpbuf_delete(pkt->buffer);
+        free(pkt->buffer_refs);
+    }
     packet_handle_std_destroy(pkt->handle_std);
     free(pkt);
 }
 
+void
+packet_make_writable(struct packet *pkt) {
+    struct ofpbuf *shared = pkt->buffer;
+
+    if (pkt->buffer_refs == NULL) {
+        return;
+    }
+    if (--(*pkt->buffer_refs) == 0) {
+        /* The other packets are gone; the buffer is ours. */
+        free(pkt->buffer_refs);
+        pkt->buffer_refs = NULL;
+        return;
+    }
+    pkt->buffer_refs = NULL;
+    pkt->buffer = ofpbuf_clone(shared);
+    packet_handle_std_rebase(pkt->handle_std, shared);
+}
+
 char *
 packet_to_string(struct packet *pkt) {
     char *str;
@@ -131,8 +166,10 @@ packet_to_string(struct packet *pkt) {
 /*Modificacion UAH Discovery hybrid topologies, JAH-*/
 
 /* Paquetes HELLO para descubrir sensores virtuales */
-void packet_hello_send(void)
+void packet_hello_send(struct datapath *dp)
 {
+    struct packet *pkt_hello = dp->pkt_hello;
+
     dp_actions_output_port(pkt_hello, OFPP_FLOOD, pkt_hello->out_queue, pkt_hello->out_port_max_len, 0xffffffffffffffff);
 }
 
@@ -142,7 +179,7 @@ struct packet * packet_hello_create(struct datapath *dp, uint32_t in_port, bool
         struct ofpbuf *buf = NULL;
         uint8_t Total[44] = {0}, Mac[ETH_ADDR_LEN] = {0xFF,0xFF,0xFF,0xFF,0xFF,0xFF} , 
             type_array[2] = {0x76, 0x98};
-        uint16_t eth_type = 0x9876, type_device = htons(type_sensor);
+        uint16_t type_device = htons(dp->hddp_config.sensor_type);
 
         //Creamos el buffer del paquete
         buf = ofpbuf_new(46); //sizeof(struct eth_header));
@@ -156,24 +193,16 @@ struct packet * packet_hello_create(struct datapath *dp, uint32_t in_port, bool
         ofpbuf_put(buf, &type_device, sizeof(type_device));
         //rellenamos
         ofpbuf_put(buf, Total, 44);
-        //Creamos el buffer del paquete
+        //Creamos el paquete, las cabeceras las saca el parser del propio buffer
         pkt = packet_create(dp, in_port, buf, packet_out);
 
-        //creamos la cabecera eth y le metemos los valores que queremos
-        pkt->handle_std->proto->eth = xmalloc(sizeof(struct eth_header));
-        memcpy(pkt->handle_std->proto->eth->eth_dst, Mac, ETH_ADDR_LEN);
-        memcpy(pkt->handle_std->proto->eth->eth_src, dp->ports[1].conf->hw_addr, ETH_ADDR_LEN);
-        pkt->handle_std->proto->eth->eth_type = eth_type;
-
-        pkt->handle_std->valid = false;
-        packet_handle_std_validate(pkt->handle_std);
-
     return pkt;
 }
 
 /*Modificacion UAH Discovery hybrid topologies, JAH-*/
 struct packet * create_dht_reply_packet(struct datapath *dp, uint8_t * mac_dst,
-    uint32_t in_port, uint32_t out_port, uint16_t type_device, uint64_t mac_device_64, uint16_t num_devices)
+    uint32_t in_port, uint32_t out_port, uint16_t type_device, uint64_t mac_device_64, uint16_t num_devices,
+    uint32_t seq)
 {
     /*                                 Estructura del paquete
      * ----------------------------------------------------------------------------------
@@ -181,6 +210,7 @@ struct packet * create_dht_reply_packet(struct datapath *dp, uint8_t * mac_dst,
      * | struct 1 = [TYPE DEVICE 4B |MAC DEVICE X 8B | IN_PORT X 4B | OUT_PORT X 4B] |
      * | struct 2 ... struct 30 | 
      * | struct 31 = [TYPE DEVICE 4B | MAC DEVICE X 8B | IN_PORT X 4B | OUT_PORT X 4B] | 
+     * | SEQ 4B (copiado del request) |
      * ---------------------------------------------------------------------------------- 
     */
 
@@ -229,28 +259,10 @@ struct packet * create_dht_reply_packet(struct datapath *dp, uint8_t * mac_dst,
     ofpbuf_put(buffer2,mac, sizeof(uint64_t)*DHT_MAX_ELEMENTS);
     ofpbuf_put(buffer2,in_ports, sizeof(uint32_t)*DHT_MAX_ELEMENTS);
     ofpbuf_put(buffer2,out_ports, sizeof(uint32_t)*DHT_MAX_ELEMENTS);
+    ofpbuf_put(buffer2,&seq, sizeof(uint32_t));
 
-    //Creamos la estructura del paquete
+    //Creamos la estructura del paquete, el parser apunta las cabeceras al buffer
     pkt = packet_create(dp, in_port, buffer2, false);
-
-    //Creamos la cabecera ethernet
-    pkt->handle_std->proto->eth = xmalloc(sizeof(struct eth_header));
-    memcpy(pkt->handle_std->proto->eth->eth_dst, mac_dst, ETH_ADDR_LEN);
-    memcpy(pkt->handle_std->proto->eth->eth_src, dp->ports[1].conf->hw_addr, ETH_ADDR_LEN);
-    //Insertamos el eth al reves por tema de little endian
-    pkt->handle_std->proto->eth->eth_type=ETH_TYPE_DHT_INV;
-
-    //creamos la cabecera de nuestro protocolo
-    pkt->handle_std->proto->dht=xmalloc(sizeof(struct dht_header));
-    pkt->handle_std->proto->dht->opcode = opcode;
-    pkt->handle_std->proto->dht->num_devices = num_devices;
-    memcpy(&pkt->handle_std->proto->dht->type_devices,type_devices,sizeof(uint16_t)*DHT_MAX_ELEMENTS);
-    memcpy(&pkt->handle_std->proto->dht->macs,mac,sizeof(uint64_t)*DHT_MAX_ELEMENTS);
-    memcpy(&pkt->handle_std->proto->dht->in_ports, in_ports,sizeof(uint32_t)*DHT_MAX_ELEMENTS);
-    memcpy(&pkt->handle_std->proto->dht->out_ports, out_ports,sizeof(uint32_t)*DHT_MAX_ELEMENTS);
-
-    //validamos el paquete
-    packet_handle_std_validate(pkt->handle_std);
     return pkt;
 }
 
@@ -258,6 +270,8 @@ void update_data_request(struct packet * pkt){
     //actualizo el numero de saltos para control de posibles enlaces perdidos
     uint64_t num_elements=pkt->handle_std->proto->dht->num_devices;
     
+    packet_make_writable(pkt);
+    
     pkt->handle_std->proto->dht->num_devices = htons(bigtolittle16(num_elements)+1);
     pkt->packet_out=false;
     pkt->handle_std->valid = false;
@@ -272,6 +286,8 @@ uint16_t update_data_reply(struct packet * pkt, uint32_t out_port, uint16_t type
     if (num_elements > DHT_MAX_ELEMENTS)
         return num_elements;
 
+    packet_make_writable(pkt);
+
     //Puerto de entrada sentido SRC->DST
     pkt->handle_std->proto->dht->num_devices = htons(num_elements);
     pkt->handle_std->proto->dht->type_devices[num_elements-1]=htons(type_device);
@@ -36,6 +36,8 @@
 struct packet {
     struct datapath    *dp;
     struct ofpbuf      *buffer;    /* buffer containing the packet */
+    unsigned int       *buffer_refs; /* number of packets sharing the buffer;
+                                        NULL if the packet owns it alone */
     uint32_t            in_port;
     struct action_set  *action_set; /* action set associated with the packet */
     bool                packet_out; /* true if the packet arrived in a packet out msg */
@@ -63,26 +65,31 @@ packet_to_string(struct packet *pkt);
 void
 packet_destroy(struct packet *pkt);
 
-/* Clones a packet deeply, i.e. all associated structures are also cloned. */
+/* Clones a packet. The clone shares the buffer of the packet until either
+ * of them is modified; the other associated structures are copied. */
 struct packet *
 packet_clone(struct packet *pkt);
 
+/* Makes sure the packet owns its buffer, copying it if it is shared with
+ * clones. Must be called before the packet data is modified. */
+void
+packet_make_writable(struct packet *pkt);
+
 /*Modificacion UAH Discovery hybrid topologies, JAH-*/
 
 //Tipos de dispositivos 
 #define NODO_SDN 1
 #define NODO_NO_SDN 2
 #define NODO_SENSOR 3
-extern uint16_t type_sensor;
 
 /* Paquetes HELLO para descubrir sensores virtuales */
-struct packet * pkt_hello;
-void packet_hello_send(void);
+void packet_hello_send(struct datapath *dp);
 struct packet * packet_hello_create(struct datapath *dp, uint32_t in_port, bool packet_out);
 
 //funciones para crear paquete de Discovery hybrid topologies
 struct packet * create_dht_reply_packet(struct datapath *dp, uint8_t * mac_dst,
-    uint32_t in_port, uint32_t out_port, uint16_t type_device, uint64_t mac_device_64, uint16_t num_devices);
+    uint32_t in_port, uint32_t out_port, uint16_t type_device, uint64_t mac_device_64, uint16_t num_devices,
+    uint32_t seq);
 
 //funcion para actualizar los paquetes
 void update_data_request(struct packet * pkt);
@@ -27,7 +27,6 @@
 #include "openflow/openflow.h"
 #include "compiler.h"
 
-#include "lib/hash.h"
 #include "oflib/oxm-match.h"
 
 #include "nbee_link/nbee_link.h"
@@ -36,27 +35,23 @@
 
 void
 packet_handle_std_validate(struct packet_handle_std *handle) {
-    struct ofl_match_tlv * iter, *next, *f;
+    struct ofl_match_tlv *f;
     uint64_t metadata = 0;
     uint64_t tunnel_id = 0;
     if(handle->valid)
         return;
     
-    HMAP_FOR_EACH_WITH_HASH(f, struct ofl_match_tlv,
-                    hmap_node, hash_int(OXM_OF_METADATA,0), &handle->match.match_fields){
-                    metadata = *((uint64_t*) f->value);
+    f = ofl_structs_match_lookup(&handle->match, OXM_OF_METADATA);
+    if (f != NULL) {
+        memcpy(&metadata, f->value, sizeof(uint64_t));
     }
 
-    HMAP_FOR_EACH_WITH_HASH(f, struct ofl_match_tlv,
-                    hmap_node, hash_int(OXM_OF_TUNNEL_ID,0), &handle->match.match_fields){
-            tunnel_id = *((uint64_t*) f->value);
+    f = ofl_structs_match_lookup(&handle->match, OXM_OF_TUNNEL_ID);
+    if (f != NULL) {
+        memcpy(&tunnel_id, f->value, sizeof(uint64_t));
     }
 
-    HMAP_FOR_EACH_SAFE(iter, next, struct ofl_match_tlv, hmap_node, &handle->match.match_fields){
-        free(iter->value);
-        free(iter);
-    }
-    ofl_structs_match_init(&handle->match);
+    ofl_structs_match_clear(&handle->match);
 
     if (nblink_packet_parse(handle->pkt->buffer,&handle->match,
                             handle->proto) < 0)
@@ -64,11 +59,16 @@ packet_handle_std_validate(struct packet_handle_std *handle) {
 
     handle->valid = true;
 
-    /* Add in_port value to the hash_map */
+    /* Add in_port value to the match */
     ofl_structs_match_put32(&handle->match, OXM_OF_IN_PORT, handle->pkt->in_port);
-    /*Add metadata  and tunnel_id value to the hash_map */
+    /*Add metadata  and tunnel_id value to the match */
     ofl_structs_match_put64(&handle->match,  OXM_OF_METADATA, metadata);
     ofl_structs_match_put64(&handle->match,  OXM_OF_TUNNEL_ID, tunnel_id);
+
+    handle->fields = 0;
+    OFL_MATCH_FOR_EACH(f, &handle->match) {
+        handle->fields |= match_std_field_bit(f->header);
+    }
     return;
 }
 
@@ -79,7 +79,7 @@ packet_handle_std_create(struct packet *pkt) {
 	handle->proto = xmalloc(sizeof(struct protocols_std));
 	handle->pkt = pkt;
 
-	hmap_init(&handle->match.match_fields);
+	ofl_structs_match_init(&handle->match);
 
 	handle->valid = false;
 	packet_handle_std_validate(handle);
@@ -88,30 +88,74 @@ packet_handle_std_create(struct packet *pkt) {
 }
 
 struct packet_handle_std *
-packet_handle_std_clone(struct packet *pkt, struct packet_handle_std *handle UNUSED) {
+packet_handle_std_clone(struct packet *pkt, struct packet_handle_std *handle) {
     struct packet_handle_std *clone = xmalloc(sizeof(struct packet_handle_std));
 
     clone->pkt = pkt;
-    clone->proto = xmalloc(sizeof(struct protocols_std));
-    hmap_init(&clone->match.match_fields);
-    clone->valid = false;
-    // TODO Zoltan: if handle->valid, then match could be memcpy'd, and protocol
-    //              could be offset
-    packet_handle_std_validate(clone);
+    clone->table_miss = handle->table_miss;
+    ofl_structs_match_init(&clone->match);
+
+    if (!handle->valid) {
+        clone->proto = xmalloc(sizeof(struct protocols_std));
+        clone->valid = false;
+        packet_handle_std_validate(clone);
+        return clone;
+    }
+
+    /* No need to parse the packet again: copy the match fields, and have the
+     * protocol pointers follow the buffer if it is not shared. */
+    clone->proto = xmemdup(handle->proto, sizeof(struct protocols_std));
+    clone->valid = true;
+    clone->fields = handle->fields;
+    if (pkt->buffer != handle->pkt->buffer) {
+        packet_handle_std_rebase(clone, handle->pkt->buffer);
+    }
+    ofl_structs_match_copy(&clone->match, &handle->match);
 
     return clone;
 }
 
+/* Returns the pointer at the same offset in the data of 'to' as 'p' in the
+ * data of 'from', or NULL if 'p' does not point into the data of 'from'. */
+static inline void *
+rebase(void *p, const struct ofpbuf *from, const struct ofpbuf *to) {
+    uint8_t *b = p, *data = from->data;
+
+    if (b < data || b >= data + from->size) {
+        return NULL;
+    }
+    return (uint8_t *)to->data + (b - data);
+}
+
 void
-packet_handle_std_destroy(struct packet_handle_std *handle) {
+packet_handle_std_rebase(struct packet_handle_std *handle, const struct ofpbuf *old) {
+    struct protocols_std *p = handle->proto;
+    const struct ofpbuf *buf = handle->pkt->buffer;
 
-    struct ofl_match_tlv * iter, *next;
-    HMAP_FOR_EACH_SAFE(iter, next, struct ofl_match_tlv, hmap_node, &handle->match.match_fields){
-        free(iter->value);
-        free(iter);
+    if (!handle->valid) {
+        return;
     }
+    p->eth       = rebase(p->eth, old, buf);
+    p->eth_snap  = rebase(p->eth_snap, old, buf);
+    p->vlan      = rebase(p->vlan, old, buf);
+    p->vlan_last = rebase(p->vlan_last, old, buf);
+    p->mpls      = rebase(p->mpls, old, buf);
+    p->pbb       = rebase(p->pbb, old, buf);
+    p->ipv4      = rebase(p->ipv4, old, buf);
+    p->ipv6      = rebase(p->ipv6, old, buf);
+    p->arp       = rebase(p->arp, old, buf);
+    p->tcp       = rebase(p->tcp, old, buf);
+    p->udp       = rebase(p->udp, old, buf);
+    p->sctp      = rebase(p->sctp, old, buf);
+    p->icmp      = rebase(p->icmp, old, buf);
+    p->dht       = rebase(p->dht, old, buf);
+}
+
+void
+packet_handle_std_destroy(struct packet_handle_std *handle) {
+
+    ofl_structs_match_clear(&handle->match);
     free(handle->proto);
-    hmap_destroy(&handle->match.match_fields);
     free(handle);
 }
 
@@ -156,6 +200,17 @@ packet_handle_std_match(struct packet_handle_std *handle, struct ofl_match *matc
     return packet_match(match ,&handle->match );
 }
 
+uint64_t
+packet_handle_std_fields(struct packet_handle_std *handle) {
+    if (!handle->valid) {
+        packet_handle_std_validate(handle);
+        if (!handle->valid) {
+            return 0;
+        }
+    }
+    return handle->fields;
+}
+
 
 
 /* If pointer is not null, returns str; otherwise returns an empty string. */
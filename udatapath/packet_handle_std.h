@@ -37,6 +37,8 @@ struct packet_handle_std {
    struct ofl_match  match;  /* Match fields extracted from the packet
                                            are also stored in a match structure
                                            for convenience */
+   uint64_t                    fields; /* Fields in match, as in
+                                           match_std_field_bit(). */
    bool                        valid; /* Set to true if the handler data is valid.
                                            if false, it is revalidated before
                                            executing any methods. */
@@ -64,6 +66,11 @@ packet_handle_std_is_fragment(struct packet_handle_std *handle);
 bool
 packet_handle_std_match(struct packet_handle_std *handle,  struct ofl_match *match);
 
+/* Returns the set of fields the packet has, as in match_std_fields(); none
+ * if it cannot be parsed, as it then matches nothing. */
+uint64_t
+packet_handle_std_fields(struct packet_handle_std *handle);
+
 /* Converts the packet to a string representation */
 char *
 packet_handle_std_to_string(struct packet_handle_std *handle);
@@ -75,6 +82,11 @@ packet_handle_std_print(FILE *stream, struct packet_handle_std *handle);
 struct packet_handle_std *
 packet_handle_std_clone(struct packet *pkt, struct packet_handle_std *handle);
 
+/* Moves the protocol pointers of the handler, which point into the old
+ * buffer, to the same offsets in the current buffer of its packet. */
+void
+packet_handle_std_rebase(struct packet_handle_std *handle, const struct ofpbuf *old);
+
 /* Revalidates the handler data */
 void
 packet_handle_std_validate(struct packet_handle_std *handle);
@@ -24,6 +24,7 @@
 #include "dp_actions.h"
 #include "dp_buffers.h"
 #include "dp_exp.h"
+#include "dp_latency.h"
 #include "dp_ports.h"
 #include "datapath.h"
 #include "packet.h"
@@ -68,41 +69,25 @@ is_table_miss(struct flow_entry *entry){
 /* Sends a packet to the controller in a packet_in message */
 static void
 send_packet_to_controller(struct pipeline *pl, struct packet *pkt, uint8_t table_id, uint8_t reason) {
-
-    struct ofl_msg_packet_in msg;
-    struct ofl_match *m;
-    msg.header.type = OFPT_PACKET_IN;
-    msg.total_len   = pkt->buffer->size;
-    msg.reason      = reason;
-    msg.table_id    = table_id;
-    msg.cookie      = 0xffffffffffffffff;
-    msg.data = pkt->buffer->data;
-
+    size_t data_len = pkt->buffer->size;
 
     /* A max_len of OFPCML_NO_BUFFER means that the complete
         packet should be sent, and it should not be buffered.*/
     if (pl->dp->config.miss_send_len != OFPCML_NO_BUFFER){
         dp_buffers_save(pl->dp->buffers, pkt);
-        msg.buffer_id   = pkt->buffer_id;
-        msg.data_length = MIN(pl->dp->config.miss_send_len, pkt->buffer->size);
-    }else {
-        msg.buffer_id   = OFP_NO_BUFFER;
-        msg.data_length = pkt->buffer->size;
+        data_len = MIN(pl->dp->config.miss_send_len, pkt->buffer->size);
     }
 
-    m = &pkt->handle_std->match;
     /* In this implementation the fields in_port and in_phy_port
         always will be the same, because we are not considering logical
         ports                                 */
-    msg.match = (struct ofl_match_header*)m;
-    dp_send_message(pl->dp, (struct ofl_msg_header *)&msg, NULL);
+    dp_send_packet_in(pl->dp, pkt, reason, table_id, 0xffffffffffffffff, data_len);
 }
 
-/* Pass the packet through the flow tables.
- * This function takes ownership of the packet and will destroy it. */
-void
-pipeline_process_packet(struct pipeline *pl, struct packet *pkt) {
+static void
+pipeline_process_packet__(struct pipeline *pl, struct packet *pkt) {
     struct flow_table *table, *next_table;
+    uint64_t start;
 
     if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
         char *pkt_str = packet_to_string(pkt);
@@ -117,8 +102,10 @@ pipeline_process_packet(struct pipeline *pl, struct packet *pkt) {
     }
 
     /*Modificacion UAH Discovery hybrid topologies, JAH-*/
+    start = dp_latency_start();
     //Tratamos los hellos para detectar a los sensores
     if (handle_hello_packets(pkt) == 1){
+        dp_latency_end(OFPELS_HDDP, start);
         VLOG_INFO(LOG_MODULE,"Paquete Hello tratado Correctamente!");
         //una vez tratado eliminamos el mensaje
         if (pkt)
@@ -130,6 +117,7 @@ pipeline_process_packet(struct pipeline *pl, struct packet *pkt) {
     }
     //Tratamos los paquetes del protocolo, empezando por el Request (Broadcast)
     if (selecto_HDT_packets(pkt) == 1){
+        dp_latency_end(OFPELS_HDDP, start);
         VLOG_INFO(LOG_MODULE, "Paquete HDT tratado Correctamente!");
         //una vez tratado eliminamos el mensaje
         if (pkt)
@@ -139,6 +127,7 @@ pipeline_process_packet(struct pipeline *pl, struct packet *pkt) {
         }
         return;
     }
+    dp_latency_end(OFPELS_HDDP, start);
 
     /*Fin Modificacion UAH Discovery hybrid topologies, JAH-*/
 
@@ -158,7 +147,9 @@ pipeline_process_packet(struct pipeline *pl, struct packet *pkt) {
             VLOG_DBG_RL(LOG_MODULE, &rl, "searching table entry for packet match: %s.", m);
             free(m);
         }
+        start = dp_latency_start();
         entry = flow_table_lookup(table, pkt);
+        dp_latency_end(OFPELS_LOOKUP, start);
         if (entry != NULL) {
 	        if (VLOG_IS_DBG_ENABLED(LOG_MODULE)) {
                 char *m = ofl_structs_flow_stats_to_string(entry->stats, pkt->dp->exp);
@@ -166,7 +157,9 @@ pipeline_process_packet(struct pipeline *pl, struct packet *pkt) {
                 free(m);
             }
             pkt->handle_std->table_miss = is_table_miss(entry);
+            start = dp_latency_start();
             execute_entry(pl, entry, &next_table, &pkt);
+            dp_latency_end(OFPELS_INSTRUCTIONS, start);
             /* Packet could be destroyed by a meter instruction */
             if (!pkt)
                 return;
@@ -189,6 +182,16 @@ pipeline_process_packet(struct pipeline *pl, struct packet *pkt) {
     VLOG_WARN_RL(LOG_MODULE, &rl, "Reached outside of pipeline processing cycle.");
 }
 
+/* Pass the packet through the flow tables.
+ * This function takes ownership of the packet and will destroy it. */
+void
+pipeline_process_packet(struct pipeline *pl, struct packet *pkt) {
+    uint64_t start = dp_latency_start();
+
+    pipeline_process_packet__(pl, pkt);
+    dp_latency_end(OFPELS_PIPELINE, start);
+}
+
 static
 int inst_compare(const void *inst1, const void *inst2){
     struct ofl_instruction_header * i1 = *(struct ofl_instruction_header **) inst1;
@@ -201,20 +204,9 @@ int inst_compare(const void *inst1, const void *inst2){
 }
 
 ofl_err
-pipeline_handle_flow_mod(struct pipeline *pl, struct ofl_msg_flow_mod *msg,
-                                                const struct sender *sender) {
-    /* Note: the result of using table_id = 0xff is undefined in the spec.
-     *       for now it is accepted for delete commands, meaning to delete
-     *       from all tables */
+pipeline_validate_flow_mod(struct pipeline *pl, struct ofl_msg_flow_mod *msg) {
     ofl_err error;
     size_t i;
-    bool match_kept,insts_kept;
-
-    if(sender->remote->role == OFPCR_ROLE_SLAVE)
-        return ofl_error(OFPET_BAD_REQUEST, OFPBRC_IS_SLAVE);
-
-    match_kept = false;
-    insts_kept = false;
 
     /*Sort by execution oder*/
     qsort(msg->instructions, msg->instructions_num,
@@ -241,25 +233,55 @@ pipeline_handle_flow_mod(struct pipeline *pl, struct ofl_msg_flow_mod *msg,
 	  return ofl_error(OFPET_BAD_INSTRUCTION, OFPBIC_UNSUP_INST);
     }
 
+    if (msg->table_id == 0xff &&
+        msg->command != OFPFC_DELETE && msg->command != OFPFC_DELETE_STRICT) {
+        return ofl_error(OFPET_FLOW_MOD_FAILED, OFPFMFC_BAD_TABLE_ID);
+    }
+    return 0;
+}
+
+ofl_err
+pipeline_handle_flow_mod(struct pipeline *pl, struct ofl_msg_flow_mod *msg,
+                                                const struct sender *sender) {
+    /* Note: the result of using table_id = 0xff is undefined in the spec.
+     *       for now it is accepted for delete commands, meaning to delete
+     *       from all tables */
+    ofl_err error;
+    bool match_kept,insts_kept;
+
+    if(sender->remote->role == OFPCR_ROLE_SLAVE)
+        return ofl_error(OFPET_BAD_REQUEST, OFPBRC_IS_SLAVE);
+
+    match_kept = false;
+    insts_kept = false;
+
+    error = pipeline_validate_flow_mod(pl, msg);
+    if (error) {
+        return error;
+    }
+
+    /* Flow entries keep the match and instructions, which must not stay in
+     * the arena the message may have been unpacked into. */
+    if (msg->command == OFPFC_ADD || msg->command == OFPFC_MODIFY ||
+        msg->command == OFPFC_MODIFY_STRICT) {
+        ofl_msg_flow_mod_copy_out(msg);
+    }
+
     if (msg->table_id == 0xff) {
-        if (msg->command == OFPFC_DELETE || msg->command == OFPFC_DELETE_STRICT) {
-            size_t i;
-
-            error = 0;
-            for (i=0; i < PIPELINE_TABLES; i++) {
-                error = flow_table_flow_mod(pl->tables[i], msg, &match_kept, &insts_kept);
-                if (error) {
-                    break;
-                }
-            }
+        size_t i;
+
+        error = 0;
+        for (i=0; i < PIPELINE_TABLES; i++) {
+            error = flow_table_flow_mod(pl->tables[i], msg, &match_kept, &insts_kept);
             if (error) {
-                return error;
-            } else {
-                ofl_msg_free_flow_mod(msg, !match_kept, !insts_kept, pl->dp->exp);
-                return 0;
+                break;
             }
+        }
+        if (error) {
+            return error;
         } else {
-            return ofl_error(OFPET_FLOW_MOD_FAILED, OFPFMFC_BAD_TABLE_ID);
+            ofl_msg_free_flow_mod(msg, !match_kept, !insts_kept, pl->dp->exp);
+            return 0;
         }
     } else {
         error = flow_table_flow_mod(pl->tables[msg->table_id], msg, &match_kept, &insts_kept);
@@ -307,37 +329,95 @@ pipeline_handle_table_mod(struct pipeline *pl,
     return 0;
 }
 
-ofl_err
-pipeline_handle_stats_request_flow(struct pipeline *pl,
-                                   struct ofl_msg_multipart_request_flow *msg,
-                                   const struct sender *sender) {
-
-    struct ofl_flow_stats **stats = xmalloc(sizeof(struct ofl_flow_stats *));
-    size_t stats_size = 1;
+/* Bound on the length of the flow stats carried by each part of a flow
+ * stats multipart reply. */
+#define FLOW_STATS_PART_LEN 32768
+
+/* State of a flow stats dump, sent as a series of multipart reply parts from
+ * the remote's dump callback. */
+struct flow_stats_dump {
+    struct pipeline                       *pl;
+    struct ofl_msg_multipart_request_flow *msg;
+    struct sender                          sender;
+    uint8_t                                table_id;   /* table being dumped. */
+    uint8_t                                last_table;
+    struct flow_table_cursor               cursor;
+    struct ofl_flow_stats                **stats;      /* stats of one part. */
+    size_t                                 stats_size;
+};
+
+/* Sends the next part of a flow stats dump. Returns 1 while parts remain,
+ * 0 once the last one was sent. */
+static int
+flow_stats_dump_part(struct datapath *dp UNUSED, void *aux) {
+    struct flow_stats_dump *dump = aux;
     size_t stats_num = 0;
-
-    if (msg->table_id == 0xff) {
-        size_t i;
-        for (i=0; i<PIPELINE_TABLES; i++) {
-            flow_table_stats(pl->tables[i], msg, &stats, &stats_size, &stats_num);
+    size_t len = 0;
+    bool more = true;
+
+    while (flow_table_stats(dump->pl->tables[dump->table_id], &dump->cursor, dump->msg,
+                            FLOW_STATS_PART_LEN, &len, &dump->stats, &dump->stats_size,
+                            &stats_num)) {
+        if (dump->table_id == dump->last_table) {
+            more = false;
+            break;
         }
-    } else {
-        flow_table_stats(pl->tables[msg->table_id], msg, &stats, &stats_size, &stats_num);
+        flow_table_cursor_close(&dump->cursor);
+        dump->table_id++;
+        flow_table_cursor_open(dump->pl->tables[dump->table_id], &dump->cursor);
     }
 
     {
         struct ofl_msg_multipart_reply_flow reply =
                 {{{.type = OFPT_MULTIPART_REPLY},
-                  .type = OFPMP_FLOW, .flags = 0x0000},
-                 .stats     = stats,
+                  .type = OFPMP_FLOW, .flags = more ? OFPMPF_REPLY_MORE : 0x0000},
+                 .stats     = dump->stats,
                  .stats_num = stats_num
                 };
 
-        dp_send_message(pl->dp, (struct ofl_msg_header *)&reply, sender);
+        /* len is the exact length of the packed entries. */
+        dp_send_message_sized(dump->pl->dp, (struct ofl_msg_header *)&reply, &dump->sender,
+                              sizeof(struct ofp_multipart_reply) + len);
     }
+    return more ? 1 : 0;
+}
 
-    free(stats);
-    ofl_msg_free((struct ofl_msg_header *)msg, pl->dp->exp);
+static void
+flow_stats_dump_done(void *aux) {
+    struct flow_stats_dump *dump = aux;
+
+    flow_table_cursor_close(&dump->cursor);
+    ofl_msg_free((struct ofl_msg_header *)dump->msg, dump->pl->dp->exp);
+    free(dump->stats);
+    free(dump);
+}
+
+ofl_err
+pipeline_handle_stats_request_flow(struct pipeline *pl,
+                                   struct ofl_msg_multipart_request_flow *msg,
+                                   const struct sender *sender) {
+    struct flow_stats_dump *dump;
+
+    if (msg->table_id != 0xff && msg->table_id >= PIPELINE_TABLES) {
+        return ofl_error(OFPET_BAD_REQUEST, OFPBRC_BAD_TABLE_ID);
+    }
+
+    /* The entries are not collected up front: the remote sends the reply
+     * part by part, resuming from a cursor in each of its runs. */
+    dump = xmalloc(sizeof(struct flow_stats_dump));
+    dump->pl         = pl;
+    dump->msg        = msg;
+    dump->sender     = *sender;
+    dump->sender.buffer = NULL;
+    dump->table_id   = msg->table_id == 0xff ? 0 : msg->table_id;
+    dump->last_table = msg->table_id == 0xff ? PIPELINE_TABLES - 1 : msg->table_id;
+    dump->stats      = xmalloc(sizeof(struct ofl_flow_stats *));
+    dump->stats_size = 1;
+    flow_table_cursor_open(pl->tables[dump->table_id], &dump->cursor);
+
+    sender->remote->cb_dump = flow_stats_dump_part;
+    sender->remote->cb_done = flow_stats_dump_done;
+    sender->remote->cb_aux  = dump;
     return 0;
 }
 
@@ -351,6 +431,7 @@ pipeline_handle_stats_request_table(struct pipeline *pl,
     stats = xmalloc(sizeof(struct ofl_table_stats *) * PIPELINE_TABLES);
 
     for (i=0; i<PIPELINE_TABLES; i++) {
+        flow_table_update(pl->tables[i]);
         stats[i] = pl->tables[i]->stats;
     }
 
@@ -639,8 +720,8 @@ execute_entry(struct pipeline *pl, struct flow_entry *entry,
                  *       should be updated in all. */
                 packet_handle_std_validate((*pkt)->handle_std);
                 /* Search field on the description of the packet. */
-                HMAP_FOR_EACH_WITH_HASH(f, struct ofl_match_tlv,
-                    hmap_node, hash_int(OXM_OF_METADATA,0), &(*pkt)->handle_std->match.match_fields){
+                f = ofl_structs_match_lookup(&(*pkt)->handle_std->match, OXM_OF_METADATA);
+                if (f != NULL) {
                     uint64_t *metadata = (uint64_t*) f->value;
                     *metadata = (*metadata & ~wi->metadata_mask) | (wi->metadata & wi->metadata_mask);
                     VLOG_DBG_RL(LOG_MODULE, &rl, "Executing write metadata: 0x%"PRIx64"", *metadata);
@@ -682,18 +763,30 @@ int8_t handle_hello_packets(struct packet *pkt){
     //packet Hello (EthType = 7698 o 9876)
     if( eth_type== 30360 || eth_type == 39030)
     {
+        pkt->dp->hddp_stats.hellos_rx++;
         //Solo se entra para guardar info si no existe conexion entre sensores y es el 
         //gateway quien tiene que descubrir a los sensores
-        if (SENSOR_TO_SENSOR == 0){
+        if (!pkt->dp->hddp_config.sensor_to_sensor){
             //sacamos el tipo de sensores que nos llega
             memcpy(&(type_device), ofpbuf_at_assert(pkt->buffer, pkt->buffer->size - 46*sizeof(uint8_t), 
                 sizeof(uint16_t)), sizeof(uint16_t));
+            //notificamos al controlador los vecinos nuevos o que cambian de puerto o tipo
+            {
+                struct mac_port_time *old = mac_to_port_lookup(&pkt->dp->neighbor_table, pkt->handle_std->proto->eth->eth_src);
+
+                if (old == NULL || time_msec() > old->valid_time_entry)
+                    hddp_neighbor_event(pkt->dp, OFPENR_ADD, pkt->handle_std->proto->eth->eth_src,
+                        htons(type_device), pkt->in_port);
+                else if (old->port_in != pkt->in_port || old->type != htons(type_device))
+                    hddp_neighbor_event(pkt->dp, OFPENR_MODIFY, pkt->handle_std->proto->eth->eth_src,
+                        htons(type_device), pkt->in_port);
+            }
             //pasamos a realizar la actualizacion de la tabla de vecinos
-            if(mac_to_port_found_port(&neighbor_table, pkt->handle_std->proto->eth->eth_src) != -1)
-                mac_to_port_update(&neighbor_table, pkt->handle_std->proto->eth->eth_src, htons(type_device), pkt->in_port, TIME_HELLO_SENSOR);
+            if(mac_to_port_found_port(&pkt->dp->neighbor_table, pkt->handle_std->proto->eth->eth_src) != -1)
+                mac_to_port_update(&pkt->dp->neighbor_table, pkt->handle_std->proto->eth->eth_src, htons(type_device), pkt->in_port, pkt->dp->hddp_config.hello_lifetime);
             else
                 //guardamos el valor del vecino
-                mac_to_port_add(&neighbor_table, pkt->handle_std->proto->eth->eth_src, htons(type_device), pkt->in_port, TIME_HELLO_SENSOR);
+                mac_to_port_add(&pkt->dp->neighbor_table, pkt->handle_std->proto->eth->eth_src, htons(type_device), pkt->in_port, pkt->dp->hddp_config.hello_lifetime);
             //paquete tratado correctamente;
         }
         return 1;
@@ -707,12 +800,20 @@ uint8_t selecto_HDT_packets(struct packet *pkt){
 
     //packet HDT (EthType = FFAA o AAFF)
     if( eth_type== 65450 || eth_type == 43775 ){
-        if ((SENSOR_TO_SENSOR == 1) || (SENSOR_TO_SENSOR == 0 && pkt->dp->id < 0x0100)){   
+        if (pkt->dp->hddp_config.sensor_to_sensor || dp_hddp_is_gateway(pkt->dp)){   
             //paquetes broadcast son paquetes request
             VLOG_INFO(LOG_MODULE, "Paquete DHT detectado Opcode : %d", htons(pkt->handle_std->proto->dht->opcode));
             if (htons(pkt->handle_std->proto->dht->opcode) == 1){
                 VLOG_INFO(LOG_MODULE, "Paquete DHT REQUEST detectado");
-                handle_hdt_request_packets(pkt);
+                //copias de un request ya tratado en esta ronda se descartan sin tocar las tablas
+                if (hddp_seen_check(&pkt->dp->hddp_seen, pkt->handle_std->proto->eth->eth_src,
+                        ntohl(pkt->handle_std->proto->dht->seq), pkt->in_port)){
+                    pkt->dp->hddp_stats.requests_dup++;
+                    VLOG_DBG_RL(LOG_MODULE, &rl, "Request duplicado (seq %u) en el puerto %u, descartado",
+                        ntohl(pkt->handle_std->proto->dht->seq), pkt->in_port);
+                }
+                else
+                    handle_hdt_request_packets(pkt);
             }//paquetes unicast son paquetes reply
             else if (htons(pkt->handle_std->proto->dht->opcode) == 2){
                 VLOG_INFO(LOG_MODULE, "Paquete DHT REPLY detectado");
@@ -729,35 +830,64 @@ uint8_t selecto_HDT_packets(struct packet *pkt){
     return 0;
 }
 
+/* Starts a discovery round, closing the previous one. */
+static void
+hddp_round_start(struct hddp_stats *stats) {
+    uint64_t now = time_msec();
+
+    if (stats->rounds > 0) {
+        uint64_t duration = stats->round_end - stats->round_start;
+
+        stats->round_sum += duration;
+        if (duration > stats->round_max) {
+            stats->round_max = duration;
+        }
+    }
+    stats->rounds++;
+    stats->round_start = now;
+    stats->round_end = now;
+}
+
+/* Extends the current round up to now. */
+static void
+hddp_round_update(struct hddp_stats *stats) {
+    if (stats->rounds > 0) {
+        stats->round_end = time_msec();
+    }
+}
+
 uint8_t handle_hdt_request_packets(struct packet *pkt){
     int table_port = 0; //varible auxiliar para puertp
     int response_reply = 1; //variable para responder o no con reply
     int num_ports = 0; //numero de puertos disponibles (son todos menos los utilizados por los sensores y caidos)
+    struct hddp_stats *stats = &pkt->dp->hddp_stats;
 
     /*Contamos numero de paquetes request*/
-    log_count_request_pks("Request Detectado\n");
+    stats->requests_rx++;
 
     VLOG_INFO(LOG_MODULE, "Calculamos el puerto de entrada y el numero de puertos disponible");
-    num_ports = num_port_available(&neighbor_table, pkt->dp);
-    table_port = mac_to_port_found_port(&bt_table, pkt->handle_std->proto->eth->eth_src);
+    num_ports = num_port_available(&pkt->dp->neighbor_table, pkt->dp);
+    table_port = mac_to_port_found_port(&pkt->dp->bt_table, pkt->handle_std->proto->eth->eth_src);
     VLOG_INFO(LOG_MODULE, "Puerto: entrada %d | Puerto en tabla: %d | Numero de puertos disponibles: %d", 
         pkt->in_port, table_port ,num_ports);
 
     if (table_port == -1 ) //Puerto no encontrado
     {
         VLOG_INFO(LOG_MODULE, "Anyado entrada a la tabla de bloqueo: %d", pkt->in_port);
-        mac_to_port_add(&bt_table, pkt->handle_std->proto->eth->eth_src, 1, pkt->in_port, BT_TIME);
+        mac_to_port_add(&pkt->dp->bt_table, pkt->handle_std->proto->eth->eth_src, 1, pkt->in_port, pkt->dp->hddp_config.bt_lifetime);
+        hddp_round_start(stats);
         response_reply = 0; 
     }
     else if (table_port == 0 ) //puerto encontrado pero caducado
     {
         VLOG_INFO(LOG_MODULE, "actualizo el puerto de la entrada de tabla BT al puerto: %d", pkt->in_port);
-        mac_to_port_update(&bt_table, pkt->handle_std->proto->eth->eth_src, 1, pkt->in_port, BT_TIME);
+        mac_to_port_update(&pkt->dp->bt_table, pkt->handle_std->proto->eth->eth_src, 1, pkt->in_port, pkt->dp->hddp_config.bt_lifetime);
+        hddp_round_start(stats);
         response_reply = 0; 
     }
     else if (table_port == pkt->in_port){ //Puerto encontrado y valido, comparamos con el de entrada
         VLOG_INFO(LOG_MODULE, "actualizo el tiempo de la entrada de tabla BT");
-        mac_to_port_time_refresh(&bt_table, pkt->handle_std->proto->eth->eth_src, BT_TIME);
+        mac_to_port_time_refresh(&pkt->dp->bt_table, pkt->handle_std->proto->eth->eth_src, pkt->dp->hddp_config.bt_lifetime);
         response_reply = 0; 
     } 
     
@@ -765,9 +895,10 @@ uint8_t handle_hdt_request_packets(struct packet *pkt){
     if (num_ports == 1 || response_reply == 1){
         VLOG_INFO(LOG_MODULE, "Entramos en generar el reply: num_ports: %d | response_reply: %d", num_ports, response_reply);
         VLOG_INFO(LOG_MODULE, "Request detectado pasamos a crear los Replys de contestacion");
-        log_uah("Envio Replies:\n", pkt->dp->id);
-        visualizar_tabla(&bt_table, pkt->dp->id);
+        hddp_trace(pkt->dp, "Envio Replies:\n");
+        stats->requests_answered++;
         creator_dht_reply_packets(pkt);
+        hddp_round_update(stats);
         VLOG_INFO(LOG_MODULE, "Replies enviado pasamos eliminar el Request");
         return 1;
     }
@@ -777,8 +908,8 @@ uint8_t handle_hdt_request_packets(struct packet *pkt){
         update_data_request(pkt);
         VLOG_INFO(LOG_MODULE,"Update number of jump: %d ",
             bigtolittle16(pkt->handle_std->proto->dht->num_devices));
-        log_uah("Envio Request:\n", pkt->dp->id);
-        visualizar_tabla(&bt_table, pkt->dp->id);
+        hddp_trace(pkt->dp, "Envio Request:\n");
+        stats->requests_fwd++;
         dp_actions_output_port(pkt, OFPP_FLOOD, pkt->out_queue, pkt->out_port_max_len, 0xffffffffffffffff);
         return 1;
     }
@@ -787,19 +918,20 @@ uint8_t handle_hdt_request_packets(struct packet *pkt){
 
 uint8_t handle_hdt_reply_packets(struct packet *pkt){
 
-    uint32_t out_port = mac_to_port_found_port(&bt_table, pkt->handle_std->proto->eth->eth_dst);
+    uint32_t out_port = mac_to_port_found_port(&pkt->dp->bt_table, pkt->handle_std->proto->eth->eth_dst);
     uint16_t num_elementos = 0;
     uint16_t type_device = 1;
 
     if (out_port < 1){
         VLOG_INFO(LOG_MODULE,"ERROR!!!! DON'T found any out_port!!!!");
+        pkt->dp->hddp_stats.replies_dropped++;
         return 0;
     }
     else
     {
          /** Soy un sensor indico que sensor soy */
-        if (pkt->dp->id >= 0x1000 )
-            type_device = type_sensor;
+        if (dp_hddp_is_sensor(pkt->dp))
+            type_device = pkt->dp->hddp_config.sensor_type;
         else /** Como no soy un sensor, soy un NO SDN */
             type_device = NODO_NO_SDN; 
 
@@ -808,8 +940,8 @@ uint8_t handle_hdt_reply_packets(struct packet *pkt){
 
         if (pkt->in_port == out_port){
             VLOG_INFO(LOG_MODULE, "ERROR!!! El puerto de entrada y salida no pueden ser iguales para un paquete unicast");
-            log_uah("ERROR!!! El puerto de entrada y salida no pueden ser iguales para un paquete unicast\n",pkt->dp->id);
-            visualizar_tabla(&bt_table, pkt->dp->id);
+            hddp_trace(pkt->dp, "ERROR!!! El puerto de entrada y salida no pueden ser iguales para un paquete unicast\n");
+            pkt->dp->hddp_stats.replies_dropped++;
             return 0;
         }
 
@@ -819,10 +951,14 @@ uint8_t handle_hdt_reply_packets(struct packet *pkt){
         if(num_elementos == 0){ // Indica qeu tenemos hueco en el paquete para enviar 
             //visualizar_tabla(mac_port, pkt->dp->id);
             dp_actions_output_port(pkt, out_port, pkt->out_queue, pkt->out_port_max_len, 0xffffffffffffffff);
+            pkt->dp->hddp_stats.replies_relayed++;
+            hddp_round_update(&pkt->dp->hddp_stats);
         }
-        else
+        else {
             VLOG_INFO(LOG_MODULE, "Se ha sobrepasado el numero de elementos maximos en el paquete: %d"
                 ,num_elementos);
+            pkt->dp->hddp_stats.replies_overflow++;
+        }
                 
         return 1;
     }    
@@ -835,14 +971,17 @@ void creator_dht_reply_packets(struct packet *pkt){
     struct packet *pkt_reply = NULL;
     uint8_t Mac[ETH_ADDR_LEN]={0};
     uint16_t type_device = 1;
+    struct hddp_delta *delta = &pkt->dp->hddp_delta;
+
+    hddp_delta_round(delta, ntohl(pkt->handle_std->proto->dht->seq));
 
-    if (neighbor_table.num_element == 0 || (SENSOR_TO_SENSOR == 1)) // no tengo sensores solo mando mi información
+    if (pkt->dp->neighbor_table.num_element == 0 || pkt->dp->hddp_config.sensor_to_sensor) // no tengo sensores solo mando mi información
     {
         VLOG_INFO(LOG_MODULE, "neighbor_table.num_element == 0");
         //en este caso el puerto salida y el puerto de entrada es el mismo ya que contesto a un reply
         //genero el paquete de respuesta
-        if (pkt->dp->id >= 0x1000 ){ /** Soy un sensor indico que sensor soy */
-            type_device = type_sensor;
+        if (dp_hddp_is_sensor(pkt->dp)){ /** Soy un sensor indico que sensor soy */
+            type_device = pkt->dp->hddp_config.sensor_type;
             VLOG_INFO(LOG_MODULE, "Son un sensor tipo :%d",type_device);
         }
         else /** Como no soy un sensor, soy un NO SDN */
@@ -850,12 +989,20 @@ void creator_dht_reply_packets(struct packet *pkt){
             type_device = NODO_NO_SDN; 
             VLOG_INFO(LOG_MODULE, "Son un NO SDN:%d",NODO_NO_SDN);
         }
-        VLOG_INFO(LOG_MODULE, "Numero de elementos: %d", (int)(neighbor_table.num_element + 1));
+        VLOG_INFO(LOG_MODULE, "Numero de elementos: %d", (int)(pkt->dp->neighbor_table.num_element + 1));
+        //en modo delta no se repite un reply que no ha cambiado
+        if (!hddp_delta_report(delta, pkt->in_port, mac2int(pkt->dp->ports[1].conf->hw_addr),
+                pkt->in_port, type_device)){
+            pkt->dp->hddp_stats.replies_suppressed++;
+            return;
+        }
         pkt_reply = create_dht_reply_packet(pkt->dp, pkt->handle_std->proto->eth->eth_src,pkt->in_port,
-            pkt->in_port, type_device, mac2int(pkt->dp->ports[1].conf->hw_addr), (uint16_t)(neighbor_table.num_element + 1));
+            pkt->in_port, type_device, mac2int(pkt->dp->ports[1].conf->hw_addr), (uint16_t)(pkt->dp->neighbor_table.num_element + 1),
+            pkt->handle_std->proto->dht->seq);
         VLOG_INFO(LOG_MODULE, "create_dht_reply_packet OK");
         //envio el paquete por el puerto de entrada
         dp_actions_output_port(pkt_reply, pkt->in_port, pkt->out_queue, pkt->out_port_max_len, 0xffffffffffffffff);
+        pkt->dp->hddp_stats.replies_tx++;
         VLOG_INFO(LOG_MODULE, "dp_actions_output_port OK OUT PORT : %d", pkt->in_port);
         //destruyo el paquete para limpiar la memoria
         if (pkt_reply){
@@ -866,19 +1013,24 @@ void creator_dht_reply_packets(struct packet *pkt){
     }
     else {
         //debemos generar todos los paquetes replies que pertenecen a un mismo request
-        VLOG_INFO(LOG_MODULE, "Tenemos sensores que transmitir!!!-> %d", (int)neighbor_table.num_element);
-        for (pos_sensor = 0; pos_sensor < neighbor_table.num_element; pos_sensor ++){
+        VLOG_INFO(LOG_MODULE, "Tenemos sensores que transmitir!!!-> %d", (int)pkt->dp->neighbor_table.num_element);
+        for (pos_sensor = 0; pos_sensor < pkt->dp->neighbor_table.num_element; pos_sensor ++){
             VLOG_INFO(LOG_MODULE, "comenzamos con el sensor %lu",pos_sensor);
             //buscamos el puerto de salida para llegar al controller
-            out_port = mac_to_port_found_port_position(&neighbor_table, pos_sensor);
-            type_device = mac_to_port_found_mac_position(&neighbor_table, pos_sensor, Mac); 
+            out_port = mac_to_port_found_port_position(&pkt->dp->neighbor_table, pos_sensor);
+            type_device = mac_to_port_found_mac_position(&pkt->dp->neighbor_table, pos_sensor, Mac); 
             VLOG_INFO(LOG_MODULE, "Puerto de conexion el sensor: %d",(int)out_port);
             VLOG_INFO(LOG_MODULE, "Sensory type : %d", (int)type_device);
             //solo nos valen los sensores que no hayan caducado
             if (out_port > 0 && type_device > 0){
+                if (!hddp_delta_report(delta, pkt->in_port, mac2int(Mac), out_port, type_device)){
+                    pkt->dp->hddp_stats.replies_suppressed++;
+                    continue;
+                }
                 //Creamos el paquete con la información del sensore y el nodo
                 pkt_reply = create_dht_reply_packet(pkt->dp, pkt->handle_std->proto->eth->eth_src,
-                    out_port, pkt->in_port, type_device, mac2int(Mac), (uint16_t)neighbor_table.num_element);
+                    out_port, pkt->in_port, type_device, mac2int(Mac), (uint16_t)pkt->dp->neighbor_table.num_element,
+                    pkt->handle_std->proto->dht->seq);
                 VLOG_INFO(LOG_MODULE, "Send Reply packet with sensor information!!!!!!");
                 //una vez localizado el puerto conexion con el sensor, el puerto de salida del mensaje
                 //es el puerto de entrada del request
@@ -886,6 +1038,7 @@ void creator_dht_reply_packets(struct packet *pkt){
                 VLOG_INFO(LOG_MODULE, "Send via in port: %d", out_port);
                 //enviamos el paquete
                 dp_actions_output_port(pkt_reply, out_port, pkt->out_queue, pkt->out_port_max_len, 0xffffffffffffffff);
+                pkt->dp->hddp_stats.replies_tx++;
                 VLOG_INFO(LOG_MODULE, "Send via in port: %d", out_port);
                 //destruyo el paquete para limpiar la memoria
                 if (pkt_reply){
@@ -34,14 +34,8 @@ struct sender;
  ****************************************************************************/
 
 /*Modificacion UAH Discovery hybrid topologies, JAH-*/
-//vecinos globales para asi poder pasar y seleccionar envios
-
-extern struct mac_to_port neighbor_table, bt_table;
-//tiempo de vida del sensor 1.5 segundos]
-#define TIME_HELLO_SENSOR 1.5 
-//tiempo de vida del controlador en la tabla de controladores debe ser mas 
-//pequeño que el tiempo entre refresco del controlador
-#define BT_TIME 20
+//las tablas de vecinos y de bloqueo estan en cada datapath (dp->neighbor_table, dp->bt_table)
+//los tiempos de vida de las tablas estan en dp->hddp_config (dp_hddp.h)
 
 //Tipos de dispositivos 
 #define NODO_SDN 1
@@ -65,6 +59,11 @@ pipeline_create(struct datapath *dp);
 void
 pipeline_process_packet(struct pipeline *pl, struct packet *pkt);
 
+/* Sorts the instructions of a flow_mod message and checks them, along with
+ * its table id, against the capabilities of the pipeline. */
+ofl_err
+pipeline_validate_flow_mod(struct pipeline *pl, struct ofl_msg_flow_mod *msg);
+
 /* Handles a flow_mod message. */
 ofl_err
 pipeline_handle_flow_mod(struct pipeline *pl, struct ofl_msg_flow_mod *msg,
@@ -28,6 +28,7 @@
 #include "daemon.h"
 #include "datapath.h"
 #include "fault.h"
+#include "netdev.h"
 #include "openflow/openflow.h"
 #include "poll-loop.h"
 #include "queue.h"
@@ -46,17 +47,6 @@
 #define THIS_MODULE VLM_udatapath
 #include "vlog.h"
 
-/*Modificacion UAH Discovery hybrid topologies, JAH- */
-#include <time.h>
-#include <sys/time.h>
-
-#define TIME_SEND 1 // enviamos cada segundo para mayor precision en los sensores
-#define TIME_DELETE_NG 1.5 //tiempo de borrado de tabla de vecinos
-#define TIME_DELETE_BT 5 //tiempo de borrado de tabla de vecinos
-#define NUMERO_TIPO_SENSORES 13 //numero de tipos de sensores distintos
-
-/* FIn Modificacion UAH Discovery hybrid topologies, JAH- */
-
 int udatapath_cmd(int argc, char *argv[]);
 
 static void parse_options(struct datapath *dp, int argc, char *argv[]);
@@ -71,12 +61,8 @@ static void add_ports(struct datapath *dp, char *port_list);
 
 static bool use_multiple_connections = false;
 
-/*Modificacion UAH Discovery hybrid topologies, JAH-*/
-extern struct packet *pkt_hello;
-extern struct mac_to_port neighbor_table, bt_table;
-extern uint16_t type_sensor;
-extern uint8_t SENSOR_TO_SENSOR;
-/*FIN Modificacion UAH Discovery hybrid topologies, JAH-*/
+/* Write logs and HDDP traces from a separate thread (--log-async). */
+static bool log_async = false;
 
 /* Need to treat this more generically */
 #if defined(UDATAPATH_AS_LIB)
@@ -103,11 +89,6 @@ udatapath_cmd(int argc, char *argv[])
     int n_listeners;
     int error;
     int i;
-    /*Modificacion UAH Discovery hybrid topologies, JAH-*/
-    uint64_t hellotime = 0, deletetime = 0, deletetimeBT = 0;
-    /** Cambiamos de modo 0 (sin conexiones entre sensores) o modo 1 (con conexion entre sensores) */
-    SENSOR_TO_SENSOR = 1 ; 
-    /*Fin Modificacion UAH Discovery hybrid topologies, JAH-*/
 
     set_program_name(argv[0]);
     register_fault_handlers();
@@ -174,48 +155,19 @@ udatapath_cmd(int argc, char *argv[])
 
     die_if_already_running();
     daemonize();
+    if (log_async) {
+        vlog_async_start();
+    }
 
     /*Modificacion UAH Discovery hybrid topologies, JAH-*/
-    if (dp->id >= 0x1000) //establecemis el tipo de sensor que somos
-    {
-        VLOG_INFO(THIS_MODULE,"Somos un sensor con ID: %lu", dp->id);
-        type_sensor = (int)(rand() % NUMERO_TIPO_SENSORES)+3;
-        //Creamos el nuevo paquete hello con la informacion de tipo de device
-        if (SENSOR_TO_SENSOR == 0)
-            pkt_hello = packet_hello_create(dp, 0, 1);
-    
-    }
+    /* Los temporizadores de HDDP se ejecutan desde dp_run(). */
+    dp_hddp_start(dp);
     /*Fin Modificacion UAH Discovery hybrid topologies, JAH-*/
 
     for (;;) {
         dp_run(dp);
         dp_wait(dp);
         poll_block();
-        
-        /*Modificacion UAH Discovery hybrid topologies, JAH-*/
-        //enviamos solo si estamos simulando un sensor (id > 100000)
-        if((time_msec() - hellotime >= TIME_SEND*1000) && (dp->id >= 0x1000) && (SENSOR_TO_SENSOR == 0))
-        {
-            VLOG_INFO(THIS_MODULE,"Enviamos Hello al gateway");
-            packet_hello_send(); //lanzamos el paquete de hello
-            hellotime = time_msec();
-        }
-        /* Limpieza de dispositivos sin conexion */
-        if((time_msec() - deletetime >= TIME_DELETE_NG*1000) && (SENSOR_TO_SENSOR == 0))
-        {
-            VLOG_INFO(THIS_MODULE,"Borramos los Vecinos antiguos");
-            //Borramos tabla de vecinos para permitir movilidad de sensores
-            mac_to_port_delete_timeout(&neighbor_table);
-            deletetime = time_msec();
-        }
-        if((time_msec() - deletetimeBT >= TIME_DELETE_BT*1000))
-        {
-            VLOG_INFO(THIS_MODULE,"Borramos los bloqueos antiguos");
-            //Borramos tabla de vecinos para permitir movilidad de sensores
-            mac_to_port_delete_timeout(&neighbor_table);
-            deletetimeBT = time_msec();
-        }
-        /*Fin Modificacion UAH Discovery hybrid topologies, JAH-*/
     }
 
     return 0;
@@ -250,7 +202,13 @@ parse_options(struct datapath *dp, int argc, char *argv[])
         OPT_SERIAL_NUM,
         OPT_BOOTSTRAP_CA_CERT,
         OPT_NO_LOCAL_PORT,
-        OPT_NO_SLICING
+        OPT_NO_SLICING,
+        OPT_SW_QUEUES,
+        OPT_TAP_QUEUES,
+        OPT_LOG_ASYNC,
+        OPT_LOG_RATE,
+        OPT_HDDP_DELTA,
+        OPT_HDDP
     };
 
     static struct option long_options[] = {
@@ -263,11 +221,17 @@ parse_options(struct datapath *dp, int argc, char *argv[])
         {"help",        no_argument, 0, 'h'},
         {"version",     no_argument, 0, 'V'},
         {"no-slicing",  no_argument, 0, OPT_NO_SLICING},
+        {"sw-queues",   optional_argument, 0, OPT_SW_QUEUES},
+        {"tap-queues",  required_argument, 0, OPT_TAP_QUEUES},
         {"mfr-desc",    required_argument, 0, OPT_MFR_DESC},
         {"hw-desc",     required_argument, 0, OPT_HW_DESC},
         {"sw-desc",     required_argument, 0, OPT_SW_DESC},
         {"dp_desc",  required_argument, 0, OPT_DP_DESC},
         {"serial_num",  required_argument, 0, OPT_SERIAL_NUM},
+        {"log-async",   no_argument, 0, OPT_LOG_ASYNC},
+        {"log-rate",    required_argument, 0, OPT_LOG_RATE},
+        {"hddp-delta",  optional_argument, 0, OPT_HDDP_DELTA},
+        {"hddp",        required_argument, 0, OPT_HDDP},
         DAEMON_LONG_OPTIONS,
 #ifdef HAVE_OPENSSL
         VCONN_SSL_LONG_OPTIONS
@@ -360,6 +324,60 @@ parse_options(struct datapath *dp, int argc, char *argv[])
             dp_set_max_queues(dp, 0);
             break;
 
+        case OPT_SW_QUEUES: {
+            enum dp_sched_mode mode = DP_SCHED_DRR;
+            uint64_t rate = 0;
+            const char *arg = optarg ? optarg : "";
+            const char *mbps = strchr(arg, ':');
+            size_t len = mbps ? (size_t) (mbps - arg) : strlen(arg);
+
+            if (len == strlen("strict") && !strncmp(arg, "strict", len)) {
+                mode = DP_SCHED_STRICT;
+            } else if (len && (len != strlen("drr") || strncmp(arg, "drr", len))) {
+                ofp_fatal(0, "argument to --sw-queues must be drr or strict");
+            }
+            if (mbps) {
+                rate = strtoull(mbps + 1, NULL, 10) * 1000000 / 8;
+                if (rate == 0) {
+                    ofp_fatal(0, "link rate of --sw-queues must be at least 1 Mbps");
+                }
+            }
+            dp_set_sched(dp, mode, rate);
+            break;
+        }
+
+        case OPT_TAP_QUEUES: {
+            int n = atoi(optarg);
+            if (n < 1 || n > NETDEV_MAX_TAP_QUEUES) {
+                ofp_fatal(0, "argument to --tap-queues must be between 1 "
+                          "and %d", NETDEV_MAX_TAP_QUEUES);
+            }
+            netdev_set_tap_queues(n);
+            break;
+        }
+
+        case OPT_LOG_ASYNC:
+            log_async = true;
+            break;
+
+        case OPT_HDDP_DELTA:
+            dp->hddp_delta.enabled = true;
+            if (optarg) {
+                dp->hddp_delta.full_every = atoi(optarg);
+                if (dp->hddp_delta.full_every < 1) {
+                    ofp_fatal(0, "argument to --hddp-delta must be at least 1");
+                }
+            }
+            break;
+
+        case OPT_LOG_RATE: {
+            char *error = vlog_set_rate_limit_from_string(optarg);
+            if (error) {
+                ofp_fatal(0, "--log-rate: %s", error);
+            }
+            break;
+        }
+
         DAEMON_OPTION_HANDLERS
 
 #ifdef HAVE_OPENSSL
@@ -399,14 +417,35 @@ usage(void)
            "  -m, --multiconn         enable multiple connections to the\n"
            "                          same controller.\n"
            "  --no-slicing            disable slicing\n"
+           "  --sw-queues[=drr|strict][:MBPS]\n"
+           "                          schedule the port queues in userspace\n"
+           "                          instead of with tc, sharing spare\n"
+           "                          bandwidth by deficit round robin\n"
+           "                          (default) or strict priority, on links\n"
+           "                          of MBPS (default: the port speed)\n"
+           "  --tap-queues=N          open tap ports, the local one among\n"
+           "                          them, with N queues (default: 1)\n"
+           "  --hddp-delta[=N]        only send the HDDP replies that changed,\n"
+           "                          with a full answer every N rounds\n"
+           "                          (default: %d)\n"
+           "  --hddp=KEY=VALUE[,KEY=VALUE]...\n"
+           "                          set HDDP timers (in ms) and role:\n"
+           "                          hello, hello-lifetime, bt-lifetime,\n"
+           "                          neighbor-sweep, bt-sweep, sensor-type,\n"
+           "                          role=auto|switch|gateway|sensor,\n"
+           "                          sensor-to-sensor=on|off\n"
            "\nOther options:\n"
            "  -D, --detach            run in background as daemon\n"
            "  -P, --pidfile[=FILE]    create pidfile (default: %s/ofdatapath.pid)\n"
            "  -f, --force             with -P, start even if already running\n"
            "  -v, --verbose=MODULE[:FACILITY[:LEVEL]]  set logging levels\n"
            "  -v, --verbose           set maximum verbosity level\n"
+           "  --log-async             write logs and traces from a separate\n"
+           "                          thread\n"
+           "  --log-rate=MODULE:RATE[:BURST]  limit MODULE (or ANY) to RATE\n"
+           "                          log messages per minute\n"
            "  -h, --help              display this help message\n"
            "  -V, --version           display version information\n",
-        ofp_rundir);
+        HDDP_DELTA_FULL_EVERY, ofp_rundir);
     exit(EXIT_SUCCESS);
 }
@@ -5,6 +5,9 @@ bin_PROGRAMS += \
 	utilities/ofp-kill
 bin_SCRIPTS += utilities/ofp-pki
 noinst_PROGRAMS += \
+	utilities/ofp-bench-pack \
+	utilities/ofp-bench-tx \
+	utilities/ofp-bench-unpack \
 	utilities/ofp-read
 
 EXTRA_DIST += \
@@ -43,6 +46,15 @@ utilities_ofp_discover_LDADD = lib/libopenflow.a
 utilities_ofp_kill_SOURCES = utilities/ofp-kill.c
 utilities_ofp_kill_LDADD = lib/libopenflow.a
 
+utilities_ofp_bench_pack_SOURCES = utilities/ofp-bench-pack.c
+utilities_ofp_bench_pack_LDADD = lib/libopenflow.a oflib/liboflib.a
+
+utilities_ofp_bench_tx_SOURCES = utilities/ofp-bench-tx.c
+utilities_ofp_bench_tx_LDADD = lib/libopenflow.a oflib/liboflib.a oflib-exp/liboflib_exp.a $(SSL_LIBS)
+
+utilities_ofp_bench_unpack_SOURCES = utilities/ofp-bench-unpack.c
+utilities_ofp_bench_unpack_LDADD = lib/libopenflow.a oflib/liboflib.a
+
 utilities_ofp_read_SOURCES = utilities/ofp-read.c
 utilities_ofp_read_LDADD = lib/libopenflow.a oflib/liboflib.a
 
@@ -202,11 +202,21 @@ static struct ofl_exp_msg dpctl_exp_msg =
          .free      = ofl_exp_msg_free,
          .to_string = ofl_exp_msg_to_string};
 
+static struct ofl_exp_stats dpctl_exp_multipart =
+        {.req_pack        = ofl_exp_stats_req_pack,
+         .req_unpack      = ofl_exp_stats_req_unpack,
+         .req_free        = ofl_exp_stats_req_free,
+         .req_to_string   = ofl_exp_stats_req_to_string,
+         .reply_pack      = ofl_exp_stats_reply_pack,
+         .reply_unpack    = ofl_exp_stats_reply_unpack,
+         .reply_free      = ofl_exp_stats_reply_free,
+         .reply_to_string = ofl_exp_stats_reply_to_string};
+
 static struct ofl_exp dpctl_exp =
         {.act   = NULL,
          .inst  = NULL,
          .match = NULL,
-         .stats = NULL,
+         .stats = &dpctl_exp_multipart,
          .msg   = &dpctl_exp_msg};
 
 
@@ -601,9 +611,10 @@ set_config(struct vconn *vconn, int argc UNUSED, char *argv[]) {
 
 
 
+/* Fills in a flow_mod message from the arguments of the flow-mod command. */
 static void
-flow_mod(struct vconn *vconn, int argc, char *argv[]) {
-    struct ofl_msg_flow_mod msg =
+make_flow_mod(int argc, char *argv[], struct ofl_msg_flow_mod *msg) {
+    struct ofl_msg_flow_mod init =
             {{.type = OFPT_FLOW_MOD},
              .cookie = 0x0000000000000000ULL,
              .cookie_mask = 0x0000000000000000ULL,
@@ -620,19 +631,20 @@ flow_mod(struct vconn *vconn, int argc, char *argv[]) {
              .instructions_num = 0,
              .instructions = NULL};
 
-    parse_flow_mod_args(argv[0], &msg);
+    *msg = init;
+    parse_flow_mod_args(argv[0], msg);
     if (argc > 1) {
         size_t i, j;
         size_t inst_num = 0;
         if (argc > 2){
             inst_num = argc - 2;
             j = 2;
-            parse_match(argv[1], &(msg.match));
+            parse_match(argv[1], &(msg->match));
         }
         else {
-            if(msg.command == OFPFC_DELETE) {
+            if(msg->command == OFPFC_DELETE) {
                 inst_num = 0;
-                parse_match(argv[1], &(msg.match));
+                parse_match(argv[1], &(msg->match));
             } else {
                 /*We copy the value because we don't know if
                 it is an instruction or match.
@@ -640,23 +652,30 @@ flow_mod(struct vconn *vconn, int argc, char *argv[]) {
                 causing errors to instructions parsing*/
                 char *cpy = malloc(strlen(argv[1])+1);
                 memcpy(cpy, argv[1], strlen(argv[1]) + 1); 
-                parse_match(cpy, &(msg.match));
+                parse_match(cpy, &(msg->match));
                 free(cpy);
-                if(msg.match->length <= 4){
+                if(msg->match->length <= 4){
                     inst_num = argc - 1;
                     j = 1;
                 }
             }
         }
 
-        msg.instructions_num = inst_num;
-        msg.instructions = xmalloc(sizeof(struct ofl_instruction_header *) * inst_num);
+        msg->instructions_num = inst_num;
+        msg->instructions = xmalloc(sizeof(struct ofl_instruction_header *) * inst_num);
         for (i=0; i < inst_num; i++) {
-            parse_inst(argv[j+i], &(msg.instructions[i]));
+            parse_inst(argv[j+i], &(msg->instructions[i]));
         }
     } else {
-        make_all_match(&(msg.match));
+        make_all_match(&(msg->match));
     }
+}
+
+static void
+flow_mod(struct vconn *vconn, int argc, char *argv[]) {
+    struct ofl_msg_flow_mod msg;
+
+    make_flow_mod(argc, argv, &msg);
     dpctl_send_and_print(vconn, (struct ofl_msg_header *)&msg);
 }
 
@@ -832,6 +851,209 @@ set_desc(struct vconn *vconn, int argc UNUSED, char *argv[]) {
 
 
 
+static void
+stats_hddp(struct vconn *vconn, int argc UNUSED, char *argv[] UNUSED) {
+    struct ofl_exp_openflow_msg_multipart_request req =
+            {{{{.type = OFPT_MULTIPART_REQUEST},
+               .type = OFPMP_EXPERIMENTER, .flags = 0x0000},
+              .experimenter_id = OPENFLOW_VENDOR_ID},
+             .type = OFPEMP_HDDP};
+
+    dpctl_transact_and_print(vconn, (struct ofl_msg_header *)&req, NULL);
+}
+
+
+
+/* Prints the latency histograms of the switch, after turning measuring on
+ * or off, or clearing the histograms. */
+static void
+latency(struct vconn *vconn, int argc, char *argv[]) {
+    struct ofl_exp_openflow_msg_latency_request msg =
+            {{{{.type = OFPT_EXPERIMENTER},
+               .experimenter_id = OPENFLOW_VENDOR_ID},
+              .type = OFP_EXT_LATENCY_REQUEST},
+             .command = OFPELC_GET};
+
+    if (argc > 0) {
+        if (strcmp(argv[0], "on") == 0) {
+            msg.command = OFPELC_ENABLE;
+        } else if (strcmp(argv[0], "off") == 0) {
+            msg.command = OFPELC_DISABLE;
+        } else if (strcmp(argv[0], "reset") == 0) {
+            msg.command = OFPELC_RESET;
+        } else {
+            ofp_fatal(0, "Error parsing latency command: %s.", argv[0]);
+        }
+    }
+
+    dpctl_transact_and_print(vconn, (struct ofl_msg_header *)&msg, NULL);
+}
+
+
+
+/* Prints the HDDP timers and role of the switch, after changing the ones
+ * given as KEY=VALUE,... */
+static void
+hddp_config(struct vconn *vconn, int argc, char *argv[]) {
+    struct ofl_exp_openflow_msg_hddp_config msg =
+            {{{{.type = OFPT_EXPERIMENTER},
+               .experimenter_id = OPENFLOW_VENDOR_ID},
+              .type = OFP_EXT_HDDP_CONFIG_REQUEST},
+             .fields = 0};
+
+    if (argc > 0) {
+        char *error = ofl_exp_openflow_hddp_config_parse(argv[0], &msg);
+        if (error != NULL) {
+            ofp_fatal(0, "Error parsing hddp-config: %s.", error);
+        }
+    }
+
+    dpctl_transact_and_print(vconn, (struct ofl_msg_header *)&msg, NULL);
+}
+
+
+
+/* Sends a bundle control message and waits for its reply. */
+static void
+bundle_control(struct vconn *vconn, uint32_t id, uint16_t type) {
+    struct ofl_exp_openflow_msg_bundle_ctrl msg =
+            {{{{.type = OFPT_EXPERIMENTER},
+               .experimenter_id = OPENFLOW_VENDOR_ID},
+              .type = OFP_EXT_BUNDLE_CONTROL},
+             .bundle_id = id,
+             .type = type,
+             .flags = OFPEBF_ATOMIC | OFPEBF_ORDERED};
+    struct ofl_msg_header *reply;
+
+    dpctl_transact_and_print(vconn, (struct ofl_msg_header *)&msg, &reply);
+    if (reply->type == OFPT_ERROR) {
+        ofp_fatal(0, "Bundle %u was not applied.", id);
+    }
+    ofl_msg_free(reply, &dpctl_exp);
+}
+
+/* Sends a message of a bundle with the given xid, without waiting for a
+ * reply: the switch only answers those it rejects. */
+static void
+bundle_send(struct vconn *vconn, struct ofl_msg_header *msg, uint32_t xid) {
+    struct ofpbuf *ofpbuf;
+    uint8_t *buf;
+    size_t buf_size;
+
+    if (ofl_msg_pack(msg, xid, &buf, &buf_size, &dpctl_exp)) {
+        ofp_fatal(0, "Error packing message %u.", xid);
+    }
+    ofpbuf = ofpbuf_new(0);
+    ofpbuf_use(ofpbuf, buf, buf_size);
+    ofpbuf_put_uninit(ofpbuf, buf_size);
+    if (vconn_send_block(vconn, ofpbuf)) {
+        ofp_fatal(0, "Error sending message %u.", xid);
+    }
+}
+
+/* Checks a message received while flow mods are added to bundle 'id', each
+ * sent with xid 'id' plus its number. An error discards the bundle and exits.
+ * Returns true if the message is the reply to the barrier with xid
+ * 'barrier_xid'. */
+static bool
+bundle_check_reply(struct vconn *vconn, uint32_t id, uint32_t barrier_xid,
+                   struct ofpbuf *buf) {
+    struct ofl_msg_header *msg;
+    uint32_t xid;
+    bool done;
+
+    if (ofl_msg_unpack(buf->data, buf->size, &msg, &xid, &dpctl_exp)) {
+        ofp_fatal(0, "Error unpacking reply.");
+    }
+    /* NOTE: the message takes over ownership of buffer's data. */
+    buf->base = NULL;
+    buf->data = NULL;
+    ofpbuf_delete(buf);
+
+    if (msg->type == OFPT_ERROR) {
+        char *str = ofl_msg_to_string(msg, &dpctl_exp);
+
+        printf("\nRECEIVED (xid=0x%X):\n%s\n\n", xid, str);
+        free(str);
+        ofl_msg_free(msg, &dpctl_exp);
+        bundle_control(vconn, id, OFPEBCT_DISCARD_REQUEST);
+        ofp_fatal(0, "Flow mod %u was rejected, bundle %u discarded.", xid - id, id);
+    }
+    done = msg->type == OFPT_BARRIER_REPLY && xid == barrier_xid;
+    ofl_msg_free(msg, &dpctl_exp);
+    return done;
+}
+
+/* Applies the flow mods in a file, one per line with the arguments of the
+ * flow-mod command, as a single bundle. If the switch rejects any of them,
+ * the bundle is discarded and nothing is applied. */
+static void
+bundle_flows(struct vconn *vconn, int argc UNUSED, char *argv[]) {
+    struct ofl_msg_header barrier = {.type = OFPT_BARRIER_REQUEST};
+    uint32_t id = global_xid;
+    struct ofpbuf *reply;
+    char line[4096];
+    size_t n = 0;
+    FILE *file;
+
+    file = strcmp(argv[0], "-") ? fopen(argv[0], "r") : stdin;
+    if (file == NULL) {
+        ofp_fatal(errno, "%s: open failed", argv[0]);
+    }
+
+    bundle_control(vconn, id, OFPEBCT_OPEN_REQUEST);
+    while (fgets(line, sizeof line, file) != NULL) {
+        struct ofl_exp_openflow_msg_bundle_add msg =
+                {{{{.type = OFPT_EXPERIMENTER},
+                   .experimenter_id = OPENFLOW_VENDOR_ID},
+                  .type = OFP_EXT_BUNDLE_ADD_MESSAGE},
+                 .bundle_id = id,
+                 .flags = OFPEBF_ATOMIC | OFPEBF_ORDERED};
+        struct ofl_msg_flow_mod *mod;
+        char *args[10], *save_ptr = NULL, *token;
+        int n_args = 0;
+
+        for (token = strtok_r(line, " \t\r\n", &save_ptr);
+             token != NULL && token[0] != '#';
+             token = strtok_r(NULL, " \t\r\n", &save_ptr)) {
+            if (n_args == ARRAY_SIZE(args)) {
+                ofp_fatal(0, "Too many arguments in flow mod %zu.", n + 1);
+            }
+            args[n_args++] = token;
+        }
+        if (n_args == 0) {
+            continue;
+        }
+
+        mod = xmalloc(sizeof(struct ofl_msg_flow_mod));
+        make_flow_mod(n_args, args, mod);
+        msg.message = (struct ofl_msg_header *)mod;
+
+        n++;
+        bundle_send(vconn, (struct ofl_msg_header *)&msg, id + n);
+        ofl_msg_free((struct ofl_msg_header *)mod, &dpctl_exp);
+
+        /* Stop at the first flow mod rejected so far. */
+        while (vconn_recv(vconn, &reply) == 0) {
+            bundle_check_reply(vconn, id, 0, reply);
+        }
+    }
+    if (file != stdin) {
+        fclose(file);
+    }
+
+    /* The replies to all the flow mods come before the one to the barrier. */
+    bundle_send(vconn, &barrier, id + n + 1);
+    do {
+        if (vconn_recv_block(vconn, &reply)) {
+            ofp_fatal(0, "Error receiving replies to bundle %u.", id);
+        }
+    } while (!bundle_check_reply(vconn, id, id + n + 1, reply));
+
+    printf("\nAdded %zu flow mods to bundle %u.\n", n, id);
+    bundle_control(vconn, id, OFPEBCT_COMMIT_REQUEST);
+}
+
 static void
 queue_mod(struct vconn *vconn, int argc UNUSED, char *argv[]) {
     struct ofl_packet_queue *pq;
@@ -937,6 +1159,10 @@ static struct command all_commands[] = {
     {"table-mod", 1, 1, table_mod },
     {"queue-get-config", 1, 1, queue_get_config},
     {"set-desc", 1, 1, set_desc},
+    {"bundle-flows", 1, 1, bundle_flows},
+    {"latency", 0, 1, latency},
+    {"stats-hddp", 0, 0, stats_hddp},
+    {"hddp-config", 0, 1, hddp_config},
     {"set-table-match", 0, 2, set_table_features_match},
 
     {"queue-mod", 3, 3, queue_mod},
@@ -1100,6 +1326,13 @@ usage(void)
             "\n"
             "OpenFlow extensions\n"
             "  SWITCH set-desc DESC                   sets the DP description\n"
+            "  SWITCH bundle-flows FILE               applies the flow mods in FILE\n"
+            "                                         as a single transaction\n"
+            "  SWITCH latency [on|off|reset]          prints per-stage latency\n"
+            "                                         histograms of the packet path\n"
+            "  SWITCH stats-hddp                      prints HDDP discovery counters\n"
+            "  SWITCH hddp-config [KEY=VALUE,...]     prints HDDP timers and role,\n"
+            "                                         after setting the given ones\n"
             "  SWITCH queue-mod PORT QUEUE BW         adds/modifies queue\n"
             "  SWITCH queue-del PORT QUEUE            deletes queue\n"
             "\n",
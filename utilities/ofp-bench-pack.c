@@ -0,0 +1,205 @@
+/* 
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/HDDP).
+ * Copyright (c) 2020.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Measures how fast oflib packs a flow stats reply of N_FLOWS entries, sent
+ * as parts of up to 32 KB the way the datapath dumps a flow table.
+ *
+ * Usage: ofp-bench-pack [N_REPLIES [N_FLOWS]]
+ *
+ * Each entry matches on six fields and applies a set-field and two output
+ * actions before going to table 1. The "pack" run is ofl_msg_pack followed by
+ * wrapping the result in an ofpbuf, as the datapath used to send replies. The
+ * "ofpbuf" runs pack each part with ofl_msg_pack_ofpbuf, into an empty buffer
+ * and into one reserved with the length of the part. */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "ofp.h"
+#include "ofpbuf.h"
+#include "oflib/ofl.h"
+#include "oflib/ofl-actions.h"
+#include "oflib/ofl-messages.h"
+#include "oflib/ofl-structs.h"
+#include "openflow/openflow.h"
+#include "timeval.h"
+#include "util.h"
+#include "vlog.h"
+
+/* As FLOW_STATS_PART_LEN in the datapath. */
+#define PART_LEN 32768
+
+enum mode {
+    MODE_PACK,
+    MODE_OFPBUF,
+    MODE_OFPBUF_RESERVED
+};
+
+static double
+now_sec(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static uint8_t eth_dst[ETH_ADDR_LEN] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55};
+static struct ofl_match_tlv field = {.header = OXM_OF_ETH_DST,
+                                     .value = eth_dst};
+static struct ofl_action_set_field set_field = {{.type = OFPAT_SET_FIELD},
+                                                .field = &field};
+static struct ofl_action_output outputs[2] = {
+    {{.type = OFPAT_OUTPUT}, .port = 2, .max_len = 0},
+    {{.type = OFPAT_OUTPUT}, .port = 3, .max_len = 0}
+};
+static struct ofl_action_header *actions[] = {
+    &set_field.header, &outputs[0].header, &outputs[1].header
+};
+static struct ofl_instruction_actions apply = {{.type = OFPIT_APPLY_ACTIONS},
+                                               .actions_num = 3,
+                                               .actions = actions};
+static struct ofl_instruction_goto_table go = {{.type = OFPIT_GOTO_TABLE},
+                                               .table_id = 1};
+static struct ofl_instruction_header *insts[] = {&apply.header, &go.header};
+
+/* Returns the stats of the i-th flow described above. */
+static struct ofl_flow_stats *
+build_flow_stats(int i)
+{
+    struct ofl_flow_stats *stats = xcalloc(1, sizeof *stats);
+    struct ofl_match *match = xmalloc(sizeof *match);
+
+    ofl_structs_match_init(match);
+    ofl_structs_match_put32(match, OXM_OF_IN_PORT, 1);
+    ofl_structs_match_put16(match, OXM_OF_ETH_TYPE, 0x0800);
+    ofl_structs_match_put32(match, OXM_OF_IPV4_SRC, 0x0a000001);
+    ofl_structs_match_put32(match, OXM_OF_IPV4_DST, 0x0a000000 + i);
+    ofl_structs_match_put8(match, OXM_OF_IP_PROTO, 6);
+    ofl_structs_match_put16(match, OXM_OF_TCP_DST, 80);
+
+    stats->table_id = 0;
+    stats->duration_sec = i;
+    stats->priority = 100;
+    stats->cookie = i;
+    stats->packet_count = i * 10;
+    stats->byte_count = i * 1500;
+    stats->match = &match->header;
+    stats->instructions_num = 2;
+    stats->instructions = insts;
+    return stats;
+}
+
+/* Packs all the parts of the reply once. Returns the number of bytes. */
+static size_t
+pack_reply(enum mode mode, struct ofl_flow_stats **stats, int n_flows)
+{
+    size_t total = 0;
+    int first = 0;
+
+    while (first < n_flows) {
+        struct ofl_msg_multipart_reply_flow reply;
+        struct ofpbuf *buf;
+        size_t len = 0;
+        int n = first;
+
+        while (n < n_flows) {
+            size_t entry_len = ofl_structs_flow_stats_ofp_len(stats[n], NULL);
+            if (n > first && len + entry_len > PART_LEN) {
+                break;
+            }
+            len += entry_len;
+            n++;
+        }
+        memset(&reply, 0x00, sizeof reply);
+        reply.header.header.type = OFPT_MULTIPART_REPLY;
+        reply.header.type = OFPMP_FLOW;
+        reply.header.flags = n < n_flows ? OFPMPF_REPLY_MORE : 0;
+        reply.stats = stats + first;
+        reply.stats_num = n - first;
+
+        if (mode == MODE_PACK) {
+            uint8_t *data;
+            size_t data_len;
+
+            if (ofl_msg_pack(&reply.header.header, 1, &data, &data_len, NULL)) {
+                ofp_fatal(0, "could not pack the reply");
+            }
+            buf = ofpbuf_new(0);
+            ofpbuf_use(buf, data, data_len);
+            ofpbuf_put_uninit(buf, data_len);
+        } else {
+            buf = ofpbuf_new(mode == MODE_OFPBUF_RESERVED
+                             ? sizeof(struct ofp_multipart_reply) + len : 0);
+            if (ofl_msg_pack_ofpbuf(&reply.header.header, 1, buf, NULL)) {
+                ofp_fatal(0, "could not pack the reply");
+            }
+        }
+        total += buf->size;
+        ofpbuf_delete(buf);
+        first = n;
+    }
+    return total;
+}
+
+int
+main(int argc, char *argv[])
+{
+    static const char *names[] = {"pack", "ofpbuf", "ofpbuf reserved"};
+    unsigned long n_replies = argc > 1 ? strtoul(argv[1], NULL, 10) : 200;
+    int n_flows = argc > 2 ? atoi(argv[2]) : 10000;
+    struct ofl_flow_stats **stats;
+    int mode, i;
+
+    set_program_name(argv[0]);
+    time_init();
+    vlog_init();
+
+    if (n_replies < 1 || n_flows < 1) {
+        ofp_fatal(0, "N_REPLIES and N_FLOWS must be at least 1");
+    }
+
+    stats = xmalloc(n_flows * sizeof *stats);
+    for (i = 0; i < n_flows; i++) {
+        stats[i] = build_flow_stats(i);
+    }
+
+    for (mode = MODE_PACK; mode <= MODE_OFPBUF_RESERVED; mode++) {
+        size_t bytes = 0;
+        unsigned long n;
+        double start, elapsed;
+
+        start = now_sec();
+        for (n = 0; n < n_replies; n++) {
+            bytes = pack_reply(mode, stats, n_flows);
+        }
+        elapsed = now_sec() - start;
+        printf("%-16s %lu replies of %d flows (%zu bytes): %.3f s, "
+               "%.0f replies/s, %.1f MB/s\n", names[mode], n_replies, n_flows,
+               bytes, elapsed, n_replies / elapsed,
+               bytes * n_replies / elapsed / 1e6);
+    }
+
+    for (i = 0; i < n_flows; i++) {
+        ofl_structs_free_match(stats[i]->match, NULL);
+        free(stats[i]);
+    }
+    free(stats);
+    return 0;
+}
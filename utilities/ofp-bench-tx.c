@@ -0,0 +1,156 @@
+/*
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/HDDP).
+ * Copyright (c) 2020.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Measures how many OpenFlow messages per second an rconn delivers to a local
+ * stand-in controller over the loopback interface.
+ *
+ * Usage: ofp-bench-tx [N_MSGS [MSG_SIZE [BURST [PORT]]]]
+ *
+ * Messages are handed to the rconn in bursts of BURST messages with the rconn
+ * corked, the way the datapath does with packet-ins and multipart replies; a
+ * BURST of 1 sends every message with its own system call. */
+
+#include <config.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "ofp.h"
+#include "ofpbuf.h"
+#include "openflow/openflow.h"
+#include "poll-loop.h"
+#include "rconn.h"
+#include "timeval.h"
+#include "util.h"
+#include "vconn.h"
+#include "vlog.h"
+
+static double
+now_sec(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int
+main(int argc, char *argv[])
+{
+    unsigned long n_msgs = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+    size_t msg_size = argc > 2 ? strtoul(argv[2], NULL, 10) : 128;
+    int burst = argc > 3 ? atoi(argv[3]) : 64;
+    int port = argc > 4 ? atoi(argv[4]) : 16633;
+    unsigned long n_sent = 0, n_rcvd = 0;
+    struct pvconn *pvconn;
+    struct vconn *peer = NULL;
+    struct rconn *rc;
+    char name[64];
+    int n_queued = 0;
+    double start = 0;
+    int retval;
+
+    set_program_name(argv[0]);
+    time_init();
+    vlog_init();
+
+    if (msg_size < sizeof(struct ofp_header) || msg_size > UINT16_MAX
+        || burst < 1) {
+        ofp_fatal(0, "MSG_SIZE must be between %zu and %d, BURST at least 1",
+                  sizeof(struct ofp_header), UINT16_MAX);
+    }
+
+    /* The stand-in controller. */
+    snprintf(name, sizeof name, "ptcp:%d", port);
+    retval = pvconn_open(name, &pvconn);
+    if (retval) {
+        ofp_fatal(retval, "%s", name);
+    }
+
+    snprintf(name, sizeof name, "tcp:127.0.0.1:%d", port);
+    rc = rconn_create(0, 1);
+    rconn_connect(rc, name);
+
+    while (n_rcvd < n_msgs) {
+        struct ofpbuf *b;
+        int i;
+
+        rconn_run(rc);
+        if (peer == NULL) {
+            retval = pvconn_accept(pvconn, OFP_VERSION, &peer);
+            if (retval && retval != EAGAIN) {
+                ofp_fatal(retval, "accept");
+            }
+        }
+
+        if (rconn_is_connected(rc)) {
+            if (!start) {
+                start = now_sec();
+            }
+            rconn_cork(rc);
+            for (i = 0; i < burst && n_sent < n_msgs
+                        && n_queued < TXQ_LIMIT; i++) {
+                make_openflow_xid(msg_size, OFPT_ECHO_REPLY, n_sent, &b);
+                if (rconn_send(rc, b, &n_queued)) {
+                    ofpbuf_delete(b);
+                    break;
+                }
+                n_sent++;
+            }
+            rconn_uncork(rc);
+        }
+
+        while (peer != NULL) {
+            retval = vconn_recv(peer, &b);
+            if (retval) {
+                if (retval != EAGAIN) {
+                    ofp_fatal(retval, "receive");
+                }
+                break;
+            }
+            if (((struct ofp_header *) b->data)->type == OFPT_ECHO_REPLY) {
+                n_rcvd++;
+            }
+            ofpbuf_delete(b);
+        }
+
+        rconn_run_wait(rc);
+        if (peer != NULL) {
+            vconn_recv_wait(peer);
+        } else {
+            pvconn_wait(pvconn);
+        }
+        if (rconn_is_connected(rc) && n_sent < n_msgs
+            && n_queued < TXQ_LIMIT) {
+            poll_immediate_wake();
+        }
+        poll_block();
+    }
+
+    {
+        double elapsed = now_sec() - start;
+        printf("%lu messages of %zu bytes in bursts of %d: %.3f s, "
+               "%.0f msgs/s, %.1f MB/s\n", n_msgs, msg_size, burst, elapsed,
+               n_msgs / elapsed, n_msgs * msg_size / elapsed / 1e6);
+    }
+
+    vconn_close(peer);
+    rconn_destroy(rc);
+    pvconn_close(pvconn);
+    return 0;
+}
@@ -0,0 +1,193 @@
+/* 
+ * This file is part of the HDDP Switch distribution (https://github.com/gistnetserv-uah/HDDP).
+ * Copyright (c) 2020.
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Measures how many flow_mod messages per second oflib unpacks and frees, with
+ * every structure taken from the heap and with the message arena.
+ *
+ * Usage: ofp-bench-unpack [N_MSGS [N_ACTIONS]]
+ *
+ * The flow_mod matches on six fields and applies a set-field and N_ACTIONS
+ * output actions before going to table 1, which is what a controller
+ * installing host routes typically sends. The "arena + copy-out" run also
+ * moves the match and instructions to the heap and frees them, as the
+ * datapath does for the flow mods that add or modify entries. */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "ofp.h"
+#include "oflib/ofl.h"
+#include "oflib/ofl-actions.h"
+#include "oflib/ofl-arena.h"
+#include "oflib/ofl-messages.h"
+#include "oflib/ofl-structs.h"
+#include "openflow/openflow.h"
+#include "timeval.h"
+#include "util.h"
+#include "vlog.h"
+
+/* Same size as the arena of the datapath. */
+#define ARENA_CHUNK 16384
+
+enum mode {
+    MODE_HEAP,
+    MODE_ARENA,
+    MODE_ARENA_COPY_OUT
+};
+
+static double
+now_sec(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/* Packs the flow_mod described above into '*buf'. */
+static void
+build_flow_mod(int n_actions, uint8_t **buf, size_t *buf_len)
+{
+    uint8_t eth_dst[ETH_ADDR_LEN] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55};
+    struct ofl_match *match = xmalloc(sizeof *match);
+    struct ofl_action_set_field set_field;
+    struct ofl_match_tlv field;
+    struct ofl_action_output *outputs;
+    struct ofl_action_header **actions;
+    struct ofl_instruction_actions apply;
+    struct ofl_instruction_goto_table go = {{.type = OFPIT_GOTO_TABLE},
+                                            .table_id = 1};
+    struct ofl_instruction_header *insts[2];
+    struct ofl_msg_flow_mod mod;
+    int i;
+
+    ofl_structs_match_init(match);
+    ofl_structs_match_put32(match, OXM_OF_IN_PORT, 1);
+    ofl_structs_match_put16(match, OXM_OF_ETH_TYPE, 0x0800);
+    ofl_structs_match_put32(match, OXM_OF_IPV4_SRC, 0x0a000001);
+    ofl_structs_match_put32(match, OXM_OF_IPV4_DST, 0x0a000002);
+    ofl_structs_match_put8(match, OXM_OF_IP_PROTO, 6);
+    ofl_structs_match_put16(match, OXM_OF_TCP_DST, 80);
+
+    field.header = OXM_OF_ETH_DST;
+    field.value = eth_dst;
+    set_field.header.type = OFPAT_SET_FIELD;
+    set_field.field = &field;
+
+    outputs = xmalloc(n_actions * sizeof *outputs);
+    actions = xmalloc((n_actions + 1) * sizeof *actions);
+    actions[0] = &set_field.header;
+    for (i = 0; i < n_actions; i++) {
+        outputs[i].header.type = OFPAT_OUTPUT;
+        outputs[i].port = i + 2;
+        outputs[i].max_len = 0;
+        actions[i + 1] = &outputs[i].header;
+    }
+    apply.header.type = OFPIT_APPLY_ACTIONS;
+    apply.actions_num = n_actions + 1;
+    apply.actions = actions;
+    insts[0] = &apply.header;
+    insts[1] = &go.header;
+
+    memset(&mod, 0x00, sizeof mod);
+    mod.header.type = OFPT_FLOW_MOD;
+    mod.command = OFPFC_ADD;
+    mod.table_id = 0;
+    mod.priority = 100;
+    mod.buffer_id = OFP_NO_BUFFER;
+    mod.out_port = OFPP_ANY;
+    mod.out_group = OFPG_ANY;
+    mod.match = &match->header;
+    mod.instructions_num = 2;
+    mod.instructions = insts;
+
+    if (ofl_msg_pack(&mod.header, 1, buf, buf_len, NULL)) {
+        ofp_fatal(0, "could not pack the flow_mod");
+    }
+    ofl_structs_free_match(&match->header, NULL);
+    free(outputs);
+    free(actions);
+}
+
+static double
+run(enum mode mode, const uint8_t *wire, size_t len, unsigned long n_msgs)
+{
+    struct ofl_arena *arena = ofl_arena_create(ARENA_CHUNK);
+    uint8_t *buf = xmalloc(len);
+    unsigned long n;
+    double start;
+
+    start = now_sec();
+    for (n = 0; n < n_msgs; n++) {
+        struct ofl_msg_header *msg;
+        uint32_t xid;
+        ofl_err error;
+
+        /* Unpacking may rewrite the buffer, as with a received message. */
+        memcpy(buf, wire, len);
+        if (mode == MODE_HEAP) {
+            error = ofl_msg_unpack(buf, len, &msg, &xid, NULL);
+        } else {
+            error = ofl_msg_unpack_arena(buf, len, &msg, &xid, NULL, arena);
+        }
+        if (error) {
+            ofp_fatal(0, "could not unpack the flow_mod");
+        }
+        if (mode == MODE_ARENA_COPY_OUT) {
+            ofl_msg_flow_mod_copy_out((struct ofl_msg_flow_mod *)msg);
+        }
+        ofl_msg_free(msg, NULL);
+        if (mode != MODE_HEAP) {
+            ofl_arena_reset(arena);
+        }
+    }
+
+    free(buf);
+    ofl_arena_destroy(arena);
+    return now_sec() - start;
+}
+
+int
+main(int argc, char *argv[])
+{
+    static const char *names[] = {"heap", "arena", "arena + copy-out"};
+    unsigned long n_msgs = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+    int n_actions = argc > 2 ? atoi(argv[2]) : 2;
+    uint8_t *wire;
+    size_t len;
+    int mode;
+
+    set_program_name(argv[0]);
+    time_init();
+    vlog_init();
+
+    if (n_msgs < 1 || n_actions < 1) {
+        ofp_fatal(0, "N_MSGS and N_ACTIONS must be at least 1");
+    }
+
+    build_flow_mod(n_actions, &wire, &len);
+    for (mode = MODE_HEAP; mode <= MODE_ARENA_COPY_OUT; mode++) {
+        double elapsed = run(mode, wire, len, n_msgs);
+        printf("%-16s %lu flow_mods of %zu bytes: %.3f s, %.0f msgs/s\n",
+               names[mode], n_msgs, len, elapsed, n_msgs / elapsed);
+    }
+
+    free(wire);
+    return 0;
+}